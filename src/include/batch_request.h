@@ -103,6 +103,12 @@ struct rq_manage {
 	pbs_list_head rq_attr; /* svrattrlist */
 };
 
+/* ModifyJobs - a ModifyJob_Async for each of a number of jobs */
+struct rq_modifyjobs {
+	int rq_count;
+	struct rq_manage **rq_jobs;
+};
+
 /* Management - used by PBS_BATCH_Manager requests */
 struct rq_management {
 	struct rq_manage rq_manager;
@@ -293,6 +299,7 @@ struct batch_request {
 		struct rq_relnodes rq_relnodes;
 		struct rq_py_spawn rq_py_spawn;
 		struct rq_manage rq_modify;
+		struct rq_modifyjobs rq_modifyjobs;
 		struct rq_move rq_move;
 		struct rq_register rq_register;
 		struct rq_manage rq_release;
@@ -358,6 +365,9 @@ extern void req_stat_sched(struct batch_request *);
 extern void req_trackjob(struct batch_request *);
 extern void req_stat_rsc(struct batch_request *);
 extern void req_preemptjobs(struct batch_request *);
+extern int resume_stat_requests(void);
+extern void flush_held_replies(int);
+extern void drop_held_reply(int);
 #else
 extern void req_cpyfile(struct batch_request *);
 extern void req_delfile(struct batch_request *);
@@ -411,6 +421,7 @@ extern int encode_DIS_Cred(int, char *, char *, int, char *, size_t, long);
 extern int dis_request_read(int, struct batch_request *);
 extern int dis_reply_read(int, struct batch_reply *, int);
 extern int decode_DIS_PreemptJobs(int, struct batch_request *);
+extern int decode_DIS_ModifyJobs(int, struct batch_request *);
 
 #ifdef __cplusplus
 }
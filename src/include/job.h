@@ -411,6 +411,27 @@ struct block_job_reply {
 #define	ji_taskid	ji_extended.ji_ext.ji_taskidx
 #define	ji_nodeid	ji_extended.ji_ext.ji_nodeidx
 
+#ifndef PBS_MOM
+/*
+ * The DIS encoded status of a job for one client privilege and one
+ * requested attribute list, kept so repeated status requests can send
+ * it as is.  See status_job().
+ */
+#define JOB_STCACHE_ALL		0	/* slot for "all attributes" */
+#define JOB_STCACHE_LIST	1	/* first of the slots for attribute lists */
+#define JOB_STCACHE_SLOTS	4
+
+struct job_stcache {
+	long		jsc_version;	/* ji_stversion when encoded */
+	int		jsc_perm;	/* client privilege encoded for */
+	long		jsc_hidden;	/* show_hidden_attribs when encoded */
+	long		jsc_elig;	/* eligible_time_enable when encoded */
+	time_t		jsc_used;	/* last sent, to pick a list slot to reuse */
+	char	       *jsc_attrs;	/* requested attribute names, or NULL */
+	struct brp_cache *jsc_enc;	/* the encoded job */
+};
+#endif /* PBS_MOM */
+
 enum bg_hook_request {
 	BG_NONE,
 	BG_IS_DISCARD_JOB,
@@ -514,6 +535,7 @@ struct job {
 	int		ji_terminated;	/* job terminated by deljob batch req */
 	int		ji_deletehistory; /* job history should not be saved */
 	pbs_list_head	ji_rejectdest;	/* list of rejected destinations */
+	pbs_list_link	ji_dbsave_link;	/* links to jobs with a deferred db save */
 	struct job     *ji_parentaj;	/* subjob:   parent Array Job */
 	struct ajtrkhd *ji_ajtrk;	/* ArrayJob: index tracking table */
 	int		ji_subjindx;	/* subjob:   its index into the table */
@@ -540,6 +562,9 @@ struct job {
 	int preempt_order_index;
 	struct work_task *ji_prov_startjob_task;
 
+	long		ji_stversion;	/* bumped when status finds a modified attribute */
+	struct job_stcache ji_stcache[JOB_STCACHE_SLOTS]; /* encoded status */
+
 #endif					/* END SERVER ONLY */
 
 	/*
@@ -1046,6 +1071,9 @@ extern int job_save_fs(job *);
 
 extern job *job_recov_db(char *, job *pjob);
 extern int job_save_db(job *);
+extern void job_save_db_batch_begin(void);
+extern int job_save_db_batch_end(void);
+extern int job_save_db_batch_pending(void);
 
 #define job_save  job_save_db
 #define job_recov job_recov_db
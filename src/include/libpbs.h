@@ -142,14 +142,28 @@ struct brp_select {
 	char brp_jobid[PBS_MAXSVRJOBID + 1];
 };
 
+/*
+ * DIS encoded form of one status object, shared by reference between the
+ * owner of the cache and any reply it is linked into.  A zero bc_len means
+ * it is still to be filled in by the encoder.
+ */
+struct brp_cache {
+	int bc_refct;	/* reference count */
+	size_t bc_len;	/* length of bc_data */
+	char *bc_data;	/* objtype, objname and attributes as sent */
+};
+
 /* reply to Status Job/Queue/Server Request */
 struct brp_status {
 	pbs_list_link brp_stlink;
 	int brp_objtype;
 	char brp_objname[(PBS_MAXSVRJOBID > PBS_MAXDEST ? PBS_MAXSVRJOBID : PBS_MAXDEST) + 1];
 	pbs_list_head brp_attr; /* head of svrattrlist */
+	struct brp_cache *brp_cache; /* if set, pre-encoded form of the object */
 };
 
+extern void free_brp_cache(struct brp_cache *);
+
 /* reply to Resource Query Request */
 struct brp_rescq {
 	int brq_number; /* number of items in following arrays */
@@ -274,6 +288,10 @@ struct batch_reply
 #define PBS_BATCH_Authenticate		95
 #define PBS_BATCH_ModifyJob_Async	96
 #define PBS_BATCH_AsyrunJob_ack	97
+#define PBS_BATCH_ModifyJobs_Async	98
+
+/* most jobs a server accepts in one ModifyJobs request */
+#define PBS_MAX_MODIFYJOBS		1024
 
 #define PBS_BATCH_FileOpt_Default	0
 #define PBS_BATCH_FileOpt_OFlg		1
@@ -315,6 +333,9 @@ extern int PBSD_msg_put(int, char *, int, char *, char *, int, char **);
 extern int PBSD_relnodes_put(int, char *, char *, char *, int, char **);
 extern int PBSD_py_spawn_put(int, char *, char **, char **, int, char **);
 extern int PBSD_sig_put(int, char *, char *, char *, int, char **);
+extern int PBSD_runjob_put(int, char *, char *, char *, int);
+extern int PBSD_runjob_get(int);
+extern int PBSD_modifyjobs_put(int, int, char **, struct attrl **, char *);
 extern int PBSD_term_put(int, int, char *);
 extern int PBSD_jobfile(int, int, char *, char *, enum job_file, int, char **);
 extern int PBSD_status_put(int, int, char *, struct attrl *, char *, int, char **);
@@ -354,6 +375,7 @@ extern int encode_DIS_attropl(int, struct attropl *);
 extern int encode_DIS_CopyHookFile(int, int, char *, int, char *);
 extern int encode_DIS_DelHookFile(int, char *);
 extern int encode_DIS_PreemptJobs(int, char **);
+extern int encode_DIS_ModifyJobs(int, int, char **, struct attrl **);
 extern char *PBSD_submit_resv(int, char *, struct attropl *, char *);
 extern int DIS_reply_read(int, struct batch_reply *, int);
 extern int tcp_pre_process(conn_t *);
@@ -317,6 +317,12 @@ void convert_duration_to_str(time_t duration, char* buf, int bufsize);
  */
 struct preempt_ordering *get_preemption_order(struct preempt_ordering *porder, int req, int used);
 
+/**
+ * 64 bit FNV-1a string hash.  Chain calls starting from PBS_HASH_INIT
+ */
+#define PBS_HASH_INIT 14695981039346656037ULL
+unsigned long long pbs_strhash(unsigned long long hash, const char *str);
+
 /**
  * Begin collecting performance stats (e.g. walltime)
  */
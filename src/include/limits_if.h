@@ -86,6 +86,10 @@ extern void	lim_free_liminfo(void *);
  *	@retval 0	no hard limits set
  *	@retval 1	at least one hard limit set
  *
+ *	@par	Also records which kinds of hard limits are set, so
+ *		check_limits() can skip the checks which can't fire.  Call it
+ *		after all the limits have been set.
+ *
  *	@par MT-safe:	No
  */
 extern int	has_hardlimits(void *);
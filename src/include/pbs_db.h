@@ -80,6 +80,10 @@ extern "C" {
 #define OBJ_SAVE_NEW    1   /* object is new, so whole object should be saved */
 #define OBJ_SAVE_QS     2   /* quick save area modified, it should be saved */
 
+/* how to end a transaction - see pbs_db_end_trx */
+#define PBS_DB_COMMIT   0
+#define PBS_DB_ROLLBACK 1
+
 /**
  * @brief
  * Following are a set of mapping of DATABASE vs C data types. These are
@@ -359,6 +363,35 @@ int pbs_db_disconnect(void *conn);
  */
 int pbs_db_save_obj(void *conn, pbs_db_obj_info_t *obj, int savetype);
 
+/**
+ * @brief
+ *	Start a transaction. Transactions nest, only the outermost
+ *	begin and end reach the database.
+ *
+ * @param[in]	conn - Connected database handle
+ *
+ * @return      int
+ * @retval      -1  - Failure
+ * @retval       0  - success
+ *
+ */
+int pbs_db_begin_trx(void *conn);
+
+/**
+ * @brief
+ *	End a transaction started with pbs_db_begin_trx. If any nested
+ *	transaction asked for a rollback, the outermost one is rolled back.
+ *
+ * @param[in]	conn - Connected database handle
+ * @param[in]	commit - PBS_DB_COMMIT or PBS_DB_ROLLBACK
+ *
+ * @return      int
+ * @retval      -1  - Failure or rolled back
+ * @retval       0  - success
+ *
+ */
+int pbs_db_end_trx(void *conn, int commit);
+
 /**
  * @brief
  *	Delete an existing object from the database
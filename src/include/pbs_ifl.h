@@ -305,6 +305,7 @@ extern "C" {
 #define ATTR_license_max	"pbs_license_max"
 #define ATTR_license_linger	"pbs_license_linger_time"
 #define ATTR_license_count	"license_count"
+#define ATTR_job_save_stats	"job_save_stats"
 #define ATTR_job_sort_formula	"job_sort_formula"
 #define ATTR_EligibleTimeEnable "eligible_time_enable"
 #define ATTR_resv_retry_time	"reserve_retry_time"
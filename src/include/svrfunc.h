@@ -209,6 +209,7 @@ extern void complete_running(job *);
 extern void am_jobs_add(job *);
 extern int was_job_alteredmoved(job *);
 extern void check_failed_attempts(job *);
+extern void free_job_stcache(job *);
 #endif
 #ifdef _QUEUE_H
 extern int check_entity_ct_limit_max(job *, pbs_queue *);
@@ -265,6 +266,7 @@ extern void req_messagejob(struct batch_request *);
 extern void req_py_spawn(struct batch_request *);
 extern void req_relnodesjob(struct batch_request *);
 extern void req_modifyjob(struct batch_request *);
+extern void req_modifyjobs(struct batch_request *);
 extern void req_modifyReservation(struct batch_request *);
 extern void req_orderjob(struct batch_request *);
 extern void req_rescreserve(struct batch_request *);
@@ -306,6 +308,7 @@ extern int   removefiles_action(attribute *pattr, void *pobject, int actmode);
 /* Functions below exposed as they are now accessed by the Python hooks */
 extern void update_state_ct(attribute *, int *, char *);
 extern void update_license_ct(attribute *, char *);
+extern void update_job_save_ct(attribute *);
 
 #ifdef _PBS_JOB_H
 extern int job_set_wait(attribute *, void *, int);
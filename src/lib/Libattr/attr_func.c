@@ -209,6 +209,8 @@ free_null(struct attribute *attr)
 	if (attr->at_type == ATR_TYPE_SIZE)
 		attr->at_val.at_size.atsv_shift = 10;
 	attr->at_flags &= ~(ATR_VFLAG_SET|ATR_VFLAG_INDIRECT|ATR_VFLAG_TARGET);
+	/* the value is gone, so is any encoded form of the object holding it */
+	attr->at_flags |= ATR_VFLAG_MODCACHE;
 	if (attr->at_user_encoded != NULL || attr->at_priv_encoded != NULL)
 		free_svrcache(attr);
 }
@@ -574,6 +576,7 @@ free_none(struct attribute *attr)
 {
 	/* do nothing */
 	/* to be used for accrue_type attribute of job */
+	attr->at_flags |= ATR_VFLAG_MODCACHE;
 	if (attr->at_user_encoded != NULL || attr->at_priv_encoded != NULL) {
 		free_svrcache(attr);
 	}
@@ -174,26 +174,34 @@ db_initialize_state(void *conn, query_cb_t query_cb)
 	state->res = NULL;
 	state->row = -1;
 	state->query_cb = query_cb;
+	state->cursor = NULL;
 	return state;
 }
 
 /**
  * @brief
  *	Destroy a query state variable.
- *	Clears the database resultset and free's the memory allocated to
- *	the state variable
+ *	Clears the database resultset, closes the cursor if the rows came
+ *	from one and free's the memory allocated to the state variable
  *
+ * @param[in]	conn - Database connection handle
  * @param[in]	st - Pointer to the state variable
  *
  * @return void
  */
 static void
-db_destroy_state(void *st)
+db_destroy_state(void *conn, void *st)
 {
 	db_query_state_t *state = st;
+	char sql[MAX_SQL_LENGTH];
+
 	if (state) {
 		if (state->res)
 			PQclear(state->res);
+		if (state->cursor) {
+			snprintf(sql, sizeof(sql), "close %s", state->cursor);
+			db_execute_str(conn, sql);
+		}
 		free(state);
 	}
 }
@@ -233,7 +241,7 @@ pbs_db_search(void *conn, pbs_db_obj_info_t *obj, pbs_db_query_options_t *opts,
 	ret = db_fn_arr[obj->pbs_db_obj_type].pbs_db_find_obj(conn, st, obj, opts);
 	if (ret == -1) {
 		/* error in executing the sql */
-		db_destroy_state(st);
+		db_destroy_state(conn, st);
 		return -1;
 	}
 	totcount = 0;
@@ -243,7 +251,11 @@ pbs_db_search(void *conn, pbs_db_obj_info_t *obj, pbs_db_query_options_t *opts,
 			totcount++;
 	}
 
-	db_destroy_state(st);
+	/* rows streamed from a cursor may have been lost to a failed fetch */
+	if (rc == -1 && ((db_query_state_t *) st)->cursor != NULL)
+		totcount = -1;
+
+	db_destroy_state(conn, st);
 	return totcount;
 }
 
@@ -270,6 +282,12 @@ db_cursor_next(void *conn, void *st, pbs_db_obj_info_t *obj)
 	db_query_state_t *state = (db_query_state_t *)st;
 	int ret;
 
+	/* a full batch from a cursor may be followed by more rows */
+	if (state->cursor != NULL && state->row >= state->count && state->count == DB_CURSOR_FETCH_SIZE) {
+		if ((ret = db_cursor_fetch(conn, state)) != 0)
+			return ret;
+	}
+
 	if (state->row < state->count) {
 		ret = db_fn_arr[obj->pbs_db_obj_type].pbs_db_next_obj(conn, st, obj);
 		state->row++;
@@ -278,6 +296,81 @@ db_cursor_next(void *conn, void *st, pbs_db_obj_info_t *obj)
 	return 1; /* no more rows */
 }
 
+/**
+ * @brief
+ *	Open a server side cursor for a query and fetch the first batch of
+ *	rows into the query state. Later batches are fetched by
+ *	db_cursor_next as the rows are used, so a large resultset is never
+ *	held in memory at once. The cursor is declared WITH HOLD, so other
+ *	statements can run on the connection between the fetches.
+ *
+ * @param[in]	conn - Connected database handle
+ * @param[in,out]	state - The cursor state handle
+ * @param[in]	name - Name of the cursor
+ * @param[in]	sql - The query
+ *
+ * @return	Error code
+ * @retval	-1  - Failure
+ * @retval	 0  - Success
+ * @retval	 1  - Success but no rows
+ */
+int
+db_cursor_open(void *conn, db_query_state_t *state, char *name, char *sql)
+{
+	char *decl = NULL;
+	int rc;
+
+	if (pbs_asprintf(&decl, "declare %s no scroll cursor with hold for %s", name, sql) == -1)
+		return -1;
+	rc = db_execute_str(conn, decl);
+	free(decl);
+	if (rc == -1)
+		return -1;
+
+	state->cursor = name;
+	return (db_cursor_fetch(conn, state));
+}
+
+/**
+ * @brief
+ *	Fetch the next batch of rows from the query's cursor. Rows are
+ *	fetched in binary format, like the results of prepared queries.
+ *
+ * @param[in]	conn - Connected database handle
+ * @param[in,out]	state - The cursor state handle
+ *
+ * @return	Error code
+ * @retval	-1  - Failure
+ * @retval	 0  - Success
+ * @retval	 1  - Success but no more rows
+ */
+int
+db_cursor_fetch(void *conn, db_query_state_t *state)
+{
+	char sql[MAX_SQL_LENGTH];
+
+	if (state->res)
+		PQclear(state->res);
+	state->row = 0;
+	state->count = 0;
+
+	snprintf(sql, sizeof(sql), "fetch forward %d from %s", DB_CURSOR_FETCH_SIZE, state->cursor);
+	state->res = PQexecParams((PGconn *) conn, sql, 0, NULL, NULL, NULL, NULL, 1);
+	if (PQresultStatus(state->res) != PGRES_TUPLES_OK) {
+		char *sql_error = PQresultErrorField(state->res, PG_DIAG_SQLSTATE);
+		db_set_error(conn, &errmsg_cache, "Fetch from cursor", state->cursor, sql_error);
+		PQclear(state->res);
+		state->res = NULL;
+		return -1;
+	}
+
+	state->count = PQntuples(state->res);
+	if (state->count <= 0)
+		return 1;
+
+	return 0;
+}
+
 /**
  * @brief
  *	Delete an existing object from the database
@@ -889,6 +982,68 @@ pbs_db_save_obj(void *conn, pbs_db_obj_info_t *obj, int savetype)
 	return (db_fn_arr[obj->pbs_db_obj_type].pbs_db_save_obj(conn, obj, savetype));
 }
 
+/**
+ * @brief
+ *	Start a transaction. Transactions nest, only the outermost
+ *	begin sends a BEGIN to the database.
+ *
+ * @param[in]	conn - Connected database handle
+ *
+ * @return      Error code
+ * @retval	-1  - Failure
+ * @retval	 0  - Success
+ *
+ */
+int
+pbs_db_begin_trx(void *conn)
+{
+	if (conn_trx->conn_trx_nest == 0) {
+		if (db_execute_str(conn, "BEGIN") == -1)
+			return -1;
+		conn_trx->conn_trx_rollback = 0;
+	}
+	conn_trx->conn_trx_nest++;
+
+	return 0;
+}
+
+/**
+ * @brief
+ *	End a transaction. Only the outermost end reaches the database,
+ *	it rolls back if this or any nested end asked for a rollback.
+ *
+ * @param[in]	conn - Connected database handle
+ * @param[in]	commit - PBS_DB_COMMIT or PBS_DB_ROLLBACK
+ *
+ * @return      Error code
+ * @retval	-1  - Failure, or the transaction was rolled back
+ * @retval	 0  - Success
+ *
+ */
+int
+pbs_db_end_trx(void *conn, int commit)
+{
+	if (conn_trx->conn_trx_nest == 0)
+		return -1;
+
+	if (commit == PBS_DB_ROLLBACK)
+		conn_trx->conn_trx_rollback = 1;
+
+	if (--conn_trx->conn_trx_nest > 0)
+		return 0;
+
+	/* a failed statement aborts the whole transaction, COMMIT would only roll it back */
+	if (conn_trx->conn_trx_rollback || PQtransactionStatus((PGconn *) conn) == PQTRANS_INERROR) {
+		db_execute_str(conn, "ROLLBACK");
+		return -1;
+	}
+
+	if (db_execute_str(conn, "COMMIT") == -1)
+		return -1;
+
+	return 0;
+}
+
 /**
  * @brief
  *	Delete attributes of an object from the database
@@ -47,6 +47,37 @@
 #include "pbs_db.h"
 #include "db_postgres.h"
 
+/* columns of a job row, in the form load_job() reads them */
+#define FIND_JOBS_COLUMNS \
+	"ji_jobid," \
+	"ji_state," \
+	"ji_substate," \
+	"ji_svrflags," \
+	"ji_numattr," \
+	"ji_ordering," \
+	"ji_priority," \
+	"ji_stime," \
+	"ji_endtBdry," \
+	"ji_queue," \
+	"ji_destin," \
+	"ji_un_type," \
+	"ji_momaddr," \
+	"ji_momport," \
+	"ji_exitstat," \
+	"ji_quetime," \
+	"ji_rteretry," \
+	"ji_fromsock," \
+	"ji_fromaddr," \
+	"ji_4jid," \
+	"ji_4ash," \
+	"ji_credtype," \
+	"ji_qrank," \
+	"hstore_to_array(attributes) as attributes "
+
+/* all jobs, streamed from a cursor at recovery */
+#define FIND_JOBS_SQL "select " FIND_JOBS_COLUMNS "from pbs.job order by ji_qrank"
+#define FIND_JOBS_CURSOR "pbs_find_jobs"
+
 /**
  * @brief
  *	Prepare all the job related sqls. Typically called after connect
@@ -228,59 +259,7 @@ db_prepare_job_sqls(void *conn)
 		return -1;
 
 	snprintf(conn_sql, MAX_SQL_LENGTH, "select "
-		"ji_jobid,"
-		"ji_state,"
-		"ji_substate,"
-		"ji_svrflags,"
-		"ji_numattr,"
-		"ji_ordering,"
-		"ji_priority,"
-		"ji_stime,"
-		"ji_endtBdry,"
-		"ji_queue,"
-		"ji_destin,"
-		"ji_un_type,"
-		"ji_momaddr,"
-		"ji_momport,"
-		"ji_exitstat,"
-		"ji_quetime,"
-		"ji_rteretry,"
-		"ji_fromsock,"
-		"ji_fromaddr,"
-		"ji_4jid,"
-		"ji_4ash,"
-		"ji_credtype,"
-		"ji_qrank,"
-		"hstore_to_array(attributes) as attributes "
-		"from pbs.job order by ji_qrank");
-	if (db_prepare_stmt(conn, STMT_FINDJOBS_ORDBY_QRANK, conn_sql, 0) != 0)
-		return -1;
-
-	snprintf(conn_sql, MAX_SQL_LENGTH, "select "
-		"ji_jobid,"
-		"ji_state,"
-		"ji_substate,"
-		"ji_svrflags,"
-		"ji_numattr,"
-		"ji_ordering,"
-		"ji_priority,"
-		"ji_stime,"
-		"ji_endtBdry,"
-		"ji_queue,"
-		"ji_destin,"
-		"ji_un_type,"
-		"ji_momaddr,"
-		"ji_momport,"
-		"ji_exitstat,"
-		"ji_quetime,"
-		"ji_rteretry,"
-		"ji_fromsock,"
-		"ji_fromaddr,"
-		"ji_4jid,"
-		"ji_4ash,"
-		"ji_credtype,"
-		"ji_qrank,"
-		"hstore_to_array(attributes) as attributes "
+		FIND_JOBS_COLUMNS
 		"from pbs.job where ji_queue = $1"
 		" order by ji_qrank");
 	if (db_prepare_stmt(conn, STMT_FINDJOBS_BYQUE_ORDBY_QRANK,
@@ -528,8 +507,8 @@ pbs_db_find_job(void *conn, void *st, pbs_db_obj_info_t *obj,
 		params=1;
 		strcpy(conn_sql, STMT_FINDJOBS_BYQUE_ORDBY_QRANK);
 	} else {
-		strcpy(conn_sql, STMT_FINDJOBS_ORDBY_QRANK);
-		params=0;
+		/* all jobs, stream them in batches instead of holding the whole table in memory */
+		return (db_cursor_open(conn, state, FIND_JOBS_CURSOR, FIND_JOBS_SQL));
 	}
 
 	if ((rc = db_query(conn, conn_sql, params, &res)) != 0)
@@ -88,7 +88,6 @@ extern "C" {
 #define STMT_UPDATE_JOB "update_job"
 #define STMT_UPDATE_JOB_ATTRSONLY "update_job_attrsonly"
 #define STMT_UPDATE_JOB_QUICK "update_job_quick"
-#define STMT_FINDJOBS_ORDBY_QRANK "findjobs_ordby_qrank"
 #define STMT_FINDJOBS_BYQUE_ORDBY_QRANK "findjobs_byque_ordby_qrank"
 #define STMT_DELETE_JOB "delete_job"
 #define STMT_REMOVE_JOBATTRS "remove_jobattrs"
@@ -212,6 +211,7 @@ struct db_query_state {
 	int row;
 	int count;
 	query_cb_t query_cb;
+	char *cursor;	/* server side cursor the rows are fetched from in batches, or NULL */
 };
 typedef struct db_query_state db_query_state_t;
 
@@ -326,6 +326,9 @@ typedef struct postgres_db_fn pg_db_fn_t;
 
 #define FIND_JOBS_BY_QUE 1
 
+/* number of rows fetched at a time from a server side cursor */
+#define DB_CURSOR_FETCH_SIZE 10000
+
 /* common functions */
 int db_prepare_job_sqls(void *conn);
 int db_prepare_resv_sqls(void *conn);
@@ -338,6 +341,8 @@ void db_set_error(void *conn, char **conn_db_err, char *fnc, char *msg, char *ms
 int db_prepare_stmt(void *conn, char *stmt, char *sql, int num_vars);
 int db_cmd(void *conn, char *stmt, int num_vars);
 int db_query(void *conn, char *stmt, int num_vars, PGresult **res);
+int db_cursor_open(void *conn, db_query_state_t *state, char *name, char *sql);
+int db_cursor_fetch(void *conn, db_query_state_t *state);
 unsigned long long db_ntohll(unsigned long long);
 int dbarray_to_attrlist(char *raw_array, pbs_db_attr_list_t *attr_list);
 int attrlist_to_dbarray(char **raw_array, pbs_db_attr_list_t *attr_list);
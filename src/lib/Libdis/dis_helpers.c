@@ -808,6 +808,41 @@ dis_flush(int fd)
 	return 0;
 }
 
+/**
+ * @brief
+ * 	dis_get_writedata - return the start of the write buffer associated with fd
+ *
+ *	Lets a caller copy out the bytes it has just encoded, by noting the
+ *	buffer length before and after encoding.  The pointer is only valid
+ *	until the next write to or flush of the buffer.
+ *
+ * @param[in] fd - file descriptor
+ * @param[out] len - number of bytes currently in the write buffer
+ *
+ * @return char *
+ *
+ * @retval !NULL - start of the write buffer
+ * @retval NULL - no channel associated with fd
+ *
+ * @par Side Effects:
+ *	None
+ *
+ * @par MT-safe: Yes
+ *
+ */
+char *
+dis_get_writedata(int fd, size_t *len)
+{
+	pbs_dis_buf_t *tp = dis_get_writebuf(fd);
+
+	if (tp == NULL) {
+		*len = 0;
+		return NULL;
+	}
+	*len = tp->tdis_len;
+	return tp->tdis_data;
+}
+
 /**
  * @brief
  * 	dis_destroy_chan - release structures associated with fd
@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) 1994-2020 Altair Engineering, Inc.
+ * For more information, contact Altair at www.altair.com.
+ *
+ * This file is part of both the OpenPBS software ("OpenPBS")
+ * and the PBS Professional ("PBS Pro") software.
+ *
+ * Open Source License Information:
+ *
+ * OpenPBS is free software. You can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * OpenPBS is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Affero General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Commercial License Information:
+ *
+ * PBS Pro is commercially licensed software that shares a common core with
+ * the OpenPBS software.  For a copy of the commercial license terms and
+ * conditions, go to: (http://www.pbspro.com/agreement.html) or contact the
+ * Altair Legal Department.
+ *
+ * Altair's dual-license business model allows companies, individuals, and
+ * organizations to create proprietary derivative works of OpenPBS and
+ * distribute them - whether embedded or bundled with other software -
+ * under a commercial license agreement.
+ *
+ * Use of Altair's trademarks, including but not limited to "PBS™",
+ * "OpenPBS®", "PBS Professional®", and "PBS Pro™" and Altair's logos is
+ * subject to Altair's trademark licensing policies.
+ */
+
+
+/**
+ * @file	dec_ModifyJobs.c
+ * @brief
+ * decode_DIS_ModifyJobs() - decode a Modify Jobs Batch Request
+ *
+ *	The batch_request structure must already exist (be allocated by the
+ *	caller.   It is assumed that the header fields (protocol type,
+ *	protocol version, request type, and user name) have already be decoded.
+ *
+ * @par	Data items are:
+ *			unsigned int	number of jobs
+ *		for each job:
+ *			string		job id
+ *			attropl		attributes to set
+ */
+
+#include <pbs_config.h>   /* the master config generated by configure */
+
+#include <sys/types.h>
+#include <stdlib.h>
+#include "libpbs.h"
+#include "list_link.h"
+#include "server_limits.h"
+#include "attribute.h"
+#include "credential.h"
+#include "batch_request.h"
+#include "dis.h"
+#include "pbs_error.h"
+
+/**
+ * @brief
+ *	-decode a Modify Jobs Batch Request
+ *
+ * @par	Each job is decoded into an rq_manage as if it came in its own
+ *	ModifyJob request.  The job count comes from the client, so no more
+ *	than PBS_MAX_MODIFYJOBS jobs are accepted and space is only
+ *	allocated for jobs as they are actually read.
+ *
+ * @param[in] sock - socket descriptor
+ * @param[out] preq - pointer to batch_request structure
+ *
+ * @return      int
+ * @retval      DIS_SUCCESS(0)  success
+ * @retval      PBSE_PROTOCOL	too many jobs in the request
+ * @retval      error code      error
+ */
+int
+decode_DIS_ModifyJobs(int sock, struct batch_request *preq)
+{
+	int rc;
+	int count;
+	int size = 0;
+	struct rq_manage *pmgr;
+	struct rq_manage **jobs;
+	struct rq_modifyjobs *pmjs = &preq->rq_ind.rq_modifyjobs;
+
+	pmjs->rq_count = 0;
+	pmjs->rq_jobs = NULL;
+
+	count = disrui(sock, &rc);
+	if (rc)
+		return rc;
+	if ((count < 0) || (count > PBS_MAX_MODIFYJOBS))
+		return PBSE_PROTOCOL;
+
+	/*
+	 * rq_count only covers jobs that were allocated, so the request's
+	 * destructor frees what was decoded on error
+	 */
+	while (pmjs->rq_count < count) {
+		if (pmjs->rq_count == size) {
+			size = size ? size * 2 : 16;
+			jobs = realloc(pmjs->rq_jobs, size * sizeof(struct rq_manage *));
+			if (jobs == NULL)
+				return DIS_NOMALLOC;
+			pmjs->rq_jobs = jobs;
+		}
+		pmgr = malloc(sizeof(struct rq_manage));
+		if (pmgr == NULL)
+			return DIS_NOMALLOC;
+		pmgr->rq_cmd = MGR_CMD_SET;
+		pmgr->rq_objtype = MGR_OBJ_JOB;
+		CLEAR_HEAD(pmgr->rq_attr);
+		pmjs->rq_jobs[pmjs->rq_count++] = pmgr;
+
+		rc = disrfst(sock, PBS_MAXSVRJOBID+1, pmgr->rq_objname);
+		if (rc)
+			return rc;
+		rc = decode_DIS_svrattrl(sock, &pmgr->rq_attr);
+		if (rc)
+			return rc;
+	}
+
+	return DIS_SUCCESS;
+}
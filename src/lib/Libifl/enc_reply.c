@@ -50,6 +50,8 @@
 
 #include <pbs_config.h>   /* the master config generated by configure */
 
+#include <stdlib.h>
+#include <string.h>
 #include "libpbs.h"
 #include "list_link.h"
 #include "attribute.h"
@@ -59,6 +61,76 @@
 int encode_DIS_svrattrl(int sock, svrattrl *psattl);
 
 
+/**
+ * @brief
+ *	free_brp_cache - drop a reference to a pre-encoded status object,
+ *	freeing it when the last reference goes
+ *
+ * @param[in] pc - pointer to brp_cache structure, may be NULL
+ *
+ * @return void
+ */
+void
+free_brp_cache(struct brp_cache *pc)
+{
+	if ((pc == NULL) || (--pc->bc_refct > 0))
+		return;
+	free(pc->bc_data);
+	free(pc);
+}
+
+/**
+ * @brief
+ *	encode one object of a status reply: type, name and attribute list
+ *
+ *	If the object carries a filled in brp_cache, its bytes are written
+ *	as they are instead.  If it carries an empty one, the bytes written
+ *	for the object are copied into it for use by later replies.
+ *
+ * @param[in] sock - socket descriptor
+ * @param[in] pstat - pointer to brp_status structure
+ *
+ * @return      int
+ * @retval      0       Success
+ * @retval      !0      DIS error
+ *
+ */
+static int
+encode_DIS_status_obj(int sock, struct brp_status *pstat)
+{
+	struct brp_cache *pc = pstat->brp_cache;
+	size_t start = 0;
+	size_t end;
+	char *buf;
+	int rc;
+
+	if ((pc != NULL) && (pc->bc_len > 0)) {
+		if (dis_puts(sock, pc->bc_data, pc->bc_len) != (int) pc->bc_len)
+			return DIS_PROTO;
+		return 0;
+	}
+
+	if (pc != NULL)
+		(void) dis_get_writedata(sock, &start);
+
+	if ((rc = diswui(sock, pstat->brp_objtype)) || (rc = diswst(sock, pstat->brp_objname)))
+		return rc;
+	if ((rc = encode_DIS_svrattrl(sock, (svrattrl *) GET_NEXT(pstat->brp_attr))) != 0)
+		return rc;
+
+	/* keep a copy of what was just encoded, not fatal if it can't be kept */
+	if (pc != NULL) {
+		buf = dis_get_writedata(sock, &end);
+		if ((buf != NULL) && (pc->bc_data == NULL) && (start > 0) && (end > start)) {
+			if ((pc->bc_data = malloc(end - start)) != NULL) {
+				memcpy(pc->bc_data, buf + start, end - start);
+				pc->bc_len = end - start;
+			}
+		}
+	}
+	return 0;
+}
+
 /**
  * @brief-
  *      encode a Batch Protocol Reply Structure for a Command
@@ -82,7 +154,6 @@ encode_DIS_reply_inner(int sock, struct batch_reply *reply)
 	int i;
 	struct brp_select *psel;
 	struct brp_status *pstat;
-	svrattrl *psvrl;
 	preempt_job_info *ppj;
 
 	int rc;
@@ -135,11 +206,7 @@ encode_DIS_reply_inner(int sock, struct batch_reply *reply)
 				return rc;
 			pstat = (struct brp_status *) GET_NEXT(reply->brp_un.brp_status);
 			while (pstat) {
-				if ((rc = diswui(sock, pstat->brp_objtype)) || (rc = diswst(sock, pstat->brp_objname)))
-					return rc;
-
-				psvrl = (svrattrl *) GET_NEXT(pstat->brp_attr);
-				if ((rc = encode_DIS_svrattrl(sock, psvrl)) != 0)
+				if ((rc = encode_DIS_status_obj(sock, pstat)) != 0)
 					return rc;
 				pstat = (struct brp_status *) GET_NEXT(pstat->brp_stlink);
 			}
@@ -203,3 +203,45 @@ __pbs_asyalterjob(int c, char *jobid, struct attrl *attrib, char *extend)
 	return i;
 
 }
+
+/**
+ * @brief	Send a Modify Jobs request to the server, Asynchronously
+ *
+ * @par	The request sets the attributes of a number of jobs at once.  The
+ *	server treats it as a ModifyJob_Async request for each job, so no
+ *	reply is sent.  The caller is responsible for locking the connection.
+ *
+ * @param[in] c - connection handle
+ * @param[in] count - number of jobs
+ * @param[in] jobids - job identifiers
+ * @param[in] attribs - attribute list to set on each job
+ * @param[in] extend - extend string for encoding req
+ *
+ * @return	int
+ * @retval	0	success
+ * @retval	!0	error
+ *
+ */
+int
+PBSD_modifyjobs_put(int c, int count, char **jobids, struct attrl **attribs, char *extend)
+{
+	int rc;
+
+	if (count <= 0 || count > PBS_MAX_MODIFYJOBS || jobids == NULL || attribs == NULL)
+		return (pbs_errno = PBSE_IVALREQ);
+
+	DIS_tcp_funcs();
+
+	if ((rc = encode_DIS_ReqHdr(c, PBS_BATCH_ModifyJobs_Async, pbs_current_user)) ||
+		(rc = encode_DIS_ModifyJobs(c, count, jobids, attribs)) ||
+		(rc = encode_DIS_ReqExtend(c, extend))) {
+		if (set_conn_errtxt(c, dis_emsg[rc]) != 0)
+			return (pbs_errno = PBSE_SYSTEM);
+		return (pbs_errno = PBSE_PROTOCOL);
+	}
+
+	if (dis_flush(c))
+		return (pbs_errno = PBSE_PROTOCOL);
+
+	return 0;
+}
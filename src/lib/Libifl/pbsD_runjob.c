@@ -50,20 +50,27 @@
 #include "pbs_ecl.h"
 
 /**
- * @brief	Helper function for pbs_asynrunjob and pbs_asynrunjob_ack
+ * @brief
+ *	-send a run job batch request without reading the reply
+ *
+ * @par	The caller is responsible for locking the connection and for
+ *	reading the reply with PBSD_runjob_get() if the request type has one.
+ *	Replies to PBS_BATCH_AsyrunJob_ack requests are sent before the server
+ *	contacts MoM, so several requests can be outstanding on one connection
+ *	and their replies are read back in the order they were sent.
  *
  * @param[in] c - connection handle
  * @param[in] jobid- job identifier
  * @param[in] location - string of vnodes/resources to be allocated to the job
  * @param[in] extend - extend string for encoding req
- * @param[in] req_type - one of PBS_BATCH_AsyrunJob or PBS_BATCH_AsyrunJob_ack
+ * @param[in] req_type - one of PBS_BATCH_RunJob, PBS_BATCH_AsyrunJob or PBS_BATCH_AsyrunJob_ack
  *
  * @return      int
  * @retval      0       success
  * @retval      !0      error
  */
-static int
-__runjob_helper(int c, char *jobid, char *location, char *extend, int req_type)
+int
+PBSD_runjob_put(int c, char *jobid, char *location, char *extend, int req_type)
 {
 	int rc = 0;
 	unsigned long resch = 0;
@@ -73,15 +80,6 @@ __runjob_helper(int c, char *jobid, char *location, char *extend, int req_type)
 	if (location == NULL)
 		location = "";
 
-	/* initialize the thread context data, if not already initialized */
-	if (pbs_client_thread_init_thread_context() != 0)
-		return pbs_errno;
-
-	/* lock pthread mutex here for this connection */
-	/* blocking call, waits for mutex release */
-	if (pbs_client_thread_lock_connection(c) != 0)
-		return pbs_errno;
-
 	/* setup DIS support routines for following DIS calls */
 
 	DIS_tcp_funcs();
@@ -96,25 +94,76 @@ __runjob_helper(int c, char *jobid, char *location, char *extend, int req_type)
 		else
 			pbs_errno = PBSE_PROTOCOL;
 
-		pbs_client_thread_unlock_connection(c);
 		return pbs_errno;
 	}
 
-	if (dis_flush(c)) {
-		pbs_errno = PBSE_PROTOCOL;
-		pbs_client_thread_unlock_connection(c);
+	if (dis_flush(c))
+		return (pbs_errno = PBSE_PROTOCOL);
+
+	return 0;
+}
+
+/**
+ * @brief
+ *	-read the reply to a run job batch request sent by PBSD_runjob_put()
+ *
+ * @param[in] c - connection handle
+ *
+ * @return      int
+ * @retval      0       success
+ * @retval      !0      error code of the run request
+ */
+int
+PBSD_runjob_get(int c)
+{
+	struct batch_reply *reply;
+	int rc;
+
+	reply = PBSD_rdrpy(c);
+	rc = get_conn_errno(c);
+	PBSD_FreeReply(reply);
+
+	return rc;
+}
+
+/**
+ * @brief	Helper function for pbs_asynrunjob and pbs_asynrunjob_ack
+ *
+ * @param[in] c - connection handle
+ * @param[in] jobid- job identifier
+ * @param[in] location - string of vnodes/resources to be allocated to the job
+ * @param[in] extend - extend string for encoding req
+ * @param[in] req_type - one of PBS_BATCH_AsyrunJob or PBS_BATCH_AsyrunJob_ack
+ *
+ * @return      int
+ * @retval      0       success
+ * @retval      !0      error
+ */
+static int
+__runjob_helper(int c, char *jobid, char *location, char *extend, int req_type)
+{
+	int rc = 0;
+
+	if ((jobid == NULL) || (*jobid == '\0'))
+		return (pbs_errno = PBSE_IVALREQ);
+
+	/* initialize the thread context data, if not already initialized */
+	if (pbs_client_thread_init_thread_context() != 0)
 		return pbs_errno;
-	}
 
-	if (req_type != PBS_BATCH_AsyrunJob) {
-		struct batch_reply *reply = NULL;
+	/* lock pthread mutex here for this connection */
+	/* blocking call, waits for mutex release */
+	if (pbs_client_thread_lock_connection(c) != 0)
+		return pbs_errno;
 
-		/* Get reply */
-		reply = PBSD_rdrpy(c);
-		rc = get_conn_errno(c);
-		PBSD_FreeReply(reply);
+	if ((rc = PBSD_runjob_put(c, jobid, location, extend, req_type)) != 0) {
+		pbs_client_thread_unlock_connection(c);
+		return rc;
 	}
 
+	if (req_type != PBS_BATCH_AsyrunJob)
+		rc = PBSD_runjob_get(c);
+
 	/* unlock the thread lock and update the thread context data */
 	if (pbs_client_thread_unlock_connection(c) != 0)
 		return pbs_errno;
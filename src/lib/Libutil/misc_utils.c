@@ -1621,6 +1621,35 @@ get_preemption_order(struct preempt_ordering *porder, int req, int used)
 	return po;
 }
 
+/**
+ * @brief
+ *	pbs_strhash - fold a string into a running 64 bit FNV-1a hash.
+ *	Calls can be chained to hash several strings into one value.
+ *	Start a new hash with PBS_HASH_INIT.
+ *
+ * @param[in]	hash - hash value to continue from
+ * @param[in]	str - string to add to the hash (NULL is hashed as "")
+ *
+ * @return	unsigned long long
+ * @retval	the new hash value
+ */
+unsigned long long
+pbs_strhash(unsigned long long hash, const char *str)
+{
+	const unsigned char *p;
+
+	if (str != NULL) {
+		for (p = (const unsigned char *) str; *p != '\0'; p++) {
+			hash ^= *p;
+			hash *= 1099511628211ULL;
+		}
+	}
+	/* hash the terminator so "ab","c" and "a","bc" differ */
+	hash *= 1099511628211ULL;
+
+	return hash;
+}
+
 #ifdef WIN32
 /**
  * @brief
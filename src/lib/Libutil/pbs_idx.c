@@ -37,18 +37,805 @@
  * subject to Altair's trademark licensing policies.
  */
 
+/**
+ * @file	pbs_idx.c
+ *
+ * @brief
+ *	Generic index used by the daemons to look up objects by key.
+ *
+ * @par
+ *	Every entry is allocated once, when it is inserted, and holds its own
+ *	copy of the key.  Exact key lookups go through an open addressing
+ *	hash table (linear probing) so they never allocate, and never write
+ *	to the index.  The same entries are also kept in a B+tree whose leaves
+ *	are chained in key order, which gives the ordered iteration (and the
+ *	grouping of duplicate keys) that callers get from pbs_idx_find() with
+ *	an iteration context.  Indexes which allow duplicate keys have no hash
+ *	table, all their lookups go through the B+tree.
+ *
+ * @par
+ *	As with any index, concurrent lookups are safe but updates need to be
+ *	serialized by the caller.  Entries other than the current one must not
+ *	be deleted while an iteration context is in use; the current one can
+ *	be deleted with pbs_idx_delete_byctx() and the iteration continued.
+ *
+ * Functions included are:
+ *	pbs_idx_create()
+ *	pbs_idx_destroy()
+ *	pbs_idx_insert()
+ *	pbs_idx_delete()
+ *	pbs_idx_delete_byctx()
+ *	pbs_idx_find()
+ *	pbs_idx_free_ctx()
+ */
+
 #include "pbs_idx.h"
-#include "avltree.h"
+#include <ctype.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
+
+#define IDX_NODE_MAX  32 /* max entries in a B+tree leaf, or children of an internal node */
+#define IDX_MAX_DEPTH 32 /* max internal levels of a B+tree */
+#define IDX_HASH_MIN  16 /* initial number of hash slots, must be a power of 2 */
+
+/* an entry in the index */
+typedef struct idx_entry {
+	void *data;	    /* data of entry */
+	unsigned int hash;  /* hash of key, see idx_hash() */
+	unsigned int keysz; /* size of key, including the terminator of string keys */
+	char key[1];	    /* key, actually keysz bytes long */
+} idx_entry;
+
+/* a slot of the hash table */
+typedef struct idx_slot {
+	unsigned int hash; /* hash of ent's key, saves comparing keys on a mismatch */
+	idx_entry *ent;	   /* entry in slot, NULL for an empty slot */
+} idx_slot;
+
+/* a B+tree node */
+typedef struct idx_node {
+	int leaf;			     /* non-zero for a leaf */
+	int cnt;			     /* entries in a leaf, or children of an internal node */
+	struct idx_node *prev;		     /* previous leaf in key order */
+	struct idx_node *next;		     /* next leaf in key order */
+	idx_entry *ents[IDX_NODE_MAX];	     /* leaf: entries, internal: lowest entry under kids[i] */
+	struct idx_node *kids[IDX_NODE_MAX]; /* children of an internal node */
+} idx_node;
+
+/* path from the B+tree root down to a leaf */
+typedef struct idx_path {
+	int depth;			    /* number of internal nodes on path */
+	idx_node *node[IDX_MAX_DEPTH];	    /* internal nodes, root first */
+	int slot[IDX_MAX_DEPTH];	    /* child of node[i] taken */
+} idx_path;
+
+/* the index, opaque to application */
+typedef struct idx_desc {
+	int flags;	     /* PBS_IDX_DUPS_OK, PBS_IDX_ICASE_CMP */
+	int keylen;	     /* length of key, 0 for null-terminated strings */
+	int count;	     /* number of entries */
+	int nleaves;	     /* number of B+tree leaves */
+	unsigned long gen;   /* bumped by each insert and delete, see iter_ctx */
+	idx_node *root;	     /* B+tree root, NULL while index is empty */
+	idx_slot *slots;     /* hash table, not used with PBS_IDX_DUPS_OK */
+	unsigned int nslots; /* size of hash table, a power of 2 */
+} idx_desc;
 
 /* iteration context structure, opaque to application */
 typedef struct _iter_ctx {
-	AVL_IX_DESC *idx; /* pointer to idx */
-	AVL_IX_REC *pkey; /* pointer to key used while iteration */
+	idx_desc *idx;	   /* pointer to idx */
+	idx_entry *cur;	   /* current entry, NULL at end of index */
+	idx_node *leaf;	   /* leaf holding cur, valid while gen matches idx */
+	int pos;	   /* position of cur in leaf */
+	int pending;	   /* cur was not returned yet, set by pbs_idx_delete_byctx() */
+	unsigned long gen; /* idx->gen when leaf and pos were set */
 } iter_ctx;
 
+/**
+ * @brief
+ *	hash a key (32 bit FNV-1a)
+ *
+ * @param[in] - d   - pointer to index
+ * @param[in] - key - key to hash
+ *
+ * @return unsigned int
+ * @retval hash of key, case folded for a case-insensitive index
+ *
+ */
+static unsigned int
+idx_hash(idx_desc *d, const void *key)
+{
+	const unsigned char *p = key;
+	unsigned int h = 2166136261U;
+	int i;
+
+	if (d->keylen != 0) {
+		for (i = 0; i < d->keylen; i++) {
+			h ^= p[i];
+			h *= 16777619U;
+		}
+	} else if (d->flags & PBS_IDX_ICASE_CMP) {
+		for (; *p != '\0'; p++) {
+			h ^= tolower(*p);
+			h *= 16777619U;
+		}
+	} else {
+		for (; *p != '\0'; p++) {
+			h ^= *p;
+			h *= 16777619U;
+		}
+	}
+	return h;
+}
+
+/**
+ * @brief
+ *	compare a key with the key of an entry
+ *
+ * @param[in] - d   - pointer to index
+ * @param[in] - key - key to compare
+ * @param[in] - e   - entry to compare with
+ *
+ * @return int
+ * @retval <0, 0, >0 - key is less than, equal to, greater than the entry's key
+ *
+ */
+static int
+idx_keycmp(idx_desc *d, const void *key, idx_entry *e)
+{
+	if (d->keylen != 0)
+		return memcmp(key, e->key, d->keylen);
+	if (d->flags & PBS_IDX_ICASE_CMP)
+		return strcasecmp(key, e->key);
+	return strcmp(key, e->key);
+}
+
+/**
+ * @brief
+ *	compare a key and data pair with an entry, in B+tree order.
+ *	Duplicate keys are ordered by their data pointer.
+ *
+ * @param[in] - d    - pointer to index
+ * @param[in] - key  - key to compare
+ * @param[in] - data - data to compare, only used with PBS_IDX_DUPS_OK
+ * @param[in] - e    - entry to compare with
+ *
+ * @return int
+ * @retval <0, 0, >0 - pair is less than, equal to, greater than the entry
+ *
+ */
+static int
+idx_cmp(idx_desc *d, const void *key, void *data, idx_entry *e)
+{
+	int n;
+
+	n = idx_keycmp(d, key, e);
+	if (n != 0 || !(d->flags & PBS_IDX_DUPS_OK))
+		return n;
+	if ((uintptr_t) data < (uintptr_t) e->data)
+		return -1;
+	return (uintptr_t) data > (uintptr_t) e->data;
+}
+
+/**
+ * @brief
+ *	find the entry with given key in the hash table
+ *
+ * @param[in] - d   - pointer to index
+ * @param[in] - key - key to find
+ * @param[in] - h   - hash of key
+ *
+ * @return idx_entry *
+ * @retval !NULL - the entry
+ * @retval NULL  - not found
+ *
+ */
+static idx_entry *
+hash_find(idx_desc *d, const void *key, unsigned int h)
+{
+	unsigned int mask;
+	unsigned int i;
+
+	if (d->slots == NULL)
+		return NULL;
+
+	mask = d->nslots - 1;
+	for (i = h & mask; d->slots[i].ent != NULL; i = (i + 1) & mask) {
+		if (d->slots[i].hash == h && idx_keycmp(d, key, d->slots[i].ent) == 0)
+			return d->slots[i].ent;
+	}
+	return NULL;
+}
+
+/**
+ * @brief
+ *	make room in the hash table for one more entry, growing it
+ *	once it would be more than 3/4 full
+ *
+ * @param[in] - d - pointer to index
+ *
+ * @return int
+ * @retval 0  - success
+ * @retval -1 - out of memory
+ *
+ */
+static int
+hash_reserve(idx_desc *d)
+{
+	idx_slot *slots;
+	unsigned int nslots;
+	unsigned int mask;
+	unsigned int i;
+	unsigned int j;
+
+	if (d->slots != NULL && ((unsigned int) d->count + 1) * 4 <= d->nslots * 3)
+		return 0;
+
+	nslots = d->slots == NULL ? IDX_HASH_MIN : d->nslots * 2;
+	slots = calloc(nslots, sizeof(idx_slot));
+	if (slots == NULL)
+		return -1;
+
+	mask = nslots - 1;
+	for (i = 0; i < d->nslots; i++) {
+		if (d->slots[i].ent == NULL)
+			continue;
+		for (j = d->slots[i].hash & mask; slots[j].ent != NULL; j = (j + 1) & mask)
+			;
+		slots[j] = d->slots[i];
+	}
+	free(d->slots);
+	d->slots = slots;
+	d->nslots = nslots;
+	return 0;
+}
+
+/**
+ * @brief
+ *	add an entry to the hash table, hash_reserve() must have been called
+ *
+ * @param[in] - d - pointer to index
+ * @param[in] - e - entry to add
+ *
+ * @return void
+ *
+ */
+static void
+hash_add(idx_desc *d, idx_entry *e)
+{
+	unsigned int mask = d->nslots - 1;
+	unsigned int i;
+
+	for (i = e->hash & mask; d->slots[i].ent != NULL; i = (i + 1) & mask)
+		;
+	d->slots[i].hash = e->hash;
+	d->slots[i].ent = e;
+}
+
+/**
+ * @brief
+ *	remove an entry from the hash table, shifting back the entries
+ *	after it so no tombstones are needed
+ *
+ * @param[in] - d - pointer to index
+ * @param[in] - e - entry to remove
+ *
+ * @return void
+ *
+ */
+static void
+hash_del(idx_desc *d, idx_entry *e)
+{
+	unsigned int mask;
+	unsigned int i;
+	unsigned int j;
+	unsigned int home;
+
+	if (d->slots == NULL)
+		return;
+
+	mask = d->nslots - 1;
+	for (i = e->hash & mask; d->slots[i].ent != e; i = (i + 1) & mask) {
+		if (d->slots[i].ent == NULL)
+			return;
+	}
+
+	for (j = (i + 1) & mask; d->slots[j].ent != NULL; j = (j + 1) & mask) {
+		home = d->slots[j].hash & mask;
+		/* leave the entry where it is if its home slot lies in (i, j] */
+		if (i <= j ? (i < home && home <= j) : (i < home || home <= j))
+			continue;
+		d->slots[i] = d->slots[j];
+		i = j;
+	}
+	d->slots[i].ent = NULL;
+}
+
+/**
+ * @brief
+ *	find the position of a key and data pair in a node
+ *
+ * @param[in] - d    - pointer to index
+ * @param[in] - n    - node to search
+ * @param[in] - key  - key to find
+ * @param[in] - data - data to find
+ * @param[in] - excl - for a leaf, skip entries equal to the pair
+ *
+ * @return int
+ * @retval leaf:     the first entry greater than (or equal to, unless excl) the pair,
+ *                   n->cnt if there is none
+ * @retval internal: the last child whose lowest entry is not greater than the pair,
+ *                   0 if there is none
+ *
+ */
+static int
+node_search(idx_desc *d, idx_node *n, const void *key, void *data, int excl)
+{
+	int lo = 0;
+	int hi = n->cnt;
+	int mid;
+	int c;
+
+	if (!n->leaf)
+		excl = 1;
+
+	/* find the first entry greater than (or equal to) the pair */
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		c = idx_cmp(d, key, data, n->ents[mid]);
+		if (c > 0 || (c == 0 && excl))
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (!n->leaf)
+		return lo > 0 ? lo - 1 : 0;
+	return lo;
+}
+
+/**
+ * @brief
+ *	descend the B+tree to the leaf where a key and data pair belongs
+ *
+ * @param[in]  - d    - pointer to index
+ * @param[in]  - key  - key to find
+ * @param[in]  - data - data to find
+ * @param[out] - path - internal nodes passed, can be NULL
+ *
+ * @return idx_node *
+ * @retval the leaf
+ *
+ */
+static idx_node *
+bt_descend(idx_desc *d, const void *key, void *data, idx_path *path)
+{
+	idx_node *n = d->root;
+	int i;
+
+	if (path != NULL)
+		path->depth = 0;
+	while (!n->leaf) {
+		i = node_search(d, n, key, data, 1);
+		if (path != NULL) {
+			path->node[path->depth] = n;
+			path->slot[path->depth] = i;
+			path->depth++;
+		}
+		n = n->kids[i];
+	}
+	return n;
+}
+
+/**
+ * @brief
+ *	find the first entry after (or at, unless excl) a key and data pair
+ *
+ * @param[in]  - d    - pointer to index
+ * @param[in]  - key  - key to find
+ * @param[in]  - data - data to find
+ * @param[in]  - excl - skip an entry equal to the pair
+ * @param[out] - pos  - position of the entry in the returned leaf
+ *
+ * @return idx_node *
+ * @retval !NULL - leaf holding the entry
+ * @retval NULL  - no such entry
+ *
+ */
+static idx_node *
+bt_seek(idx_desc *d, const void *key, void *data, int excl, int *pos)
+{
+	idx_node *leaf;
+
+	if (d->root == NULL)
+		return NULL;
+
+	leaf = bt_descend(d, key, data, NULL);
+	*pos = node_search(d, leaf, key, data, excl);
+	if (*pos < leaf->cnt)
+		return leaf;
+	*pos = 0;
+	return leaf->next;
+}
+
+/**
+ * @brief
+ *	insert an entry or a child in a node which has room for it
+ *
+ * @param[in] - n   - node
+ * @param[in] - i   - position to insert at
+ * @param[in] - e   - entry to insert, lowest entry under kid for an internal node
+ * @param[in] - kid - child to insert, for an internal node
+ *
+ * @return void
+ *
+ */
+static void
+node_put(idx_node *n, int i, idx_entry *e, idx_node *kid)
+{
+	memmove(&n->ents[i + 1], &n->ents[i], (n->cnt - i) * sizeof(idx_entry *));
+	n->ents[i] = e;
+	if (!n->leaf) {
+		memmove(&n->kids[i + 1], &n->kids[i], (n->cnt - i) * sizeof(idx_node *));
+		n->kids[i] = kid;
+	}
+	n->cnt++;
+}
+
+/**
+ * @brief
+ *	remove an entry or a child from a node
+ *
+ * @param[in] - n - node
+ * @param[in] - i - position to remove
+ *
+ * @return void
+ *
+ */
+static void
+node_cut(idx_node *n, int i)
+{
+	n->cnt--;
+	memmove(&n->ents[i], &n->ents[i + 1], (n->cnt - i) * sizeof(idx_entry *));
+	if (!n->leaf)
+		memmove(&n->kids[i], &n->kids[i + 1], (n->cnt - i) * sizeof(idx_node *));
+}
+
+/**
+ * @brief
+ *	free a B+tree, but not its entries
+ *
+ * @param[in] - n - root of the tree
+ *
+ * @return void
+ *
+ */
+static void
+bt_free(idx_node *n)
+{
+	int i;
+
+	if (n == NULL)
+		return;
+	if (!n->leaf) {
+		for (i = 0; i < n->cnt; i++)
+			bt_free(n->kids[i]);
+	}
+	free(n);
+}
+
+/**
+ * @brief
+ *	return the first leaf of the B+tree
+ *
+ * @param[in] - d - pointer to index
+ *
+ * @return idx_node *
+ * @retval first leaf, NULL if index is empty
+ *
+ */
+static idx_node *
+bt_first(idx_desc *d)
+{
+	idx_node *n = d->root;
+
+	while (n != NULL && !n->leaf)
+		n = n->kids[0];
+	return n;
+}
+
+/**
+ * @brief
+ *	insert an entry in the B+tree, splitting full nodes on the way up
+ *
+ * @param[in] - d - pointer to index
+ * @param[in] - e - entry to insert
+ *
+ * @return int
+ * @retval 0  - success
+ * @retval -1 - out of memory, tree is unchanged
+ *
+ */
+static int
+bt_insert(idx_desc *d, idx_entry *e)
+{
+	idx_path path;
+	idx_node *spare[IDX_MAX_DEPTH + 2];
+	int nspare = 0;
+	idx_node *n;
+	idx_node *right;
+	idx_node *kid = NULL;
+	idx_entry *ins = e;
+	int lvl;
+	int pos;
+	int leafpos;
+	int half = IDX_NODE_MAX / 2;
+
+	if (d->root == NULL) {
+		if ((d->root = calloc(1, sizeof(idx_node))) == NULL)
+			return -1;
+		d->root->leaf = 1;
+		d->nleaves = 1;
+	}
+
+	n = bt_descend(d, e->key, e->data, &path);
+	leafpos = pos = node_search(d, n, e->key, e->data, 0);
+
+	/* allocate every node a split could need up front, so a failure leaves the tree intact */
+	if (n->cnt == IDX_NODE_MAX) {
+		for (lvl = path.depth; lvl >= 0; lvl--) {
+			if ((spare[nspare++] = calloc(1, sizeof(idx_node))) == NULL) {
+				while (nspare > 0)
+					free(spare[--nspare]);
+				return -1;
+			}
+			if (lvl > 0 && path.node[lvl - 1]->cnt < IDX_NODE_MAX)
+				break;
+			if (lvl == 0 && (spare[nspare++] = calloc(1, sizeof(idx_node))) == NULL) {
+				while (nspare > 0)
+					free(spare[--nspare]);
+				return -1;
+			}
+		}
+	}
+
+	for (lvl = path.depth;; lvl--) {
+		if (n->cnt < IDX_NODE_MAX) {
+			node_put(n, pos, ins, kid);
+			break;
+		}
+
+		/* split n, the upper half moves to a new node on its right */
+		right = spare[--nspare];
+		right->leaf = n->leaf;
+		right->cnt = IDX_NODE_MAX - half;
+		memcpy(right->ents, &n->ents[half], right->cnt * sizeof(idx_entry *));
+		if (!n->leaf)
+			memcpy(right->kids, &n->kids[half], right->cnt * sizeof(idx_node *));
+		n->cnt = half;
+		if (n->leaf) {
+			right->prev = n;
+			right->next = n->next;
+			if (n->next != NULL)
+				n->next->prev = right;
+			n->next = right;
+			d->nleaves++;
+		}
+		if (pos <= half)
+			node_put(n, pos, ins, kid);
+		else
+			node_put(right, pos - half, ins, kid);
+
+		ins = right->ents[0];
+		kid = right;
+		if (lvl == 0) {
+			/* n was the root, grow a new one */
+			d->root = spare[--nspare];
+			d->root->cnt = 2;
+			d->root->ents[0] = n->ents[0];
+			d->root->kids[0] = n;
+			d->root->ents[1] = ins;
+			d->root->kids[1] = right;
+			break;
+		}
+		n = path.node[lvl - 1];
+		pos = path.slot[lvl - 1] + 1;
+	}
+
+	/* an entry landing first in its leaf is the lowest in the index */
+	if (leafpos == 0) {
+		for (n = d->root; !n->leaf; n = n->kids[0])
+			n->ents[0] = e;
+	}
+	return 0;
+}
+
+/**
+ * @brief
+ *	rebuild the B+tree with full nodes once deletes have left too
+ *	many nodes nearly empty
+ *
+ * @param[in] - d - pointer to index
+ *
+ * @return void
+ *
+ * @note
+ *	out of memory is not an error here, the old tree is kept
+ *
+ */
+static void
+bt_rebuild(idx_desc *d)
+{
+	idx_node *heads[IDX_MAX_DEPTH + 1];
+	idx_node *old;
+	idx_node *c;
+	idx_node *tail;
+	idx_node *n;
+	int nlvl = 0;
+	int nnodes = 0;
+	int fill = IDX_NODE_MAX * 3 / 4;
+	int nl;
+	int i;
+
+	/* leaves, chained through next */
+	heads[0] = tail = NULL;
+	for (old = bt_first(d); old != NULL; old = old->next) {
+		for (i = 0; i < old->cnt; i++) {
+			if (tail == NULL || tail->cnt == fill) {
+				if ((n = calloc(1, sizeof(idx_node))) == NULL)
+					goto err;
+				n->leaf = 1;
+				n->prev = tail;
+				if (tail == NULL)
+					heads[0] = n;
+				else
+					tail->next = n;
+				tail = n;
+				nnodes++;
+			}
+			tail->ents[tail->cnt++] = old->ents[i];
+		}
+	}
+	nl = nnodes;
+	nlvl = 1;
+
+	/* internal levels, temporarily chained through next too */
+	while (nnodes > 1) {
+		heads[nlvl] = tail = NULL;
+		nnodes = 0;
+		for (c = heads[nlvl - 1]; c != NULL; c = c->next) {
+			if (tail == NULL || tail->cnt == fill) {
+				if ((n = calloc(1, sizeof(idx_node))) == NULL) {
+					nlvl++;
+					goto err;
+				}
+				if (tail == NULL)
+					heads[nlvl] = n;
+				else
+					tail->next = n;
+				tail = n;
+				nnodes++;
+			}
+			tail->ents[tail->cnt] = c->ents[0];
+			tail->kids[tail->cnt++] = c;
+		}
+		nlvl++;
+	}
+
+	for (i = 1; i < nlvl; i++) {
+		for (c = heads[i]; c != NULL; c = n) {
+			n = c->next;
+			c->next = NULL;
+		}
+	}
+	bt_free(d->root);
+	d->root = heads[nlvl - 1];
+	d->nleaves = nl;
+	return;
+
+err:
+	if (nlvl == 0)
+		nlvl = 1;
+	for (i = 0; i < nlvl; i++) {
+		for (c = heads[i]; c != NULL; c = n) {
+			n = c->next;
+			free(c);
+		}
+	}
+}
+
+/**
+ * @brief
+ *	remove an entry from the B+tree, dropping nodes it leaves empty
+ *
+ * @param[in] - d - pointer to index
+ * @param[in] - e - entry to remove
+ *
+ * @return void
+ *
+ */
+static void
+bt_delete(idx_desc *d, idx_entry *e)
+{
+	idx_path path;
+	idx_node *n;
+	idx_entry *low;
+	int lvl;
+	int pos;
+
+	if (d->root == NULL)
+		return;
+
+	if (d->count == 1) {
+		bt_free(d->root);
+		d->root = NULL;
+		d->nleaves = 0;
+		return;
+	}
+
+	n = bt_descend(d, e->key, e->data, &path);
+	pos = node_search(d, n, e->key, e->data, 0);
+	if (pos >= n->cnt || n->ents[pos] != e)
+		return;
+
+	node_cut(n, pos);
+	for (lvl = path.depth; n->cnt == 0 && lvl > 0; lvl--) {
+		if (n->leaf) {
+			if (n->prev != NULL)
+				n->prev->next = n->next;
+			if (n->next != NULL)
+				n->next->prev = n->prev;
+			d->nleaves--;
+		}
+		free(n);
+		n = path.node[lvl - 1];
+		pos = path.slot[lvl - 1];
+		node_cut(n, pos);
+	}
+
+	/* the lowest entry under n changed, pass it up while n is a first child */
+	if (pos == 0) {
+		low = n->ents[0];
+		for (lvl--; lvl >= 0; lvl--) {
+			path.node[lvl]->ents[path.slot[lvl]] = low;
+			if (path.slot[lvl] != 0)
+				break;
+		}
+	}
+
+	while (!d->root->leaf && d->root->cnt == 1) {
+		n = d->root;
+		d->root = n->kids[0];
+		free(n);
+	}
+
+	if (d->nleaves > 1 && d->count - 1 < d->nleaves * (IDX_NODE_MAX / 4))
+		bt_rebuild(d);
+}
+
+/**
+ * @brief
+ *	remove an entry from the index and free it
+ *
+ * @param[in] - d - pointer to index
+ * @param[in] - e - entry to remove
+ *
+ * @return void
+ *
+ */
+static void
+idx_remove(idx_desc *d, idx_entry *e)
+{
+	bt_delete(d, e);
+	if (!(d->flags & PBS_IDX_DUPS_OK))
+		hash_del(d, e);
+	d->count--;
+	d->gen++;
+	free(e);
+}
+
 /**
  * @brief
  *	Create an empty index
@@ -64,18 +851,19 @@ typedef struct _iter_ctx {
 void *
 pbs_idx_create(int flags, int keylen)
 {
-	void *idx = NULL;
+	idx_desc *d;
 
-	idx = malloc(sizeof(AVL_IX_DESC));
-	if (idx == NULL)
+	if (keylen < 0)
 		return NULL;
 
-	if (avl_create_index(idx, flags, keylen)) {
-		free(idx);
+	d = calloc(1, sizeof(idx_desc));
+	if (d == NULL)
 		return NULL;
-	}
 
-	return idx;
+	d->flags = flags;
+	d->keylen = keylen;
+
+	return d;
 }
 
 /**
@@ -90,9 +878,18 @@ pbs_idx_create(int flags, int keylen)
 void
 pbs_idx_destroy(void *idx)
 {
-	if (idx != NULL) {
-		avl_destroy_index(idx);
-		free(idx);
+	idx_desc *d = (idx_desc *) idx;
+	idx_node *n;
+	int i;
+
+	if (d != NULL) {
+		for (n = bt_first(d); n != NULL; n = n->next) {
+			for (i = 0; i < n->cnt; i++)
+				free(n->ents[i]);
+		}
+		bt_free(d->root);
+		free(d->slots);
+		free(d);
 		idx = NULL;
 	}
 }
@@ -113,21 +910,45 @@ pbs_idx_destroy(void *idx)
 int
 pbs_idx_insert(void *idx, void *key, void *data)
 {
-	AVL_IX_REC *pkey;
+	idx_desc *d = (idx_desc *) idx;
+	idx_entry *e;
+	idx_node *leaf;
+	unsigned int h;
+	size_t keysz;
+	int pos;
 
-	if (idx == NULL || key == NULL)
+	if (d == NULL || key == NULL)
 		return PBS_IDX_RET_FAIL;
 
-	pkey = avlkey_create(idx, key);
-	if (pkey == NULL)
+	h = idx_hash(d, key);
+	if (d->flags & PBS_IDX_DUPS_OK) {
+		leaf = bt_seek(d, key, data, 0, &pos);
+		if (leaf != NULL && idx_cmp(d, key, data, leaf->ents[pos]) == 0)
+			return PBS_IDX_RET_FAIL;
+	} else {
+		if (hash_find(d, key, h) != NULL)
+			return PBS_IDX_RET_FAIL;
+		if (hash_reserve(d) != 0)
+			return PBS_IDX_RET_FAIL;
+	}
+
+	keysz = d->keylen != 0 ? (size_t) d->keylen : strlen(key) + 1;
+	e = malloc(offsetof(idx_entry, key) + keysz);
+	if (e == NULL)
 		return PBS_IDX_RET_FAIL;
+	e->data = data;
+	e->hash = h;
+	e->keysz = keysz;
+	memcpy(e->key, key, keysz);
 
-	pkey->recptr = data;
-	if (avl_add_key(pkey, idx) != AVL_IX_OK) {
-		free(pkey);
+	if (bt_insert(d, e) != 0) {
+		free(e);
 		return PBS_IDX_RET_FAIL;
 	}
-	free(pkey);
+	if (!(d->flags & PBS_IDX_DUPS_OK))
+		hash_add(d, e);
+	d->count++;
+	d->gen++;
 	return PBS_IDX_RET_OK;
 }
 
@@ -142,22 +963,30 @@ pbs_idx_insert(void *idx, void *key, void *data)
  * @retval PBS_IDX_RET_OK   - success
  * @retval PBS_IDX_RET_FAIL - failure
  *
+ * @note
+ *	with PBS_IDX_DUPS_OK, the first entry with the key is deleted
+ *
  */
 int
 pbs_idx_delete(void *idx, void *key)
 {
-	AVL_IX_REC *pkey;
+	idx_desc *d = (idx_desc *) idx;
+	idx_entry *e = NULL;
+	idx_node *leaf;
+	int pos;
 
-	if (idx == NULL || key == NULL)
+	if (d == NULL || key == NULL)
 		return PBS_IDX_RET_FAIL;
 
-	pkey = avlkey_create(idx, key);
-	if (pkey == NULL)
-		return PBS_IDX_RET_FAIL;
+	if (d->flags & PBS_IDX_DUPS_OK) {
+		leaf = bt_seek(d, key, NULL, 0, &pos);
+		if (leaf != NULL && idx_keycmp(d, key, leaf->ents[pos]) == 0)
+			e = leaf->ents[pos];
+	} else
+		e = hash_find(d, key, idx_hash(d, key));
 
-	pkey->recptr = NULL;
-	avl_delete_key(pkey, idx);
-	free(pkey);
+	if (e != NULL)
+		idx_remove(d, e);
 	return PBS_IDX_RET_OK;
 }
 
@@ -172,16 +1001,33 @@ pbs_idx_delete(void *idx, void *key)
  * @retval PBS_IDX_RET_OK   - success
  * @retval PBS_IDX_RET_FAIL - failure
  *
+ * @note
+ *	the next pbs_idx_find() with ctx returns the entry
+ *	which followed the deleted one
+ *
  */
 int
 pbs_idx_delete_byctx(void *ctx)
 {
 	iter_ctx *pctx = (iter_ctx *) ctx;
+	idx_desc *d;
+	idx_entry *next = NULL;
+	idx_node *leaf;
+	int pos;
 
-	if (pctx == NULL || pctx->idx == NULL || pctx->pkey == NULL)
+	if (pctx == NULL || pctx->idx == NULL || pctx->cur == NULL || pctx->pending)
 		return PBS_IDX_RET_FAIL;
 
-	avl_delete_key(pctx->pkey, pctx->idx);
+	d = pctx->idx;
+	leaf = bt_seek(d, pctx->cur->key, pctx->cur->data, 1, &pos);
+	if (leaf != NULL)
+		next = leaf->ents[pos];
+
+	idx_remove(d, pctx->cur);
+
+	pctx->cur = next;
+	pctx->pending = 1;
+	pctx->gen = d->gen - 1; /* make the next find seek to it */
 	return PBS_IDX_RET_OK;
 }
 
@@ -211,11 +1057,13 @@ pbs_idx_delete_byctx(void *ctx)
 int
 pbs_idx_find(void *idx, void **key, void **data, void **ctx)
 {
+	idx_desc *d = (idx_desc *) idx;
 	iter_ctx *pctx;
-	AVL_IX_REC *pkey;
-	int rc = AVL_IX_FAIL;
+	idx_entry *e;
+	idx_node *leaf;
+	int pos = 0;
 
-	if (idx == NULL || data == NULL)
+	if (d == NULL || data == NULL)
 		return PBS_IDX_RET_FAIL;
 
 	if (ctx != NULL && *ctx != NULL) {
@@ -225,51 +1073,74 @@ pbs_idx_find(void *idx, void **key, void **data, void **ctx)
 		if (key)
 			*key = NULL;
 
-		if (pctx->idx != idx || pctx->pkey == NULL)
+		if (pctx->idx != d || pctx->cur == NULL)
 			return PBS_IDX_RET_FAIL;
 
-		if (avl_next_key(pctx->pkey, pctx->idx) != AVL_IX_OK)
+		if (pctx->gen != d->gen) {
+			/* index changed under us, find our place again */
+			leaf = bt_seek(d, pctx->cur->key, pctx->cur->data, !pctx->pending, &pos);
+		} else {
+			leaf = pctx->leaf;
+			pos = pctx->pos + 1;
+			if (pos >= leaf->cnt) {
+				leaf = leaf->next;
+				pos = 0;
+			}
+		}
+		pctx->pending = 0;
+		if (leaf == NULL) {
+			pctx->cur = NULL;
 			return PBS_IDX_RET_FAIL;
+		}
+		pctx->leaf = leaf;
+		pctx->pos = pos;
+		pctx->gen = d->gen;
+		pctx->cur = leaf->ents[pos];
 
-		*data = pctx->pkey->recptr;
+		*data = pctx->cur->data;
 		if (key)
-			*key = &pctx->pkey->key;
+			*key = pctx->cur->key;
 
 		return PBS_IDX_RET_OK;
-	} else {
-		*data = NULL;
-		pkey = avlkey_create(idx, key ? *key : NULL);
-		if (pkey == NULL)
-			return PBS_IDX_RET_FAIL;
+	}
 
-		if (key != NULL && *key != NULL) {
-			rc = avl_find_key(pkey, idx);
-		} else {
-			avl_first_key(idx);
-			rc = avl_next_key(pkey, idx);
+	*data = NULL;
+	if (key != NULL && *key != NULL) {
+		if (ctx == NULL && !(d->flags & PBS_IDX_DUPS_OK)) {
+			/* plain lookup, the hash table is enough */
+			e = hash_find(d, *key, idx_hash(d, *key));
+			if (e == NULL)
+				return PBS_IDX_RET_FAIL;
+			*data = e->data;
+			return PBS_IDX_RET_OK;
 		}
+		leaf = bt_seek(d, *key, NULL, 0, &pos);
+		if (leaf == NULL || idx_keycmp(d, *key, leaf->ents[pos]) != 0)
+			return PBS_IDX_RET_FAIL;
+	} else {
+		leaf = bt_first(d);
+		if (leaf == NULL)
+			return PBS_IDX_RET_FAIL;
+	}
 
-		if (rc == AVL_IX_OK) {
-			*data = pkey->recptr;
-			if (key != NULL && *key == NULL)
-				*key = &pkey->key;
-			if (ctx != NULL) {
-				pctx = (iter_ctx *) malloc(sizeof(iter_ctx));
-				if (pctx == NULL) {
-					free(pkey);
-					return PBS_IDX_RET_FAIL;
-				}
-				pctx->idx = idx;
-				pctx->pkey = pkey;
-				*ctx = (void *) pctx;
-
-				return PBS_IDX_RET_OK;
-			}
-		}
-		free(pkey);
+	e = leaf->ents[pos];
+	*data = e->data;
+	if (key != NULL && *key == NULL)
+		*key = e->key;
+	if (ctx != NULL) {
+		pctx = (iter_ctx *) malloc(sizeof(iter_ctx));
+		if (pctx == NULL)
+			return PBS_IDX_RET_FAIL;
+		pctx->idx = d;
+		pctx->cur = e;
+		pctx->leaf = leaf;
+		pctx->pos = pos;
+		pctx->pending = 0;
+		pctx->gen = d->gen;
+		*ctx = (void *) pctx;
 	}
 
-	return rc == AVL_IX_OK ? PBS_IDX_RET_OK : PBS_IDX_RET_FAIL;
+	return PBS_IDX_RET_OK;
 }
 
 /**
@@ -285,8 +1156,6 @@ void
 pbs_idx_free_ctx(void *ctx)
 {
 	if (ctx != NULL) {
-		iter_ctx *pctx = (iter_ctx *) ctx;
-		free(pctx->pkey);
 		free(ctx);
 		ctx = NULL;
 	}
@@ -629,6 +629,7 @@ bucket_match(chunk_map **cmap, resource_resv *resresv, schd_error *err)
 	int j;
 	int k;
 	static pbs_bitmap *zeromap = NULL;
+	static pbs_bitmap *takenmap = NULL;
 	server_info *sinfo;
 
 	if (cmap == NULL || resresv == NULL || resresv->select == NULL)
@@ -640,6 +641,12 @@ bucket_match(chunk_map **cmap, resource_resv *resresv, schd_error *err)
 			return 0;
 	}
 
+	if (takenmap == NULL) {
+		takenmap = pbs_bitmap_alloc(NULL, 1);
+		if (takenmap == NULL)
+			return 0;
+	}
+
 	sinfo = resresv->server;
 
 	for (i = 0; cmap[i] != NULL; i++) {
@@ -684,6 +691,28 @@ bucket_match(chunk_map **cmap, resource_resv *resresv, schd_error *err)
 
 			}
 
+			/* Without provisioning, any free node will do.  Take the nodes
+			 * we need from the free pool in bulk rather than bit by bit.
+			 */
+			if (resresv->aoename == NULL && num_chunks_needed > chunks_added) {
+				int chunk_count = cmap[i]->bkt_cnts[j]->chunk_count;
+				long nodes_needed = (num_chunks_needed - chunks_added + chunk_count - 1) / chunk_count;
+				long taken;
+
+				taken = pbs_bitmap_first_n_on_bits(bkt->free_pool->working, nodes_needed, takenmap);
+				if (taken < 0)
+					return 0;
+				if (taken > 0) {
+					clear_schd_error(err);
+					pbs_bitmap_andnot(bkt->free_pool->working, takenmap);
+					bkt->free_pool->working_ct -= taken;
+					pbs_bitmap_or(bkt->busy_pool->working, takenmap);
+					bkt->busy_pool->working_ct += taken;
+					pbs_bitmap_or(cmap[i]->node_bits, takenmap);
+					chunks_added += taken * chunk_count;
+				}
+			}
+
 			for (k = pbs_bitmap_first_on_bit(bkt->free_pool->working);
 			     num_chunks_needed > chunks_added && k >= 0;
 			     k = pbs_bitmap_next_on_bit(bkt->free_pool->working, k)) {
@@ -100,6 +100,7 @@
 #include "simulate.h"
 #include "resource.h"
 #include "buckets.h"
+#include "cycle_profile.h"
 #include "pbs_bitmap.h"
 
 
@@ -1076,7 +1077,9 @@ is_ok_to_run(status *policy, server_info *sinfo,
 		}
 	}
 
+	prof_phase_start(PROF_CHECK_NODES);
 	ns_arr = check_nodes(policy, sinfo, qinfo, resresv, flags, err);
+	prof_phase_end(PROF_CHECK_NODES);
 
 	if (err->error_code != SUCCESS)
 		add_err(&prev_err, err);
@@ -61,9 +61,14 @@
 
 /* usage file "magic number" - needs to be 8 chars */
 #define USAGE_MAGIC "PBS_MAG!"
-#define USAGE_VERSION 2
+#define USAGE_VERSION 3
 #define USAGE_NAME_MAX 50
 
+/* usage changes between full writes of the usage file are appended here */
+#define USAGE_JOURNAL_SUFFIX ".journal"
+/* number of journal records after which the usage file is rewritten */
+#define USAGE_JOURNAL_MAX 10000
+
 #define UNKNOWN_GROUP_NAME "unknown"
 
 /* preempt priority values */
@@ -165,6 +170,7 @@
 #define PARSE_UPDATE_COMMENTS "update_comments"
 #define PARSE_RESV_CONFIRM_IGNORE "resv_confirm_ignore"
 #define PARSE_ALLOW_AOE_CALENDAR "allow_aoe_calendar"
+#define PARSE_RUNJOB_PIPELINE_DEPTH "runjob_pipeline_depth"
 
 /* deprecated */
 #define PARSE_PREEMPT_STARVING "preempt_starving"
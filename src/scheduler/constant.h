@@ -115,6 +115,15 @@ enum select_job_status
 /* infinity walltime value for forever job. This is 5 years(=60 * 60 * 24 * 365 * 5 seconds) */
 #define JOB_INFINITY (60 * 60 * 24 * 365 * 5)
 
+/* number of cycles after which the cross-cycle job cache is fully resynced */
+#define JOB_CACHE_RESYNC_CYCLES 100
+
+/* maximum height of the calendar's skip list index (1/4 chance per level) */
+#define CALENDAR_SKIP_LEVELS 16
+
+/* maximum number of jobs whose delayed attribute updates share one request */
+#define JOB_UPDATE_BATCH_SIZE PBS_MAX_MODIFYJOBS
+
 /* for filter functions */
 #define FILTER_FULL	1	/* leave new array the full size */
 
@@ -179,7 +188,8 @@ enum thread_task_type
 	TS_FREE_ND_INFO,
 	TS_DUP_RESRESV,
 	TS_QUERY_JOB_INFO,
-	TS_FREE_RESRESV
+	TS_FREE_RESRESV,
+	TS_SORT_KEYS
 };
 
 /* return codes for is_ok_to_run_* functions
@@ -0,0 +1,304 @@
+/*
+ * Copyright (C) 1994-2020 Altair Engineering, Inc.
+ * For more information, contact Altair at www.altair.com.
+ *
+ * This file is part of both the OpenPBS software ("OpenPBS")
+ * and the PBS Professional ("PBS Pro") software.
+ *
+ * Open Source License Information:
+ *
+ * OpenPBS is free software. You can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * OpenPBS is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Affero General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Commercial License Information:
+ *
+ * PBS Pro is commercially licensed software that shares a common core with
+ * the OpenPBS software.  For a copy of the commercial license terms and
+ * conditions, go to: (http://www.pbspro.com/agreement.html) or contact the
+ * Altair Legal Department.
+ *
+ * Altair's dual-license business model allows companies, individuals, and
+ * organizations to create proprietary derivative works of OpenPBS and
+ * distribute them - whether embedded or bundled with other software -
+ * under a commercial license agreement.
+ *
+ * Use of Altair's trademarks, including but not limited to "PBS™",
+ * "OpenPBS®", "PBS Professional®", and "PBS Pro™" and Altair's logos is
+ * subject to Altair's trademark licensing policies.
+ */
+
+
+/**
+ * @file    cycle_profile.c
+ *
+ * @brief
+ * 	Low overhead profiler for the phases of a scheduling cycle.
+ *	Each phase accumulates its call count, wall time and CPU time.  At
+ *	the end of a cycle the totals are pushed into a ring buffer of the last
+ *	PROF_HISTORY cycles and a summary is written to CYCLE_PROFILE_FILE.
+ *	Only the main scheduler thread is profiled.
+ *
+ * Functions included are:
+ * 	prof_init()
+ * 	prof_start_cycle()
+ * 	prof_end_cycle()
+ * 	prof_phase_start()
+ * 	prof_phase_end()
+ */
+
+#include <pbs_config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "log.h"
+
+#include "config.h"
+#include "data_types.h"
+#include "globals.h"
+#include "cycle_profile.h"
+
+struct prof_counter {
+	long calls;		/* number of times the phase was entered */
+	double wall;		/* wall clock seconds spent in the phase */
+	double cpu;		/* CPU seconds spent in the phase */
+};
+
+struct prof_cycle {
+	int cycle;		/* scheduling cycle iteration */
+	time_t start;		/* when the cycle started */
+	struct prof_counter total;	/* the whole cycle */
+	struct prof_counter phase[PROF_NUM_PHASES];
+};
+
+static char *prof_phase_names[PROF_NUM_PHASES] = {
+	"query_server",
+	"sort_jobs",
+	"create_node_buckets",
+	"is_ok_to_run",
+	"check_nodes",
+	"find_and_preempt_jobs",
+	"add_job_to_calendar",
+	"run_job"
+};
+
+static pthread_t prof_main_thread;
+static int prof_inited = 0;
+static int prof_in_cycle = 0;
+
+static struct prof_cycle prof_ring[PROF_HISTORY];
+static int prof_ring_next = 0;		/* next slot in prof_ring to fill */
+static int prof_ring_count = 0;		/* number of filled slots */
+
+static struct prof_cycle prof_cur;	/* the cycle being profiled */
+static struct timespec prof_cycle_wall;
+static struct timespec prof_cycle_cpu;
+static int prof_depth[PROF_NUM_PHASES];
+static struct timespec prof_wall[PROF_NUM_PHASES];
+static struct timespec prof_cpu[PROF_NUM_PHASES];
+
+/**
+ * @brief	seconds elapsed between two timespecs
+ */
+static double
+ts_diff(struct timespec *start, struct timespec *end)
+{
+	return (end->tv_sec - start->tv_sec) + (end->tv_nsec - start->tv_nsec) / 1e9;
+}
+
+/**
+ * @brief	should the calling thread be profiled
+ */
+static int
+prof_enabled(void)
+{
+	return prof_inited && prof_in_cycle && pthread_equal(pthread_self(), prof_main_thread);
+}
+
+/**
+ * @brief	initialize the profiler.  Must be called from the main thread.
+ *
+ * @return	void
+ */
+void
+prof_init(void)
+{
+	prof_main_thread = pthread_self();
+	prof_inited = 1;
+}
+
+/**
+ * @brief	start profiling a scheduling cycle
+ *
+ * @return	void
+ */
+void
+prof_start_cycle(void)
+{
+	if (!prof_inited)
+		return;
+
+	memset(&prof_cur, 0, sizeof(prof_cur));
+	memset(prof_depth, 0, sizeof(prof_depth));
+	prof_cur.cycle = cstat.iteration;
+	prof_cur.start = time(NULL);
+	clock_gettime(CLOCK_MONOTONIC, &prof_cycle_wall);
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &prof_cycle_cpu);
+	prof_in_cycle = 1;
+}
+
+/**
+ * @brief	start timing a phase.  Nested calls of the same phase are
+ *		counted but only the outermost is timed.
+ *
+ * @param[in]	phase	-	the phase
+ *
+ * @return	void
+ */
+void
+prof_phase_start(enum prof_phase phase)
+{
+	if (!prof_enabled())
+		return;
+
+	prof_cur.phase[phase].calls++;
+	if (prof_depth[phase]++ > 0)
+		return;
+
+	clock_gettime(CLOCK_MONOTONIC, &prof_wall[phase]);
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &prof_cpu[phase]);
+}
+
+/**
+ * @brief	stop timing a phase
+ *
+ * @param[in]	phase	-	the phase
+ *
+ * @return	void
+ */
+void
+prof_phase_end(enum prof_phase phase)
+{
+	struct timespec wall;
+	struct timespec cpu;
+
+	if (!prof_enabled() || prof_depth[phase] == 0)
+		return;
+
+	if (--prof_depth[phase] > 0)
+		return;
+
+	clock_gettime(CLOCK_MONOTONIC, &wall);
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu);
+	prof_cur.phase[phase].wall += ts_diff(&prof_wall[phase], &wall);
+	prof_cur.phase[phase].cpu += ts_diff(&prof_cpu[phase], &cpu);
+}
+
+/**
+ * @brief	write the profile summary file.  The file is written to a
+ *		temporary and renamed over CYCLE_PROFILE_FILE so readers never
+ *		see a partial file.
+ *
+ *		One line per phase for the last cycle, followed by the average
+ *		and maximum wall time per phase over the cycles in the ring.
+ *
+ * @return	void
+ */
+static void
+write_prof_file(void)
+{
+	FILE *fp;
+	int i, j;
+	char *tmpfile = CYCLE_PROFILE_FILE ".new";
+
+	if ((fp = fopen(tmpfile, "w")) == NULL) {
+		log_errf(errno, __func__, "Unable to open %s", tmpfile);
+		return;
+	}
+
+	fprintf(fp, "cycle=%d start=%ld phase=cycle calls=1 wall=%.6f cpu=%.6f\n",
+		prof_cur.cycle, (long) prof_cur.start, prof_cur.total.wall, prof_cur.total.cpu);
+	for (i = 0; i < PROF_NUM_PHASES; i++)
+		fprintf(fp, "cycle=%d start=%ld phase=%s calls=%ld wall=%.6f cpu=%.6f\n",
+			prof_cur.cycle, (long) prof_cur.start, prof_phase_names[i],
+			prof_cur.phase[i].calls, prof_cur.phase[i].wall, prof_cur.phase[i].cpu);
+
+	for (i = 0; i < PROF_NUM_PHASES; i++) {
+		double sum = 0;
+		double max = 0;
+
+		for (j = 0; j < prof_ring_count; j++) {
+			sum += prof_ring[j].phase[i].wall;
+			if (prof_ring[j].phase[i].wall > max)
+				max = prof_ring[j].phase[i].wall;
+		}
+		fprintf(fp, "window=%d phase=%s wall_avg=%.6f wall_max=%.6f\n",
+			prof_ring_count, prof_phase_names[i], sum / prof_ring_count, max);
+	}
+
+	if (fclose(fp) != 0) {
+		log_errf(errno, __func__, "Unable to write %s", tmpfile);
+		unlink(tmpfile);
+		return;
+	}
+
+	if (rename(tmpfile, CYCLE_PROFILE_FILE) != 0) {
+		log_errf(errno, __func__, "Unable to rename %s", tmpfile);
+		unlink(tmpfile);
+	}
+}
+
+/**
+ * @brief	finish profiling a scheduling cycle.  The cycle is added to
+ *		the ring buffer, logged and written to CYCLE_PROFILE_FILE.
+ *
+ * @return	void
+ */
+void
+prof_end_cycle(void)
+{
+	struct timespec wall;
+	struct timespec cpu;
+	char buf[MAX_LOG_SIZE];
+	size_t len;
+	int i;
+
+	if (!prof_enabled())
+		return;
+
+	clock_gettime(CLOCK_MONOTONIC, &wall);
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu);
+	prof_cur.total.calls = 1;
+	prof_cur.total.wall = ts_diff(&prof_cycle_wall, &wall);
+	prof_cur.total.cpu = ts_diff(&prof_cycle_cpu, &cpu);
+	prof_in_cycle = 0;
+
+	prof_ring[prof_ring_next] = prof_cur;
+	prof_ring_next = (prof_ring_next + 1) % PROF_HISTORY;
+	if (prof_ring_count < PROF_HISTORY)
+		prof_ring_count++;
+
+	len = snprintf(buf, sizeof(buf), "Cycle %d took %.6f seconds (cpu %.6f):",
+		prof_cur.cycle, prof_cur.total.wall, prof_cur.total.cpu);
+	for (i = 0; i < PROF_NUM_PHASES && len < sizeof(buf); i++)
+		len += snprintf(buf + len, sizeof(buf) - len, " %s=%ld/%.6f",
+			prof_phase_names[i], prof_cur.phase[i].calls, prof_cur.phase[i].wall);
+	log_event(PBSEVENT_DEBUG2, PBS_EVENTCLASS_SCHED, LOG_DEBUG, __func__, buf);
+
+	write_prof_file();
+}
@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 1994-2020 Altair Engineering, Inc.
+ * For more information, contact Altair at www.altair.com.
+ *
+ * This file is part of both the OpenPBS software ("OpenPBS")
+ * and the PBS Professional ("PBS Pro") software.
+ *
+ * Open Source License Information:
+ *
+ * OpenPBS is free software. You can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * OpenPBS is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Affero General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Commercial License Information:
+ *
+ * PBS Pro is commercially licensed software that shares a common core with
+ * the OpenPBS software.  For a copy of the commercial license terms and
+ * conditions, go to: (http://www.pbspro.com/agreement.html) or contact the
+ * Altair Legal Department.
+ *
+ * Altair's dual-license business model allows companies, individuals, and
+ * organizations to create proprietary derivative works of OpenPBS and
+ * distribute them - whether embedded or bundled with other software -
+ * under a commercial license agreement.
+ *
+ * Use of Altair's trademarks, including but not limited to "PBS™",
+ * "OpenPBS®", "PBS Professional®", and "PBS Pro™" and Altair's logos is
+ * subject to Altair's trademark licensing policies.
+ */
+
+
+#ifndef SRC_SCHEDULER_CYCLE_PROFILE_H_
+#define SRC_SCHEDULER_CYCLE_PROFILE_H_
+
+/* file in sched_priv the per-cycle profile summary is written to */
+#define CYCLE_PROFILE_FILE "cycle_profile"
+
+/* number of cycles kept in the profile ring buffer */
+#define PROF_HISTORY 16
+
+/* timed phases of a scheduling cycle.  Phases may nest (e.g., check_nodes
+ * inside is_ok_to_run), so their times can overlap.
+ */
+enum prof_phase {
+	PROF_QUERY_SERVER,
+	PROF_SORT_JOBS,
+	PROF_NODE_BUCKETS,
+	PROF_IS_OK_TO_RUN,
+	PROF_CHECK_NODES,
+	PROF_PREEMPT,
+	PROF_CALENDAR,
+	PROF_RUN_JOB,
+	PROF_NUM_PHASES
+};
+
+void prof_init(void);
+void prof_start_cycle(void);
+void prof_end_cycle(void);
+void prof_phase_start(enum prof_phase phase);
+void prof_phase_end(enum prof_phase phase);
+
+#endif /* SRC_SCHEDULER_CYCLE_PROFILE_H_ */
@@ -90,6 +90,7 @@ struct np_cache;
 struct chunk;
 struct selspec;
 struct resdef;
+struct resource_lookup;
 struct event_list;
 struct status;
 struct fairshare_head;
@@ -125,6 +126,7 @@ typedef struct np_cache np_cache;
 typedef struct chunk chunk;
 typedef struct selspec selspec;
 typedef struct resdef resdef;
+typedef struct resource_lookup resource_lookup;
 typedef struct timed_event timed_event;
 typedef struct event_list event_list;
 typedef struct status status;
@@ -137,6 +139,7 @@ typedef struct bucket_bitpool bucket_bitpool;
 typedef struct chunk_map chunk_map;
 typedef struct node_bucket_count node_bucket_count;
 typedef struct preempt_job_st preempt_job_st;
+typedef struct preempt_index preempt_index;
 typedef struct th_task_info th_task_info;
 typedef struct th_data_nd_eligible th_data_nd_eligible;
 typedef struct th_data_dup_nd_info th_data_dup_nd_info;
@@ -145,6 +148,8 @@ typedef struct th_data_free_ninfo th_data_free_ninfo;
 typedef struct th_data_dup_resresv th_data_dup_resresv;
 typedef struct th_data_query_jinfo th_data_query_jinfo;
 typedef struct th_data_free_resresv th_data_free_resresv;
+typedef struct sort_keys_info sort_keys_info;
+typedef struct th_data_sort_keys th_data_sort_keys;
 
 
 #ifdef NAS
@@ -178,9 +183,15 @@ typedef int (*event_func_t)(event_ptr_t*, void *);
 
 struct th_task_info
 {
-	int task_id;							/* task id, should be set by main thread */
 	enum thread_task_type task_type;		/* task type */
-	void *thread_data;					/* data for the worker thread to execute the task */
+	void *thread_data;					/* template data for the task, sidx/eidx are set per range */
+	int num_items;						/* number of items to run the task over */
+	int range_size;						/* number of items a thread claims at a time */
+	int num_ranges;						/* number of ranges num_items is split into */
+	int next_item;						/* next unclaimed item, claimed atomically */
+	int num_active;						/* number of worker threads inside the task */
+	int error;						/* set if any range reported an error */
+	void **results;						/* per-range output for task types which have it */
 };
 
 struct th_data_nd_eligible
@@ -252,6 +263,26 @@ struct th_data_free_resresv
 	int eidx;
 };
 
+/* sort keys of an array of nodes or jobs, computed once per sort */
+struct sort_keys_info
+{
+	enum sort_obj_type obj_type;		/* SOBJ_NODE or SOBJ_JOB */
+	void **obj_arr;				/* objects in their order before the sort */
+	int nkeys;				/* number of keys per object */
+	int fs_key;				/* fairshare paths are compared before this key, -1 for none */
+	sch_resource_t *keys;			/* nkeys per object, descending keys are negated */
+};
+
+struct th_data_sort_keys
+{
+	sort_keys_info *ski;
+	int *order;				/* object indices, sorted per range */
+	int *tmp;				/* merge buffer */
+	int *runs;				/* run starts found in each range */
+	int sidx;
+	int eidx;
+};
+
 struct schd_error
 {
 	enum sched_error error_code;	/* scheduler error code (see constant.h) */
@@ -291,6 +322,7 @@ struct place
 	unsigned int share:1;		/* will share nodes */
 
 	char *group;			/* resource to node group by */
+	int refcount;			/* # of owners sharing this place (see share_place()) */
 };
 
 struct chunk
@@ -307,6 +339,7 @@ struct selspec
 	int total_cpus;			/* # of cpus requested in this select spec */
 	resdef **defs;			/* the resources requested by this select spec*/
 	chunk **chunks;
+	int refcount;			/* # of owners sharing this spec (see share_selspec()) */
 };
 
 /* for description of these bits, check the PBS admin guide or scheduler IDS */
@@ -425,12 +458,15 @@ struct server_info
 	queue_info **queues;		/* array of queues */
 	queue_info ***queue_list;	/* 3 dimensional array, used to order jobs in round_robin */
 	node_info **nodes;		/* array of nodes associated with the server */
+	void *nodes_idx;		/* index of nodes by name */
 	node_info **unassoc_nodes;	/* array of nodes not associated with queues */
 	resource_resv **resvs;		/* the reservations on the server */
 	resource_resv **running_jobs;	/* array of jobs which are in state R */
 	resource_resv **exiting_jobs;	/* array of jobs which are in state E */
 	resource_resv **jobs;		/* all the jobs in the server */
+	void *jobs_idx;			/* index of jobs by name */
 	resource_resv **all_resresv;	/* a list of all jobs and adv resvs */
+	void *all_resresv_idx;		/* index of all_resresv by name */
 	event_list *calendar;		/* the calendar of events */
 	char *job_sort_formula;	/* set via the JSF attribute of either the sched, or the server */
 
@@ -862,9 +898,19 @@ struct schd_resource
 
 	resdef *def;			/* resource definition */
 
+	resource_lookup *res_ind;	/* lookup table by resdef index - only set on list heads */
+
 	struct schd_resource *next;	/* next resource in list */
 };
 
+/* dense lookup table for a schd_resource list, indexed by resdef->idx */
+struct resource_lookup
+{
+	int num_defs;			/* size of res - one past the highest indexed resdef */
+	schd_resource *tail;		/* last resource in the list when it was indexed */
+	schd_resource **res;		/* resources in the list by resdef index */
+};
+
 struct resource_req
 {
 	char *name;			/* name of the resource - reference to the definition name */
@@ -881,6 +927,7 @@ struct resdef
 	char *name;			/* name of resource */
 	struct resource_type type;	/* resource type */
 	unsigned int flags;		/* resource flags (see pbs_ifl.h) */
+	int idx;			/* dense index of the resource (its position in allres) */
 };
 
 struct prev_job_info
@@ -922,6 +969,8 @@ struct fairshare_head
 {
 	group_info *root;			/* root of fairshare tree */
 	time_t last_decay;			/* last time tree was decayed */
+	unsigned int usage_generation;		/* generation of the usage file last read or written */
+	int journal_len;			/* number of records in the usage journal */
 };
 
 /* a path from the root to a group_info in the tree */
@@ -952,6 +1001,11 @@ struct group_info
 
 	struct group_path *gpath;		/* path from the root of the tree */
 
+	usage_t pending_usage;			/* usage accrued since the usage file was last synced */
+	int child_shares;			/* sum of the shares of the children */
+	unsigned int child_perc_stale:1;	/* children's percentages need recalculating */
+	void *name_idx;				/* name -> group_info index, only set on the tree root */
+
 	group_info *parent;			/* parent node */
 	group_info *sibling;			/* sibling node */
 	group_info *child;			/* child node */
@@ -974,6 +1028,8 @@ struct resresv_set
 	place *place_spec;		/* place spec of set */
 	resource_req *req;		/* ATTR_L (qsub -l) resources of set.  Only contains resources on the resources line */
 	queue_info *qinfo;		/* The queue the resresv is in if the queue has nodes associated */
+	unsigned long long key_hash;	/* hash of the set's key (see resresv_set_hash()) */
+	int num_members;		/* number of resresvs in the set */
 };
 
 struct node_partition
@@ -1033,6 +1089,33 @@ struct group_node_usage_v2
 	usage_t usage;
 };
 
+/* Version 3 follows the group_node_header with this header and then an array
+ * of group_node_usage_v2 records, so the file can be mapped and used in place.
+ * The file is written to a temporary file and renamed into place.
+ */
+struct group_node_usage_v3_header
+{
+	time_t last_decay;		/* last time the tree was decayed */
+	unsigned int generation;	/* ties journals to this file */
+	unsigned int num_entities;	/* number of records following the header */
+	unsigned int checksum;		/* over the records and this header (checksum as 0) */
+};
+
+/* The usage journal is a group_node_header followed by this header and a
+ * sequence of group_node_journal records.  Each record holds usage to add
+ * to an entity and everything on its path to the root.
+ */
+struct group_node_journal_header
+{
+	unsigned int generation;	/* generation of the usage file this applies to */
+};
+
+struct group_node_journal
+{
+	struct group_node_usage_v2 grp;	/* usage is the amount accrued */
+	unsigned int checksum;		/* over grp */
+};
+
 struct usage_info
 {
 	char *name;			/* name of the user */
@@ -1182,6 +1265,7 @@ struct config
 	int unknown_shares;			/* unknown group shares */
 	int max_preempt_attempts;		/* max num of preempt attempts per cyc*/
 	int max_jobs_to_check;			/* max number of jobs to check in cyc*/
+	int runjob_pipeline_depth;		/* max outstanding run requests (0 = wait for each) */
 	char ded_prefix[PBS_MAXQUEUENAME +1];	/* prefix to dedicated queues */
 	char pt_prefix[PBS_MAXQUEUENAME +1];	/* prefix to primetime queues */
 	char npt_prefix[PBS_MAXQUEUENAME +1];	/* prefix to non primetime queues */
@@ -1228,6 +1312,10 @@ struct event_list
 	timed_event *next_event;	/* the next event to be performed */
 	timed_event *first_run_event;	/* The first run event in the calendar */
 	time_t *current_time;		/* [reference] current time in the calendar */
+	/* skip list index over events: level 0 is events/next itself */
+	timed_event *skip_head[CALENDAR_SKIP_LEVELS];
+	int skip_top;			/* number of levels in use */
+	unsigned int skip_seed;		/* state for picking new event levels */
 };
 
 struct timed_event
@@ -1241,6 +1329,8 @@ struct timed_event
 	void *event_func_arg;		/* optional argument to function - not freed */
 	timed_event *next;
 	timed_event *prev;
+	int skip_lvl;			/* number of skip list levels this event is on */
+	timed_event **skip_next;	/* forward links for levels 1 .. skip_lvl - 1 */
 };
 
 struct te_list {
@@ -1282,6 +1372,17 @@ struct resresv_filter {
 	resource_resv *job;
 	schd_error *err;		/* reason why set can not run*/
 };
+
+/* running jobs which can be preempted for one high priority job.  Built once
+ * per find_jobs_to_preempt() call and queried by select_index_to_preempt()
+ */
+struct preempt_index {
+	resource_resv **cands;		/* candidates in preemption order */
+	int num_cands;
+	signed char *node_useful;	/* by node_ind: 1 node can help the job, -1 not, 0 unknown */
+	int num_nodes;
+	resdef **rdtc_non_consumable;	/* non consumable resources to check on multivnoded hosts */
+};
 #ifdef	__cplusplus
 }
 #endif
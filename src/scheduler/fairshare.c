@@ -61,9 +61,13 @@
  * 	print_fairshare()
  * 	write_usage()
  * 	rec_write_usage()
+ * 	write_usage_journal()
+ * 	sync_usage()
  * 	read_usage()
  * 	read_usage_v1()
  * 	read_usage_v2()
+ * 	read_usage_v3()
+ * 	read_usage_journal()
  * 	new_group_path()
  * 	free_group_path_list()
  * 	create_group_path()
@@ -75,6 +79,7 @@
  * 	dup_fairshare_head()
  * 	free_fairshare_head()
  * 	reset_temp_usage()
+ * 	refresh_fair_share_perc()
  *
  */
 #include <pbs_config.h>
@@ -83,8 +88,15 @@
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <math.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/param.h>
+#include <sys/stat.h>
 
 #include <log.h>
+#include <pbs_idx.h>
 
 #include "data_types.h"
 #include "job_info.h"
@@ -105,6 +117,12 @@
 
 extern time_t last_decay;
 
+/* seed of the usage file checksum (32 bit FNV-1a) */
+#define USAGE_CHECKSUM_INIT 2166136261U
+
+/* find_alloc_ginfo() is called from the query_jobs() worker threads */
+static pthread_mutex_t fairshare_lock = PTHREAD_MUTEX_INITIALIZER;
+
 /**
  * @brief
  *		add_child - add a group_info to the resource group tree
@@ -118,12 +136,23 @@ extern time_t last_decay;
 void
 add_child(group_info *ginfo, group_info *parent)
 {
+	group_info *root;
+
 	if (parent != NULL) {
 		ginfo->sibling = parent->child;
 		parent->child = ginfo;
 		ginfo->parent = parent;
 		ginfo->resgroup = parent->cresgroup;
 		ginfo->gpath = create_group_path(ginfo);
+		parent->child_shares += ginfo->shares;
+
+		/* the path to the root was just built; its head is the tree root */
+		root = ginfo->gpath != NULL ? ginfo->gpath->ginfo : NULL;
+		if (root != NULL && root->name_idx != NULL) {
+			if (pbs_idx_insert(root->name_idx, ginfo->name, ginfo) != PBS_IDX_RET_OK)
+				log_eventf(PBSEVENT_SCHED, PBS_EVENTCLASS_FILE, LOG_WARNING, ginfo->name,
+					"Failed to add fairshare entity to the name index");
+		}
 	}
 }
 
@@ -142,15 +171,51 @@ add_unknown(group_info *ginfo, group_info *root)
 {
 	group_info *unknown;		/* ptr to the "unknown" group */
 
-	unknown = find_group_info("unknown", root);
+	unknown = find_group_info(UNKNOWN_GROUP_NAME, root);
 	add_child(ginfo, unknown);
-	calc_fair_share_perc(unknown->child, UNSPECIFIED);
+
+	/* Only the new entity's percentage is calculated now.  Its siblings'
+	 * shrink a little and are recalculated in one pass by
+	 * refresh_fair_share_perc() instead of once per new entity.
+	 */
+	if (unknown->child_shares * unknown->tree_percentage == 0) {
+		ginfo->group_percentage = 0;
+		ginfo->tree_percentage = 0;
+	} else {
+		ginfo->group_percentage = (float) ginfo->shares / unknown->child_shares;
+		ginfo->tree_percentage = ginfo->group_percentage * unknown->tree_percentage;
+	}
+	unknown->child_perc_stale = 1;
 }
 
 /**
  * @brief
- *		find_group_info - recursive function to find a group_info in the
- *			  resgroup tree
+ *		refresh_fair_share_perc - recalculate the percentages of the
+ *			"unknown" group's children if entities were added to it
+ *			since the last refresh
+ *
+ * @param[in]	root	-	root of the fairshare tree
+ *
+ * @return	nothing
+ *
+ */
+void
+refresh_fair_share_perc(group_info *root)
+{
+	group_info *unknown;
+
+	unknown = find_group_info(UNKNOWN_GROUP_NAME, root);
+	if (unknown != NULL && unknown->child_perc_stale) {
+		calc_fair_share_perc(unknown->child, unknown->child_shares);
+		unknown->child_perc_stale = 0;
+	}
+}
+
+/**
+ * @brief
+ *		find_group_info - find a group_info in the resgroup tree.  Lookups
+ *			  from the root of the tree go through its name index,
+ *			  lookups from a sub-tree walk it recursively.
  *
  * @param[in]	name	-	name of the ginfo to find
  * @param[in]	root	-	the root of the current sub-tree
@@ -165,6 +230,12 @@ find_group_info(char *name, group_info *root)
 	if (root == NULL || name == NULL || !strcmp(name, root->name))
 		return root;
 
+	if (root->name_idx != NULL) {
+		if (pbs_idx_find(root->name_idx, (void **) &name, (void **) &ginfo, NULL) != PBS_IDX_RET_OK)
+			return NULL;
+		return ginfo;
+	}
+
 	ginfo = find_group_info(name, root->sibling);
 	if (ginfo == NULL)
 		ginfo = find_group_info(name, root->child);
@@ -192,16 +263,20 @@ find_alloc_ginfo(char *name, group_info *root)
 	if (name == NULL || root == NULL)
 		return NULL;
 
+	pthread_mutex_lock(&fairshare_lock);
 	ginfo = find_group_info(name, root);
 
 	if (ginfo == NULL) {
-		if ((ginfo = new_group_info()) == NULL)
+		if ((ginfo = new_group_info()) == NULL) {
+			pthread_mutex_unlock(&fairshare_lock);
 			return NULL;
+		}
 
 		ginfo->name = string_dup(name);
 		ginfo->shares = 1;
 		add_unknown(ginfo, root);
 	}
+	pthread_mutex_unlock(&fairshare_lock);
 	return ginfo;
 }
 
@@ -231,7 +306,11 @@ new_group_info()
 	new->usage = FAIRSHARE_MIN_USAGE;
 	new->temp_usage = FAIRSHARE_MIN_USAGE;
 	new->usage_factor = 0.0;
+	new->pending_usage = 0;
 	new->gpath = NULL;
+	new->child_shares = 0;
+	new->child_perc_stale = 0;
+	new->name_idx = NULL;
 	new->parent = NULL;
 	new->sibling = NULL;
 	new->child = NULL;
@@ -384,6 +463,8 @@ preload_tree()
 	root->resgroup = -1;
 	root->cresgroup = 0;
 	root->tree_percentage = 1.0;
+	/* if this fails, find_group_info() falls back to walking the tree */
+	root->name_idx = pbs_idx_create(0, 0);
 
 	if ((unknown = new_group_info()) == NULL) {
 		free_fairshare_head(head);
@@ -505,28 +586,53 @@ update_usage_on_run(resource_resv *resresv)
 			"Job doesn't have a group_info ptr set, usage not updated.");
 }
 
+/**
+ * @brief
+ *		recursive helper function to decay_fairshare_tree()
+ *
+ * @param[in,out]	root	-	the root of the current sub-tree
+ * @param[in]	factor	-	factor to multiply the usage by
+ *
+ * @return nothing
+ */
+static void
+decay_fairshare_tree_rec(group_info *root, double factor)
+{
+	group_info *ginfo;
+
+	for (ginfo = root; ginfo != NULL; ginfo = ginfo->sibling) {
+		decay_fairshare_tree_rec(ginfo->child, factor);
+
+		ginfo->usage *= factor;
+		if (ginfo->usage < FAIRSHARE_MIN_USAGE)
+			ginfo->usage = FAIRSHARE_MIN_USAGE;
+	}
+}
+
 /**
  * @brief
  *		decay_fairshare_tree - decay the usage information kept in the fair
  *			       share tree
  *
+ * @par
+ *		Several half lives are applied in a single pass over the tree.
+ *		Decaying by the combined factor and clamping to FAIRSHARE_MIN_USAGE
+ *		once gives the same result as decaying and clamping once per half
+ *		life, since the decay factor is at most 1.
+ *
  * @param[in,out]	root	-	the root of the fairshare tree
+ * @param[in]	num_decays	-	number of half lives to decay by
  *
  * @return nothing
  *
  */
 void
-decay_fairshare_tree(group_info *root)
+decay_fairshare_tree(group_info *root, int num_decays)
 {
-	if (root == NULL)
+	if (root == NULL || num_decays <= 0)
 		return;
 
-	decay_fairshare_tree(root->sibling);
-	decay_fairshare_tree(root->child);
-
-	root->usage *= conf.fairshare_decay_factor;
-	if (root->usage < FAIRSHARE_MIN_USAGE)
-		root->usage = FAIRSHARE_MIN_USAGE;
+	decay_fairshare_tree_rec(root, pow(conf.fairshare_decay_factor, num_decays));
 }
 
 /**
@@ -590,11 +696,83 @@ compare_path(struct group_path *gp1, struct group_path *gp2)
 	return rc;
 }
 
+/**
+ * @brief
+ *		usage_checksum - fold a buffer into a running usage file checksum
+ *		(32 bit FNV-1a).  Start a new checksum with USAGE_CHECKSUM_INIT.
+ *
+ * @param[in]	sum	-	checksum to continue from
+ * @param[in]	buf	-	data to add
+ * @param[in]	len	-	length of buf
+ *
+ * @return	the new checksum
+ */
+static unsigned int
+usage_checksum(unsigned int sum, const void *buf, size_t len)
+{
+	const unsigned char *p = buf;
+
+	while (len-- > 0) {
+		sum ^= *p++;
+		sum *= 16777619U;
+	}
+
+	return sum;
+}
+
+/**
+ * @brief
+ *		usage_header_checksum - finish a version 3 checksum by folding in the
+ *		header with its checksum member zeroed
+ *
+ * @param[in]	sum	-	checksum of the records
+ * @param[in]	v3	-	the header
+ *
+ * @return	the final checksum
+ */
+static unsigned int
+usage_header_checksum(unsigned int sum, struct group_node_usage_v3_header *v3)
+{
+	struct group_node_usage_v3_header h;
+
+	memset(&h, 0, sizeof(h));
+	h.last_decay = v3->last_decay;
+	h.generation = v3->generation;
+	h.num_entities = v3->num_entities;
+
+	return usage_checksum(sum, &h, sizeof(h));
+}
+
+/**
+ * @brief
+ *		clear_pending_usage - forget the usage accrued since the last sync
+ *		once it has been written out
+ *
+ * @param[in,out]	root	-	the root of the current subtree
+ *
+ * @return nothing
+ */
+static void
+clear_pending_usage(group_info *root)
+{
+	group_info *ginfo;
+
+	for (ginfo = root; ginfo != NULL; ginfo = ginfo->sibling) {
+		ginfo->pending_usage = 0;
+		clear_pending_usage(ginfo->child);
+	}
+}
+
 /**
  * @brief
  *		write_usage - write the usage information to the usage file
  *		      This function uses a recursive helper function
  *
+ * @par
+ *		The file is written to <filename>.new, synced and renamed over
+ *		filename, so a crash leaves either the old or the new file.  A new
+ *		file starts a new generation, which retires the journal of the old.
+ *
  * @param[in]	filename	-	usage file
  * @param[in]	fhead	-	Pointer to fairshare_head structure.
  *
@@ -606,6 +784,10 @@ write_usage(char *filename, fairshare_head *fhead)
 {
 	FILE *fp;		/* file pointer to usage file */
 	struct group_node_header head;
+	struct group_node_usage_v3_header v3;
+	char tmpname[MAXPATHLEN + 1];
+	char jname[MAXPATHLEN + 1];
+	int err = 0;
 
 	if (fhead == NULL)
 		return 0;
@@ -613,27 +795,59 @@ write_usage(char *filename, fairshare_head *fhead)
 	if (filename == NULL)
 		filename = USAGE_FILE;
 
-	if ((fp = fopen(filename, "wb")) == NULL) {
-		sprintf(log_buffer, "Error opening file %s", filename);
+	snprintf(tmpname, sizeof(tmpname), "%s.new", filename);
+	snprintf(jname, sizeof(jname), "%s%s", filename, USAGE_JOURNAL_SUFFIX);
+
+	if ((fp = fopen(tmpname, "wb")) == NULL) {
+		sprintf(log_buffer, "Error opening file %s", tmpname);
 		log_err(errno, "write_usage", log_buffer);
 		return 0;
 	}
 
-	/* version 2:
+	/* version 3:
 	 * header
-	 * last_decay
+	 * group_node_usage_v3_header
 	 * group_node_usage_v2
 	 * group_node_usage_v2
 	 * ...
 	 */
 
+	memset(&head, 0, sizeof(head));
 	pbs_strncpy(head.tag, USAGE_MAGIC, sizeof(head.tag));
 	head.version = USAGE_VERSION;
+	memset(&v3, 0, sizeof(v3));
+	v3.last_decay = fhead->last_decay;
+	v3.generation = fhead->usage_generation + 1;
+	if (v3.generation == 0)
+		v3.generation = 1;
+	v3.checksum = USAGE_CHECKSUM_INIT;
+
+	/* the v3 header is rewritten once the records are counted and summed */
 	fwrite(&head, sizeof(struct group_node_header), 1, fp);
-	fwrite(&fhead->last_decay, sizeof(time_t), 1, fp);
+	fwrite(&v3, sizeof(v3), 1, fp);
+	rec_write_usage(fhead->root, fp, &v3);
+	v3.checksum = usage_header_checksum(v3.checksum, &v3);
+
+	if (fseek(fp, sizeof(struct group_node_header), SEEK_SET) != 0 ||
+		fwrite(&v3, sizeof(v3), 1, fp) != 1 ||
+		fflush(fp) != 0 || ferror(fp) || fsync(fileno(fp)) != 0)
+		err = errno;
+	if (fclose(fp) != 0 && err == 0)
+		err = errno;
+
+	if (err != 0 || rename(tmpname, filename) != 0) {
+		sprintf(log_buffer, "Error writing file %s", filename);
+		log_err(err != 0 ? err : errno, "write_usage", log_buffer);
+		unlink(tmpname);
+		return 0;
+	}
+
+	/* the journal belongs to the previous generation now */
+	unlink(jname);
+	fhead->usage_generation = v3.generation;
+	fhead->journal_len = 0;
+	clear_pending_usage(fhead->root);
 
-	rec_write_usage(fhead->root, fp);
-	fclose(fp);
 	return 1;
 }
 
@@ -644,12 +858,13 @@ write_usage(char *filename, fairshare_head *fhead)
  *
  * @param[in]	root	-	the root of the current subtree
  * @param[in]	fp	-	the file to write the ginfo out to
+ * @param[in,out]	v3	-	header to count and checksum the records in
  *
  * @return nothing
  *
  */
 void
-rec_write_usage(group_info *root, FILE *fp)
+rec_write_usage(group_info *root, FILE *fp, struct group_node_usage_v3_header *v3)
 {
 	struct group_node_usage_v2 grp;	/* used to write out usage info */
 
@@ -665,14 +880,202 @@ rec_write_usage(group_info *root, FILE *fp)
 #else
 	if (root->usage != 1 && root->child == NULL && strcmp(root->name, UNKNOWN_GROUP_NAME) != 0) {
 #endif /* localmod 043 */
+		/* zero the padding too, it is part of the checksum */
+		memset(&grp, 0, sizeof(grp));
 		snprintf(grp.name, sizeof(grp.name), "%s", root->name);
 		grp.usage = root->usage;
 
 		fwrite(&grp, sizeof(struct group_node_usage_v2), 1, fp);
+		v3->num_entities++;
+		v3->checksum = usage_checksum(v3->checksum, &grp, sizeof(grp));
+	}
+
+	rec_write_usage(root->sibling, fp, v3);
+	rec_write_usage(root->child, fp, v3);
+}
+
+/**
+ * @brief
+ *		rec_write_usage_journal - recursive helper function which appends a
+ *			  journal record for every entity with pending usage
+ *
+ * @param[in]	root	-	the root of the current subtree
+ * @param[in]	fp	-	the journal
+ *
+ * @return	number of records written
+ */
+static int
+rec_write_usage_journal(group_info *root, FILE *fp)
+{
+	struct group_node_journal rec;
+	group_info *ginfo;
+	int num = 0;
+
+	for (ginfo = root; ginfo != NULL; ginfo = ginfo->sibling) {
+		if (ginfo->child == NULL && ginfo->pending_usage > 0) {
+			memset(&rec, 0, sizeof(rec));
+			snprintf(rec.grp.name, sizeof(rec.grp.name), "%s", ginfo->name);
+			rec.grp.usage = ginfo->pending_usage;
+			rec.checksum = usage_checksum(USAGE_CHECKSUM_INIT, &rec.grp, sizeof(rec.grp));
+			fwrite(&rec, sizeof(rec), 1, fp);
+			num++;
+		}
+		num += rec_write_usage_journal(ginfo->child, fp);
+	}
+
+	return num;
+}
+
+/**
+ * @brief
+ *		write_usage_journal - append the usage accrued since the last sync
+ *			  to the usage journal instead of rewriting the usage file
+ *
+ * @par
+ *		A journal left by an older generation of the usage file is
+ *		discarded, as is a partial record at its end from a crash.
+ *
+ * @param[in]	filename	-	usage file (the journal is next to it)
+ * @param[in]	fhead	-	Pointer to fairshare_head structure.
+ *
+ * @return	success/failure
+ */
+int
+write_usage_journal(char *filename, fairshare_head *fhead)
+{
+	FILE *fp;
+	struct group_node_header head;
+	struct group_node_journal_header jhead;
+	char jname[MAXPATHLEN + 1];
+	size_t hlen = sizeof(head) + sizeof(jhead);
+	struct stat sb;
+	off_t len;
+	int num;
+
+	if (fhead == NULL || fhead->usage_generation == 0)
+		return 0;
+
+	if (filename == NULL)
+		filename = USAGE_FILE;
+	snprintf(jname, sizeof(jname), "%s%s", filename, USAGE_JOURNAL_SUFFIX);
+
+	if ((fp = fopen(jname, "r+b")) == NULL && (fp = fopen(jname, "w+b")) == NULL) {
+		sprintf(log_buffer, "Error opening file %s", jname);
+		log_err(errno, __func__, log_buffer);
+		return 0;
+	}
+
+	if (fstat(fileno(fp), &sb) != 0 || (size_t) sb.st_size < hlen ||
+		fread(&head, sizeof(head), 1, fp) != 1 ||
+		fread(&jhead, sizeof(jhead), 1, fp) != 1 ||
+		jhead.generation != fhead->usage_generation) {
+		/* start a fresh journal for this generation */
+		memset(&head, 0, sizeof(head));
+		pbs_strncpy(head.tag, USAGE_MAGIC, sizeof(head.tag));
+		head.version = USAGE_VERSION;
+		memset(&jhead, 0, sizeof(jhead));
+		jhead.generation = fhead->usage_generation;
+		if (ftruncate(fileno(fp), 0) != 0)
+			goto err;
+		rewind(fp);
+		fwrite(&head, sizeof(head), 1, fp);
+		fwrite(&jhead, sizeof(jhead), 1, fp);
+		len = hlen;
+	} else {
+		/* drop a partial record from a crash mid-append */
+		len = hlen + (sb.st_size - hlen) / sizeof(struct group_node_journal) *
+			sizeof(struct group_node_journal);
+		if (len != sb.st_size && ftruncate(fileno(fp), len) != 0)
+			goto err;
 	}
 
-	rec_write_usage(root->sibling, fp);
-	rec_write_usage(root->child, fp);
+	if (fseek(fp, len, SEEK_SET) != 0)
+		goto err;
+	num = rec_write_usage_journal(fhead->root, fp);
+	if (fflush(fp) != 0 || ferror(fp) || fsync(fileno(fp)) != 0)
+		goto err;
+	fclose(fp);
+
+	fhead->journal_len += num;
+	clear_pending_usage(fhead->root);
+	return 1;
+
+err:
+	sprintf(log_buffer, "Error writing file %s", jname);
+	log_err(errno, __func__, log_buffer);
+	fclose(fp);
+	return 0;
+}
+
+/**
+ * @brief
+ *		sync_usage - write out the usage accrued since the last sync.  It goes
+ *		to the journal unless a full write was asked for (e.g., after a
+ *		decay changed every entity), the journal is too long, or there is no
+ *		version 3 usage file for the journal to apply to.
+ *
+ * @param[in]	filename	-	usage file
+ * @param[in]	fhead	-	Pointer to fairshare_head structure.
+ * @param[in]	full	-	rewrite the whole usage file
+ *
+ * @return	success/failure
+ */
+int
+sync_usage(char *filename, fairshare_head *fhead, int full)
+{
+	if (fhead == NULL)
+		return 0;
+
+	if (!full && fhead->usage_generation != 0 && fhead->journal_len < USAGE_JOURNAL_MAX) {
+		if (write_usage_journal(filename, fhead))
+			return 1;
+	}
+
+	return write_usage(filename, fhead);
+}
+
+/**
+ * @brief
+ * 		load one entity's usage record from a version 2 or 3 usage file
+ *
+ * @param[in]	grp	- the record
+ * @param[in]	flags	- flags to check whether to trim or not.
+ * @param[in]	root	- root of the fairshare tree
+ *
+ * @return nothing
+ */
+static void
+load_entity_usage(struct group_node_usage_v2 *grp, int flags, group_info *root)
+{
+	group_info *ginfo;
+	struct group_path *gpath;
+
+	if (grp->usage >= 0 && is_valid_pbs_name(grp->name, USAGE_NAME_MAX)) {
+		/* if we're trimming the tree, don't add any new nodes which are not
+		 * already in the resource_group file
+		 */
+		if (flags & FS_TRIM)
+			ginfo = find_group_info(grp->name, root);
+		else
+			ginfo = find_alloc_ginfo(grp->name, root);
+
+		if (ginfo != NULL) {
+			ginfo->usage = grp->usage;
+			ginfo->temp_usage = grp->usage;
+			if (ginfo->child == NULL) {
+				gpath = ginfo->gpath;
+				/* add usage down the path from the root to our parent */
+				while (gpath->next != NULL) {
+					gpath->ginfo->usage += grp->usage;
+					gpath->ginfo->temp_usage += grp->usage;
+					gpath = gpath->next;
+				}
+			}
+		}
+	}
+	else
+		log_event(PBSEVENT_SCHED, PBS_EVENTCLASS_FILE, LOG_WARNING,
+			  "fairshare usage", "Invalid entity");
 }
 
 /**
@@ -701,6 +1104,9 @@ read_usage(char *filename, int flags, fairshare_head *fhead)
 	if (filename == NULL)
 		filename = USAGE_FILE;
 
+	fhead->usage_generation = 0;
+	fhead->journal_len = 0;
+
 	if ((fp = fopen(filename, "r")) == NULL) {
 		log_event(PBSEVENT_SCHED, PBS_EVENTCLASS_FILE, LOG_WARNING, "fairshare usage",
 			  "Creating usage database for fairshare");
@@ -711,7 +1117,13 @@ read_usage(char *filename, int flags, fairshare_head *fhead)
 	/* read header */
 	if (fread(&head, sizeof(struct group_node_header), 1, fp) != 0) {
 		if (!strcmp(head.tag, USAGE_MAGIC)) { /* this is a header */
-			if (head.version == 2) {
+			if (head.version == 3) {
+				if (read_usage_v3(fp, flags, fhead))
+					read_usage_journal(filename, flags, fhead);
+				else
+					error = 1;
+			}
+			else if (head.version == 2) {
 				if (fread(&last, sizeof(time_t), 1, fp) != 0) {
 					/* 946713600 = 1/1/2000 00:00 - before usage version 2 existed */
 					if (last == 0 || last > 946713600)
@@ -739,6 +1151,144 @@ read_usage(char *filename, int flags, fairshare_head *fhead)
 	fclose(fp);
 }
 
+/**
+ * @brief
+ * 		read version 3 usage file.  The file is mapped and its records are
+ *		used in place.  Nothing is loaded unless the checksum matches.
+ *
+ * @param[in]	fp	- the usage file, positioned after the group_node_header
+ * @param[in]	flags	- flags to check whether to trim or not.
+ * @param[in,out]	fhead	- fairshare tree to load into
+ *
+ * @return	int
+ * @retval	1	: success
+ * @retval	0	: failure
+ */
+int
+read_usage_v3(FILE *fp, int flags, fairshare_head *fhead)
+{
+	struct group_node_usage_v3_header v3;
+	struct group_node_usage_v2 *recs;
+	struct stat sb;
+	size_t off = sizeof(struct group_node_header) + sizeof(v3);
+	unsigned int sum;
+	unsigned int i;
+	char *map;
+
+	if (fp == NULL || fhead == NULL)
+		return 0;
+
+	if (fstat(fileno(fp), &sb) != 0 || (size_t) sb.st_size < off)
+		return 0;
+
+	map = mmap(NULL, sb.st_size, PROT_READ, MAP_PRIVATE, fileno(fp), 0);
+	if (map == MAP_FAILED) {
+		log_err(errno, __func__, "Unable to map usage file");
+		return 0;
+	}
+
+	memcpy(&v3, map + sizeof(struct group_node_header), sizeof(v3));
+	recs = (struct group_node_usage_v2 *) (map + off);
+	if ((size_t) sb.st_size != off + (size_t) v3.num_entities * sizeof(*recs)) {
+		munmap(map, sb.st_size);
+		return 0;
+	}
+
+	sum = usage_checksum(USAGE_CHECKSUM_INIT, recs, (size_t) v3.num_entities * sizeof(*recs));
+	if (usage_header_checksum(sum, &v3) != v3.checksum) {
+		log_event(PBSEVENT_SCHED, PBS_EVENTCLASS_FILE, LOG_WARNING,
+			"fairshare usage", "Usage file checksum mismatch, usage not loaded");
+		munmap(map, sb.st_size);
+		return 0;
+	}
+
+	/* 946713600 = 1/1/2000 00:00 - before usage version 2 existed */
+	if (v3.last_decay == 0 || v3.last_decay > 946713600)
+		fhead->last_decay = v3.last_decay;
+	fhead->usage_generation = v3.generation;
+
+	for (i = 0; i < v3.num_entities; i++)
+		load_entity_usage(&recs[i], flags, fhead->root);
+
+	munmap(map, sb.st_size);
+	return 1;
+}
+
+/**
+ * @brief
+ * 		replay the usage journal on top of a version 3 usage file.  Records
+ *		are replayed up to the first damaged one, where the journal is
+ *		truncated so records appended later are not stranded behind it.
+ *
+ * @param[in]	filename	- usage file (the journal is next to it)
+ * @param[in]	flags	- flags to check whether to trim or not.
+ * @param[in,out]	fhead	- fairshare tree the usage file was loaded into
+ *
+ * @return	number of records replayed
+ */
+int
+read_usage_journal(char *filename, int flags, fairshare_head *fhead)
+{
+	FILE *fp;
+	struct group_node_header head;
+	struct group_node_journal_header jhead;
+	struct group_node_journal rec;
+	struct group_path *gpath;
+	group_info *ginfo;
+	char jname[MAXPATHLEN + 1];
+	int num = 0;
+
+	if (fhead == NULL || fhead->usage_generation == 0)
+		return 0;
+
+	if (filename == NULL)
+		filename = USAGE_FILE;
+	snprintf(jname, sizeof(jname), "%s%s", filename, USAGE_JOURNAL_SUFFIX);
+
+	if ((fp = fopen(jname, "r+b")) == NULL && (fp = fopen(jname, "rb")) == NULL)
+		return 0;
+
+	/* a journal from another generation was already folded into the file */
+	if (fread(&head, sizeof(head), 1, fp) != 1 || strcmp(head.tag, USAGE_MAGIC) ||
+		fread(&jhead, sizeof(jhead), 1, fp) != 1 ||
+		jhead.generation != fhead->usage_generation) {
+		fclose(fp);
+		return 0;
+	}
+
+	while (fread(&rec, sizeof(rec), 1, fp) == 1) {
+		if (usage_checksum(USAGE_CHECKSUM_INIT, &rec.grp, sizeof(rec.grp)) != rec.checksum) {
+			log_event(PBSEVENT_SCHED, PBS_EVENTCLASS_FILE, LOG_WARNING,
+				"fairshare usage", "Damaged usage journal record, journal truncated");
+			if (ftruncate(fileno(fp), sizeof(head) + sizeof(jhead) + num * sizeof(rec)) != 0) {
+				sprintf(log_buffer, "Error truncating file %s", jname);
+				log_err(errno, __func__, log_buffer);
+			}
+			break;
+		}
+		num++;
+		if (rec.grp.usage < 0 || !is_valid_pbs_name(rec.grp.name, USAGE_NAME_MAX))
+			continue;
+
+		if (flags & FS_TRIM)
+			ginfo = find_group_info(rec.grp.name, fhead->root);
+		else
+			ginfo = find_alloc_ginfo(rec.grp.name, fhead->root);
+
+		/* the journal holds accrued usage: add it all the way down the path */
+		if (ginfo != NULL) {
+			for (gpath = ginfo->gpath; gpath != NULL; gpath = gpath->next) {
+				gpath->ginfo->usage += rec.grp.usage;
+				gpath->ginfo->temp_usage += rec.grp.usage;
+			}
+		}
+	}
+	fclose(fp);
+
+	fhead->journal_len = num;
+	return num;
+}
+
 /**
  * @brief
  * 		read version 1 usage file
@@ -802,40 +1352,12 @@ int
 read_usage_v2(FILE *fp, int flags, group_info *root)
 {
 	struct group_node_usage_v2 grp;
-	group_info *ginfo;
-	struct group_path *gpath;
 
 	if (fp == NULL)
 		return 0;
 
-	while (fread(&grp, sizeof(struct group_node_usage_v2), 1, fp)) {
-		if (grp.usage >= 0 && is_valid_pbs_name(grp.name, USAGE_NAME_MAX)) {
-			/* if we're trimming the tree, don't add any new nodes which are not
-			 * already in the resource_group file
-			 */
-			if (flags & FS_TRIM)
-				ginfo = find_group_info(grp.name, root);
-			else
-				ginfo = find_alloc_ginfo(grp.name, root);
-
-			if (ginfo != NULL) {
-				ginfo->usage = grp.usage;
-				ginfo->temp_usage = grp.usage;
-				if (ginfo->child == NULL) {
-					gpath = ginfo->gpath;
-					/* add usage down the path from the root to our parent */
-					while (gpath->next != NULL) {
-						gpath->ginfo->usage += grp.usage;
-						gpath->ginfo->temp_usage += grp.usage;
-						gpath = gpath->next;
-					}
-				}
-			}
-		}
-		else
-			log_event(PBSEVENT_SCHED, PBS_EVENTCLASS_FILE, LOG_WARNING,
-				  "fairshare usage", "Invalid entity");
-	}
+	while (fread(&grp, sizeof(struct group_node_usage_v2), 1, fp))
+		load_entity_usage(&grp, flags, root);
 
 	return 1;
 }
@@ -973,6 +1495,7 @@ dup_fairshare_tree(group_info *root, group_info *nparent)
 	nroot->usage = root->usage;
 	nroot->usage_factor = root->usage_factor;
 	nroot->temp_usage = root->temp_usage;
+	nroot->child_perc_stale = root->child_perc_stale;
 	nroot->name = string_dup(root->name);
 
 	if (nroot->name == NULL) {
@@ -980,6 +1503,10 @@ dup_fairshare_tree(group_info *root, group_info *nparent)
 		return NULL;
 	}
 
+	/* the tree root carries the name index for the whole tree */
+	if (nparent == NULL && root->name_idx != NULL)
+		nroot->name_idx = pbs_idx_create(0, 0);
+
 	add_child(nroot, nparent);
 
 
@@ -1020,6 +1547,8 @@ free_fairshare_node(group_info *node)
 
 	free(node->name);
 	free_group_path_list(node->gpath);
+	if (node->name_idx != NULL)
+		pbs_idx_destroy(node->name_idx);
 	free(node);
 }
 
@@ -1039,6 +1568,8 @@ new_fairshare_head()
 
 	fhead->root = NULL;
 	fhead->last_decay = 0;
+	fhead->usage_generation = 0;
+	fhead->journal_len = 0;
 
 	return fhead;
 }
@@ -1066,6 +1597,8 @@ dup_fairshare_head(fairshare_head *ofhead)
 		return NULL;
 
 	nfhead->last_decay = ofhead->last_decay;
+	nfhead->usage_generation = ofhead->usage_generation;
+	nfhead->journal_len = ofhead->journal_len;
 	nfhead->root = dup_fairshare_tree(ofhead->root, NULL);
 	if (nfhead->root == NULL) {
 		free_fairshare_head(nfhead);
@@ -1176,4 +1709,5 @@ void reset_usage(group_info *node) {
 	reset_usage(node->child);
 	node->usage = 1;
 	node->temp_usage = 1;
+	node->pending_usage = 0;
 }
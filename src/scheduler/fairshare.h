@@ -131,7 +131,7 @@ void update_usage_on_run(resource_resv *resresv);
  *      decay_fairshare_tree - decay the usage information kept in the fair
  *                             share tree
  */
-void decay_fairshare_tree(group_info *root);
+void decay_fairshare_tree(group_info *root, int num_decays);
 
 /*
  *      write_usage - write the usage information to the usage file
@@ -143,7 +143,19 @@ int write_usage(char *filename, fairshare_head *fhead);
  *      rec_write_usage - recursive helper function which will write out all
  *                        the group_info structs of the resgroup tree
  */
-void rec_write_usage(group_info *root, FILE *fp);
+void rec_write_usage(group_info *root, FILE *fp, struct group_node_usage_v3_header *v3);
+
+/*
+ *      write_usage_journal - append the usage accrued since the last sync
+ *                            to the usage journal
+ */
+int write_usage_journal(char *filename, fairshare_head *fhead);
+
+/*
+ *      sync_usage - write out the usage accrued since the last sync, to the
+ *                   journal or by rewriting the usage file
+ */
+int sync_usage(char *filename, fairshare_head *fhead, int full);
 
 /*
  *      read_usage - read the usage information and load it into the
@@ -161,6 +173,16 @@ int read_usage_v1(FILE *fp, group_info *root);
  */
 int read_usage_v2(FILE *fp, int flags, group_info *root);
 
+/*
+ *      read_usage_v3 - read version 3 usage file
+ */
+int read_usage_v3(FILE *fp, int flags, fairshare_head *fhead);
+
+/*
+ *      read_usage_journal - replay the usage journal on top of the usage file
+ */
+int read_usage_journal(char *filename, int flags, fairshare_head *fhead);
+
 /*
  *      new_group_path - create a new group_path structure and init it
  */
@@ -250,6 +272,12 @@ void free_fairshare_head(fairshare_head *fhead);
  */
 void add_unknown(group_info *ginfo, group_info *root);
 
+/*
+ *	refresh_fair_share_perc - recalculate the percentages of the "unknown"
+ *				  group's children if entities were added to it
+ */
+void refresh_fair_share_perc(group_info *root);
+
 /*
  * 	reset_temp_usage - walk the fairshare tree resetting temp_usage = usage
  *
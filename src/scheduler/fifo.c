@@ -83,6 +83,7 @@
 #include <libutil.h>
 #include <pbs_error.h>
 #include <pbs_ifl.h>
+#include <libpbs.h>
 #include <sched_cmds.h>
 #include <time.h>
 #include <log.h>
@@ -118,6 +119,8 @@
 #include "limits_if.h"
 #include "pbs_version.h"
 #include "buckets.h"
+#include "cycle_profile.h"
+#include "obj_pool.h"
 #include "multi_threading.h"
 #include "pbs_python.h"
 
@@ -239,6 +242,8 @@ schedinit(int nthreads)
 		}
 	}
 
+	prof_init();
+
 	return 0;
 }
 
@@ -352,6 +357,7 @@ init_scheduling_cycle(status *policy, int pbs_sd, server_info *sinfo)
 	char decayed = 0;		/* boolean: have we decayed usage? */
 	time_t t;			/* used in decaying fair share */
 	usage_t delta;			/* the usage between last sch cycle and now */
+	int num_decays;			/* number of half lives since the last decay */
 	struct group_path *gpath;	/* used to update usage with delta */
 	static schd_error *err;
 	int i, j;
@@ -397,6 +403,8 @@ init_scheduling_cycle(status *policy, int pbs_sd, server_info *sinfo)
 
 							delta = IF_NEG_THEN_ZERO(delta);
 
+							/* remembered for the usage journal */
+							user->pending_usage += delta;
 							gpath = user->gpath;
 							while (gpath != NULL) {
 								gpath->ginfo->usage += delta;
@@ -409,19 +417,28 @@ init_scheduling_cycle(status *policy, int pbs_sd, server_info *sinfo)
 			}
 		}
 
+		/* entities created while querying jobs only had their own
+		 * percentage calculated, bring their siblings up to date
+		 */
+		refresh_fair_share_perc(sinfo->fairshare->root);
+
 		/* The half life for the fair share tree might have passed since the last
 		 * scheduling cycle.  For that matter, several half lives could have
-		 * passed.  If this is the case, perform as many decays as necessary
+		 * passed.  If this is the case, decay by all of them in one pass
 		 */
 
 		t = policy->current_time;
+		num_decays = 0;
 		while (conf.decay_time != SCHD_INFINITY &&
 			(t - sinfo->fairshare->last_decay) > conf.decay_time) {
-			log_event(PBSEVENT_DEBUG2, PBS_EVENTCLASS_SERVER, LOG_DEBUG,
-				  "Fairshare", "Decaying Fairshare Tree");
-			if (conf.fairshare != NULL)
-				decay_fairshare_tree(sinfo->fairshare->root);
 			t -= conf.decay_time;
+			num_decays++;
+		}
+		if (num_decays > 0) {
+			log_eventf(PBSEVENT_DEBUG2, PBS_EVENTCLASS_SERVER, LOG_DEBUG,
+				  "Fairshare", "Decaying Fairshare Tree by %d half lives", num_decays);
+			if (conf.fairshare != NULL)
+				decay_fairshare_tree(sinfo->fairshare->root, num_decays);
 			decayed = 1;
 			resort = 1;
 		}
@@ -434,7 +451,8 @@ init_scheduling_cycle(status *policy, int pbs_sd, server_info *sinfo)
 		}
 
 		if (policy->sync_fairshare_files && (decayed || last_running != NULL)) {
-			write_usage(USAGE_FILE, sinfo->fairshare);
+			/* a decay changes every entity, so rewrite the whole file */
+			sync_usage(USAGE_FILE, sinfo->fairshare, decayed);
 			log_event(PBSEVENT_DEBUG2, PBS_EVENTCLASS_SERVER, LOG_DEBUG,
 				  "Fairshare", "Usage Sync");
 		}
@@ -604,7 +622,9 @@ intermediate_schedule(int sd, char *jobid)
 	int cycle_cnt = 0; /* count of cycles run */
 
 	do {
+		prof_start_cycle();
 		ret = scheduling_cycle(sd, jobid);
+		prof_end_cycle();
 
 		/* don't restart cycle if :- */
 
@@ -672,7 +692,10 @@ scheduling_cycle(int sd, char *jobid)
 	do_hard_cycle_interrupt = 0;
 #endif /* localmod 030 */
 	/* create the server / queue / job / node structures */
-	if ((sinfo = query_server(&cstat, sd)) == NULL) {
+	prof_phase_start(PROF_QUERY_SERVER);
+	sinfo = query_server(&cstat, sd);
+	prof_phase_end(PROF_QUERY_SERVER);
+	if (sinfo == NULL) {
 		log_event(PBSEVENT_SYSTEM, PBS_EVENTCLASS_SERVER, LOG_NOTICE,
 			  "", "Problem with creating server data structure");
 		end_cycle_tasks(sinfo);
@@ -706,7 +729,7 @@ scheduling_cycle(int sd, char *jobid)
 		if (is_job_array(jobid) > 1) /* is a single subjob or a range */
 			modify_job_array_for_qrun(sinfo, jobid);
 		else
-			sinfo->qrun_job = find_resource_resv(sinfo->jobs, jobid);
+			sinfo->qrun_job = find_resource_resv_idx(sinfo->jobs_idx, sinfo->jobs, jobid);
 
 		if (sinfo->qrun_job == NULL) { /* something went wrong */
 			log_event(PBSEVENT_JOB, PBS_EVENTCLASS_JOB, LOG_INFO, jobid,
@@ -795,6 +818,201 @@ scheduling_cycle(int sd, char *jobid)
 	return 0;
 }
 
+/* run requests sent to the server whose replies have not been read yet */
+static struct {
+	int enabled;		/* pipeline run requests this cycle */
+	server_info *sinfo;	/* universe to reconcile failed requests against */
+	char **jobids;		/* ring of jobids of outstanding requests */
+	int size;		/* size of jobids */
+	int head;		/* index of oldest outstanding request */
+	int count;		/* number of outstanding requests */
+	int sent;		/* requests sent this cycle */
+	int failed;		/* requests which failed this cycle */
+} runjob_pipe;
+
+/**
+ * @brief	start pipelining run requests for a cycle
+ *
+ * @par	Pipelining is only used when the scheduler would otherwise wait
+ *	for an ack for each job it runs (job_run_wait=runjob_hook with a
+ *	runjob hook).  The server acks those requests before contacting MoM,
+ *	so the acks come back in the order the requests were sent.  It is not
+ *	used for qrun, since the result of the run is needed for the reply.
+ *
+ * @param[in]	sinfo	-	universe of the cycle
+ *
+ * @return	void
+ */
+static void
+start_runjob_pipeline(server_info *sinfo)
+{
+	char **tmp;
+
+	runjob_pipe.enabled = 0;
+	runjob_pipe.sinfo = sinfo;
+	runjob_pipe.head = 0;
+	runjob_pipe.count = 0;
+	runjob_pipe.sent = 0;
+	runjob_pipe.failed = 0;
+
+	if (conf.runjob_pipeline_depth <= 0 || sinfo->qrun_job != NULL ||
+	    sc_attrs.runjob_mode != RJ_RUNJOB_HOOK || !sinfo->has_runjob_hook)
+		return;
+
+	if (runjob_pipe.size != conf.runjob_pipeline_depth) {
+		tmp = realloc(runjob_pipe.jobids, conf.runjob_pipeline_depth * sizeof(char *));
+		if (tmp == NULL) {
+			log_err(errno, __func__, MEM_ERR_MSG);
+			return;
+		}
+		runjob_pipe.jobids = tmp;
+		runjob_pipe.size = conf.runjob_pipeline_depth;
+	}
+	runjob_pipe.enabled = 1;
+}
+
+/**
+ * @brief	read the reply to the oldest outstanding run request
+ *
+ * @par	The job was optimistically treated as running when its request was
+ *	sent.  If the server rejected it, its simulated start is undone: it is
+ *	put back in the queued state and the resources it was given in the
+ *	universe are returned, like a job which is requeued.  It is then
+ *	marked as can not run and its comment is updated, as for a job whose
+ *	run request fails in run_update_resresv().
+ *
+ * @param[in]	pbs_sd	-	connection descriptor to the server
+ *
+ * @return	void
+ */
+static void
+reap_runjob_pipeline(int pbs_sd)
+{
+	char *jobid;
+	char *errbuf;
+	char buf[MAX_LOG_SIZE];
+	int rc;
+	resource_resv *job;
+	schd_error *err;
+
+	if (runjob_pipe.count == 0)
+		return;
+
+	jobid = runjob_pipe.jobids[runjob_pipe.head];
+	runjob_pipe.head = (runjob_pipe.head + 1) % runjob_pipe.size;
+	runjob_pipe.count--;
+
+	if (pbs_client_thread_lock_connection(pbs_sd) != 0)
+		rc = pbs_errno;
+	else {
+		rc = PBSD_runjob_get(pbs_sd);
+		pbs_client_thread_unlock_connection(pbs_sd);
+	}
+	if (rc != 0) {
+		runjob_pipe.failed++;
+		errbuf = pbs_geterrmsg(pbs_sd);
+		job = find_resource_resv_idx(runjob_pipe.sinfo->jobs_idx,
+			runjob_pipe.sinfo->jobs, jobid);
+		err = new_schd_error();
+		if (job != NULL && job->job->is_running)
+			update_universe_on_end(runjob_pipe.sinfo->policy, job, "Q", NO_FLAGS);
+		if (job != NULL && err != NULL) {
+			set_schd_error_codes(err, NOT_RUN, RUN_FAILURE);
+			set_schd_error_arg(err, ARG1, errbuf == NULL ? "" : errbuf);
+			snprintf(buf, sizeof(buf), "%d", rc);
+			set_schd_error_arg(err, ARG2, buf);
+			update_job_can_not_run(pbs_sd, job, err);
+		} else
+			log_eventf(PBSEVENT_SCHED, PBS_EVENTCLASS_JOB, LOG_INFO, jobid,
+				"Failed to run: %s (%d)", errbuf == NULL ? "" : errbuf, rc);
+		free_schd_error(err);
+	}
+	free(jobid);
+}
+
+/**
+ * @brief	read the replies to all outstanding run requests
+ *
+ * @par	This must be called before any other request which reads a reply
+ *	is sent on the connection, or that request would read a run reply.
+ *
+ * @param[in]	pbs_sd	-	connection descriptor to the server
+ *
+ * @return	void
+ */
+void
+drain_runjob_pipeline(int pbs_sd)
+{
+	if (runjob_pipe.count == 0)
+		return;
+
+	prof_phase_start(PROF_RUN_JOB);
+	while (runjob_pipe.count > 0)
+		reap_runjob_pipeline(pbs_sd);
+	prof_phase_end(PROF_RUN_JOB);
+}
+
+/**
+ * @brief	stop pipelining run requests at the end of a cycle
+ *
+ * @param[in]	pbs_sd	-	connection descriptor to the server
+ *
+ * @return	void
+ */
+static void
+end_runjob_pipeline(int pbs_sd)
+{
+	drain_runjob_pipeline(pbs_sd);
+	if (runjob_pipe.enabled && runjob_pipe.sent > 0)
+		log_eventf(PBSEVENT_DEBUG2, PBS_EVENTCLASS_SCHED, LOG_DEBUG, __func__,
+			"Pipelined %d run requests, %d failed", runjob_pipe.sent, runjob_pipe.failed);
+	runjob_pipe.enabled = 0;
+	runjob_pipe.sinfo = NULL;
+}
+
+/**
+ * @brief	send a run request without waiting for its reply
+ *
+ * @par	If the pipeline is full, the reply to the oldest request is read first.
+ *
+ * @param[in]	pbs_sd	-	connection descriptor to the server
+ * @param[in]	jobid	-	id of the job to run
+ * @param[in]	execvnode	-	the execvnode to run the job on
+ *
+ * @return	int
+ * @retval	0	: request sent
+ * @retval	!0	: error sending the request
+ */
+static int
+pipeline_run_job(int pbs_sd, char *jobid, char *execvnode)
+{
+	char *id;
+	int rc;
+
+	if (runjob_pipe.count == runjob_pipe.size)
+		reap_runjob_pipeline(pbs_sd);
+
+	if ((id = string_dup(jobid)) == NULL)
+		return (pbs_errno = PBSE_SYSTEM);
+
+	if (pbs_client_thread_lock_connection(pbs_sd) != 0) {
+		free(id);
+		return pbs_errno;
+	}
+	rc = PBSD_runjob_put(pbs_sd, jobid, execvnode, NULL, PBS_BATCH_AsyrunJob_ack);
+	pbs_client_thread_unlock_connection(pbs_sd);
+	if (rc != 0) {
+		free(id);
+		return rc;
+	}
+
+	runjob_pipe.jobids[(runjob_pipe.head + runjob_pipe.count) % runjob_pipe.size] = id;
+	runjob_pipe.count++;
+	runjob_pipe.sent++;
+
+	return 0;
+}
+
 /**
  * @brief
  * 		the main scheduler loop
@@ -853,6 +1071,9 @@ main_sched_loop(status *policy, int sd, server_info *sinfo, schd_error **rerr)
 		return -1;
 	}
 
+	if (sd != SIMULATE_SD)
+		start_runjob_pipeline(sinfo);
+
 	/* main scheduling loop */
 #ifdef NAS
 	/* localmod 030 */
@@ -888,11 +1109,13 @@ main_sched_loop(status *policy, int sd, server_info *sinfo, schd_error **rerr)
 		if(should_use_buckets)
 			flags = USE_BUCKETS;
 
+		prof_phase_start(PROF_IS_OK_TO_RUN);
 		if (njob->is_shrink_to_fit) {
 			/* Pass the suitable heuristic for shrinking */
 			ns_arr = is_ok_to_run_STF(policy, sinfo, qinfo, njob, flags, err, shrink_job_algorithm);
 		} else
 			ns_arr = is_ok_to_run(policy, sinfo, qinfo, njob, flags, err);
+		prof_phase_end(PROF_IS_OK_TO_RUN);
 
 		if (err->status_code == NEVER_RUN)
 			njob->can_never_run = 1;
@@ -926,7 +1149,12 @@ main_sched_loop(status *policy, int sd, server_info *sinfo, schd_error **rerr)
 				free_nspecs(ns_arr);
 		}
 		else if (policy->preempting && in_runnable_state(njob) && (!njob -> can_never_run)) {
-			if (find_and_preempt_jobs(policy, sd, njob, sinfo, err) > 0) {
+			int preempt_rc;
+
+			prof_phase_start(PROF_PREEMPT);
+			preempt_rc = find_and_preempt_jobs(policy, sd, njob, sinfo, err);
+			prof_phase_end(PROF_PREEMPT);
+			if (preempt_rc > 0) {
 				rc = SUCCESS;
 				sort_again = MUST_RESORT_JOBS;
 			}
@@ -958,7 +1186,9 @@ main_sched_loop(status *policy, int sd, server_info *sinfo, schd_error **rerr)
 #else
 			if (should_backfill_with_job(policy, sinfo, njob, num_topjobs) != 0) {
 #endif
+				prof_phase_start(PROF_CALENDAR);
 				cal_rc = add_job_to_calendar(sd, policy, sinfo, njob, should_use_buckets);
+				prof_phase_end(PROF_CALENDAR);
 
 				if (cal_rc > 0) { /* Success! */
 #ifdef NAS /* localmod 034 */
@@ -1119,6 +1349,9 @@ main_sched_loop(status *policy, int sd, server_info *sinfo, schd_error **rerr)
 		send_job_updates(sd, njob);
 	}
 
+	if (sd != SIMULATE_SD)
+		end_runjob_pipeline(sd);
+
 	*rerr = err;
 
 	free_schd_error(chk_lim_err);
@@ -1173,6 +1406,9 @@ end_cycle_tasks(server_info *sinfo)
 {
 	int i;
 
+	/* send the job attribute updates still waiting in the batch */
+	flush_job_updates();
+
 	/* keep track of update used resources for fairshare */
 	if (sinfo != NULL && sinfo->policy->fair_share)
 		update_last_running(sinfo);
@@ -1204,6 +1440,8 @@ end_cycle_tasks(server_info *sinfo)
 
 	got_sigpipe = 0;
 
+	obj_pool_log_stats();
+
 	log_event(PBSEVENT_DEBUG, PBS_EVENTCLASS_REQUEST, LOG_DEBUG,
 		"", "Leaving Scheduling Cycle");
 }
@@ -1304,12 +1542,22 @@ update_job_can_not_run(int pbs_sd, resource_resv *job, schd_error *err)
 static int
 send_run_job(int pbs_sd, int has_runjob_hook, char *jobid, char *execvnode)
 {
+	int rc;
+
+	prof_phase_start(PROF_RUN_JOB);
 	if (sc_attrs.runjob_mode == RJ_EXECJOB_HOOK)
-		return pbs_runjob(pbs_sd, jobid, execvnode, NULL);
-	else if ((sc_attrs.runjob_mode == RJ_RUNJOB_HOOK) && has_runjob_hook)
-		return pbs_asyrunjob_ack(pbs_sd, jobid, execvnode, NULL);
+		rc = pbs_runjob(pbs_sd, jobid, execvnode, NULL);
+	else if ((sc_attrs.runjob_mode == RJ_RUNJOB_HOOK) && has_runjob_hook) {
+		if (runjob_pipe.enabled)
+			rc = pipeline_run_job(pbs_sd, jobid, execvnode);
+		else
+			rc = pbs_asyrunjob_ack(pbs_sd, jobid, execvnode, NULL);
+	}
 	else
-		return pbs_asyrunjob(pbs_sd, jobid, execvnode, NULL);
+		rc = pbs_asyrunjob(pbs_sd, jobid, execvnode, NULL);
+	prof_phase_end(PROF_RUN_JOB);
+
+	return rc;
 }
 
 /**
@@ -1358,6 +1606,8 @@ run_job(int pbs_sd, resource_resv *rjob, char *execvnode, int has_runjob_hook, s
 				rjob->server->name);
 		}
 
+		/* a "local" peer shares the connection to our server */
+		drain_runjob_pipeline(pbs_sd);
 		rc = pbs_movejob(rjob->job->peer_sd, rjob->name, buf, NULL);
 
 		/*
@@ -1509,6 +1759,7 @@ run_update_resresv(status *policy, int pbs_sd, server_info *sinfo,
 	pbs_errno = PBSE_NONE;
 	if (resresv->is_job && resresv->job->is_suspended) {
 		if (pbs_sd != SIMULATE_SD) {
+			drain_runjob_pipeline(pbs_sd);
 			pbsrc = pbs_sigjob(pbs_sd, resresv->name, "resume", NULL);
 			if (!pbsrc)
 				ret = 1;
@@ -1535,7 +1786,7 @@ run_update_resresv(status *policy, int pbs_sd, server_info *sinfo,
 	}
 	else {
 		if (resresv->is_job && resresv->job->is_subjob) {
-			array = find_resource_resv(sinfo->jobs, resresv->job->array_id);
+			array = find_resource_resv_idx(sinfo->jobs_idx, sinfo->jobs, resresv->job->array_id);
 			rr = resresv;
 		} else if (resresv->is_job && resresv->job->is_array) {
 			array = resresv;
@@ -1953,7 +2204,6 @@ add_job_to_calendar(int pbs_sd, status *policy, server_info *sinfo,
 	char *exec;			/* used to hold execvnode for topjob */
 	timed_event *te_start;	/* start event for topjob */
 	timed_event *te_end;		/* end event for topjob */
-	timed_event *nexte;
 	char log_buf[MAX_LOG_SIZE];
 	int i;
 
@@ -1965,8 +2215,8 @@ add_job_to_calendar(int pbs_sd, status *policy, server_info *sinfo,
 		/* if the job is in the calendar, then there is nothing to do
 		 * Note: We only ever look from now into the future
 		 */
-		nexte = get_next_event(sinfo->calendar);
-		if (find_timed_event(nexte, IGNORE_DISABLED_EVENTS, topjob->name, TIMED_NOEVENT, 0) != NULL)
+		if (calendar_has_pending_event(sinfo->calendar, topjob->run_event) ||
+			calendar_has_pending_event(sinfo->calendar, topjob->end_event))
 			return 1;
 	}
 	if ((nsinfo = dup_server_info(sinfo)) == NULL)
@@ -2004,7 +2254,7 @@ add_job_to_calendar(int pbs_sd, status *policy, server_info *sinfo,
 			}
 
 			/* Can't search by rank, we just created tjob and it has a new rank*/
-			njob = find_resource_resv(nsinfo->jobs, tjob->name);
+			njob = find_resource_resv_idx(nsinfo->jobs_idx, nsinfo->jobs, tjob->name);
 			if (njob == NULL) {
 				log_event(PBSEVENT_DEBUG, PBS_EVENTCLASS_JOB, LOG_DEBUG, __func__,
 					"Can't find new subjob in simulated universe");
@@ -183,6 +183,11 @@ int add_job_to_calendar(int pbs_sd, status *policy, server_info *sinfo, resource
  */
 int run_job(int pbs_sd, resource_resv *rjob, char *execvnode, int had_runjob_hook, schd_error *err);
 
+/*
+ *	drain_runjob_pipeline - read the replies to all outstanding run requests
+ */
+void drain_runjob_pipeline(int pbs_sd);
+
 /*
  *	should_backfill_with_job - should we call add_job_to_calendar() with job
  *	returns 1: we should backfill 0: we should not
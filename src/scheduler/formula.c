@@ -0,0 +1,669 @@
+/*
+ * Copyright (C) 1994-2020 Altair Engineering, Inc.
+ * For more information, contact Altair at www.altair.com.
+ *
+ * This file is part of both the OpenPBS software ("OpenPBS")
+ * and the PBS Professional ("PBS Pro") software.
+ *
+ * Open Source License Information:
+ *
+ * OpenPBS is free software. You can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * OpenPBS is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Affero General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Commercial License Information:
+ *
+ * PBS Pro is commercially licensed software that shares a common core with
+ * the OpenPBS software.  For a copy of the commercial license terms and
+ * conditions, go to: (http://www.pbspro.com/agreement.html) or contact the
+ * Altair Legal Department.
+ *
+ * Altair's dual-license business model allows companies, individuals, and
+ * organizations to create proprietary derivative works of OpenPBS and
+ * distribute them - whether embedded or bundled with other software -
+ * under a commercial license agreement.
+ *
+ * Use of Altair's trademarks, including but not limited to "PBS™",
+ * "OpenPBS®", "PBS Professional®", and "PBS Pro™" and Altair's logos is
+ * subject to Altair's trademark licensing policies.
+ */
+
+
+/**
+ * @file    formula.c
+ *
+ * @brief
+ * 	Native evaluator for job_sort_formula and fairshare_usage_res.  A
+ *	formula is compiled once into a postfix program over the consumable
+ *	resources and the formula keywords (see pbs_share.h), and the program
+ *	is run for each job.  The supported grammar is the arithmetic subset of
+ *	Python which formulas are written in:
+ *
+ *	expr  := term (('+' | '-') term)*
+ *	term  := unary (('*' | '/' | '//' | '%') unary)*
+ *	unary := ('+' | '-') unary | power
+ *	power := atom ['**' unary]
+ *	atom  := number | name | '(' expr ')'
+ *
+ *	Anything else (function calls, comparisons, conditionals, unknown
+ *	names) is left to the Python evaluator.
+ *
+ * Functions included are:
+ * 	formula_evaluate_native()
+ * 	flush_formula_cache()
+ */
+
+#include <pbs_config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <math.h>
+#include <pthread.h>
+
+#include "log.h"
+#include "pbs_share.h"
+
+#include "constant.h"
+#include "config.h"
+#include "data_types.h"
+#include "globals.h"
+#include "misc.h"
+#include "resource.h"
+#include "resource_resv.h"
+#include "formula.h"
+
+enum formula_op_type {
+	FOP_NUM,	/* push a constant */
+	FOP_RES,	/* push a requested resource amount */
+	FOP_VAR,	/* push a formula keyword value */
+	FOP_NEG,
+	FOP_ADD,
+	FOP_SUB,
+	FOP_MUL,
+	FOP_DIV,
+	FOP_FLOORDIV,
+	FOP_MOD,
+	FOP_POW
+};
+
+enum formula_var {
+	FVAR_ELIGIBLE_TIME,
+	FVAR_QUEUE_PRIO,
+	FVAR_JOB_PRIO,
+	FVAR_FSPERC,
+	FVAR_TREE_USAGE,
+	FVAR_FSFACTOR,
+	FVAR_ACCRUE_TYPE
+};
+
+struct formula_op {
+	enum formula_op_type type;
+	double num;		/* FOP_NUM */
+	resdef *def;		/* FOP_RES */
+	enum formula_var var;	/* FOP_VAR */
+};
+
+typedef struct formula_prog {
+	struct formula_op *ops;
+	int num_ops;
+	int max_depth;		/* deepest the evaluation stack gets */
+	int refct;		/* held by the cache and each evaluation running it */
+} formula_prog;
+
+/* parser state */
+struct formula_parser {
+	char *p;		/* current position in the formula */
+	struct formula_op *ops;
+	int num_ops;
+	int size;
+	int depth;		/* current stack depth of the program so far */
+	int max_depth;
+	int error;
+};
+
+struct formula_cache_entry {
+	char *text;		/* the formula */
+	formula_prog *prog;	/* NULL if the formula needs the Python evaluator */
+};
+
+static struct formula_cache_entry formula_cache[FORMULA_CACHE_SIZE];
+static int formula_cache_next = 0;
+static pthread_mutex_t formula_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static struct {
+	char *name;
+	enum formula_var var;
+} formula_vars[] = {
+	{FORMULA_ELIGIBLE_TIME, FVAR_ELIGIBLE_TIME},
+	{FORMULA_QUEUE_PRIO, FVAR_QUEUE_PRIO},
+	{FORMULA_JOB_PRIO, FVAR_JOB_PRIO},
+	{FORMULA_FSPERC, FVAR_FSPERC},
+	{FORMULA_FSPERC_DEP, FVAR_FSPERC},
+	{FORMULA_TREE_USAGE, FVAR_TREE_USAGE},
+	{FORMULA_FSFACTOR, FVAR_FSFACTOR},
+	{FORMULA_ACCRUE_TYPE, FVAR_ACCRUE_TYPE},
+	{NULL, 0}
+};
+
+static void parse_expr(struct formula_parser *fp);
+static void parse_unary(struct formula_parser *fp);
+
+/**
+ * @brief	append an op to the program being parsed
+ *
+ * @param[in,out]	fp	-	parser
+ * @param[in]	op	-	op to append
+ * @param[in]	depth_change	-	how the op changes the stack depth
+ */
+static void
+emit_op(struct formula_parser *fp, struct formula_op *op, int depth_change)
+{
+	struct formula_op *tmp;
+
+	if (fp->error)
+		return;
+
+	if (fp->num_ops == fp->size) {
+		tmp = realloc(fp->ops, (fp->size * 2 + 8) * sizeof(struct formula_op));
+		if (tmp == NULL) {
+			log_err(errno, __func__, MEM_ERR_MSG);
+			fp->error = 1;
+			return;
+		}
+		fp->ops = tmp;
+		fp->size = fp->size * 2 + 8;
+	}
+	fp->ops[fp->num_ops++] = *op;
+	fp->depth += depth_change;
+	if (fp->depth > fp->max_depth)
+		fp->max_depth = fp->depth;
+}
+
+/**
+ * @brief	emit an operator which takes its operands off the stack
+ */
+static void
+emit_operator(struct formula_parser *fp, enum formula_op_type type)
+{
+	struct formula_op op = {0};
+
+	op.type = type;
+	emit_op(fp, &op, type == FOP_NEG ? 0 : -1);
+}
+
+/**
+ * @brief	skip whitespace in the formula
+ */
+static void
+skip_space(struct formula_parser *fp)
+{
+	while (isspace((unsigned char) *fp->p))
+		fp->p++;
+}
+
+/**
+ * @brief	parse an atom: a number, a name or a parenthesized expression
+ */
+static void
+parse_atom(struct formula_parser *fp)
+{
+	struct formula_op op = {0};
+	char name[MAX_RES_NAME_SIZE];
+	char *endp;
+	int len;
+	int i;
+
+	skip_space(fp);
+	if (*fp->p == '(') {
+		fp->p++;
+		parse_expr(fp);
+		skip_space(fp);
+		if (*fp->p != ')') {
+			fp->error = 1;
+			return;
+		}
+		fp->p++;
+	} else if (isdigit((unsigned char) *fp->p) || *fp->p == '.') {
+		op.type = FOP_NUM;
+		op.num = strtod(fp->p, &endp);
+		if (endp == fp->p) {
+			fp->error = 1;
+			return;
+		}
+		fp->p = endp;
+		emit_op(fp, &op, 1);
+	} else if (isalpha((unsigned char) *fp->p) || *fp->p == '_') {
+		for (len = 0; isalnum((unsigned char) fp->p[len]) || fp->p[len] == '_'; len++)
+			;
+		if (len >= MAX_RES_NAME_SIZE) {
+			fp->error = 1;
+			return;
+		}
+		strncpy(name, fp->p, len);
+		name[len] = '\0';
+		fp->p += len;
+
+		/* the keywords override resources of the same name */
+		for (i = 0; formula_vars[i].name != NULL; i++) {
+			if (!strcmp(name, formula_vars[i].name)) {
+				op.type = FOP_VAR;
+				op.var = formula_vars[i].var;
+				emit_op(fp, &op, 1);
+				return;
+			}
+		}
+		op.type = FOP_RES;
+		op.def = find_resdef(consres, name);
+		if (op.def == NULL) {
+			fp->error = 1;
+			return;
+		}
+		emit_op(fp, &op, 1);
+	} else
+		fp->error = 1;
+}
+
+/**
+ * @brief	parse a power: atom ['**' unary]
+ */
+static void
+parse_power(struct formula_parser *fp)
+{
+	parse_atom(fp);
+	skip_space(fp);
+	if (fp->p[0] == '*' && fp->p[1] == '*') {
+		fp->p += 2;
+		parse_unary(fp);
+		emit_operator(fp, FOP_POW);
+	}
+}
+
+/**
+ * @brief	parse a unary expression: ('+' | '-') unary | power
+ */
+static void
+parse_unary(struct formula_parser *fp)
+{
+	skip_space(fp);
+	if (*fp->p == '-') {
+		fp->p++;
+		parse_unary(fp);
+		emit_operator(fp, FOP_NEG);
+	} else if (*fp->p == '+') {
+		fp->p++;
+		parse_unary(fp);
+	} else
+		parse_power(fp);
+}
+
+/**
+ * @brief	parse a term: unary (('*' | '/' | '//' | '%') unary)*
+ */
+static void
+parse_term(struct formula_parser *fp)
+{
+	enum formula_op_type type;
+
+	parse_unary(fp);
+	while (!fp->error) {
+		skip_space(fp);
+		if (fp->p[0] == '*' && fp->p[1] != '*') {
+			type = FOP_MUL;
+			fp->p++;
+		} else if (fp->p[0] == '/' && fp->p[1] == '/') {
+			type = FOP_FLOORDIV;
+			fp->p += 2;
+		} else if (fp->p[0] == '/') {
+			type = FOP_DIV;
+			fp->p++;
+		} else if (fp->p[0] == '%') {
+			type = FOP_MOD;
+			fp->p++;
+		} else
+			break;
+		parse_unary(fp);
+		emit_operator(fp, type);
+	}
+}
+
+/**
+ * @brief	parse an expression: term (('+' | '-') term)*
+ */
+static void
+parse_expr(struct formula_parser *fp)
+{
+	enum formula_op_type type;
+
+	parse_term(fp);
+	while (!fp->error) {
+		skip_space(fp);
+		if (*fp->p == '+')
+			type = FOP_ADD;
+		else if (*fp->p == '-')
+			type = FOP_SUB;
+		else
+			break;
+		fp->p++;
+		parse_term(fp);
+		emit_operator(fp, type);
+	}
+}
+
+/**
+ * @brief	compile a formula into a postfix program
+ *
+ * @param[in]	formula	-	the formula
+ *
+ * @return	formula_prog *
+ * @retval	the program
+ * @retval	NULL	: the formula uses something which isn't supported
+ */
+static formula_prog *
+compile_formula(char *formula)
+{
+	struct formula_parser fp = {0};
+	formula_prog *prog;
+
+	fp.p = formula;
+	parse_expr(&fp);
+	skip_space(&fp);
+	if (fp.error || *fp.p != '\0' || fp.num_ops == 0) {
+		free(fp.ops);
+		return NULL;
+	}
+
+	if ((prog = malloc(sizeof(formula_prog))) == NULL) {
+		log_err(errno, __func__, MEM_ERR_MSG);
+		free(fp.ops);
+		return NULL;
+	}
+	prog->ops = fp.ops;
+	prog->num_ops = fp.num_ops;
+	prog->max_depth = fp.max_depth;
+	prog->refct = 1;
+
+	return prog;
+}
+
+/**
+ * @brief	free a compiled formula
+ */
+static void
+free_formula_prog(formula_prog *prog)
+{
+	if (prog == NULL)
+		return;
+	free(prog->ops);
+	free(prog);
+}
+
+/**
+ * @brief	drop a reference to a compiled formula, freeing it with the last.
+ *		Must be called with formula_cache_lock held.
+ */
+static void
+put_formula_prog(formula_prog *prog)
+{
+	if (prog != NULL && --prog->refct == 0)
+		free_formula_prog(prog);
+}
+
+/**
+ * @brief	find a formula's compiled program, compiling it on first use.
+ *		The caller gets a reference to the program, released with
+ *		put_formula_prog(), so a program evicted by a new formula or
+ *		flushed while it runs is freed when it finishes.  Must be called
+ *		with formula_cache_lock held.
+ *
+ * @param[in]	formula	-	the formula
+ * @param[out]	prog	-	the program or NULL if the formula needs Python
+ *
+ * @return	int
+ * @retval	1	: formula was found or compiled
+ * @retval	0	: error
+ */
+static int
+find_formula_prog(char *formula, formula_prog **prog)
+{
+	struct formula_cache_entry *ent;
+	int i;
+
+	for (i = 0; i < FORMULA_CACHE_SIZE; i++) {
+		if (formula_cache[i].text != NULL && !strcmp(formula_cache[i].text, formula)) {
+			*prog = formula_cache[i].prog;
+			if (*prog != NULL)
+				(*prog)->refct++;
+			return 1;
+		}
+	}
+
+	ent = &formula_cache[formula_cache_next];
+	formula_cache_next = (formula_cache_next + 1) % FORMULA_CACHE_SIZE;
+	free(ent->text);
+	put_formula_prog(ent->prog);
+	ent->prog = NULL;
+	if ((ent->text = string_dup(formula)) == NULL)
+		return 0;
+	ent->prog = compile_formula(formula);
+	if (ent->prog == NULL)
+		log_eventf(PBSEVENT_DEBUG, PBS_EVENTCLASS_SCHED, LOG_DEBUG, __func__,
+			"Formula '%s' can not be evaluated natively, using Python", formula);
+	else
+		ent->prog->refct++;
+
+	*prog = ent->prog;
+	return 1;
+}
+
+/**
+ * @brief	get the value of a formula keyword for a job
+ */
+static double
+formula_var_value(enum formula_var var, resource_resv *resresv)
+{
+	job_info *job = resresv->job;
+
+	switch (var) {
+		case FVAR_ELIGIBLE_TIME:
+			return job->eligible_time;
+		case FVAR_QUEUE_PRIO:
+			return job->queue != NULL ? job->queue->priority : 0;
+		case FVAR_JOB_PRIO:
+			return job->priority;
+		case FVAR_FSPERC:
+			return job->ginfo != NULL ? job->ginfo->tree_percentage : 0;
+		case FVAR_TREE_USAGE:
+			return job->ginfo != NULL ? job->ginfo->usage_factor : 0;
+		case FVAR_FSFACTOR:
+			if (job->ginfo == NULL || job->ginfo->tree_percentage == 0)
+				return 0;
+			return pow(2, -(job->ginfo->usage_factor / job->ginfo->tree_percentage));
+		case FVAR_ACCRUE_TYPE:
+			return job->accrue_type;
+	}
+	return 0;
+}
+
+/**
+ * @brief	run a compiled formula for a job
+ *
+ * @param[in]	prog	-	the compiled formula
+ * @param[in]	resresv	-	the job
+ * @param[in]	resreq	-	resources to use for resource names
+ * @param[out]	ans	-	the answer
+ *
+ * @return	enum formula_native_rc
+ */
+static enum formula_native_rc
+run_formula_prog(formula_prog *prog, resource_resv *resresv, resource_req *resreq, sch_resource_t *ans)
+{
+	double stack_buf[32];
+	double *stack = stack_buf;
+	resource_req *req;
+	double a, b;
+	int sp = 0;
+	int i;
+	enum formula_native_rc rc = FORMULA_NATIVE_OK;
+
+	if (prog->max_depth > (int) (sizeof(stack_buf) / sizeof(stack_buf[0]))) {
+		if ((stack = malloc(prog->max_depth * sizeof(double))) == NULL) {
+			log_err(errno, __func__, MEM_ERR_MSG);
+			return FORMULA_NATIVE_UNSUPPORTED;
+		}
+	}
+
+	for (i = 0; i < prog->num_ops && rc == FORMULA_NATIVE_OK; i++) {
+		struct formula_op *op = &prog->ops[i];
+
+		switch (op->type) {
+			case FOP_NUM:
+				stack[sp++] = op->num;
+				continue;
+			case FOP_RES:
+				req = find_resource_req(resreq, op->def);
+				stack[sp++] = req != NULL ? req->amount : 0;
+				continue;
+			case FOP_VAR:
+				stack[sp++] = formula_var_value(op->var, resresv);
+				continue;
+			case FOP_NEG:
+				stack[sp - 1] = -stack[sp - 1];
+				continue;
+			default:
+				break;
+		}
+
+		/* binary operators */
+		b = stack[--sp];
+		a = stack[sp - 1];
+		switch (op->type) {
+			case FOP_ADD:
+				a += b;
+				break;
+			case FOP_SUB:
+				a -= b;
+				break;
+			case FOP_MUL:
+				a *= b;
+				break;
+			case FOP_DIV:
+			case FOP_FLOORDIV:
+			case FOP_MOD:
+				if (b == 0) {
+					rc = FORMULA_NATIVE_ERROR;
+					break;
+				}
+				if (op->type == FOP_DIV)
+					a = a / b;
+				else if (op->type == FOP_FLOORDIV)
+					a = floor(a / b);
+				else	/* Python's modulo takes the sign of the divisor */
+					a = a - b * floor(a / b);
+				break;
+			case FOP_POW:
+				if (a == 0 && b < 0) {
+					rc = FORMULA_NATIVE_ERROR;
+					break;
+				}
+				a = pow(a, b);
+				/* complex results and overflows are Python's business */
+				if (isnan(a) || isinf(a))
+					rc = FORMULA_NATIVE_UNSUPPORTED;
+				break;
+			default:
+				rc = FORMULA_NATIVE_UNSUPPORTED;
+		}
+		stack[sp - 1] = a;
+	}
+
+	if (rc == FORMULA_NATIVE_OK)
+		*ans = stack[0];
+	else if (rc == FORMULA_NATIVE_ERROR) {
+		log_event(PBSEVENT_DEBUG2, PBS_EVENTCLASS_JOB, LOG_DEBUG, resresv->name,
+			"Formula evaluation for job had an error.  Zero value will be used: "
+			"division by zero or zero raised to a negative power");
+		*ans = 0;
+	}
+
+	if (stack != stack_buf)
+		free(stack);
+
+	return rc;
+}
+
+/**
+ * @brief
+ * 		evaluate a formula for a job without the Python interpreter
+ *
+ * @param[in]	formula	-	formula to evaluate
+ * @param[in]	resresv	-	job for special case key words
+ * @param[in]	resreq	-	resources to use when evaluating
+ * @param[out]	ans	-	the answer
+ *
+ * @return	enum formula_native_rc
+ * @retval	FORMULA_NATIVE_OK	: ans is set
+ * @retval	FORMULA_NATIVE_ERROR	: evaluation failed, ans is 0
+ * @retval	FORMULA_NATIVE_UNSUPPORTED	: use the Python evaluator
+ */
+enum formula_native_rc
+formula_evaluate_native(char *formula, resource_resv *resresv,
+	resource_req *resreq, sch_resource_t *ans)
+{
+	formula_prog *prog;
+	int found;
+	enum formula_native_rc rc;
+
+	if (formula == NULL || resresv == NULL || resresv->job == NULL ||
+		consres == NULL || ans == NULL)
+		return FORMULA_NATIVE_UNSUPPORTED;
+
+	pthread_mutex_lock(&formula_cache_lock);
+	found = find_formula_prog(formula, &prog);
+	pthread_mutex_unlock(&formula_cache_lock);
+
+	if (!found || prog == NULL)
+		return FORMULA_NATIVE_UNSUPPORTED;
+
+	rc = run_formula_prog(prog, resresv, resreq, ans);
+
+	pthread_mutex_lock(&formula_cache_lock);
+	put_formula_prog(prog);
+	pthread_mutex_unlock(&formula_cache_lock);
+
+	return rc;
+}
+
+/**
+ * @brief
+ * 		forget all compiled formulas.  Compiled formulas refer to
+ *		resource definitions, so this must be called when they change.
+ *
+ * @return	void
+ */
+void
+flush_formula_cache(void)
+{
+	int i;
+
+	pthread_mutex_lock(&formula_cache_lock);
+	for (i = 0; i < FORMULA_CACHE_SIZE; i++) {
+		free(formula_cache[i].text);
+		formula_cache[i].text = NULL;
+		put_formula_prog(formula_cache[i].prog);
+		formula_cache[i].prog = NULL;
+	}
+	formula_cache_next = 0;
+	pthread_mutex_unlock(&formula_cache_lock);
+}
@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) 1994-2020 Altair Engineering, Inc.
+ * For more information, contact Altair at www.altair.com.
+ *
+ * This file is part of both the OpenPBS software ("OpenPBS")
+ * and the PBS Professional ("PBS Pro") software.
+ *
+ * Open Source License Information:
+ *
+ * OpenPBS is free software. You can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * OpenPBS is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Affero General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Commercial License Information:
+ *
+ * PBS Pro is commercially licensed software that shares a common core with
+ * the OpenPBS software.  For a copy of the commercial license terms and
+ * conditions, go to: (http://www.pbspro.com/agreement.html) or contact the
+ * Altair Legal Department.
+ *
+ * Altair's dual-license business model allows companies, individuals, and
+ * organizations to create proprietary derivative works of OpenPBS and
+ * distribute them - whether embedded or bundled with other software -
+ * under a commercial license agreement.
+ *
+ * Use of Altair's trademarks, including but not limited to "PBS™",
+ * "OpenPBS®", "PBS Professional®", and "PBS Pro™" and Altair's logos is
+ * subject to Altair's trademark licensing policies.
+ */
+
+
+#ifndef SRC_SCHEDULER_FORMULA_H_
+#define SRC_SCHEDULER_FORMULA_H_
+
+#include "data_types.h"
+
+/* number of distinct formulas kept compiled at once */
+#define FORMULA_CACHE_SIZE 4
+
+/* return codes of formula_evaluate_native() */
+enum formula_native_rc {
+	FORMULA_NATIVE_OK,		/* answer was computed */
+	FORMULA_NATIVE_ERROR,		/* evaluation error (e.g., division by zero): answer is 0 */
+	FORMULA_NATIVE_UNSUPPORTED	/* formula or values need the Python evaluator */
+};
+
+enum formula_native_rc formula_evaluate_native(char *formula, resource_resv *resresv,
+	resource_req *resreq, sch_resource_t *ans);
+void flush_formula_cache(void);
+
+#endif /* SRC_SCHEDULER_FORMULA_H_ */
@@ -153,11 +153,8 @@ int	second_connection;
 /* Stuff needed for multi-threading */
 pthread_mutex_t general_lock;
 pthread_mutex_t work_lock;
-pthread_mutex_t result_lock;
 pthread_cond_t work_cond;
 pthread_cond_t result_cond;
-ds_queue *work_queue = NULL;
-ds_queue *result_queue = NULL;
 pthread_t *threads = NULL;
 int threads_die = 0;
 int num_threads = 0;
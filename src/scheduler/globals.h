@@ -46,7 +46,6 @@ extern "C" {
 
 #include "data_types.h"
 #include "limits.h"
-#include "queue.h"
 /* resources to check */
 extern const struct rescheck res_to_check[];
 
@@ -79,10 +78,7 @@ const struct enum_conv resind[RES_HIGH+1];
 extern pthread_mutex_t general_lock;
 extern pthread_mutex_t work_lock;
 extern pthread_cond_t work_cond;
-extern pthread_mutex_t result_lock;
 extern pthread_cond_t result_cond;
-extern ds_queue *work_queue;
-extern ds_queue *result_queue;
 extern pthread_t *threads;
 extern int threads_die;
 extern int num_threads;
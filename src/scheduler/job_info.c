@@ -46,12 +46,15 @@
  * Functions included are:
  * 	query_jobs()
  * 	query_job()
+ * 	purge_job_cache()
+ * 	flush_job_cache()
  * 	new_job_info()
  * 	free_job_info()
  * 	set_job_state()
  * 	update_job_attr()
  * 	send_job_updates()
  * 	send_attr_updates()
+ * 	flush_job_updates()
  * 	unset_job_attr()
  * 	update_job_comment()
  * 	update_jobs_cant_run()
@@ -105,6 +108,8 @@
 #include <pbs_share.h>
 #include <pbs_internal.h>
 #include <pbs_error.h>
+#include <pbs_idx.h>
+#include <libpbs.h>
 #include "queue_info.h"
 #include "job_info.h"
 #include "resv_info.h"
@@ -125,6 +130,7 @@
 #include "server_info.h"
 #include "attribute.h"
 #include "multi_threading.h"
+#include "formula.h"
 
 #ifdef NAS
 #include "site_code.h"
@@ -497,6 +503,348 @@ static struct fc_translation_table fctt[] = {
 #define	ERR2INFO(code)		(fctt[(code) - RET_BASE].fc_info)
 
 
+/*
+ * Cross-cycle cache of parsed queued jobs.
+ *
+ * Most of the queued jobs the server sends us are unchanged from the last
+ * cycle, but query_job() re-parses every one of them (select, place,
+ * resource lists, etc).  We keep a parsed copy of each queued job keyed by
+ * its name along with a fingerprint of the batch_status it came from.  If the
+ * server sends us the same attributes again, we duplicate the cached copy
+ * instead of parsing the job from scratch.
+ *
+ * Attributes which change from cycle to cycle without changing the shape of
+ * the job (e.g. the comment or eligible_time) are left out of the fingerprint
+ * and refreshed on the copy by refresh_volatile_job_attrs().
+ *
+ * Entries for jobs which are not seen in a cycle are purged at the end of the
+ * query.  The whole cache is flushed when resource definitions are re-queried
+ * and every JOB_CACHE_RESYNC_CYCLES cycles to bound the life of any entry.
+ */
+typedef struct job_cache_entry {
+	unsigned long long fingerprint;	/* hash of the job's batch_status */
+	unsigned long last_seen;	/* generation the job was last queried */
+	resource_resv *resresv;		/* parsed template of the job */
+} job_cache_entry;
+
+static void *job_cache = NULL;
+static unsigned long job_cache_gen = 0;
+static pthread_mutex_t job_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* attributes not part of the fingerprint; refreshed on every cache hit */
+static char *job_cache_volatile_attrs[] = {
+	ATTR_comment,
+	ATTR_eligible_time,
+	ATTR_accrue_type,
+	ATTR_estimated,
+	NULL
+};
+
+/**
+ * @brief	is an attribute left out of the job cache fingerprint
+ *
+ * @param[in]	name	-	attribute name
+ *
+ * @return	int
+ * @retval	1	: attribute is volatile
+ * @retval	0	: attribute is not volatile
+ */
+static int
+is_job_cache_volatile_attr(char *name)
+{
+	int i;
+
+	for (i = 0; job_cache_volatile_attrs[i] != NULL; i++)
+		if (!strcmp(name, job_cache_volatile_attrs[i]))
+			return 1;
+
+	return 0;
+}
+
+/**
+ * @brief	compute the fingerprint of a job's batch_status
+ *
+ * @param[in]	job	-	batch_status of the job
+ * @param[in]	sinfo	-	server the job is being queried into
+ *
+ * @return	unsigned long long
+ * @retval	fingerprint of the job
+ */
+static unsigned long long
+job_cache_fingerprint(struct batch_status *job, server_info *sinfo)
+{
+	struct attrl *attrp;
+	unsigned long long hash;
+
+	/* query_job() only creates fairshare nodes if there is a tree */
+	hash = pbs_strhash(PBS_HASH_INIT, sinfo->fairshare != NULL ? "fs" : "");
+	hash = pbs_strhash(hash, job->name);
+
+	for (attrp = job->attribs; attrp != NULL; attrp = attrp->next) {
+		if (is_job_cache_volatile_attr(attrp->name))
+			continue;
+		hash = pbs_strhash(hash, attrp->name);
+		hash = pbs_strhash(hash, attrp->resource);
+		hash = pbs_strhash(hash, attrp->value);
+	}
+
+	return hash;
+}
+
+/**
+ * @brief	free a job cache entry
+ *
+ * @param[in]	jce	-	entry to free
+ *
+ * @return void
+ */
+static void
+free_job_cache_entry(job_cache_entry *jce)
+{
+	if (jce == NULL)
+		return;
+
+	free_resource_resv(jce->resresv);
+	free(jce);
+}
+
+/**
+ * @brief	reparse the volatile attributes of a job duplicated from the cache
+ *
+ * @param[in,out]	resresv	-	job to refresh
+ * @param[in]	attrp	-	attribute list from the server
+ *
+ * @return void
+ */
+static void
+refresh_volatile_job_attrs(resource_resv *resresv, struct attrl *attrp)
+{
+	job_info *jinfo = resresv->job;
+	long count;
+	char *endp;
+
+	free(jinfo->comment);
+	jinfo->comment = NULL;
+	free(jinfo->est_execvnode);
+	jinfo->est_execvnode = NULL;
+	jinfo->est_start_time = UNSPECIFIED;
+	jinfo->eligible_time = 0;
+	jinfo->accrue_type = 0;
+
+	for (; attrp != NULL; attrp = attrp->next) {
+		if (!strcmp(attrp->name, ATTR_comment))
+			jinfo->comment = string_dup(attrp->value);
+		else if (!strcmp(attrp->name, ATTR_accrue_type)) {
+			count = strtol(attrp->value, &endp, 10);
+			if (*endp == '\0')
+				jinfo->accrue_type = count;
+		} else if (!strcmp(attrp->name, ATTR_eligible_time))
+			jinfo->eligible_time = (time_t) res_to_num(attrp->value, NULL);
+		else if (!strcmp(attrp->name, ATTR_estimated)) {
+			if (!strcmp(attrp->resource, "start_time"))
+				jinfo->est_start_time = (time_t) res_to_num(attrp->value, NULL);
+			else if (!strcmp(attrp->resource, "execvnode"))
+				jinfo->est_execvnode = string_dup(attrp->value);
+		}
+	}
+}
+
+/**
+ * @brief	create a job from the job cache if the server sent us an
+ *		unchanged job
+ *
+ * @param[in]	job	-	batch_status of the job
+ * @param[in]	fingerprint	-	fingerprint of job
+ * @param[in]	sinfo	-	server to create the job in
+ * @param[in]	qinfo	-	queue to create the job in
+ * @param[in]	err	-	error object
+ *
+ * @return	resource_resv *
+ * @retval	newly duplicated job
+ * @retval	NULL	: job not cached or changed since it was cached
+ *
+ * @par MT-safe: Yes
+ */
+static resource_resv *
+find_job_in_cache(struct batch_status *job, unsigned long long fingerprint,
+		server_info *sinfo, queue_info *qinfo, schd_error *err)
+{
+	job_cache_entry *jce = NULL;
+	void *key = job->name;
+	resource_resv *resresv;
+
+	pthread_mutex_lock(&job_cache_lock);
+	if (job_cache == NULL ||
+		pbs_idx_find(job_cache, &key, (void **) &jce, NULL) != PBS_IDX_RET_OK) {
+		pthread_mutex_unlock(&job_cache_lock);
+		return NULL;
+	}
+	if (jce->fingerprint != fingerprint) {
+		/* job has changed, it will be requeried and possibly re-added */
+		pbs_idx_delete(job_cache, job->name);
+		pthread_mutex_unlock(&job_cache_lock);
+		free_job_cache_entry(jce);
+		return NULL;
+	}
+	jce->last_seen = job_cache_gen;
+	/* the template's server is from the cycle it was cached in */
+	jce->resresv->server = sinfo;
+	pthread_mutex_unlock(&job_cache_lock);
+
+	/* A job name appears only once in a cycle's batch_status, so only
+	 * this thread will touch the entry until the next purge.
+	 */
+	resresv = dup_resource_resv(jce->resresv, sinfo, qinfo, err);
+	if (resresv == NULL)
+		return NULL;
+
+	resresv->rank = get_sched_rank();
+	refresh_volatile_job_attrs(resresv, job->attribs);
+
+	return resresv;
+}
+
+/**
+ * @brief	add a freshly queried job to the job cache
+ *
+ * @param[in]	resresv	-	job returned from query_job()
+ * @param[in]	fingerprint	-	fingerprint of job
+ * @param[in]	qinfo	-	queue the job is in
+ * @param[in]	err	-	error object
+ *
+ * @return void
+ *
+ * @par MT-safe: Yes
+ */
+static void
+add_job_to_cache(resource_resv *resresv, unsigned long long fingerprint,
+		queue_info *qinfo, schd_error *err)
+{
+	job_cache_entry *jce;
+	job_cache_entry *old = NULL;
+	void *key = resresv->name;
+
+	/* Only plain queued jobs are cached.  Anything with node
+	 * assignments changes too often and points into this cycle's nodes.
+	 */
+	if (!resresv->job->is_queued || resresv->nspec_arr != NULL ||
+		resresv->job->resreleased != NULL || qinfo->is_peer_queue)
+		return;
+
+	if ((jce = malloc(sizeof(job_cache_entry))) == NULL) {
+		log_err(errno, __func__, MEM_ERR_MSG);
+		return;
+	}
+	jce->fingerprint = fingerprint;
+	jce->resresv = dup_resource_resv(resresv, resresv->server, qinfo, err);
+	if (jce->resresv == NULL) {
+		free(jce);
+		clear_schd_error(err);
+		return;
+	}
+
+	pthread_mutex_lock(&job_cache_lock);
+	if (job_cache == NULL)
+		job_cache = pbs_idx_create(0, 0);
+	if (job_cache == NULL) {
+		pthread_mutex_unlock(&job_cache_lock);
+		free_job_cache_entry(jce);
+		return;
+	}
+	jce->last_seen = job_cache_gen;
+	if (pbs_idx_find(job_cache, &key, (void **) &old, NULL) == PBS_IDX_RET_OK) {
+		pbs_idx_delete(job_cache, resresv->name);
+		free_job_cache_entry(old);
+	}
+	if (pbs_idx_insert(job_cache, resresv->name, jce) != PBS_IDX_RET_OK) {
+		pthread_mutex_unlock(&job_cache_lock);
+		free_job_cache_entry(jce);
+		return;
+	}
+	pthread_mutex_unlock(&job_cache_lock);
+}
+
+/**
+ * @brief	free every entry in the job cache
+ *
+ * @return void
+ */
+void
+flush_job_cache(void)
+{
+	job_cache_entry *jce = NULL;
+	void *ctx = NULL;
+
+	pthread_mutex_lock(&job_cache_lock);
+	if (job_cache != NULL) {
+		while (pbs_idx_find(job_cache, NULL, (void **) &jce, &ctx) == PBS_IDX_RET_OK)
+			free_job_cache_entry(jce);
+		pbs_idx_free_ctx(ctx);
+		pbs_idx_destroy(job_cache);
+		job_cache = NULL;
+	}
+	pthread_mutex_unlock(&job_cache_lock);
+}
+
+/**
+ * @brief	remove jobs from the job cache which the server no longer
+ *		reported this cycle and start a new cache generation.
+ *		Called once all queues have been queried.
+ *
+ * @return void
+ */
+void
+purge_job_cache(void)
+{
+	job_cache_entry *jce = NULL;
+	void *ctx = NULL;
+	void *key;
+	char **stale = NULL;
+	int nstale = 0;
+	int size = 0;
+	int i;
+
+	if (++job_cache_gen % JOB_CACHE_RESYNC_CYCLES == 0) {
+		flush_job_cache();
+		return;
+	}
+
+	pthread_mutex_lock(&job_cache_lock);
+	if (job_cache == NULL) {
+		pthread_mutex_unlock(&job_cache_lock);
+		return;
+	}
+
+	/* collect the names first, we can't delete while iterating */
+	while (pbs_idx_find(job_cache, NULL, (void **) &jce, &ctx) == PBS_IDX_RET_OK) {
+		if (jce->last_seen != job_cache_gen - 1) {
+			if (nstale == size) {
+				char **tmp;
+
+				size = size == 0 ? INIT_ARR_SIZE : size * 2;
+				tmp = realloc(stale, size * sizeof(char *));
+				if (tmp == NULL) {
+					log_err(errno, __func__, MEM_ERR_MSG);
+					break;
+				}
+				stale = tmp;
+			}
+			stale[nstale++] = jce->resresv->name;
+		}
+	}
+	pbs_idx_free_ctx(ctx);
+
+	for (i = 0; i < nstale; i++) {
+		key = stale[i];
+		if (pbs_idx_find(job_cache, &key, (void **) &jce, NULL) == PBS_IDX_RET_OK) {
+			pbs_idx_delete(job_cache, stale[i]);
+			free_job_cache_entry(jce);
+		}
+	}
+	free(stale);
+	pthread_mutex_unlock(&job_cache_lock);
+}
+
 /**
  * @brief	pthread routine for querying a chunk of jobs
  *
@@ -563,12 +911,20 @@ query_jobs_chunk(th_data_query_jinfo *data)
 		time_t start;
 		time_t end;
 		long starve_num;
+		unsigned long long fingerprint;
+		int from_cache = 1;
 
-		if ((resresv = query_job(cur_job, sinfo, err)) == NULL) {
-			data->error = 1;
-			free_schd_error(err);
-			free_resource_resv_array(resresv_arr);
-			return;
+		fingerprint = job_cache_fingerprint(cur_job, sinfo);
+		resresv = find_job_in_cache(cur_job, fingerprint, sinfo, qinfo, err);
+		if (resresv == NULL) {
+			from_cache = 0;
+			clear_schd_error(err);
+			if ((resresv = query_job(cur_job, sinfo, err)) == NULL) {
+				data->error = 1;
+				free_schd_error(err);
+				free_resource_resv_array(resresv_arr);
+				return;
+			}
 		}
 
 		/* do a validity check to see if the job is sane.  If we're peering and
@@ -595,6 +951,9 @@ query_jobs_chunk(th_data_query_jinfo *data)
 			continue;
 		}
 
+		if (!from_cache && err->error_code == SUCCESS)
+			add_job_to_cache(resresv, fingerprint, qinfo, err);
+
 		resresv->job->queue = qinfo;
 #ifdef NAS /* localmod 040 */
 		/* we modify nodect to be the same value for all jobs in queues that are
@@ -841,44 +1200,6 @@ query_jobs_chunk(th_data_query_jinfo *data)
 	free_schd_error(err);
 }
 
-/**
- * @brief	Allocates th_data_query_jinfo for multi-threading of query_jobs
- *
- * @param[in]	policy	-	policy info
- * @param[in]	pbs_sd	-	connection to pbs_server
- * @param[in]	jobs	-	batch_status of jobs
- * @param[in]	qinfo	-	queue to get jobs from
- * @param[in]	sidx	-	start index for the jobs list for the thread
- * @param[in]	eidx	-	end index for the jobs list for the thread
- *
- * @return th_data_query_jinfo *
- * @retval a newly allocated th_data_query_jinfo object
- * @retval NULL for malloc error
- */
-static inline th_data_query_jinfo *
-alloc_tdata_jquery(status *policy, int pbs_sd, struct batch_status *jobs, queue_info *qinfo,
-		int sidx, int eidx)
-{
-	th_data_query_jinfo *tdata = NULL;
-
-	tdata = malloc(sizeof(th_data_query_jinfo));
-	if (tdata == NULL) {
-		log_err(errno, __func__, MEM_ERR_MSG);
-		return NULL;
-	}
-	tdata->error = 0;
-	tdata->jobs = jobs;
-	tdata->oarr = NULL; /* Will be filled by the thread routine */
-	tdata->sinfo = qinfo->server;
-	tdata->qinfo = qinfo;
-	tdata->pbs_sd = pbs_sd;
-	tdata->policy = policy;
-	tdata->sidx = sidx;
-	tdata->eidx = eidx;
-
-	return tdata;
-}
-
 /**
  * @brief
  * 		create an array of jobs in a specified queue
@@ -929,15 +1250,10 @@ query_jobs(status *policy, int pbs_sd, queue_info *qinfo, resource_resv **pjobs,
 	char *errmsg;
 
 	/* for multi-threading */
-	int chunk_size;
 	int j;
 	int jidx;
-	th_data_query_jinfo *tdata = NULL;
-	th_task_info *task = NULL;
-	int num_tasks;
-	int th_err = 0;
-	resource_resv ***jinfo_arrs_tasks;
-	int tid;
+	th_data_query_jinfo tdata;
+	th_task_info task;
 
 	char *jobattrs[] = {
 			ATTR_p,
@@ -1031,99 +1347,177 @@ query_jobs(status *policy, int pbs_sd, queue_info *qinfo, resource_resv **pjobs,
 	}
 	resresv_arr[num_prev_jobs] = NULL;
 
-	tid = *((int *) pthread_getspecific(th_id_key));
-	if (tid != 0 || num_threads <= 1) {
-		/* don't use multi-threading if I am a worker thread or num_threads is 1 */
-		tdata = alloc_tdata_jquery(policy, pbs_sd, jobs, qinfo, 0, num_new_jobs - 1);
-		if (tdata == NULL) {
-			pbs_statfree(jobs);
-			return NULL;
+	tdata.error = 0;
+	tdata.jobs = jobs;
+	tdata.oarr = NULL; /* Will be filled by the thread routine */
+	tdata.sinfo = qinfo->server;
+	tdata.qinfo = qinfo;
+	tdata.pbs_sd = pbs_sd;
+	tdata.policy = policy;
+
+	task.task_type = TS_QUERY_JOB_INFO;
+	task.thread_data = (void *) &tdata;
+	task.num_items = num_new_jobs;
+	if (!run_parallel_task(&task)) {
+		if (task.results != NULL) {
+			for (i = 0; i < task.num_ranges; i++)
+				free_resource_resv_array((resource_resv **) task.results[i]);
+			free(task.results);
 		}
-		query_jobs_chunk(tdata);
+		pbs_statfree(jobs);
+		free_resource_resv_array(resresv_arr);
+		return NULL;
+	}
 
-		if (tdata->error || tdata->oarr == NULL) {
-			pbs_statfree(jobs);
-			return NULL;
-		}
+	/* Assemble job info objects from the ranges into the resresv_arr */
+	for (i = 0, jidx = num_prev_jobs; i < task.num_ranges; i++) {
+		resource_resv **range_arr = task.results[i];
 
-		for (j = 0, jidx = num_prev_jobs; tdata->oarr[j] != NULL; j++) {
-			resresv_arr[jidx++] = tdata->oarr[j];
+		if (range_arr != NULL) {
+			for (j = 0; range_arr[j] != NULL; j++)
+				resresv_arr[jidx++] = range_arr[j];
+			free(range_arr);
 		}
-		free(tdata->oarr);
-		free(tdata);
-		resresv_arr[jidx] = NULL;
-	} else {
-		chunk_size = num_new_jobs / num_threads;
-		chunk_size = (chunk_size > MT_CHUNK_SIZE_MIN) ? chunk_size : MT_CHUNK_SIZE_MIN;
-		chunk_size = (chunk_size < MT_CHUNK_SIZE_MAX) ? chunk_size : MT_CHUNK_SIZE_MAX;
-		for (j = 0, num_tasks = 0; num_new_jobs > 0;
-				num_tasks++, j += chunk_size, num_new_jobs -= chunk_size) {
-			tdata = alloc_tdata_jquery(policy, pbs_sd, jobs, qinfo, j, j + chunk_size - 1);
-			if (tdata == NULL) {
-				th_err = 1;
-				break;
-			}
-			task = malloc(sizeof(th_task_info));
-			if (task == NULL) {
-				free(tdata);
-				log_err(errno, __func__, MEM_ERR_MSG);
-				th_err = 1;
-				break;
-			}
-			task->task_id = num_tasks;
-			task->task_type = TS_QUERY_JOB_INFO;
-			task->thread_data = (void*) tdata;
-
-			pthread_mutex_lock(&work_lock);
-			ds_enqueue(work_queue, (void*) task);
-			pthread_cond_signal(&work_cond);
-			pthread_mutex_unlock(&work_lock);
-		}
-		jinfo_arrs_tasks = malloc(num_tasks * sizeof(resource_resv**));
-		if (jinfo_arrs_tasks == NULL) {
-			log_err(errno, __func__, MEM_ERR_MSG);
-			th_err = 1;
-		}
-		/* Get results from worker threads */
-		for (i = 0; i < num_tasks;) {
-			pthread_mutex_lock(&result_lock);
-			while (ds_queue_is_empty(result_queue))
-				pthread_cond_wait(&result_cond, &result_lock);
-			while (!ds_queue_is_empty(result_queue)) {
-				task = (th_task_info*) ds_dequeue(result_queue);
-				tdata = (th_data_query_jinfo*) task->thread_data;
-				if (tdata->error)
-					th_err = 1;
-				jinfo_arrs_tasks[task->task_id] = tdata->oarr;
-				free(tdata);
-				free(task);
-				i++;
-			}
-			pthread_mutex_unlock(&result_lock);
-		}
-		if (th_err) {
-			pbs_statfree(jobs);
-			free_resource_resv_array(resresv_arr);
-			return NULL;
-		}
-		/* Assemble job info objects from various threads into the resresv_arr */
-		for (i = 0, jidx = num_prev_jobs; i < num_tasks; i++) {
-			if (jinfo_arrs_tasks[i] != NULL) {
-				for (j = 0; jinfo_arrs_tasks[i][j] != NULL; j++) {
-					resresv_arr[jidx++] = jinfo_arrs_tasks[i][j];
-				}
-				free(jinfo_arrs_tasks[i]);
-			}
-		}
-		resresv_arr[jidx] = NULL;
-		free(jinfo_arrs_tasks);
 	}
+	resresv_arr[jidx] = NULL;
+	free(task.results);
+
+	/* new fairshare entities only had their own percentage calculated */
+	if (qinfo->server->fairshare != NULL)
+		refresh_fair_share_perc(qinfo->server->fairshare->root);
 
 	pbs_statfree(jobs);
 
 	return resresv_arr;
 }
 
+/* job attributes query_job() knows how to convert */
+enum job_attr_kind {
+	JATTR_UNKNOWN,
+	JATTR_PRIORITY,
+	JATTR_QTIME,
+	JATTR_QRANK,
+	JATTR_ETIME,
+	JATTR_STIME,
+	JATTR_JOB_NAME,
+	JATTR_STATE,
+	JATTR_SUBSTATE,
+	JATTR_SCHED_PREEMPTED,
+	JATTR_COMMENT,
+	JATTR_RELEASED,
+	JATTR_EUSER,
+	JATTR_EGROUP,
+	JATTR_PROJECT,
+	JATTR_RESV_ID,
+	JATTR_ALTID,
+	JATTR_SCHEDSELECT,
+	JATTR_ARRAY_ID,
+	JATTR_NODE_SET,
+	JATTR_ARRAY,
+	JATTR_ARRAY_INDEX,
+	JATTR_TOPJOB_INELIGIBLE,
+	JATTR_ARRAY_INDICES_REMAINING,
+	JATTR_EXECVNODE,
+	JATTR_RESOURCE_LIST,
+	JATTR_REL_LIST,
+	JATTR_RESOURCES_USED,
+	JATTR_ACCRUE_TYPE,
+	JATTR_ELIGIBLE_TIME,
+	JATTR_ESTIMATED,
+	JATTR_CHECKPOINT,
+	JATTR_RERUNABLE,
+	JATTR_DEPEND
+};
+
+struct job_attr_map {
+	char *name;
+	enum job_attr_kind kind;
+};
+
+/* sorted by name on first use so attributes can be found with bsearch() */
+static struct job_attr_map job_attr_map[] = {
+	{ATTR_p, JATTR_PRIORITY},
+	{ATTR_qtime, JATTR_QTIME},
+	{ATTR_qrank, JATTR_QRANK},
+	{ATTR_etime, JATTR_ETIME},
+	{ATTR_stime, JATTR_STIME},
+	{ATTR_N, JATTR_JOB_NAME},
+	{ATTR_state, JATTR_STATE},
+	{ATTR_substate, JATTR_SUBSTATE},
+	{ATTR_sched_preempted, JATTR_SCHED_PREEMPTED},
+	{ATTR_comment, JATTR_COMMENT},
+	{ATTR_released, JATTR_RELEASED},
+	{ATTR_euser, JATTR_EUSER},
+	{ATTR_egroup, JATTR_EGROUP},
+	{ATTR_project, JATTR_PROJECT},
+	{ATTR_resv_ID, JATTR_RESV_ID},
+	{ATTR_altid, JATTR_ALTID},
+	{ATTR_SchedSelect, JATTR_SCHEDSELECT},
+	{ATTR_array_id, JATTR_ARRAY_ID},
+	{ATTR_node_set, JATTR_NODE_SET},
+	{ATTR_array, JATTR_ARRAY},
+	{ATTR_array_index, JATTR_ARRAY_INDEX},
+	{ATTR_topjob_ineligible, JATTR_TOPJOB_INELIGIBLE},
+	{ATTR_array_indices_remaining, JATTR_ARRAY_INDICES_REMAINING},
+	{ATTR_execvnode, JATTR_EXECVNODE},
+	{ATTR_l, JATTR_RESOURCE_LIST},
+	{ATTR_rel_list, JATTR_REL_LIST},
+	{ATTR_used, JATTR_RESOURCES_USED},
+	{ATTR_accrue_type, JATTR_ACCRUE_TYPE},
+	{ATTR_eligible_time, JATTR_ELIGIBLE_TIME},
+	{ATTR_estimated, JATTR_ESTIMATED},
+	{ATTR_c, JATTR_CHECKPOINT},
+	{ATTR_r, JATTR_RERUNABLE},
+	{ATTR_depend, JATTR_DEPEND}
+};
+static pthread_once_t job_attr_map_once = PTHREAD_ONCE_INIT;
+
+/**
+ * @brief	compare two job_attr_map entries by name for qsort()/bsearch()
+ */
+static int
+cmp_job_attr_map(const void *v1, const void *v2)
+{
+	return strcmp(((const struct job_attr_map *) v1)->name,
+		((const struct job_attr_map *) v2)->name);
+}
+
+/**
+ * @brief	sort job_attr_map[] - called once through pthread_once()
+ */
+static void
+sort_job_attr_map(void)
+{
+	qsort(job_attr_map, sizeof(job_attr_map) / sizeof(job_attr_map[0]),
+		sizeof(struct job_attr_map), cmp_job_attr_map);
+}
+
+/**
+ * @brief	map a job attribute name to the kind of attribute query_job()
+ *		converts it as
+ *
+ * @param[in]	name	-	attribute name
+ *
+ * @return	enum job_attr_kind
+ * @retval	JATTR_UNKNOWN	: query_job() does not use the attribute
+ */
+static enum job_attr_kind
+find_job_attr_kind(char *name)
+{
+	struct job_attr_map key;
+	struct job_attr_map *ent;
+
+	pthread_once(&job_attr_map_once, sort_job_attr_map);
+
+	key.name = name;
+	ent = bsearch(&key, job_attr_map, sizeof(job_attr_map) / sizeof(job_attr_map[0]),
+		sizeof(struct job_attr_map), cmp_job_attr_map);
+	if (ent == NULL)
+		return JATTR_UNKNOWN;
+
+	return ent->kind;
+}
+
 /**
  * @brief
  *		query_job - takes info from a batch_status about a job and
@@ -1205,191 +1599,207 @@ query_job(struct batch_status *job, server_info *sinfo, schd_error *err)
 			else
 				resresv->job->ginfo = NULL;
 		}
-		if (!strcmp(attrp->name, ATTR_p)) { /* priority */
-			count = strtol(attrp->value, &endp, 10);
-			if (*endp == '\0')
-				resresv->job->priority = count;
-			else
-				resresv->job->priority = -1;
+		switch (find_job_attr_kind(attrp->name)) {
+			case JATTR_PRIORITY:
+				count = strtol(attrp->value, &endp, 10);
+				if (*endp == '\0')
+					resresv->job->priority = count;
+				else
+					resresv->job->priority = -1;
 #ifdef NAS /* localmod 045 */
-			resresv->job->NAS_pri = resresv->job->priority;
+				resresv->job->NAS_pri = resresv->job->priority;
 #endif /* localmod 045 */
-		}
-		else if (!strcmp(attrp->name, ATTR_qtime)) { /* queue time */
-			count = strtol(attrp->value, &endp, 10);
-			if (*endp == '\0')
-				resresv->qtime = count;
-			else
-				resresv->qtime = -1;
-		}
-		else if (!strcmp(attrp->name, ATTR_qrank)) { /* queue rank */
-			count = strtol(attrp->value, &endp, 10);
-			if (*endp == '\0')
-				resresv->qrank = count;
-			else
-				resresv->qrank = -1;
-		}
-		else if (!strcmp(attrp->name, ATTR_etime)) { /* eligible time */
-			count = strtol(attrp->value, &endp, 10);
-			if (*endp == '\0')
-				resresv->job->etime = count;
-			else
-				resresv->job->etime = -1;
-		}
-		else if (!strcmp(attrp->name, ATTR_stime)) { /* job start time */
-			count = strtol(attrp->value, &endp, 10);
-			if (*endp == '\0')
-				resresv->job->stime = count;
-			else
-				resresv->job->stime = -1;
-		}
-		else if (!strcmp(attrp->name, ATTR_N))		/* job name (qsub -N) */
-			resresv->job->job_name = string_dup(attrp->value);
-		else if (!strcmp(attrp->name, ATTR_state)) { /* state of job */
-			if (set_job_state(attrp->value, resresv->job) == 0) {
-				set_schd_error_codes(err, NEVER_RUN, ERR_SPECIAL);
-				set_schd_error_arg(err, SPECMSG, "Job is in an invalid state");
-				resresv->is_invalid = 1;
-			}
-		}
-		else if (!strcmp(attrp->name, ATTR_substate)) {
-			if (!strcmp(attrp->value, SUSP_BY_SCHED_SUBSTATE))
-				resresv->job->is_susp_sched = 1;
-			if (!strcmp(attrp->value, PROVISIONING_SUBSTATE))
-				resresv->job->is_provisioning = 1;
-		}
-		else if (!strcmp(attrp->name, ATTR_sched_preempted)) {
-			count = strtol(attrp->value, &endp, 10);
-			if (*endp == '\0') {
-				resresv->job->time_preempted = count;
-				resresv->job->is_preempted = 1;
-			}
-		}
-		else if (!strcmp(attrp->name, ATTR_comment))	/* job comment */
-			resresv->job->comment = string_dup(attrp->value);
-		else if (!strcmp(attrp->name, ATTR_released)) /* resources_released */
-			resresv->job->resreleased = parse_execvnode(attrp->value, sinfo, NULL);
-		else if (!strcmp(attrp->name, ATTR_euser))	/* account name */
-			resresv->user = string_dup(attrp->value);
-		else if (!strcmp(attrp->name, ATTR_egroup))	/* group name */
-			resresv->group = string_dup(attrp->value);
-		else if (!strcmp(attrp->name, ATTR_project))	/* project name */
-			resresv->project = string_dup(attrp->value);
-		else if (!strcmp(attrp->name, ATTR_resv_ID))	/* reserve_ID */
-			resresv->job->resv_id = string_dup(attrp->value);
-		else if (!strcmp(attrp->name, ATTR_altid))    /* vendor ID */
-			resresv->job->alt_id = string_dup(attrp->value);
-		else if (!strcmp(attrp->name, ATTR_SchedSelect))
-#ifdef NAS /* localmod 031 */
-		{
-			resresv->job->schedsel = string_dup(attrp->value);
-#endif /* localmod 031 */
-
-			resresv->select = parse_selspec(attrp->value);
+				break;
+			case JATTR_QTIME:
+				count = strtol(attrp->value, &endp, 10);
+				if (*endp == '\0')
+					resresv->qtime = count;
+				else
+					resresv->qtime = -1;
+				break;
+			case JATTR_QRANK:
+				count = strtol(attrp->value, &endp, 10);
+				if (*endp == '\0')
+					resresv->qrank = count;
+				else
+					resresv->qrank = -1;
+				break;
+			case JATTR_ETIME:
+				count = strtol(attrp->value, &endp, 10);
+				if (*endp == '\0')
+					resresv->job->etime = count;
+				else
+					resresv->job->etime = -1;
+				break;
+			case JATTR_STIME:
+				count = strtol(attrp->value, &endp, 10);
+				if (*endp == '\0')
+					resresv->job->stime = count;
+				else
+					resresv->job->stime = -1;
+				break;
+			case JATTR_JOB_NAME:
+				resresv->job->job_name = string_dup(attrp->value);
+				break;
+			case JATTR_STATE:
+				if (set_job_state(attrp->value, resresv->job) == 0) {
+					set_schd_error_codes(err, NEVER_RUN, ERR_SPECIAL);
+					set_schd_error_arg(err, SPECMSG, "Job is in an invalid state");
+					resresv->is_invalid = 1;
+				}
+				break;
+			case JATTR_SUBSTATE:
+				if (!strcmp(attrp->value, SUSP_BY_SCHED_SUBSTATE))
+					resresv->job->is_susp_sched = 1;
+				if (!strcmp(attrp->value, PROVISIONING_SUBSTATE))
+					resresv->job->is_provisioning = 1;
+				break;
+			case JATTR_SCHED_PREEMPTED:
+				count = strtol(attrp->value, &endp, 10);
+				if (*endp == '\0') {
+					resresv->job->time_preempted = count;
+					resresv->job->is_preempted = 1;
+				}
+				break;
+			case JATTR_COMMENT:
+				resresv->job->comment = string_dup(attrp->value);
+				break;
+			case JATTR_RELEASED:
+				resresv->job->resreleased = parse_execvnode(attrp->value, sinfo, NULL);
+				break;
+			case JATTR_EUSER:
+				resresv->user = string_dup(attrp->value);
+				break;
+			case JATTR_EGROUP:
+				resresv->group = string_dup(attrp->value);
+				break;
+			case JATTR_PROJECT:
+				resresv->project = string_dup(attrp->value);
+				break;
+			case JATTR_RESV_ID:
+				resresv->job->resv_id = string_dup(attrp->value);
+				break;
+			case JATTR_ALTID:
+				resresv->job->alt_id = string_dup(attrp->value);
+				break;
+			case JATTR_SCHEDSELECT:
 #ifdef NAS /* localmod 031 */
-		}
+				resresv->job->schedsel = string_dup(attrp->value);
 #endif /* localmod 031 */
-		else if (!strcmp(attrp->name, ATTR_array_id))
-			resresv->job->array_id = string_dup(attrp->value);
-		else if (!strcmp(attrp->name, ATTR_node_set))
-			resresv->node_set_str = break_comma_list(attrp->value);
-		else if (!strcmp(attrp->name, ATTR_array)) { /* array */
-			if (!strcmp(attrp->value, ATR_TRUE))
-				resresv->job->is_array = 1;
-		}
-		else if (!strcmp(attrp->name, ATTR_array_index)) { /* array_index */
-			count = strtol(attrp->value, &endp, 10);
-			if (*endp == '\0')
-				resresv->job->array_index = count;
-			else
-				resresv->job->array_index = -1;
-
-			resresv->job->is_subjob = 1;
-		}
-		else if (!strcmp(attrp->name, ATTR_topjob_ineligible)) {
-			if (!strcmp(attrp->value, ATR_TRUE))
-				resresv->job->topjob_ineligible = 1;
-		}
-		/* array_indices_remaining */
-		else if (!strcmp(attrp->name, ATTR_array_indices_remaining))
-			resresv->job->queued_subjobs = range_parse(attrp->value);
-		else if (!strcmp(attrp->name, ATTR_execvnode))
-			execvnode = attrp->value;
-		else if (!strcmp(attrp->name, ATTR_l)) { /* resources requested*/
-			resreq = find_alloc_resource_req_by_str(resresv->resreq, attrp->resource);
-			if (resreq == NULL) {
-				free_resource_resv(resresv);
-				return NULL;
-			}
+				resresv->select = intern_selspec(attrp->value);
+				break;
+			case JATTR_ARRAY_ID:
+				resresv->job->array_id = string_dup(attrp->value);
+				break;
+			case JATTR_NODE_SET:
+				resresv->node_set_str = break_comma_list(attrp->value);
+				break;
+			case JATTR_ARRAY:
+				if (!strcmp(attrp->value, ATR_TRUE))
+					resresv->job->is_array = 1;
+				break;
+			case JATTR_ARRAY_INDEX:
+				count = strtol(attrp->value, &endp, 10);
+				if (*endp == '\0')
+					resresv->job->array_index = count;
+				else
+					resresv->job->array_index = -1;
+
+				resresv->job->is_subjob = 1;
+				break;
+			case JATTR_TOPJOB_INELIGIBLE:
+				if (!strcmp(attrp->value, ATR_TRUE))
+					resresv->job->topjob_ineligible = 1;
+				break;
+			case JATTR_ARRAY_INDICES_REMAINING:
+				resresv->job->queued_subjobs = range_parse(attrp->value);
+				break;
+			case JATTR_EXECVNODE:
+				execvnode = attrp->value;
+				break;
+			case JATTR_RESOURCE_LIST:
+				resreq = find_alloc_resource_req_by_str(resresv->resreq, attrp->resource);
+				if (resreq == NULL) {
+					free_resource_resv(resresv);
+					return NULL;
+				}
 
-			if (set_resource_req(resreq, attrp->value) != 1) {
-				set_schd_error_codes(err, NEVER_RUN, ERR_SPECIAL);
-				set_schd_error_arg(err, SPECMSG, "Bad requested resource data");
-				resresv->is_invalid = 1;
-			} else {
-				if (resresv->resreq == NULL)
-					resresv->resreq = resreq;
+				if (set_resource_req(resreq, attrp->value) != 1) {
+					set_schd_error_codes(err, NEVER_RUN, ERR_SPECIAL);
+					set_schd_error_arg(err, SPECMSG, "Bad requested resource data");
+					resresv->is_invalid = 1;
+				} else {
+					if (resresv->resreq == NULL)
+						resresv->resreq = resreq;
 #ifdef NAS
-				if (!strcmp(attrp->resource, "nodect")) { /* nodect for sort */
-					/* localmod 040 */
-					count = strtol(attrp->value, &endp, 10);
-					if (*endp == '\0')
-						resresv->job->nodect = count;
-					else
-						resresv->job->nodect = 0;
-					/* localmod 034 */
-					resresv->job->accrue_rate = resresv->job->nodect; /* XXX should be SBU rate */
-				}
+					if (!strcmp(attrp->resource, "nodect")) { /* nodect for sort */
+						/* localmod 040 */
+						count = strtol(attrp->value, &endp, 10);
+						if (*endp == '\0')
+							resresv->job->nodect = count;
+						else
+							resresv->job->nodect = 0;
+						/* localmod 034 */
+						resresv->job->accrue_rate = resresv->job->nodect; /* XXX should be SBU rate */
+					}
 #endif
-				if (!strcmp(attrp->resource, "place")) {
-					resresv->place_spec = parse_placespec(attrp->value);
-					if (resresv->place_spec == NULL) {
-						set_schd_error_codes(err, NEVER_RUN, ERR_SPECIAL);
-						set_schd_error_arg(err, SPECMSG, "invalid placement spec");
-						resresv->is_invalid = 1;
+					if (!strcmp(attrp->resource, "place")) {
+						resresv->place_spec = intern_placespec(attrp->value);
+						if (resresv->place_spec == NULL) {
+							set_schd_error_codes(err, NEVER_RUN, ERR_SPECIAL);
+							set_schd_error_arg(err, SPECMSG, "invalid placement spec");
+							resresv->is_invalid = 1;
 
+						}
 					}
 				}
-			}
-		} else if (!strcmp(attrp->name, ATTR_rel_list)) {
-			resreq = find_alloc_resource_req_by_str(resresv->job->resreq_rel, attrp->resource);
-			if (resreq != NULL)
-				set_resource_req(resreq, attrp->value);
-			if (resresv->job->resreq_rel == NULL)
-				resresv->job->resreq_rel = resreq;
-		} else if (!strcmp(attrp->name, ATTR_used)) { /* resources used */
-			resreq =
-				find_alloc_resource_req_by_str(resresv->job->resused, attrp->resource);
-			if (resreq != NULL)
-				set_resource_req(resreq, attrp->value);
-			if (resresv->job->resused ==NULL)
-				resresv->job->resused = resreq;
-		} else if (!strcmp(attrp->name, ATTR_accrue_type)) {
-			count = strtol(attrp->value, &endp, 10);
-			if (*endp == '\0')
-				resresv->job->accrue_type = count;
-			else
-				resresv->job->accrue_type = 0;
-		} else if (!strcmp(attrp->name, ATTR_eligible_time))
-			resresv->job->eligible_time = (time_t) res_to_num(attrp->value, NULL);
-		else if (!strcmp(attrp->name, ATTR_estimated)) {
-			if (!strcmp(attrp->resource, "start_time")) {
-				resresv->job->est_start_time =
-					(time_t) res_to_num(attrp->value, NULL);
-			}
-			else if (!strcmp(attrp->resource, "execvnode"))
-				resresv->job->est_execvnode = string_dup(attrp->value);
-		}
-		else if (!strcmp(attrp->name, ATTR_c)) { /* checkpoint allowed? */
-			if (strcmp(attrp->value, "n") == 0)
-				resresv->job->can_checkpoint = 0;
-		}
-		else if (!strcmp(attrp->name, ATTR_r)) { /* reque allowed ? */
-			if (strcmp(attrp->value, ATR_FALSE) == 0)
-				resresv->job->can_requeue = 0;
-		}
-		else if (!strcmp(attrp->name, ATTR_depend)) {
-			resresv->job->depend_job_str = string_dup(attrp->value);
+				break;
+			case JATTR_REL_LIST:
+				resreq = find_alloc_resource_req_by_str(resresv->job->resreq_rel, attrp->resource);
+				if (resreq != NULL)
+					set_resource_req(resreq, attrp->value);
+				if (resresv->job->resreq_rel == NULL)
+					resresv->job->resreq_rel = resreq;
+				break;
+			case JATTR_RESOURCES_USED:
+				resreq =
+					find_alloc_resource_req_by_str(resresv->job->resused, attrp->resource);
+				if (resreq != NULL)
+					set_resource_req(resreq, attrp->value);
+				if (resresv->job->resused ==NULL)
+					resresv->job->resused = resreq;
+				break;
+			case JATTR_ACCRUE_TYPE:
+				count = strtol(attrp->value, &endp, 10);
+				if (*endp == '\0')
+					resresv->job->accrue_type = count;
+				else
+					resresv->job->accrue_type = 0;
+				break;
+			case JATTR_ELIGIBLE_TIME:
+				resresv->job->eligible_time = (time_t) res_to_num(attrp->value, NULL);
+				break;
+			case JATTR_ESTIMATED:
+				if (!strcmp(attrp->resource, "start_time")) {
+					resresv->job->est_start_time =
+						(time_t) res_to_num(attrp->value, NULL);
+				}
+				else if (!strcmp(attrp->resource, "execvnode"))
+					resresv->job->est_execvnode = string_dup(attrp->value);
+				break;
+			case JATTR_CHECKPOINT: /* checkpoint allowed? */
+				if (strcmp(attrp->value, "n") == 0)
+					resresv->job->can_checkpoint = 0;
+				break;
+			case JATTR_RERUNABLE: /* reque allowed ? */
+				if (strcmp(attrp->value, ATR_FALSE) == 0)
+					resresv->job->can_requeue = 0;
+				break;
+			case JATTR_DEPEND:
+				resresv->job->depend_job_str = string_dup(attrp->value);
+				break;
+			default:
+				break;
 		}
 
 		attrp = attrp->next;
@@ -1770,25 +2180,88 @@ update_job_attr(int pbs_sd, resource_resv *resresv, char *attr_name,
 	return 0;
 }
 
+/* delayed job attribute updates waiting to be sent in one ModifyJobs request */
+static struct {
+	int sd;			/* connection the updates are for */
+	int count;		/* number of jobs in the batch */
+	char *jobids[JOB_UPDATE_BATCH_SIZE];
+	struct attrl *attrs[JOB_UPDATE_BATCH_SIZE];
+} job_update_batch = {-1, 0};
+
+/**
+ * @brief
+ * 		send all delayed job attribute updates collected by send_job_updates()
+ *		to the server in a single ModifyJobs request
+ *
+ * @par
+ *		The request gets no reply, so this only waits for the request to be
+ *		written.  It is called when the batch is full and at the end of
+ *		every cycle.
+ *
+ * @return	void
+ */
+void
+flush_job_updates(void)
+{
+	int i;
+	int rc;
+
+	if (job_update_batch.count == 0)
+		return;
+
+	if (pbs_client_thread_lock_connection(job_update_batch.sd) != 0)
+		rc = pbs_errno;
+	else {
+		rc = PBSD_modifyjobs_put(job_update_batch.sd, job_update_batch.count,
+			job_update_batch.jobids, job_update_batch.attrs, NULL);
+		pbs_client_thread_unlock_connection(job_update_batch.sd);
+	}
+	if (rc == 0) {
+		last_attr_updates = time(NULL);
+		log_eventf(PBSEVENT_DEBUG3, PBS_EVENTCLASS_SCHED, LOG_DEBUG, __func__,
+			"Sent attribute updates for %d jobs", job_update_batch.count);
+	} else {
+		char *errbuf;
+
+		errbuf = pbs_geterrmsg(job_update_batch.sd);
+		if (errbuf == NULL)
+			errbuf = "";
+		log_eventf(PBSEVENT_SCHED, PBS_EVENTCLASS_SCHED, LOG_WARNING, __func__,
+			"Failed to update attributes of %d jobs: %s (%d)",
+			job_update_batch.count, errbuf, pbs_errno);
+	}
+
+	for (i = 0; i < job_update_batch.count; i++) {
+		free(job_update_batch.jobids[i]);
+		free_attrl_list(job_update_batch.attrs[i]);
+	}
+	job_update_batch.count = 0;
+	job_update_batch.sd = -1;
+}
+
 /**
  * @brief
- * 		send delayed job attribute updates for job using send_attr_updates().
+ * 		send delayed job attribute updates for job
  *
  * @par
  * 		The main reason to use this function over a direct send_attr_update()
  *      call is so that the job's attr_updates list gets free'd and NULL'd.
  *      We don't want to send the attr updates multiple times
  *
+ * @par
+ *		The updates are not sent right away.  They are handed over to a batch
+ *		which flush_job_updates() sends to the server in one request.
+ *
  * @param[in]	pbs_sd	-	server connection descriptor
  * @param[in]	job	-	job to send attributes to
  *
- * @return	int(ret val from send_attr_updates)
+ * @return	int
  * @retval	1	- success
  * @retval	0	- failure to update
  */
 int send_job_updates(int pbs_sd, resource_resv *job)
 {
-	int rc;
+	char *jobid;
 	struct attrl *iter_attr = NULL;
 
 	if(job == NULL)
@@ -1806,11 +2279,34 @@ int send_job_updates(int pbs_sd, resource_resv *job)
 			return 0;
 	}
 
-	rc = send_attr_updates(pbs_sd, job->name, job->job->attr_updates);
+	if (job->job->attr_updates == NULL)
+		return 0;
+
+	if (pbs_sd == SIMULATE_SD) {
+		free_attrl_list(job->job->attr_updates);
+		job->job->attr_updates = NULL;
+		return 1; /* simulation always successful */
+	}
 
-	free_attrl_list(job->job->attr_updates);
+	if ((jobid = string_dup(job->name)) == NULL) {
+		free_attrl_list(job->job->attr_updates);
+		job->job->attr_updates = NULL;
+		return 0;
+	}
+
+	if (job_update_batch.count > 0 && job_update_batch.sd != pbs_sd)
+		flush_job_updates();
+
+	job_update_batch.sd = pbs_sd;
+	job_update_batch.jobids[job_update_batch.count] = jobid;
+	job_update_batch.attrs[job_update_batch.count] = job->job->attr_updates;
+	job_update_batch.count++;
 	job->job->attr_updates = NULL;
-	return rc;
+
+	if (job_update_batch.count == JOB_UPDATE_BATCH_SIZE)
+		flush_job_updates();
+
+	return 1;
 }
 
 
@@ -2268,6 +2764,8 @@ new_resresv_set(void)
 	rset->req = NULL;
 	rset->select_spec = NULL;
 	rset->qinfo = NULL;
+	rset->key_hash = 0;
+	rset->num_members = 0;
 
 	return rset;
 }
@@ -2320,6 +2818,8 @@ dup_resresv_set(resresv_set *oset, server_info *nsinfo)
 		return NULL;
 
 	rset->can_not_run = oset->can_not_run;
+	rset->key_hash = oset->key_hash;
+	rset->num_members = oset->num_members;
 
 	rset->err = dup_schd_error(oset->err);
 	if (oset->err != NULL && oset->err == NULL) {
@@ -2342,12 +2842,12 @@ dup_resresv_set(resresv_set *oset, server_info *nsinfo)
 		free_resresv_set(rset);
 		return NULL;
 	}
-	rset->select_spec = dup_selspec(oset->select_spec);
+	rset->select_spec = share_selspec(oset->select_spec);
 	if (rset->select_spec == NULL) {
 		free_resresv_set(rset);
 		return NULL;
 	}
-	rset->place_spec = dup_place(oset->place_spec);
+	rset->place_spec = share_place(oset->place_spec);
 	if (rset->place_spec == NULL) {
 		free_resresv_set(rset);
 		return NULL;
@@ -2592,21 +3092,154 @@ create_resresv_set_by_resresv(status *policy, server_info *sinfo, resource_resv
 	if (resresv_set_use_proj(sinfo, rset->qinfo))
 		rset->project = string_dup(resresv->project);
 
-	rset->select_spec = dup_selspec(resresv_set_which_selspec(resresv));
+	rset->select_spec = share_selspec(resresv_set_which_selspec(resresv));
 	if (rset->select_spec == NULL) {
 		free_resresv_set(rset);
 		return NULL;
 	}
-	rset->place_spec = dup_place(resresv->place_spec);
+	rset->place_spec = share_place(resresv->place_spec);
 	if (rset->place_spec == NULL) {
 		free_resresv_set(rset);
 		return NULL;
 	}
 	/* rset->req may be NULL if the intersection of resresv->resreq and policy->equiv_class_resdef is the NULL set */
 	rset->req = dup_selective_resource_req_list(resresv->resreq, policy->equiv_class_resdef);
+	rset->key_hash = resresv_set_hash(policy, rset->user, rset->group, rset->project,
+		rset->select_spec, rset->place_spec, rset->req, rset->qinfo);
+
+	return rset;
+}
+
+/**
+ * @brief fold an integer value into a running pbs_strhash() hash
+ * @param[in] hash - hash value to continue from
+ * @param[in] val - value to add to the hash
+ * @return unsigned long long
+ */
+static unsigned long long
+hash_mix(unsigned long long hash, unsigned long long val)
+{
+	int i;
+
+	for (i = 0; i < 8; i++) {
+		hash ^= (val >> (i * 8)) & 0xff;
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+/**
+ * @brief hash the resources of a resource_req list which are in comparr
+ * @par The hash is independent of the order of the list, to match
+ *	compare_resource_req_list()
+ * @param[in] req - list to hash
+ * @param[in] comparr - resources to hash or NULL for all resources
+ * @return unsigned long long
+ */
+static unsigned long long
+hash_resource_req_list(resource_req *req, resdef **comparr)
+{
+	unsigned long long hash = 0;
+	unsigned long long h;
+	union {
+		double d;
+		unsigned long long u;
+	} amount;
+	resource_req *cur;
+
+	for (cur = req; cur != NULL; cur = cur->next) {
+		if (comparr != NULL && !resdef_exists_in_array(comparr, cur->def))
+			continue;
+		h = pbs_strhash(PBS_HASH_INIT, cur->name);
+		if (cur->type.is_consumable || cur->type.is_boolean) {
+			/* adding 0.0 turns -0 into 0 so equal amounts hash the same */
+			amount.u = 0;
+			amount.d = cur->amount + 0.0;
+			h = hash_mix(h, amount.u);
+		} else if (cur->type.is_string)
+			h = pbs_strhash(h, cur->res_str);
+		hash += h;
+	}
+	return hash;
+}
+
+/**
+ * @brief hash the key of a resresv_set
+ * @par Equal keys (as determined by resresv_set_matches()) have equal hashes.
+ *	Arguments are the same as find_resresv_set().
+ * @return unsigned long long
+ */
+unsigned long long
+resresv_set_hash(status *policy, char *user, char *group, char *project, selspec *sel, place *pl, resource_req *req, queue_info *qinfo)
+{
+	unsigned long long hash = PBS_HASH_INIT;
+	int i;
+
+	/* mix in which parts are set so a NULL part and an empty string differ */
+	hash = hash_mix(hash, (qinfo != NULL) | (user != NULL) << 1 |
+		(group != NULL) << 2 | (project != NULL) << 3 |
+		(sel != NULL) << 4 | (pl != NULL) << 5);
+	if (qinfo != NULL)
+		hash = pbs_strhash(hash, qinfo->name);
+	hash = pbs_strhash(hash, user);
+	hash = pbs_strhash(hash, group);
+	hash = pbs_strhash(hash, project);
+
+	if (sel != NULL) {
+		hash = hash_mix(hash, sel->total_chunks);
+		for (i = 0; sel->chunks != NULL && sel->chunks[i] != NULL; i++) {
+			hash = hash_mix(hash, sel->chunks[i]->num_chunks);
+			hash = hash_mix(hash, hash_resource_req_list(sel->chunks[i]->req, NULL));
+		}
+	}
+
+	if (pl != NULL) {
+		hash = hash_mix(hash, pl->free | pl->pack << 1 | pl->scatter << 2 |
+			pl->vscatter << 3 | pl->excl << 4 | pl->exclhost << 5 | pl->share << 6);
+		hash = pbs_strhash(hash, pl->group);
+	}
+
+	return hash_mix(hash, hash_resource_req_list(req, policy->equiv_class_resdef));
+}
+
+/**
+ * @brief check if a resresv_set has the key made of the component parts
+ * @par Arguments are the same as find_resresv_set()
+ * @return int
+ * @retval 1 if the set matches
+ * @retval 0 if not
+ */
+static int
+resresv_set_matches(status *policy, resresv_set *rset, char *user, char *group, char *project, selspec *sel, place *pl, resource_req *req, queue_info *qinfo)
+{
+	if ((qinfo != NULL && rset->qinfo == NULL) || (qinfo == NULL && rset->qinfo != NULL))
+		return 0;
+	if ((qinfo != NULL && rset->qinfo != NULL) && cstrcmp(qinfo->name, rset->qinfo->name) != 0)
+		return 0;
+
+	if ((user != NULL && rset->user == NULL) || (user == NULL && rset->user != NULL))
+		return 0;
+	if (user != NULL && cstrcmp(user, rset->user) != 0)
+		return 0;
 
+	if ((group != NULL && rset->group == NULL) || (group == NULL && rset->group != NULL))
+		return 0;
+	if (group != NULL && cstrcmp(group, rset->group) != 0)
+		return 0;
 
-	return rset;
+	if ((project != NULL && rset->project == NULL) || (project == NULL && rset->project != NULL))
+		return 0;
+	if (project != NULL && cstrcmp(project, rset->project) != 0)
+		return 0;
+
+	if (compare_selspec(rset->select_spec, sel) == 0)
+		return 0;
+	if (compare_place(rset->place_spec, pl) == 0)
+		return 0;
+	if (compare_resource_req_list(rset->req, req, policy->equiv_class_resdef) == 0)
+		return 0;
+
+	return 1;
 }
 
 /**
@@ -2629,42 +3262,55 @@ int
 find_resresv_set(status *policy, resresv_set **rsets, char *user, char *group, char *project, selspec *sel, place *pl, resource_req *req, queue_info *qinfo)
 {
 	int i;
+	unsigned long long hash;
 
-	if (rsets == NULL)
+	if (policy == NULL || rsets == NULL)
 		return -1;
 
+	hash = resresv_set_hash(policy, user, group, project, sel, pl, req, qinfo);
+
 	for (i = 0; rsets[i] != NULL; i++) {
-		if ((qinfo != NULL && rsets[i]->qinfo == NULL) || (qinfo == NULL && rsets[i]->qinfo != NULL))
+		if (rsets[i]->key_hash != hash)
 			continue;
-		if ((qinfo != NULL && rsets[i]->qinfo != NULL) && cstrcmp(qinfo->name, rsets[i]->qinfo->name) != 0)
+		if (resresv_set_matches(policy, rsets[i], user, group, project, sel, pl, req, qinfo))
+			return i;
+	}
+	return -1;
 
-			continue;
-		if ((user != NULL && rsets[i]->user == NULL) || (user == NULL && rsets[i]->user != NULL))
-			continue;
-		if (user != NULL && cstrcmp(user, rsets[i]->user) != 0)
-			continue;
+}
 
-		if ((group != NULL && rsets[i]->group == NULL) || (group == NULL && rsets[i]->group != NULL))
-			continue;
-		if (group != NULL && cstrcmp(group, rsets[i]->group) != 0)
-			continue;
+/**
+ * @brief get the parts of a resresv which make up its resresv_set key
+ * @par Parts which are not used by the set are returned as NULL
+ * @param[in] resresv - resresv
+ * @param[out] user - user name
+ * @param[out] grp - group name
+ * @param[out] proj - project name
+ * @param[out] qinfo - queue
+ * @param[out] sspec - select spec
+ */
+static void
+resresv_set_key_parts(resource_resv *resresv, char **user, char **grp, char **proj, queue_info **qinfo, selspec **sspec)
+{
+	*user = NULL;
+	*grp = NULL;
+	*proj = NULL;
+	*qinfo = NULL;
 
-		if ((project != NULL && rsets[i]->project == NULL) || (project == NULL && rsets[i]->project != NULL))
-			continue;
-		if (project != NULL && cstrcmp(project, rsets[i]->project) != 0)
-			continue;
+	if (resresv->is_job && resresv->job != NULL)
+		if (resresv_set_use_queue(resresv->job->queue))
+			*qinfo = resresv->job->queue;
 
-		if (compare_selspec(rsets[i]->select_spec, sel) == 0)
-			continue;
-		if (compare_place(rsets[i]->place_spec, pl) == 0)
-			continue;
-		if (compare_resource_req_list(rsets[i]->req, req, policy->equiv_class_resdef) == 0)
-			continue;
-		/* If we got here, we have found our set */
-		return i;
-	}
-	return -1;
+	if (resresv_set_use_user(resresv->server, *qinfo))
+		*user = resresv->user;
+
+	if (resresv_set_use_grp(resresv->server, *qinfo))
+		*grp = resresv->group;
 
+	if (resresv_set_use_proj(resresv->server, *qinfo))
+		*proj = resresv->project;
+
+	*sspec = resresv_set_which_selspec(resresv);
 }
 
 /**
@@ -2677,35 +3323,25 @@ find_resresv_set(status *policy, resresv_set **rsets, char *user, char *group, c
 int
 find_resresv_set_by_resresv(status *policy, resresv_set **rsets, resource_resv *resresv)
 {
-	char *user = NULL;
-	char *grp = NULL;
-	char *proj = NULL;
-	queue_info *qinfo = NULL;
+	char *user;
+	char *grp;
+	char *proj;
+	queue_info *qinfo;
 	selspec *sspec;
 
 	if (policy == NULL || rsets == NULL || resresv == NULL)
 		return -1;
 
-	if (resresv->is_job && resresv->job != NULL)
-		if (resresv_set_use_queue(resresv->job->queue))
-			qinfo = resresv->job->queue;
-
-	if (resresv_set_use_user(resresv->server, qinfo))
-		user = resresv->user;
-
-	if (resresv_set_use_grp(resresv->server, qinfo))
-		grp = resresv->group;
-
-	if (resresv_set_use_proj(resresv->server, qinfo))
-		proj = resresv->project;
-
-	sspec = resresv_set_which_selspec(resresv);
+	resresv_set_key_parts(resresv, &user, &grp, &proj, &qinfo, &sspec);
 
 	return find_resresv_set(policy, rsets, user, grp, proj, sspec, resresv->place_spec, resresv->resreq, qinfo);
 }
 
 /**
  * @brief create equivalence classes based on an array of resresvs
+ * @par Sets are found through a hash table on the set key, so creating
+ *	the classes is linear in the number of jobs rather than
+ *	jobs * classes.
  * @param[in] policy - policy info
  * @param[in] sinfo - server universe
  * @return array of equivalence classes (resresv_sets)
@@ -2717,7 +3353,17 @@ create_resresv_sets(status *policy, server_info *sinfo)
 	int j = 0;
 	int cur_ind;
 	int len;
-	int rset_len;
+	int nbuckets;
+	int *buckets;
+	int *chain;
+	int largest = 0;
+	int singles = 0;
+	unsigned long long hash;
+	char *user;
+	char *grp;
+	char *proj;
+	queue_info *qinfo;
+	selspec *sspec;
 	resource_resv **resresvs;
 	resresv_set **rsets;
 	resresv_set **tmp_rset_arr;
@@ -2735,34 +3381,73 @@ create_resresv_sets(status *policy, server_info *sinfo)
 		return NULL;
 	}
 
+	/* power of 2 number of buckets, at least as many as there are jobs */
+	for (nbuckets = 16; nbuckets < len; nbuckets <<= 1)
+		;
+	buckets = malloc(nbuckets * sizeof(int));
+	chain = malloc((len + 1) * sizeof(int));
+	if (buckets == NULL || chain == NULL) {
+		log_err(errno, __func__, MEM_ERR_MSG);
+		free(buckets);
+		free(chain);
+		free(rsets);
+		return NULL;
+	}
+	for (i = 0; i < nbuckets; i++)
+		buckets[i] = -1;
+
 	rsets[0] = NULL;
 
 	for (i = 0; resresvs[i] != NULL; i++) {
-		cur_ind = find_resresv_set_by_resresv(policy, rsets, resresvs[i]);
+		resresv_set_key_parts(resresvs[i], &user, &grp, &proj, &qinfo, &sspec);
+		hash = resresv_set_hash(policy, user, grp, proj, sspec,
+			resresvs[i]->place_spec, resresvs[i]->resreq, qinfo);
+
+		for (cur_ind = buckets[hash & (nbuckets - 1)]; cur_ind != -1; cur_ind = chain[cur_ind]) {
+			if (rsets[cur_ind]->key_hash == hash &&
+			    resresv_set_matches(policy, rsets[cur_ind], user, grp, proj, sspec,
+				resresvs[i]->place_spec, resresvs[i]->resreq, qinfo))
+				break;
+		}
 
 		/* Didn't find the set, create it.*/
 		if (cur_ind == -1) {
 			cur_rset = create_resresv_set_by_resresv(policy, sinfo, resresvs[i]);
 			if (cur_rset == NULL) {
+				free(buckets);
+				free(chain);
 				free_resresv_set_array(rsets);
 				return NULL;
 			}
 			cur_ind = j;
 			rsets[j++] = cur_rset;
 			rsets[j] = NULL;
+			chain[cur_ind] = buckets[hash & (nbuckets - 1)];
+			buckets[hash & (nbuckets - 1)] = cur_ind;
 		} else
 			cur_rset = rsets[cur_ind];
 
+		cur_rset->num_members++;
 		resresvs[i]->ec_index = cur_ind;
 	}
+	free(buckets);
+	free(chain);
 
 	tmp_rset_arr = realloc(rsets,(j + 1) * sizeof(resresv_set *));
 	if (tmp_rset_arr != NULL)
 		rsets = tmp_rset_arr;
-	rset_len = count_array(rsets);
-	if (rset_len > 0) {
+	if (j > 0) {
+		for (i = 0; i < j; i++) {
+			if (rsets[i]->num_members > largest)
+				largest = rsets[i]->num_members;
+			if (rsets[i]->num_members == 1)
+				singles++;
+		}
 		log_eventf(PBSEVENT_DEBUG3, PBS_EVENTCLASS_SCHED, LOG_DEBUG, __func__,
-			"Number of job equivalence classes: %d", rset_len);
+			"Number of job equivalence classes: %d", j);
+		log_eventf(PBSEVENT_DEBUG3, PBS_EVENTCLASS_SCHED, LOG_DEBUG, __func__,
+			"Job equivalence classes: %d jobs, largest class %d jobs, %d single job classes",
+			len, largest, singles);
 	}
 
 	return rsets;
@@ -2808,6 +3493,7 @@ dup_job_info(job_info *ojinfo, queue_info *nqinfo, server_info *nsinfo)
 	njinfo->topjob_ineligible = ojinfo->topjob_ineligible;
 	njinfo->is_checkpointed = ojinfo->is_checkpointed;
 	njinfo->is_provisioning = ojinfo->is_provisioning;
+	njinfo->is_preempted = ojinfo->is_preempted;
 
 	njinfo->can_checkpoint = ojinfo->can_checkpoint;
 	njinfo->can_requeue    = ojinfo->can_requeue;
@@ -2821,6 +3507,9 @@ dup_job_info(job_info *ojinfo, queue_info *nqinfo, server_info *nsinfo)
 	njinfo->peer_sd = ojinfo->peer_sd;
 	njinfo->job_id = ojinfo->job_id;
 	njinfo->est_start_time = ojinfo->est_start_time;
+	njinfo->time_preempted = ojinfo->time_preempted;
+	njinfo->accrue_type = ojinfo->accrue_type;
+	njinfo->eligible_time = ojinfo->eligible_time;
 	njinfo->formula_value = ojinfo->formula_value;
 	njinfo->est_execvnode = string_dup(ojinfo->est_execvnode);
 	njinfo->job_name = string_dup(ojinfo->job_name);
@@ -2842,14 +3531,14 @@ dup_job_info(job_info *ojinfo, queue_info *nqinfo, server_info *nsinfo)
 	njinfo->resreleased = dup_nspecs(ojinfo->resreleased, nsinfo->nodes, NULL);
 	njinfo->resreq_rel = dup_resource_req_list(ojinfo->resreq_rel);
 
-	if (nqinfo->server->fairshare !=NULL) {
+	if (nqinfo->server->fairshare != NULL && ojinfo->ginfo != NULL) {
 		njinfo->ginfo = find_group_info(ojinfo->ginfo->name,
 			nqinfo->server->fairshare->root);
 	}
 	else
 		njinfo->ginfo = NULL;
 
-	njinfo->depend_job_str = string_dup(njinfo->depend_job_str);
+	njinfo->depend_job_str = string_dup(ojinfo->depend_job_str);
 
 #ifdef RESC_SPEC
 	njinfo->rspec = dup_rescspec(ojinfo->rspec);
@@ -3082,6 +3771,8 @@ find_and_preempt_jobs(status *policy, int pbs_sd, resource_resv *hjob, server_in
 			}
 		}
 
+		/* the preempt reply must not be confused with a pipelined run reply */
+		drain_runjob_pipeline(pbs_sd);
 		if ((preempt_jobs_reply = pbs_preempt_jobs(pbs_sd, preempt_jobs_list)) == NULL) {
 			free_string_array(preempt_jobs_list);
 			free(preempted_list);
@@ -3195,6 +3886,256 @@ find_and_preempt_jobs(status *policy, int pbs_sd, resource_resv *hjob, server_in
 	return rc;
 }
 
+/**
+ * @brief	return the non consumable resources of policy->resdef_to_check
+ *
+ * @param[in]	policy	-	policy info
+ *
+ * @return	resdef **
+ * @retval	newly allocated array of resources
+ * @retval	NULL	: no resources to check or error
+ */
+static resdef **
+non_consumable_resdefs_to_check(status *policy)
+{
+	resdef **rdtc_nc;
+	int max_resdefs;
+	int i;
+	int j;
+
+	if (policy == NULL || (max_resdefs = count_array(policy->resdef_to_check)) == 0)
+		return NULL;
+
+	if ((rdtc_nc = calloc(max_resdefs + 1, sizeof(resdef *))) == NULL) {
+		log_err(errno, __func__, MEM_ERR_MSG);
+		return NULL;
+	}
+
+	for (i = 0, j = 0; policy->resdef_to_check[i] != NULL; i++)
+		if (policy->resdef_to_check[i]->type.is_non_consumable)
+			rdtc_nc[j++] = policy->resdef_to_check[i];
+
+	return rdtc_nc;
+}
+
+/**
+ * @brief	can a node help a high priority job if the jobs on it were
+ *		preempted, i.e. does its total resources satisfy a chunk of the job
+ *
+ * @param[in]	hjob	-	the high priority job
+ * @param[in]	node	-	the node
+ * @param[in]	rdtc_non_consumable	-	resources to check on multivnoded hosts
+ *
+ * @return	int
+ * @retval	1	: node can help
+ * @retval	0	: node can not help
+ * @retval	-1	: error
+ */
+static int
+node_can_help_preempt(resource_resv *hjob, node_info *node, resdef **rdtc_non_consumable)
+{
+	/* at first assume all resources (including consumables) need to be checked */
+	resdef **rdtc_here = NULL;
+	schd_error *err;
+	int k;
+	int good = 0;
+
+	if (node->is_multivnoded)
+		/* unsafe to consider vnodes from multivnoded hosts "no good" when "not enough" of some consumable
+		 * resource can be found in the vnode, since rest may be provided by other vnodes on the same host
+		 * restrict check on these vnodes to check only against non consumable resources
+		 */
+		rdtc_here = rdtc_non_consumable;
+
+	if ((err = new_schd_error()) == NULL)
+		return -1;
+
+	for (k = 0; hjob->select->chunks[k] != NULL; k++) {
+		long num_chunks_returned = 0;
+		/* if only non consumables are checked, infinite number of chunks can be satisfied,
+		 * and SCHD_INFINITY is negative, so don't be tempted to check on positive value
+		 */
+		clear_schd_error(err);
+		num_chunks_returned = check_avail_resources(node->res, hjob->select->chunks[k]->req,
+					COMPARE_TOTAL | CHECK_ALL_BOOLS | UNSET_RES_ZERO,
+					rdtc_here, INSUFFICIENT_RESOURCE, err);
+		if ((num_chunks_returned > 0) || (num_chunks_returned == SCHD_INFINITY)) {
+			good = 1;
+			break;
+		}
+	}
+	free_schd_error(err);
+
+	return good;
+}
+
+/**
+ * @brief	check the parts of a running job's eligibility for preemption
+ *		which do not change while preemption is simulated
+ *
+ * @param[in]	rjob	-	running job
+ * @param[in]	hjob	-	the high priority job
+ * @param[in]	fail_list	-	jobs which previously failed to be preempted
+ *
+ * @return	int
+ * @retval	1	: job may be preempted
+ * @retval	0	: job may not be preempted
+ */
+static int
+is_static_preempt_candidate(resource_resv *rjob, resource_resv *hjob, int *fail_list)
+{
+	struct preempt_ordering *po;
+	int j;
+
+	if (rjob->job == NULL || rjob->ninfo_arr == NULL)
+		return 0;
+
+	if (rjob->job->is_provisioning || rjob->job->can_not_preempt)
+		return 0;
+
+	for (j = 0; fail_list[j] != 0; j++)
+		if (fail_list[j] == rjob->rank)
+			return 0;
+
+	/* check whether any method in the job's preemption order is enabled */
+	po = schd_get_preempt_order(rjob);
+	if (po == NULL)
+		return 0;
+	for (j = 0; j < PREEMPT_METHOD_HIGH; j++) {
+		if (po->order[j] == PREEMPT_METHOD_SUSPEND && rjob->job->can_suspend)
+			break; /* suspension is always allowed */
+		if (po->order[j] == PREEMPT_METHOD_CHECKPOINT && rjob->job->can_checkpoint)
+			break; /* choose if checkpoint is allowed */
+		if (po->order[j] == PREEMPT_METHOD_REQUEUE && rjob->job->can_requeue)
+			break; /* choose if requeue is allowed */
+		if (po->order[j] == PREEMPT_METHOD_DELETE)
+			break;
+	}
+	if (j == PREEMPT_METHOD_HIGH) /* no preemption method good */
+		return 0;
+
+	for (j = 0; rjob->ninfo_arr[j] != NULL; j++)
+		if (rjob->ninfo_arr[j]->is_down || rjob->ninfo_arr[j]->is_offline)
+			return 0;
+
+	/* if the high priority job is suspended, only jobs on its nodes can help */
+	if (hjob->ninfo_arr != NULL) {
+		for (j = 0; hjob->ninfo_arr[j] != NULL; j++)
+			if (find_node_by_rank(rjob->ninfo_arr, hjob->ninfo_arr[j]->rank) != NULL)
+				break;
+		if (hjob->ninfo_arr[j] == NULL)
+			return 0;
+	}
+
+	return 1;
+}
+
+/**
+ * @brief	free a preemption index
+ *
+ * @param[in]	pidx	-	index to free
+ *
+ * @return void
+ */
+static void
+free_preempt_index(preempt_index *pidx)
+{
+	if (pidx == NULL)
+		return;
+
+	free(pidx->cands);
+	free(pidx->node_useful);
+	free(pidx->rdtc_non_consumable);
+	free(pidx);
+}
+
+/**
+ * @brief	build the preemption index for a high priority job
+ *
+ * @par	The running jobs which can never be preempted for hjob are dropped
+ *	once, rather than on every select_index_to_preempt() call, and room is
+ *	made to remember which nodes can help hjob at all.  Neither changes
+ *	while the preemption of the candidates is being simulated.
+ *
+ * @par	Preempt priorities are not compared here.  update_preemption_priority()
+ *	can change them during the simulation, so select_index_to_preempt()
+ *	compares them on every pass.  A job which is not running can not start
+ *	during the simulation, so it is safe to drop it here.
+ *
+ * @param[in]	policy	-	policy info
+ * @param[in]	hjob	-	the high priority job
+ * @param[in]	rjobs	-	running jobs sorted in preemption order
+ * @param[in]	sinfo	-	server of the jobs
+ * @param[in]	fail_list	-	jobs which previously failed to be preempted
+ *
+ * @return	preempt_index *
+ * @retval	NULL	: error
+ */
+static preempt_index *
+new_preempt_index(status *policy, resource_resv *hjob, resource_resv **rjobs,
+		server_info *sinfo, int *fail_list)
+{
+	preempt_index *pidx;
+	int i;
+
+	if ((pidx = calloc(1, sizeof(preempt_index))) == NULL) {
+		log_err(errno, __func__, MEM_ERR_MSG);
+		return NULL;
+	}
+
+	pidx->cands = malloc((count_array(rjobs) + 1) * sizeof(resource_resv *));
+	pidx->num_nodes = sinfo->num_nodes;
+	pidx->node_useful = calloc(sinfo->num_nodes + 1, sizeof(signed char));
+	if (pidx->cands == NULL || pidx->node_useful == NULL) {
+		log_err(errno, __func__, MEM_ERR_MSG);
+		free_preempt_index(pidx);
+		return NULL;
+	}
+	pidx->rdtc_non_consumable = non_consumable_resdefs_to_check(policy);
+
+	for (i = 0; rjobs[i] != NULL; i++) {
+		if (rjobs[i]->job->is_running &&
+			is_static_preempt_candidate(rjobs[i], hjob, fail_list))
+			pidx->cands[pidx->num_cands++] = rjobs[i];
+	}
+	pidx->cands[pidx->num_cands] = NULL;
+
+	log_eventf(PBSEVENT_DEBUG2, PBS_EVENTCLASS_JOB, LOG_DEBUG, hjob->name,
+		"Preemption index: %d of %d running jobs are candidates", pidx->num_cands, i);
+
+	return pidx;
+}
+
+/**
+ * @brief	can a node help the high priority job, remembered in the index
+ *
+ * @param[in]	pidx	-	preemption index
+ * @param[in]	hjob	-	the high priority job
+ * @param[in]	node	-	the node
+ *
+ * @return	int
+ * @retval	1	: node can help
+ * @retval	0	: node can not help
+ * @retval	-1	: error
+ */
+static int
+preempt_index_node_useful(preempt_index *pidx, resource_resv *hjob, node_info *node)
+{
+	int rc;
+
+	if (node->node_ind < 0 || node->node_ind >= pidx->num_nodes)
+		return node_can_help_preempt(hjob, node, pidx->rdtc_non_consumable);
+
+	if (pidx->node_useful[node->node_ind] != 0)
+		return pidx->node_useful[node->node_ind] > 0;
+
+	rc = node_can_help_preempt(hjob, node, pidx->rdtc_non_consumable);
+	if (rc >= 0)
+		pidx->node_useful[node->node_ind] = rc ? 1 : -1;
+
+	return rc;
+}
+
 
 /**
  * @brief
@@ -3253,6 +4194,7 @@ find_jobs_to_preempt(status *policy, resource_resv *hjob, server_info *sinfo, in
 	char **preempt_targets_list = NULL;
 	resource_resv **prjobs = NULL;
 	int rjobs_count = 0;
+	preempt_index *pidx = NULL;
 
 
 	*no_of_jobs = 0;
@@ -3431,7 +4373,15 @@ find_jobs_to_preempt(status *policy, resource_resv *hjob, server_info *sinfo, in
 		goto cleanup;
 	}
 
-	rjobs_subset = filter_preemptable_jobs(rjobs, nhjob, err);
+	/* drop the jobs which can never be preempted for nhjob once, rather than
+	 * every time we select a job or filter the candidates again
+	 */
+	if ((pidx = new_preempt_index(npolicy, nhjob, rjobs, nsinfo, fail_list)) == NULL) {
+		pjobs_list = NULL;
+		goto cleanup;
+	}
+
+	rjobs_subset = filter_preemptable_jobs(pidx->cands, nhjob, err);
 	if (rjobs_subset == NULL) {
 		log_event(PBSEVENT_DEBUG2, PBS_EVENTCLASS_JOB, LOG_INFO, nhjob->name, "Found no preemptable candidates");
 		pjobs_list = NULL;
@@ -3439,7 +4389,7 @@ find_jobs_to_preempt(status *policy, resource_resv *hjob, server_info *sinfo, in
 	}
 
 	skipto = 0;
-	while ((indexfound = select_index_to_preempt(npolicy, nhjob, rjobs_subset, skipto, err, fail_list)) != NO_JOB_FOUND) {
+	while ((indexfound = select_index_to_preempt(npolicy, nhjob, rjobs_subset, skipto, err, fail_list, pidx)) != NO_JOB_FOUND) {
 		struct preempt_ordering *po;
 		int dont_preempt_job = 0;
 		int ind = 0;
@@ -3557,7 +4507,7 @@ find_jobs_to_preempt(status *policy, resource_resv *hjob, server_info *sinfo, in
 
 		if (filter_again == 1) {
 			free(rjobs_subset);
-			rjobs_subset = filter_preemptable_jobs(rjobs, nhjob, err);
+			rjobs_subset = filter_preemptable_jobs(pidx->cands, nhjob, err);
 			if (rjobs_subset == NULL) {
 				log_event(PBSEVENT_DEBUG2, PBS_EVENTCLASS_JOB, LOG_INFO, nhjob->name, "Found no preemptable candidates");
 				pjobs_list = NULL;
@@ -3635,6 +4585,7 @@ find_jobs_to_preempt(status *policy, resource_resv *hjob, server_info *sinfo, in
 			*no_of_jobs = i;
 	}
 cleanup:
+	free_preempt_index(pidx);
 	free_server(nsinfo);
 	free(pjobs);
 	free(prjobs);
@@ -3655,6 +4606,8 @@ cleanup:
  * @param[in] err    - reason the high prio job isn't running
  * @param[in] fail_list - list of jobs to skip. They previously failed to be preempted.
  *			  Do not select them again.
+ * @param[in] pidx - preemption index for hjob that rjobs were taken from.  The checks
+ *		     already done when building it are skipped.  May be NULL.
  *
  * @return long
  * @retval index of the job to preempt
@@ -3664,11 +4617,10 @@ cleanup:
 long
 select_index_to_preempt(status *policy, resource_resv *hjob,
 	resource_resv **rjobs, long skipto, schd_error *err,
-	int *fail_list)
+	int *fail_list, preempt_index *pidx)
 {
-	int i, j, k;
+	int i, j;
 	int good = 1;		/* good boolean: Is job eligible to be preempted */
-	struct preempt_ordering *po;
 	resdef **rdtc_non_consumable = NULL;
 
 	if ( err == NULL || hjob == NULL || hjob->job == NULL ||
@@ -3679,166 +4631,55 @@ select_index_to_preempt(status *policy, resource_resv *hjob,
 	if (hjob->job->is_running && hjob->ninfo_arr == NULL)
 		return NO_JOB_FOUND;
 
+	if (pidx == NULL)
+		rdtc_non_consumable = non_consumable_resdefs_to_check(policy);
+
 	/* if we find a good job, we'll break out at the bottom
 	 * we can't break out up here since i will be incremented by this point
 	 * and we'll be returning the job AFTER the one we want too
 	 */
 	for (i = skipto; rjobs[i] != NULL; i++) {
 		/* Does the running job have any resource we need? */
-		int node_good = 1;
+		int node_good = 0;
 
 		/* lets be optimistic.. we'll start off assuming this is a good candidate */
 		good = 1;
 
-		/* if hjob hit a hard limit, check if candidate job has requested that resource
-		 * if reason is different then set flag as if resource was found
-		 */
-
 		if (rjobs[i]->job == NULL || rjobs[i]->ninfo_arr == NULL)
 			continue; /* we have problems... */
 
-		if (!rjobs[i]->job->is_running)
-			/* Only running jobs have resources allocated to them.
-			 * They are only eligible to preempt.
-			 */
-			good = 0;
-
-
-		if (rjobs[i]->job->is_provisioning)
-			good = 0; /* provisioning job cannot be preempted */
-
-		if (good) {
-			if (rjobs[i]->job->can_not_preempt ||
-			rjobs[i]->job->preempt >= hjob->job->preempt)
-				good = 0;
-		}
-
-		if (good) {
-			for (j = 0; fail_list[j] != 0; j++) {
-				if (fail_list[j] == rjobs[i]->rank) {
-					good = 0;
-					break;
-				}
-			}
-		}
-
-		if (good) {
-			/* get the preemption order to be used for this job */
-			po = schd_get_preempt_order(rjobs[i]);
-
-			/* check whether chosen order is enabled for this job */
-			for (j = 0; j < PREEMPT_METHOD_HIGH; j++) {
-				if (po->order[j] == PREEMPT_METHOD_SUSPEND  &&
-					rjobs[i]->job->can_suspend)
-					break; /* suspension is always allowed */
-
-				if (po->order[j] == PREEMPT_METHOD_CHECKPOINT &&
-					rjobs[i]->job->can_checkpoint)
-					break; /* choose if checkpoint is allowed */
-
-				if (po->order[j] == PREEMPT_METHOD_REQUEUE &&
-					rjobs[i]->job->can_requeue)
-					break; /* choose if requeue is allowed */
-				if (po->order[j] == PREEMPT_METHOD_DELETE)
-					break;
-			}
-			if (j == PREEMPT_METHOD_HIGH) /* no preemption method good */
-				good = 0;
-		}
-
-		if (good) {
-			for (j = 0; good && rjobs[i]->ninfo_arr[j] != NULL; j++) {
-				if (rjobs[i]->ninfo_arr[j]->is_down || rjobs[i]->ninfo_arr[j]->is_offline)
-					good = 0;
-			}
-		}
-
-		/* if the high priority job is suspended then make sure we only
-		 * select jobs from the node the job is currently suspended on
+		/* Only running jobs have resources allocated to them.
+		 * They are only eligible to preempt.  Running and preempt
+		 * change as preemption is simulated, so always check them.
 		 */
+		if (!rjobs[i]->job->is_running ||
+			rjobs[i]->job->preempt >= hjob->job->preempt)
+			continue;
 
-		if (good) {
-			if (hjob->ninfo_arr != NULL) {
-				for (j = 0; hjob->ninfo_arr[j] != NULL; j++) {
-					if (find_node_by_rank(rjobs[i]->ninfo_arr,
-						hjob->ninfo_arr[j]->rank) != NULL)
-						break;
-				}
-
-				/* if we made all the way through the list, then rjobs[i] has no useful
-				 * nodes for us to use... don't select it, unless it's not node resources we're after
-				 */
+		if (pidx == NULL && !is_static_preempt_candidate(rjobs[i], hjob, fail_list))
+			continue;
 
-				if (hjob->ninfo_arr[j] == NULL)
-					good = 0;
-			}
-		}
-		if (good) {
-			schd_error *err;
-			node_good = 0;
+		for (j = 0; rjobs[i]->ninfo_arr[j] != NULL && !node_good; j++) {
+			int rc;
 
-			err = new_schd_error();
-			if(err == NULL)
+			if (pidx != NULL)
+				rc = preempt_index_node_useful(pidx, hjob, rjobs[i]->ninfo_arr[j]);
+			else
+				rc = node_can_help_preempt(hjob, rjobs[i]->ninfo_arr[j], rdtc_non_consumable);
+			if (rc < 0) {
+				free(rdtc_non_consumable);
 				return NO_JOB_FOUND;
-
-			for (j = 0; rjobs[i]->ninfo_arr[j] != NULL && !node_good; j++) {
-				resdef **rdtc_here = NULL; /* at first assume all resources (including consumables) need to be checked */
-				node_info *node = rjobs[i]->ninfo_arr[j];
-				if (node->is_multivnoded) {
-					/* unsafe to consider vnodes from multivnoded hosts "no good" when "not enough" of some consumable
-					 * resource can be found in the vnode, since rest may be provided by other vnodes on the same host
-					 * restrict check on these vnodes to check only against non consumable resources
-					 */
-					if (rdtc_non_consumable == NULL) {
-						long max_resdefs = 0;
-						if (policy != NULL)
-							max_resdefs = count_array(policy->resdef_to_check);
-
-						if (max_resdefs > 0)    {
-							rdtc_non_consumable = (resdef **) calloc(sizeof(resdef *),(size_t) max_resdefs + 1);
-							if (rdtc_non_consumable != NULL) {
-								long resdef_index = 0;
-								long rdtc_nc_index = 0;
-								for (; policy->resdef_to_check[resdef_index] != NULL; resdef_index++) {
-									if (policy->resdef_to_check[resdef_index]->type.is_non_consumable) {
-										rdtc_non_consumable[rdtc_nc_index] = policy->resdef_to_check[resdef_index];
-										rdtc_nc_index++;
-									}
-									rdtc_non_consumable[rdtc_nc_index] = NULL;
-								}
-							}
-						}
-					}
-					rdtc_here = rdtc_non_consumable;
-				}
-				for (k = 0; hjob->select->chunks[k] != NULL; k++) {
-					long num_chunks_returned = 0;
-					/* if only non consumables are checked, infinite number of chunks can be satisfied,
-					 * and SCHD_INFINITY is negative, so don't be tempted to check on positive value
-					 */
-					clear_schd_error(err);
-					num_chunks_returned = check_avail_resources(node->res, hjob->select->chunks[k]->req,
-								COMPARE_TOTAL | CHECK_ALL_BOOLS | UNSET_RES_ZERO,
-								rdtc_here, INSUFFICIENT_RESOURCE, err);
-					if ( (num_chunks_returned > 0) || (num_chunks_returned == SCHD_INFINITY) ) {
-						node_good = 1;
-						break;
-					}
-
-				}
 			}
-			free_schd_error(err);
+			node_good = rc;
 		}
 
 		if (node_good == 0)
 			good = 0;
 
-
 		if (good)
 			break;
 	}
-	if (rdtc_non_consumable != NULL)
-		free (rdtc_non_consumable);
+	free(rdtc_non_consumable);
 
 	if (good && rjobs[i] != NULL)
 		return i;
@@ -4174,7 +5015,7 @@ modify_job_array_for_qrun(server_info *sinfo, char *jobid)
 	name[len + 1] = '\0';
 	strcat(name, rest);
 
-	job = find_resource_resv(sinfo->jobs, name);
+	job = find_resource_resv_idx(sinfo->jobs_idx, sinfo->jobs, name);
 
 	if (job != NULL) {
 		/* lets only run the jobs which were requested */
@@ -4233,7 +5074,7 @@ queue_subjob(resource_resv *array, server_info *sinfo,
 	if (subjob_index >= 0) {
 		subjob_name = create_subjob_name(array->name, subjob_index);
 		if (subjob_name != NULL) {
-			if ((rresv = find_resource_resv(sinfo->jobs, subjob_name)) != NULL) {
+			if ((rresv = find_resource_resv_idx(sinfo->jobs_idx, sinfo->jobs, subjob_name)) != NULL) {
 				free(subjob_name);
 				/* Set tmparr to something so we're not considered an error */
 				tmparr = sinfo->jobs;
@@ -4246,12 +5087,14 @@ queue_subjob(resource_resv *array, server_info *sinfo,
 				tmparr = add_resresv_to_array(sinfo->jobs, rresv, NO_FLAGS);
 				if (tmparr != NULL) {
 					sinfo->jobs = tmparr;
+					add_resresv_to_name_idx(&sinfo->jobs_idx, rresv);
 					sinfo->sc.queued++;
 					sinfo->sc.total++;
 
 					tmparr = add_resresv_to_array(sinfo->all_resresv, rresv, SET_RESRESV_INDEX);
 					if (tmparr != NULL) {
 						sinfo->all_resresv = tmparr;
+						add_resresv_to_name_idx(&sinfo->all_resresv_idx, rresv);
 						tmparr = add_resresv_to_array(qinfo->jobs, rresv, NO_FLAGS);
 						if (tmparr != NULL) {
 							qinfo->jobs = tmparr;
@@ -4276,7 +5119,7 @@ queue_subjob(resource_resv *array, server_info *sinfo,
 /**
  * @brief
  * 		evaluate a math formula for jobs based on their resources
- *		NOTE: currently done through embedded python interpreter
+ *		through the embedded python interpreter
  *
  * @param[in]	formula	-	formula to evaluate
  * @param[in]	resresv	-	job for special case key words
@@ -4287,8 +5130,8 @@ queue_subjob(resource_resv *array, server_info *sinfo,
  */
 
 #ifdef PYTHON
-sch_resource_t
-formula_evaluate(char *formula, resource_resv *resresv, resource_req *resreq)
+static sch_resource_t
+formula_evaluate_python(char *formula, resource_resv *resresv, resource_req *resreq)
 {
 	char buf[1024];
 	char *globals;
@@ -4406,13 +5249,42 @@ formula_evaluate(char *formula, resource_resv *resresv, resource_req *resreq)
 	return ans;
 }
 #else
-sch_resource_t
-formula_evaluate(char *formula, resource_resv *resresv, resource_req *resreq)
+static sch_resource_t
+formula_evaluate_python(char *formula, resource_resv *resresv, resource_req *resreq)
 {
 	return 0;
 }
 #endif
 
+/**
+ * @brief
+ * 		evaluate a math formula for jobs based on their resources.
+ *		Formulas are compiled and evaluated natively where possible
+ *		(see formula.c).  Anything else is done through the embedded
+ *		python interpreter.
+ *
+ * @param[in]	formula	-	formula to evaluate
+ * @param[in]	resresv	-	job for special case key words
+ * @param[in]	resreq	-	resources to use when evaluating
+ *
+ * @return	evaluated formula answer or 0 on exception
+ *
+ */
+sch_resource_t
+formula_evaluate(char *formula, resource_resv *resresv, resource_req *resreq)
+{
+	sch_resource_t ans = 0;
+
+	if (formula == NULL || resresv == NULL ||
+		resresv->job == NULL || consres == NULL)
+		return 0;
+
+	if (formula_evaluate_native(formula, resresv, resreq, &ans) != FORMULA_NATIVE_UNSUPPORTED)
+		return ans;
+
+	return formula_evaluate_python(formula, resresv, resreq);
+}
+
 /**
  * @brief
  * 		Set the job accrue type to eligible time.
@@ -4800,7 +5672,7 @@ update_estimated_attrs(int pbs_sd, resource_resv *job,
 
 	if (!force) {
 		if (job->job->is_subjob) {
-			array = find_resource_resv(job->server->jobs, job->job->array_id);
+			array = find_resource_resv_idx(job->server->jobs_idx, job->server->jobs, job->job->array_id);
 			if (array != NULL) {
 				if (job->job->array_index !=
 					range_next_value(array->job->queued_subjobs, -1)) {
@@ -4815,7 +5687,7 @@ update_estimated_attrs(int pbs_sd, resource_resv *job,
 	else {
 		aflags = UPDATE_NOW;
 		if (job->job->array_id !=NULL)
-			array = find_resource_resv(job->server->jobs, job->job->array_id);
+			array = find_resource_resv_idx(job->server->jobs_idx, job->server->jobs, job->job->array_id);
 	}
 
 
@@ -5527,7 +6399,7 @@ void associate_dependent_jobs(server_info *sinfo) {
 				sinfo->jobs[i]->job->dependent_jobs[len] = NULL;
 				for (j = 0; job_arr[j] != NULL; j++) {
 					resource_resv *jptr = NULL;
-					jptr = find_resource_resv(sinfo->jobs, job_arr[j]);
+					jptr = find_resource_resv_idx(sinfo->jobs_idx, sinfo->jobs, job_arr[j]);
 					if (jptr != NULL)
 						sinfo->jobs[i]->job->dependent_jobs[j] = jptr;
 					free(job_arr[j]);
@@ -59,6 +59,16 @@ void query_jobs_chunk(th_data_query_jinfo *data);
 /* create an array of jobs for a particular queue */
 resource_resv **query_jobs(status *policy, int pbs_sd, queue_info *qinfo, resource_resv **pjobs, char *queue_name);
 
+/*
+ * purge jobs the server no longer has from the cross-cycle job cache
+ */
+void purge_job_cache(void);
+
+/*
+ * free the whole cross-cycle job cache
+ */
+void flush_job_cache(void);
+
 
 /*
  *	new_job_info  - allocate and initialize new job_info structure
@@ -92,6 +102,9 @@ int send_job_updates(int pbs_sd, resource_resv *job);
 /* send delayed attributes to the server for a job */
 int send_attr_updates(int pbs_sd, char *job_name, struct attrl *pattr);
 
+/* send all delayed job attribute updates collected by send_job_updates() */
+void flush_job_updates(void);
+
 
 /*
  *
@@ -166,7 +179,7 @@ find_jobs_to_preempt(status *policy, resource_resv *jinfo,
 long
 select_index_to_preempt(status *policy, resource_resv *hjob,
 	resource_resv **rjobs, long skipto, schd_error *err,
-	int *fail_list);
+	int *fail_list, preempt_index *pidx);
 
 /*
  *      preempt_level - take a preemption priority and return a preemption
@@ -370,6 +383,9 @@ resresv_set **dup_resresv_set_array(resresv_set **osets, server_info *nsinfo);
 /* create a resresv_set with a resresv as a template */
 resresv_set *create_resresv_set_by_resresv(status *policy, server_info *sinfo, resource_resv *resresv);
 
+/* hash the key of a resresv_set by its internal components */
+unsigned long long resresv_set_hash(status *policy, char *user, char *group, char *project, selspec *sel, place *pl, resource_req *req, queue_info *qinfo);
+
 /* find a resresv_set by its internal components */
 int find_resresv_set(status *policy, resresv_set **rsets, char *user, char *group, char *project, selspec *sel, place *pl, resource_req *req, queue_info *qinfo);
 
@@ -281,23 +281,48 @@ check_queue_max_run_soft(server_info *, queue_info *,
 typedef	int	(*limfunc_t)(server_info *, queue_info *, resource_resv *,
 	limcounts *, limcounts *, schd_error *);
 
-static limfunc_t	limfuncs[] = {
-	check_queue_max_group_run,
-	check_queue_max_project_run,
-	check_queue_max_run,
-	check_queue_max_user_run,
-	check_server_max_group_run,
-	check_server_max_project_run,
-	check_server_max_run,
-	check_server_max_user_run,
-	check_queue_max_group_res,
-	check_queue_max_project_res,
-	check_queue_max_res,
-	check_queue_max_user_res,
-	check_server_max_group_res,
-	check_server_max_project_res,
-	check_server_max_res,
-	check_server_max_user_res,
+/**
+ * @brief
+ * 		bits describing the kind of hard limit a limit function checks.
+ * 		The bits of the hard limits actually set on a server or queue
+ * 		are recorded in its limit_info by has_hardlimits(), so
+ * 		check_limits() only calls the functions which can fire.
+ */
+#define	LIMF_RUN(kt)	(1u << (kt))		/* run limit for entity type kt */
+#define	LIMF_RES(kt)	(1u << ((kt) + 4))	/* resource limit for entity type kt */
+
+/**
+ * @struct	limfunc_info
+ * @brief
+ * 		a hard limit function and the limit it checks
+ *
+ * @param[in]	lf_func	-	the limit function
+ * @param[in]	lf_queue	-	1 if the limit is a queue limit, 0 for a server limit
+ * @param[in]	lf_limit	-	LIMF_* bit of the limit checked by lf_func
+ */
+struct limfunc_info {
+	limfunc_t	lf_func;
+	int		lf_queue;
+	unsigned int	lf_limit;
+};
+
+static struct limfunc_info	limfuncs[] = {
+	{check_queue_max_group_run,	1,	LIMF_RUN(LIM_GROUP)},
+	{check_queue_max_project_run,	1,	LIMF_RUN(LIM_PROJECT)},
+	{check_queue_max_run,		1,	LIMF_RUN(LIM_OVERALL)},
+	{check_queue_max_user_run,	1,	LIMF_RUN(LIM_USER)},
+	{check_server_max_group_run,	0,	LIMF_RUN(LIM_GROUP)},
+	{check_server_max_project_run,	0,	LIMF_RUN(LIM_PROJECT)},
+	{check_server_max_run,		0,	LIMF_RUN(LIM_OVERALL)},
+	{check_server_max_user_run,	0,	LIMF_RUN(LIM_USER)},
+	{check_queue_max_group_res,	1,	LIMF_RES(LIM_GROUP)},
+	{check_queue_max_project_res,	1,	LIMF_RES(LIM_PROJECT)},
+	{check_queue_max_res,		1,	LIMF_RES(LIM_OVERALL)},
+	{check_queue_max_user_res,	1,	LIMF_RES(LIM_USER)},
+	{check_server_max_group_res,	0,	LIMF_RES(LIM_GROUP)},
+	{check_server_max_project_res,	0,	LIMF_RES(LIM_PROJECT)},
+	{check_server_max_res,		0,	LIMF_RES(LIM_OVERALL)},
+	{check_server_max_user_res,	0,	LIMF_RES(LIM_USER)},
 };
 
 /**
@@ -390,10 +415,12 @@ static int		lim_setrunlimits(const struct attrl *, void *);
  *
  * @param[in]	li_ctxh	-	limit context for storing (hard) resource and run limits
  * @param[in]	li_ctxs	-	limit context for storing (soft) resource and run limits
+ * @param[in]	li_hardlims	-	LIMF_* bits of the kinds of hard limits in li_ctxh
  */
 struct limit_info {
 	void	*li_ctxh;
 	void	*li_ctxs;
+	unsigned int	li_hardlims;	/* LIMF_* bits of the hard limits set (see has_hardlimits()) */
 };
 #define	LI2RESCTX(li)		(((struct limit_info *) li)->li_ctxh)
 #define	LI2RESCTXSOFT(li)	(((struct limit_info *) li)->li_ctxs)
@@ -496,6 +523,7 @@ lim_dup_liminfo(void *p)
 			return NULL;
 		} else
 			LI2RESCTXSOFT(newlip) = ctx;
+		newlip->li_hardlims = oldlip->li_hardlims;
 
 		/*
 		 *	We currently store both resource and run limits in a
@@ -663,32 +691,70 @@ lim_setlimits(const struct attrl *a, enum limtype lt, void *p)
 }
 /**
  * @brief
- * 		check whether the limit info structure has at least one hard resource limit,
- * 		if so, free them.
+ * 		compute the LIMF_* bits of the kinds of limits stored in a limit context
+ *
+ * @param[in]	ctx	-	limit context to walk
+ *
+ * @return	LIMF_* bits of the limits found
+ */
+static unsigned int
+lim_kinds(void *ctx)
+{
+	unsigned int	kinds = 0;
+	void		*k = NULL;
+	char		*key;
+	enum lim_keytypes	kt;
+
+	while (entlim_get_next(ctx, &k) != NULL) {
+		key = k;
+		switch (key[0]) {
+			case 'u':
+				kt = LIM_USER;
+				break;
+			case 'g':
+				kt = LIM_GROUP;
+				break;
+			case 'p':
+				kt = LIM_PROJECT;
+				break;
+			case 'o':
+				kt = LIM_OVERALL;
+				break;
+			default:
+				continue;
+		}
+		if (strchr(key, ';') != NULL)
+			kinds |= LIMF_RES(kt);
+		else
+			kinds |= LIMF_RUN(kt);
+	}
+
+	return (kinds);
+}
+/**
+ * @brief
+ * 		check whether the limit info structure has at least one hard limit.
+ * 		The kinds of hard limits found are recorded in the limit info for
+ * 		check_limits(), so this must be called once all limits are set.
  *
  * @param[in,out]	p	-	limit info structure which needs to be checked.
  *
  * @return	int
- * @retval	1	: Hard limit found and freed.
- * @retval	0	: Run limit already checked, or nothing is found.
+ * @retval	1	: Hard limit found.
+ * @retval	0	: No hard limit found.
  */
 int
 has_hardlimits(void *p)
 {
 	struct limit_info	*lip = p;
-	char *k = NULL;
 
-	if (entlim_get_next(LI2RESCTX(lip), (void **)&k) != NULL) /* at least one hard resource limit present */
-		return (1);
+	lip->li_hardlims = lim_kinds(LI2RESCTX(lip));
 
-	/* run limit already checked? */
-	if (LI2RUNCTX(lip) == LI2RESCTX(lip))
-		return (0);
-	k = NULL;
-	if (entlim_get_next(LI2RUNCTX(lip), (void **)&k) != NULL) /* at least one hard run limit present */
-		return (1);
+	/* run limits are stored in a separate context? */
+	if (LI2RUNCTX(lip) != LI2RESCTX(lip))
+		lip->li_hardlims |= lim_kinds(LI2RUNCTX(lip));
 
-	return (0);
+	return (lip->li_hardlims != 0);
 }
 /**
  * @brief
@@ -812,7 +878,8 @@ make_limcounts(counts *user, counts *group, counts *project, counts *all)
  * @brief
  *		check_limits - hard limit checking function.
  *		This is table-driven limit checking, against limfuncs[]
- *		array.
+ *		array.  Only the functions for the kinds of hard limits set
+ *		on the server or queue are called.
  *
  * @param[in]	si	-	server_info structure to use for limit evaluation
  * @param[in]	qi	-	queue_info structure to use for limit evaluation
@@ -847,10 +914,18 @@ check_limits(server_info *si, queue_info *qi, resource_resv *rr, schd_error *err
 	unsigned int event_mask;
 	counts *cts;
 	schd_error *prev_err = NULL;
+	unsigned int svr_lims;
+	unsigned int que_lims;
 
 	if (si == NULL || qi == NULL || rr == NULL)
 		return 0;
 
+	/* Only the limit functions for the kinds of hard limits set can fire */
+	svr_lims = si->has_hard_limit ? ((struct limit_info *) si->liminfo)->li_hardlims : 0;
+	que_lims = qi->has_hard_limit ? ((struct limit_info *) qi->liminfo)->li_hardlims : 0;
+	if (svr_lims == 0 && que_lims == 0)
+		return 0;
+
 	/*
 	 * Check for  CHECK_CUMULATIVE_LIMIT is needed because we  must have
 	 * already run through the same loop before while calling check_limits
@@ -1099,8 +1174,11 @@ check_limits(server_info *si, queue_info *qi, resource_resv *rr, schd_error *err
 			return 0;
 		}
 	}
+	rc = 0;
 	for (i = 0; i < sizeof(limfuncs) / sizeof(limfuncs[0]); i++) {
-		if ((rc = (limfuncs[i])(si, qi, rr, server_lim,
+		if (!(limfuncs[i].lf_limit & (limfuncs[i].lf_queue ? que_lims : svr_lims)))
+			continue;
+		if ((rc = (limfuncs[i].lf_func)(si, qi, rr, server_lim,
 		queue_lim, err)) != 0) {
 			if ((flags & RETURN_ALL_ERR)) {
 				if (any_fail_rc == 0)
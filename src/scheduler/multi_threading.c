@@ -46,6 +46,7 @@
 #include <pthread.h>
 #include <errno.h>
 #include <signal.h>
+#include <time.h>
 
 #include "log.h"
 #include "pbs_idx.h"
@@ -55,11 +56,11 @@
 #include "node_info.h"
 #include "data_types.h"
 #include "globals.h"
-#include "node_info.h"
-#include "queue.h"
+#include "job_info.h"
 #include "fifo.h"
 #include "resource_resv.h"
 #include "multi_threading.h"
+#include "sort.h"
 
 
 /**
@@ -118,6 +119,24 @@ create_id_key(void)
 	pthread_setspecific(th_id_key, (void *) mainid);
 }
 
+/* The task the worker threads are currently helping with, if any */
+static th_task_info *cur_task = NULL;
+/* Bumped every time a new task is posted so a worker joins each task once */
+static unsigned int cur_task_gen = 0;
+/* Set while the main thread is running ranges of a task itself */
+static int main_in_task = 0;
+
+static const char *task_func_names[] = {
+	"check_node_eligibility_chunk",	/* TS_IS_ND_ELIGIBLE */
+	"dup_node_info_chunk",		/* TS_DUP_ND_INFO */
+	"query_node_info_chunk",	/* TS_QUERY_ND_INFO */
+	"free_node_info_chunk",		/* TS_FREE_ND_INFO */
+	"dup_resource_resv_array_chunk",	/* TS_DUP_RESRESV */
+	"query_jobs_chunk",		/* TS_QUERY_JOB_INFO */
+	"free_resource_resv_array_chunk",	/* TS_FREE_RESRESV */
+	"sort_keys_chunk"		/* TS_SORT_KEYS */
+};
+
 /**
  * @brief	convenience function to kill worker threads
  *
@@ -133,8 +152,8 @@ kill_threads(void)
 	log_event(PBSEVENT_DEBUG, PBS_EVENTCLASS_REQUEST, LOG_DEBUG,
 				"", "Killing worker threads");
 
-	threads_die = 1;
 	pthread_mutex_lock(&work_lock);
+	threads_die = 1;
 	pthread_cond_broadcast(&work_cond);
 	pthread_mutex_unlock(&work_lock);
 
@@ -144,16 +163,12 @@ kill_threads(void)
 	}
 	pthread_mutex_destroy(&work_lock);
 	pthread_cond_destroy(&work_cond);
-	pthread_mutex_destroy(&result_lock);
 	pthread_cond_destroy(&result_cond);
 	pthread_mutex_destroy(&general_lock);
 	free(threads);
-	free_ds_queue(work_queue);
-	free_ds_queue(result_queue);
 	threads = NULL;
 	num_threads = 0;
-	work_queue = NULL;
-	result_queue = NULL;
+	cur_task = NULL;
 }
 
 /**
@@ -193,7 +208,6 @@ init_multi_threading(int nthreads)
 		return 0;
 
 	pthread_mutex_init(&work_lock, &attr);
-	pthread_mutex_init(&result_lock, &attr);
 	pthread_mutex_init(&general_lock, &attr);
 
 	num_cores = sysconf(_SC_NPROCESSORS_ONLN);
@@ -217,32 +231,16 @@ init_multi_threading(int nthreads)
 		return 0;
 	}
 
-	/* Create task and result queues */
-	work_queue = new_ds_queue();
-	if (work_queue == NULL) {
-		free(threads);
-		return 0;
-	}
-	result_queue = new_ds_queue();
-	if (result_queue == NULL) {
-		free(threads);
-		free_ds_queue(work_queue);
-		work_queue = NULL;
-		return 0;
-	}
-
 	pthread_once(&key_once, create_id_key);
 	for (i = 0; i < num_threads; i++) {
 		int *thid;
 
 		thid = malloc(sizeof(int));
 		if (thid == NULL) {
-			free(threads);
-			free_ds_queue(work_queue);
-			free_ds_queue(result_queue);
-			work_queue = NULL;
-			result_queue = NULL;
 			log_err(errno, __func__, MEM_ERR_MSG);
+			/* Stop the threads we already started */
+			num_threads = i;
+			kill_threads();
 			return 0;
 		}
 		*thid = i + 1;
@@ -252,6 +250,137 @@ init_multi_threading(int nthreads)
 	return 1;
 }
 
+/**
+ * @brief	run the task's chunk routine on a single range of items
+ *
+ * @par	The task's thread_data is a template.  It is copied onto the stack
+ *	and the copy gets the range's sidx/eidx, so ranges don't need any
+ *	allocation.  Per-range output (error flags, result arrays) is
+ *	collected back into the task.
+ *
+ * @param[in,out]	task - the task being worked on
+ * @param[in]	range - the range number (sidx / range_size)
+ * @param[in]	sidx - first item of the range
+ * @param[in]	eidx - last item of the range
+ *
+ * @return void
+ */
+static void
+run_task_range(th_task_info *task, int range, int sidx, int eidx)
+{
+	int err = 0;
+
+	switch (task->task_type) {
+		case TS_IS_ND_ELIGIBLE: {
+			th_data_nd_eligible data = *(th_data_nd_eligible *) task->thread_data;
+
+			data.sidx = sidx;
+			data.eidx = eidx;
+			check_node_eligibility_chunk(&data);
+			task->results[range] = data.err;
+			break;
+		}
+		case TS_DUP_ND_INFO: {
+			th_data_dup_nd_info data = *(th_data_dup_nd_info *) task->thread_data;
+
+			data.sidx = sidx;
+			data.eidx = eidx;
+			dup_node_info_chunk(&data);
+			err = data.error;
+			break;
+		}
+		case TS_QUERY_ND_INFO: {
+			th_data_query_ninfo data = *(th_data_query_ninfo *) task->thread_data;
+
+			data.sidx = sidx;
+			data.eidx = eidx;
+			query_node_info_chunk(&data);
+			err = data.error;
+			task->results[range] = data.oarr;
+			break;
+		}
+		case TS_FREE_ND_INFO: {
+			th_data_free_ninfo data = *(th_data_free_ninfo *) task->thread_data;
+
+			data.sidx = sidx;
+			data.eidx = eidx;
+			free_node_info_chunk(&data);
+			break;
+		}
+		case TS_DUP_RESRESV: {
+			th_data_dup_resresv data = *(th_data_dup_resresv *) task->thread_data;
+
+			data.sidx = sidx;
+			data.eidx = eidx;
+			dup_resource_resv_array_chunk(&data);
+			err = data.error;
+			break;
+		}
+		case TS_QUERY_JOB_INFO: {
+			th_data_query_jinfo data = *(th_data_query_jinfo *) task->thread_data;
+
+			data.sidx = sidx;
+			data.eidx = eidx;
+			query_jobs_chunk(&data);
+			err = data.error;
+			task->results[range] = data.oarr;
+			break;
+		}
+		case TS_FREE_RESRESV: {
+			th_data_free_resresv data = *(th_data_free_resresv *) task->thread_data;
+
+			data.sidx = sidx;
+			data.eidx = eidx;
+			free_resource_resv_array_chunk(&data);
+			break;
+		}
+		case TS_SORT_KEYS: {
+			th_data_sort_keys data = *(th_data_sort_keys *) task->thread_data;
+
+			data.sidx = sidx;
+			data.eidx = eidx;
+			sort_keys_chunk(&data);
+			break;
+		}
+		default:
+			log_event(PBSEVENT_ERROR, PBS_EVENTCLASS_SCHED, LOG_ERR, __func__,
+					"Invalid task type passed to worker thread");
+			err = 1;
+	}
+
+	if (err)
+		__atomic_store_n(&task->error, 1, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief	claim ranges of a task and run them until none are left
+ *
+ * @par	Ranges are claimed with an atomic add on next_item, so a thread
+ *	which finishes its range early simply claims the next one.  A slow
+ *	range only holds up the thread running it.
+ *
+ * @param[in,out]	task - the task to work on
+ *
+ * @return	the number of ranges this thread ran
+ */
+static int
+work_on_task(th_task_info *task)
+{
+	int sidx;
+	int eidx;
+	int nranges = 0;
+
+	while ((sidx = __atomic_fetch_add(&task->next_item, task->range_size, __ATOMIC_RELAXED)) < task->num_items) {
+		eidx = sidx + task->range_size - 1;
+		if (eidx >= task->num_items)
+			eidx = task->num_items - 1;
+		run_task_range(task, sidx / task->range_size, sidx, eidx);
+		nranges++;
+	}
+
+	return nranges;
+}
+
 /**
  * @brief	Main pthread routine for worker threads
  *
@@ -262,10 +391,11 @@ init_multi_threading(int nthreads)
 void *
 worker(void *tid)
 {
-	th_task_info *work = NULL;
+	th_task_info *task;
+	unsigned int seen_gen = 0;
 	sigset_t set;
 	int ntid;
-	char buf[1024];
+	int nranges;
 
 	pthread_setspecific(th_id_key, tid);
 	ntid = *(int *)tid;
@@ -280,81 +410,150 @@ worker(void *tid)
 		pthread_exit(NULL);
 	}
 
+	pthread_mutex_lock(&work_lock);
 	while (!threads_die) {
-		/* Get the next work task from work queue */
-		pthread_mutex_lock(&work_lock);
-		while (ds_queue_is_empty(work_queue) && !threads_die) {
+		/* Wait for a task we haven't joined yet */
+		if (cur_task == NULL || cur_task_gen == seen_gen) {
 			pthread_cond_wait(&work_cond, &work_lock);
+			continue;
 		}
-		work = ds_dequeue(work_queue);
+		task = cur_task;
+		seen_gen = cur_task_gen;
+		task->num_active++;
 		pthread_mutex_unlock(&work_lock);
 
-		/* find out what task we need to do */
-		if (work != NULL) {
-			switch (work->task_type) {
-			case TS_IS_ND_ELIGIBLE:
-				snprintf(buf, sizeof(buf), "Thread %d calling check_node_eligibility_chunk()", ntid);
-				log_event(PBSEVENT_DEBUG3, PBS_EVENTCLASS_SCHED, LOG_DEBUG, __func__, buf);
-				check_node_eligibility_chunk((th_data_nd_eligible *) work->thread_data);
-				break;
-			case TS_DUP_ND_INFO:
-				snprintf(buf, sizeof(buf), "Thread %d calling dup_node_info_chunk()", ntid);
-				log_event(PBSEVENT_DEBUG3, PBS_EVENTCLASS_SCHED, LOG_DEBUG, __func__, buf);
-				dup_node_info_chunk((th_data_dup_nd_info *) work->thread_data);
-				break;
-			case TS_QUERY_ND_INFO:
-				snprintf(buf, sizeof(buf), "Thread %d calling query_node_info_chunk()", ntid);
-				log_event(PBSEVENT_DEBUG3, PBS_EVENTCLASS_SCHED, LOG_DEBUG, __func__, buf);
-				query_node_info_chunk((th_data_query_ninfo *) work->thread_data);
-				break;
-			case TS_FREE_ND_INFO:
-				snprintf(buf, sizeof(buf), "Thread %d calling free_node_info_chunk()", ntid);
-				log_event(PBSEVENT_DEBUG3, PBS_EVENTCLASS_SCHED, LOG_DEBUG, __func__, buf);
-				free_node_info_chunk((th_data_free_ninfo *) work->thread_data);
-				break;
-			case TS_DUP_RESRESV:
-				snprintf(buf, sizeof(buf), "Thread %d calling dup_resource_resv_array_chunk()", ntid);
-				log_event(PBSEVENT_DEBUG3, PBS_EVENTCLASS_SCHED, LOG_DEBUG, __func__, buf);
-				dup_resource_resv_array_chunk((th_data_dup_resresv *) work->thread_data);
-				break;
-			case TS_QUERY_JOB_INFO:
-				snprintf(buf, sizeof(buf), "Thread %d calling query_jobs_chunk()", ntid);
-				log_event(PBSEVENT_DEBUG3, PBS_EVENTCLASS_SCHED, LOG_DEBUG, __func__, buf);
-				query_jobs_chunk((th_data_query_jinfo *) work->thread_data);
-				break;
-			case TS_FREE_RESRESV:
-				snprintf(buf, sizeof(buf), "Thread %d calling free_resource_resv_array_chunk()", ntid);
-				log_event(PBSEVENT_DEBUG3, PBS_EVENTCLASS_SCHED, LOG_DEBUG, __func__, buf);
-				free_resource_resv_array_chunk((th_data_free_resresv *) work->thread_data);
-				break;
-			default:
-				log_event(PBSEVENT_ERROR, PBS_EVENTCLASS_SCHED, LOG_ERR, __func__,
-						"Invalid task type passed to worker thread");
-			}
-
-			/* Post results */
-			pthread_mutex_lock(&result_lock);
-			ds_enqueue(result_queue, (void *) work);
+		nranges = work_on_task(task);
+		log_eventf(PBSEVENT_DEBUG3, PBS_EVENTCLASS_SCHED, LOG_DEBUG, __func__,
+				"Thread %d ran %d ranges of %s()", ntid, nranges,
+				task_func_names[task->task_type]);
+
+		/* The main thread waits for every thread to leave the task before returning */
+		pthread_mutex_lock(&work_lock);
+		if (--task->num_active == 0)
 			pthread_cond_signal(&result_cond);
-			pthread_mutex_unlock(&result_lock);
-		}
 	}
+	pthread_mutex_unlock(&work_lock);
 
 	pthread_exit(NULL);
 }
 
 /**
- * @brief	Convenience function to queue up work for worker threads
+ * @brief	log how long a task took.  Only tasks large enough to be split
+ *		across threads are logged to keep the log readable.
  *
- * @param[in]	task - the task to queue up
+ * @param[in]	task - the task which was run
+ * @param[in]	start - when the task was started
  *
  * @return void
  */
-void
-queue_work_for_threads(th_task_info *task)
+static void
+log_task_time(th_task_info *task, struct timespec *start)
+{
+	struct timespec end;
+
+	if (task->num_items <= MT_CHUNK_SIZE_MIN)
+		return;
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	log_eventf(PBSEVENT_DEBUG3, PBS_EVENTCLASS_SCHED, LOG_DEBUG, "run_parallel_task",
+			"%s(): %d items in %d ranges took %.6f seconds",
+			task_func_names[task->task_type], task->num_items, task->num_ranges,
+			(end.tv_sec - start->tv_sec) + (end.tv_nsec - start->tv_nsec) / 1e9);
+}
+
+/**
+ * @brief	run a task over items 0 .. num_items - 1 using all the threads
+ *
+ * @par	The caller fills in task_type, thread_data and num_items.  The items
+ *	are split into ranges of range_size items.  The worker threads and the
+ *	main thread claim ranges from a shared counter until all of them
+ *	have been run.  Small tasks, tasks started from a worker thread, or
+ *	tasks started while the main thread is already inside a task are run
+ *	on the calling thread as a single range.
+ *
+ * @par	For task types which produce output per range (TS_IS_ND_ELIGIBLE,
+ *	TS_QUERY_ND_INFO and TS_QUERY_JOB_INFO), task->results is allocated with
+ *	one slot per range, in item order.  The caller frees it.
+ *
+ * @param[in,out]	task - the task to run
+ *
+ * @return	int
+ * @retval	1	task ran and no range reported an error
+ * @retval	0	malloc error or a range reported an error
+ */
+int
+run_parallel_task(th_task_info *task)
 {
+	int tid;
+	int parallel;
+	struct timespec start;
+
+	if (task == NULL)
+		return 0;
+
+	task->results = NULL;
+	task->next_item = 0;
+	task->num_active = 0;
+	task->error = 0;
+	task->num_ranges = 0;
+
+	if (task->num_items <= 0)
+		return 1;
+
+	/* don't use multi-threading if num_threads is 1, the task is too small or I am a worker thread */
+	parallel = 0;
+	if (num_threads > 1 && !main_in_task && task->num_items > MT_CHUNK_SIZE_MIN) {
+		tid = *((int *) pthread_getspecific(th_id_key));
+		parallel = (tid == 0);
+	}
+
+	if (parallel) {
+		task->range_size = task->num_items / ((num_threads + 1) * MT_RANGES_PER_THREAD);
+		if (task->range_size < MT_RANGE_SIZE_MIN)
+			task->range_size = MT_RANGE_SIZE_MIN;
+		else if (task->range_size > MT_CHUNK_SIZE_MAX)
+			task->range_size = MT_CHUNK_SIZE_MAX;
+	} else
+		task->range_size = task->num_items;
+	task->num_ranges = (task->num_items + task->range_size - 1) / task->range_size;
+
+	if (task->task_type == TS_IS_ND_ELIGIBLE || task->task_type == TS_QUERY_ND_INFO ||
+			task->task_type == TS_QUERY_JOB_INFO) {
+		task->results = calloc(task->num_ranges, sizeof(void *));
+		if (task->results == NULL) {
+			log_err(errno, __func__, MEM_ERR_MSG);
+			return 0;
+		}
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	if (!parallel) {
+		run_task_range(task, 0, 0, task->num_items - 1);
+		log_task_time(task, &start);
+		return !task->error;
+	}
+
 	pthread_mutex_lock(&work_lock);
-	ds_enqueue(work_queue, (void *) task);
-	pthread_cond_signal(&work_cond);
+	cur_task = task;
+	cur_task_gen++;
+	pthread_cond_broadcast(&work_cond);
 	pthread_mutex_unlock(&work_lock);
+
+	main_in_task = 1;
+	work_on_task(task);
+	main_in_task = 0;
+
+	/* Every range has been claimed.  Stop new threads from joining and
+	 * wait for the ones still running their last range.
+	 */
+	pthread_mutex_lock(&work_lock);
+	cur_task = NULL;
+	while (task->num_active > 0)
+		pthread_cond_wait(&result_cond, &work_lock);
+	pthread_mutex_unlock(&work_lock);
+
+	log_task_time(task, &start);
+
+	return !task->error;
 }
@@ -43,13 +43,15 @@
 
 #include "data_types.h"
 
-#define MT_CHUNK_SIZE_MIN 1024
-#define MT_CHUNK_SIZE_MAX 8192
+#define MT_CHUNK_SIZE_MIN 1024	/* tasks with this many items or fewer aren't split */
+#define MT_CHUNK_SIZE_MAX 8192	/* largest range a thread claims at a time */
+#define MT_RANGE_SIZE_MIN 128	/* smallest range a thread claims at a time */
+#define MT_RANGES_PER_THREAD 4	/* aim for this many ranges per thread for load balancing */
 
 int init_multi_threading(int nthreads);
 void kill_threads(void);
 void *worker(void *);
-void queue_work_for_threads(th_task_info *task);
+int run_parallel_task(th_task_info *task);
 int init_mutex_attr_recursive(pthread_mutexattr_t *attr);
 
 #endif /* SRC_SCHEDULER_MULTI_THREADING_H_ */
@@ -57,6 +57,8 @@
  * 	talk_with_mom()
  * 	node_filter()
  * 	find_node_info()
+ * 	create_node_name_idx()
+ * 	find_node_info_idx()
  * 	find_node_by_host()
  * 	dup_nodes()
  * 	dup_node_info()
@@ -85,6 +87,10 @@
  * 	check_resources_for_node()
  * 	parse_placespec()
  * 	parse_selspec()
+ * 	intern_selspec()
+ * 	intern_placespec()
+ * 	purge_spec_cache()
+ * 	flush_spec_cache()
  * 	create_execvnode()
  * 	parse_execvnode()
  * 	node_state_to_str()
@@ -134,6 +140,7 @@
 #include <rm.h>
 #include <grunt.h>
 #include <libutil.h>
+#include <pbs_idx.h>
 #include <pbs_internal.h>
 #include "attribute.h"
 #include "node_info.h"
@@ -155,6 +162,7 @@
 #include "pbs_bitmap.h"
 #include "pbs_license.h"
 #include "multi_threading.h"
+#include "obj_pool.h"
 #ifdef NAS
 #include "site_code.h"
 #endif
@@ -231,38 +239,6 @@ query_node_info_chunk(th_data_query_ninfo *data)
 	data->oarr = ninfo_arr;
 }
 
-/**
- * @brief	Allocates th_data_query_ninfo for multi-threading of query_nodes
- *
- * @param[in]	nodes	-	batch_status of nodes queried from server
- * @param[in]	sinfo	-	server information
- * @param[in]	sidx	-	start index for the jobs list for the thread
- * @param[in]	eidx	-	end index for the jobs list for the thread
- *
- * @return th_data_query_ninfo *
- * @retval a newly allocated th_data_query_ninfo object
- * @retval NULL for malloc error
- */
-static inline th_data_query_ninfo *
-alloc_tdata_nd_query(struct batch_status *nodes, server_info *sinfo, int sidx, int eidx)
-{
-	th_data_query_ninfo *tdata = NULL;
-
-	tdata = malloc(sizeof(th_data_query_ninfo));
-	if (tdata == NULL) {
-		log_err(errno, __func__, MEM_ERR_MSG);
-		return NULL;
-	}
-	tdata->error = 0;
-	tdata->nodes = nodes;
-	tdata->oarr = NULL; /* Will be filled by the thread routine */
-	tdata->sinfo = sinfo;
-	tdata->sidx = sidx;
-	tdata->eidx = eidx;
-
-	return tdata;
-}
-
 /**
  * @brief
  *      query_nodes - query all the nodes associated with a server
@@ -285,13 +261,8 @@ query_nodes(int pbs_sd, server_info *sinfo)
 	int j;
 	int nidx = 0;
 	static struct attrl *attrib = NULL;
-	int chunk_size;
-	th_data_query_ninfo *tdata = NULL;
-	th_task_info *task = NULL;
-	int num_tasks;
-	int th_err = 0;
-	node_info ***ninfo_arrs_tasks = NULL;
-	int tid;
+	th_data_query_ninfo tdata;
+	th_task_info task;
 	char *nodeattrs[] = {
 			ATTR_NODE_state,
 			ATTR_NODE_Mom,
@@ -347,93 +318,48 @@ query_nodes(int pbs_sd, server_info *sinfo)
 		cur_node = cur_node->next;
 	}
 
-	tid = *((int *) pthread_getspecific(th_id_key));
-	if (tid != 0 || num_threads <= 1) {
-		/* don't use multi-threading if I am a worker thread or num_threads is 1 */
-		tdata = alloc_tdata_nd_query(nodes, sinfo, 0, num_nodes - 1);
-		if (tdata == NULL) {
-			pbs_statfree(nodes);
-			return NULL;
+	if ((ninfo_arr = (node_info **) malloc((num_nodes + 1) * sizeof(node_info *))) == NULL) {
+		log_err(errno, __func__, MEM_ERR_MSG);
+		pbs_statfree(nodes);
+		return NULL;
+	}
+	ninfo_arr[0] = NULL;
+
+	tdata.error = 0;
+	tdata.nodes = nodes;
+	tdata.oarr = NULL; /* Will be filled by the thread routine */
+	tdata.sinfo = sinfo;
+
+	task.task_type = TS_QUERY_ND_INFO;
+	task.thread_data = (void *) &tdata;
+	task.num_items = num_nodes;
+	if (!run_parallel_task(&task)) {
+		if (task.results != NULL) {
+			for (i = 0; i < task.num_ranges; i++)
+				free_nodes((node_info **) task.results[i]);
+			free(task.results);
 		}
-		query_node_info_chunk(tdata);
-		ninfo_arr = tdata->oarr;
-		free(tdata);
+		pbs_statfree(nodes);
+		free(ninfo_arr);
+		return NULL;
+	}
 
-		for (nidx = 0; ninfo_arr[nidx] != NULL; nidx++)
-			ninfo_arr[nidx]->rank = get_sched_rank();
+	/* Assemble node info objects from the ranges into the ninfo_arr */
+	for (i = 0; i < task.num_ranges; i++) {
+		node_info **range_arr = task.results[i];
 
-		ninfo_arr[nidx] = NULL;
-	} else {
-		if ((ninfo_arr = (node_info **) malloc((num_nodes + 1) * sizeof(node_info *))) == NULL) {
-			log_err(errno, __func__, MEM_ERR_MSG);
-			pbs_statfree(nodes);
-			return NULL;
-		}
-		ninfo_arr[0] = NULL;
-		chunk_size = num_nodes / num_threads;
-		chunk_size = (chunk_size > MT_CHUNK_SIZE_MIN) ? chunk_size : MT_CHUNK_SIZE_MIN;
-		for (j = 0, num_tasks = 0; num_nodes > 0;
-				j += chunk_size, num_tasks++, num_nodes -= chunk_size) {
-			tdata = alloc_tdata_nd_query(nodes, sinfo, j, j + chunk_size - 1);
-			if (tdata == NULL) {
-				th_err = 1;
-				break;
-			}
-			task = malloc(sizeof(th_task_info));
-			if (task == NULL) {
-				free(tdata);
-				log_err(errno, __func__, MEM_ERR_MSG);
-				th_err = 1;
-				break;
-			}
-			task->task_id = num_tasks;
-			task->task_type = TS_QUERY_ND_INFO;
-			task->thread_data = (void *) tdata;
+		if (range_arr != NULL) {
+			node_info *ninfo;
 
-			queue_work_for_threads(task);
-		}
-		ninfo_arrs_tasks = malloc(num_tasks * sizeof(node_info **));
-		if (ninfo_arrs_tasks == NULL) {
-			log_err(errno, __func__, MEM_ERR_MSG);
-			th_err = 1;
-		}
-		/* Get results from worker threads */
-		for (i = 0; i < num_tasks;) {
-			pthread_mutex_lock(&result_lock);
-			while (ds_queue_is_empty(result_queue))
-				pthread_cond_wait(&result_cond, &result_lock);
-			while (!ds_queue_is_empty(result_queue)) {
-				task = (th_task_info *) ds_dequeue(result_queue);
-				tdata = (th_data_query_ninfo *) task->thread_data;
-				if (tdata->error)
-					th_err = 1;
-				ninfo_arrs_tasks[task->task_id] = tdata->oarr;
-				free(tdata);
-				free(task);
-				i++;
+			for (j = 0; (ninfo = range_arr[j]) != NULL; j++) {
+				ninfo->rank = get_sched_rank();
+				ninfo_arr[nidx++] = ninfo;
 			}
-			pthread_mutex_unlock(&result_lock);
+			free(range_arr);
 		}
-		if (th_err) {
-			pbs_statfree(nodes);
-			free_nodes(ninfo_arr);
-			return NULL;
-		}
-		/* Assemble node info objects from various threads into the ninfo_arr */
-		for (i = 0; i < num_tasks; i++) {
-			if (ninfo_arrs_tasks[i] != NULL) {
-				node_info *ninfo;
-
-				for (j = 0; (ninfo = ninfo_arrs_tasks[i][j]) != NULL; j++) {
-					ninfo->rank = get_sched_rank();
-					ninfo_arr[nidx++] = ninfo;
-				}
-				free(ninfo_arrs_tasks[i]);
-			}
-		}
-		ninfo_arr[nidx] = NULL;
-		free(ninfo_arrs_tasks);
 	}
+	ninfo_arr[nidx] = NULL;
+	free(task.results);
 
 	if (nidx == 0) {
 		log_event(PBSEVENT_SCHED, PBS_EVENTCLASS_SERVER, LOG_INFO, __func__,
@@ -664,6 +590,9 @@ query_node_info(struct batch_status *node, server_info *sinfo)
 			sinfo->has_nonCPU_licenses = 1;
 		}
 	}
+	if (ninfo != NULL && ninfo->res != NULL)
+		index_resource_list(ninfo->res);
+
 	return ninfo;
 }
 
@@ -794,35 +723,6 @@ free_node_info_chunk(th_data_free_ninfo *data)
 	}
 }
 
-/**
- * @brief	Allocates th_data_free_ninfo for multi-threading of free_nodes
- *
- * @param[in,out]	ninfo_arr	-	the node array to free
- * @param[in]	sidx	-	start index for the nodes array for the thread
- * @param[in]	eidx	-	end index for the nodes array for the thread
- *
- * @return th_data_free_ninfo *
- * @retval a newly allocated th_data_free_ninfo object
- * @retval NULL for malloc error
- */
-static inline th_data_free_ninfo *
-alloc_tdata_free_nodes(node_info **ninfo_arr, int sidx, int eidx)
-{
-	th_data_free_ninfo *tdata = NULL;
-
-	tdata = malloc(sizeof(th_data_free_ninfo));
-	if (tdata == NULL) {
-		log_err(errno, __func__, MEM_ERR_MSG);
-		return NULL;
-	}
-
-	tdata->ninfo_arr = ninfo_arr;
-	tdata->sidx = sidx;
-	tdata->eidx = eidx;
-
-	return tdata;
-}
-
 /**
  * @brief
  *		free_nodes - free all the nodes in a node_info array
@@ -835,65 +735,19 @@ alloc_tdata_free_nodes(node_info **ninfo_arr, int sidx, int eidx)
 void
 free_nodes(node_info **ninfo_arr)
 {
-	int i;
-	int chunk_size;
-	th_data_free_ninfo *tdata = NULL;
-	th_task_info *task = NULL;
-	int num_tasks;
-	int num_nodes;
-	int tid;
+	th_data_free_ninfo tdata;
+	th_task_info task;
 
 	if (ninfo_arr == NULL)
 		return;
 
-	num_nodes = count_array(ninfo_arr);
+	tdata.ninfo_arr = ninfo_arr;
 
-	tid = *((int *) pthread_getspecific(th_id_key));
-	if (tid != 0 || num_threads <= 1) {
-		/* don't use multi-threading if I am a worker thread or num_threads is 1 */
-		tdata = alloc_tdata_free_nodes(ninfo_arr, 0, num_nodes - 1);
-		if (tdata == NULL)
-			return;
+	task.task_type = TS_FREE_ND_INFO;
+	task.thread_data = (void *) &tdata;
+	task.num_items = count_array(ninfo_arr);
+	run_parallel_task(&task);
 
-		free_node_info_chunk(tdata);
-		free(tdata);
-		free(ninfo_arr);
-		return;
-	}
-	chunk_size = num_nodes / num_threads;
-	chunk_size = (chunk_size > MT_CHUNK_SIZE_MIN) ? chunk_size : MT_CHUNK_SIZE_MIN;
-	for (i = 0, num_tasks = 0; num_nodes > 0;
-			num_tasks++, i += chunk_size, num_nodes -= chunk_size) {
-		tdata = alloc_tdata_free_nodes(ninfo_arr, i, i + chunk_size - 1);
-		if (tdata == NULL)
-			break;
-
-		task = malloc(sizeof(th_task_info));
-		if (task == NULL) {
-			free(tdata);
-			log_err(errno, __func__, MEM_ERR_MSG);
-			break;
-		}
-		task->task_type = TS_FREE_ND_INFO;
-		task->thread_data = (void *) tdata;
-
-		queue_work_for_threads(task);
-	}
-
-	/* Get results from worker threads */
-	for (i = 0; i < num_tasks;) {
-		pthread_mutex_lock(&result_lock);
-		while (ds_queue_is_empty(result_queue))
-			pthread_cond_wait(&result_cond, &result_lock);
-		while (!ds_queue_is_empty(result_queue)) {
-			task = (th_task_info *) ds_dequeue(result_queue);
-			tdata = task->thread_data;
-			free(tdata);
-			free(task);
-			i++;
-		}
-		pthread_mutex_unlock(&result_lock);
-	}
 	free(ninfo_arr);
 }
 
@@ -1380,6 +1234,74 @@ find_node_info(node_info **ninfo_arr, char *nodename)
 	return ninfo_arr[i];
 }
 
+/**
+ * @brief
+ *		create_node_name_idx - create an index of nodes by name
+ *
+ * @param[in]	ninfo_arr	-	the array of nodes to index
+ *
+ * @return	void *
+ * @retval	the index
+ * @retval	NULL	: on error
+ *
+ */
+void *
+create_node_name_idx(node_info **ninfo_arr)
+{
+	void *idx;
+	int i;
+
+	if ((idx = pbs_idx_create(0, 0)) == NULL) {
+		log_err(errno, __func__, MEM_ERR_MSG);
+		return NULL;
+	}
+
+	if (ninfo_arr == NULL)
+		return idx;
+
+	for (i = 0; ninfo_arr[i] != NULL; i++) {
+		if (pbs_idx_insert(idx, ninfo_arr[i]->name, ninfo_arr[i]) != PBS_IDX_RET_OK) {
+			log_eventf(PBSEVENT_DEBUG, PBS_EVENTCLASS_NODE, LOG_DEBUG, ninfo_arr[i]->name,
+				"Failed to index node");
+			pbs_idx_destroy(idx);
+			return NULL;
+		}
+	}
+
+	return idx;
+}
+
+/**
+ * @brief
+ *		find_node_info_idx - find a node by name using a name index
+ *				     if we have one
+ *
+ * @param[in]	idx	-	index created by create_node_name_idx() (may be NULL)
+ * @param[in]	ninfo_arr	-	the array of nodes idx was created from
+ * @param[in]	nodename	-	the node to find
+ *
+ * @return	the node
+ * @retval	NULL	: if not found
+ *
+ */
+node_info *
+find_node_info_idx(void *idx, node_info **ninfo_arr, char *nodename)
+{
+	void *key = nodename;
+	void *data = NULL;
+
+	if (idx == NULL)
+		return find_node_info(ninfo_arr, nodename);
+
+	if (nodename == NULL)
+		return NULL;
+
+	if (pbs_idx_find(idx, &key, &data, NULL) != PBS_IDX_RET_OK)
+		return NULL;
+
+	return (node_info *) data;
+}
+
 /**
  * @brief
  *		find_node_by_host - find a node by its host resource rather then
@@ -1447,41 +1369,6 @@ dup_node_info_chunk(th_data_dup_nd_info *data)
 
 }
 
-/**
- * @brief	Allocates th_data_dup_nd_info for multi-threading of dup_nodes
- *
- * @param[in]	flags	-	flags passed to dup_nodes
- * @param[in]	nsinfo	-	the new server
- * @param[in]	onodes	-	the array to duplicate
- * @param[out]	nnodes	-	the duplicated array
- * @param[in]	sidx	-	start index for the nodes list for the thread
- * @param[in]	eidx	-	end index for the nodes list for the thread
- *
- * @return th_data_dup_nd_info *
- * @retval a newly allocated th_data_dup_nd_info object
- * @retval NULL for malloc error
- */
-static inline th_data_dup_nd_info *
-alloc_tdata_dup_nodes(unsigned int flags, server_info *nsinfo, node_info **onodes, node_info **nnodes,
-		int sidx, int eidx)
-{
-	th_data_dup_nd_info *tdata = NULL;
-
-	tdata = malloc(sizeof(th_data_dup_nd_info));
-	if (tdata == NULL) {
-		log_err(errno, __func__, MEM_ERR_MSG);
-		return NULL;
-	}
-	tdata->flags = flags;
-	tdata->nsinfo = nsinfo;
-	tdata->onodes = onodes;
-	tdata->nnodes = nnodes;
-	tdata->sidx = sidx;
-	tdata->eidx = eidx;
-
-	return tdata;
-}
-
 /**
  * @brief
  *		dup_nodes - duplicate an array of nodes
@@ -1500,88 +1387,40 @@ dup_nodes(node_info **onodes, server_info *nsinfo, unsigned int flags)
 {
 	node_info **nnodes;
 	int num_nodes;
-	int thread_node_ct_left;
 	int i, j;
 	schd_resource *nres = NULL;
 	schd_resource *ores = NULL;
 	schd_resource *tres = NULL;
 	node_info *ninfo = NULL;
 	char namebuf[1024];
-	int chunk_size;
-	th_data_dup_nd_info *tdata = NULL;
-	th_task_info *task = NULL;
-	int num_tasks;
-	int th_err = 0;
-	int tid;
+	th_data_dup_nd_info tdata;
+	th_task_info task;
 
 	if (onodes == NULL || nsinfo == NULL)
 		return NULL;
 
-	num_nodes = thread_node_ct_left = count_array(onodes);
+	num_nodes = count_array(onodes);
 
-	if ((nnodes = (node_info **) malloc((num_nodes + 1) * sizeof(node_info *))) == NULL) {
+	/* calloc() so a partially duplicated array can be freed on error */
+	if ((nnodes = (node_info **) calloc(num_nodes + 1, sizeof(node_info *))) == NULL) {
 		log_err(errno, __func__, MEM_ERR_MSG);
 		return NULL;
 	}
 
-	tid = *((int *) pthread_getspecific(th_id_key));
-	if (tid != 0 || num_threads <= 1) {
-		/* don't use multi-threading if I am a worker thread or num_threads is 1 */
-		tdata = alloc_tdata_dup_nodes(flags, nsinfo, onodes, nnodes, 0, num_nodes - 1);
-		if (tdata == NULL) {
-			free_nodes(nnodes);
-			log_err(errno, __func__, MEM_ERR_MSG);
-			return NULL;
-		}
-
-		dup_node_info_chunk(tdata);
-		th_err = tdata->error;
-		free(tdata);
-	} else { /* We are multithreading */
-		j = 0;
-		chunk_size = num_nodes / num_threads;
-		chunk_size = (chunk_size > MT_CHUNK_SIZE_MIN) ? chunk_size : MT_CHUNK_SIZE_MIN;
-		for (j = 0, num_tasks = 0; thread_node_ct_left > 0;
-				num_tasks++, j+= chunk_size, thread_node_ct_left -= chunk_size) {
-			tdata = alloc_tdata_dup_nodes(flags, nsinfo, onodes, nnodes, j, j + chunk_size - 1);
-			if (tdata == NULL) {
-				th_err = 1;
-				break;
-			}
-			task = malloc(sizeof(th_task_info));
-			if (task == NULL) {
-				free(tdata);
-				th_err = 1;
-				log_err(errno, __func__, MEM_ERR_MSG);
-				break;
-
-			}
-			task->task_type = TS_DUP_ND_INFO;
-			task->thread_data = (void *) tdata;
-
-			queue_work_for_threads(task);
-		}
-
-		/* Get results from worker threads */
-		for (i = 0; i < num_tasks;) {
-			pthread_mutex_lock(&result_lock);
-			while (ds_queue_is_empty(result_queue))
-				pthread_cond_wait(&result_cond, &result_lock);
-			while (!ds_queue_is_empty(result_queue)) {
-				task = (th_task_info *) ds_dequeue(result_queue);
-				tdata = (th_data_dup_nd_info *) task->thread_data;
-				if (tdata->error)
-					th_err = 1;
-				free(tdata);
-				free(task);
-				i++;
-			}
-			pthread_mutex_unlock(&result_lock);
-		}
-	}
-
-	if (th_err) {
-		free_nodes(nnodes);
+	tdata.error = 0;
+	tdata.flags = flags;
+	tdata.nsinfo = nsinfo;
+	tdata.onodes = onodes;
+	tdata.nnodes = nnodes;
+
+	task.task_type = TS_DUP_ND_INFO;
+	task.thread_data = (void *) &tdata;
+	task.num_items = num_nodes;
+	if (!run_parallel_task(&task)) {
+		/* a failed range leaves holes, so don't stop at the first NULL */
+		for (i = 0; i < num_nodes; i++)
+			free_node_info(nnodes[i]);
+		free(nnodes);
 		return NULL;
 	}
 	nnodes[num_nodes] = NULL;
@@ -1711,6 +1550,8 @@ dup_node_info(node_info *onode, server_info *nsinfo,
 		nnode->res = dup_ind_resource_list(onode->res);
 	else
 		nnode->res = dup_resource_list(onode->res);
+	if (nnode->res != NULL)
+		index_resource_list(nnode->res);
 
 	nnode->max_load = onode->max_load;
 	nnode->ideal_load = onode->ideal_load;
@@ -1864,6 +1705,7 @@ collect_jobs_on_nodes(node_info **ninfo_arr, resource_resv **resresv_arr, int si
 	int i, j, k;
 	node_info *node;	/* used to store pointer of node in ninfo_arr */
 	resource_resv **temp_ninfo_arr = NULL;
+	void *jobs_idx;		/* name index of resresv_arr */
 
 	if (ninfo_arr == NULL || ninfo_arr[0] == NULL)
 		return 0;
@@ -1878,6 +1720,11 @@ collect_jobs_on_nodes(node_info **ninfo_arr, resource_resv **resresv_arr, int si
 		ninfo_arr[i]->job_arr[0] = NULL;
 	}
 
+	/* Every job on every node is looked up by name.  If we can't create
+	 * the index, find_resource_resv_idx() falls back to scanning the array.
+	 */
+	jobs_idx = create_resresv_name_idx(resresv_arr);
+
 	for (i = 0; ninfo_arr[i] != NULL; i++) {
 		if (ninfo_arr[i]->jobs != NULL) {
 			/* If there are no running jobs in the list and node reports a running job,
@@ -1898,7 +1745,7 @@ collect_jobs_on_nodes(node_info **ninfo_arr, resource_resv **resresv_arr, int si
 				if (ptr != NULL)
 					*ptr = '\0';
 
-				job = find_resource_resv(resresv_arr, ninfo_arr[i]->jobs[j]);
+				job = find_resource_resv_idx(jobs_idx, resresv_arr, ninfo_arr[i]->jobs[j]);
 				if ((job != NULL) && (job->nspec_arr != NULL)) {
 					/* if a distributed job has more then one instance on this node
 					 * it'll show up more then once.  If this is the case, we only
@@ -1943,6 +1790,7 @@ collect_jobs_on_nodes(node_info **ninfo_arr, resource_resv **resresv_arr, int si
 			ninfo_arr[i]->num_jobs = k;
 		}
 	}
+	pbs_idx_destroy(jobs_idx);
 
 	for (i = 0; ninfo_arr[i] != NULL; i++) {
 		temp_ninfo_arr = realloc(
@@ -2342,7 +2190,7 @@ new_nspec()
 {
 	nspec *ns;
 
-	if ((ns = (nspec *) malloc(sizeof(nspec))) == NULL) {
+	if ((ns = obj_pool_alloc(OBJ_POOL_NSPEC)) == NULL) {
 		log_err(errno, __func__, MEM_ERR_MSG);
 		return NULL;
 	}
@@ -2376,7 +2224,7 @@ free_nspec(nspec *ns)
 	if (ns->resreq != NULL)
 		free_resource_req_list(ns->resreq);
 
-	free(ns);
+	obj_pool_free(OBJ_POOL_NSPEC, ns);
 }
 
 /**
@@ -3308,7 +3156,7 @@ eval_complex_selspec(status *policy, selspec *spec, node_info **ninfo_arr, place
 				 */
 				if (conf.provision_policy != AVOID_PROVISION &&
 					cstat.node_sort[0].res_name != NULL && conf.node_sort_unused)
-					qsort(nodes, tot_nodes, sizeof(node_info *), multi_node_sort);
+					sort_nodes(nodes, tot_nodes);
 			}
 			chunks_needed--;
 		}
@@ -4315,7 +4163,8 @@ check_resources_for_node(resource_req *resreq, node_info *ninfo,
 int
 compare_place(place *pl1, place *pl2)
 {
-	if (pl1 == NULL && pl2 == NULL)
+	/* also true for interned specs of the same string */
+	if (pl1 == pl2)
 		return 1;
 	else if (pl1 == NULL || pl2 == NULL)
 		return 0;
@@ -4585,6 +4434,288 @@ parse_selspec(char *select_spec)
 	return spec;
 }
 
+/*
+ * Cross-cycle cache of parsed select and place specs.
+ *
+ * Most queued jobs share a handful of distinct select and place specs, and
+ * they rarely change from one cycle to the next.  The parsed specs are kept
+ * keyed by their string so every job with the same spec shares a single
+ * read-only object (see share_selspec()/share_place()), and identical specs
+ * can be recognized by pointer equality.
+ *
+ * Specs which were neither looked up nor are still held by a job in a cycle
+ * are purged along with the job cache.
+ * The whole cache is flushed when resource definitions are re-queried since
+ * the parsed specs point at the definitions and depend on res_to_check.
+ */
+typedef struct spec_cache_entry {
+	char *str;			/* spec string the entry is keyed by */
+	void *spec;			/* parsed selspec or place */
+	unsigned long last_used;	/* generation the spec was last used */
+} spec_cache_entry;
+
+static void *selspec_cache = NULL;
+static void *place_cache = NULL;
+static unsigned long spec_cache_gen = 0;
+static pthread_mutex_t spec_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief	free a spec cache entry and its reference on the spec
+ *
+ * @param[in]	sce	-	entry to free
+ * @param[in]	is_sel	-	entry holds a selspec rather than a place
+ *
+ * @return void
+ */
+static void
+free_spec_cache_entry(spec_cache_entry *sce, int is_sel)
+{
+	if (sce == NULL)
+		return;
+
+	if (is_sel)
+		free_selspec(sce->spec);
+	else
+		free_place(sce->spec);
+	free(sce->str);
+	free(sce);
+}
+
+/**
+ * @brief	return a shared reference on the parsed form of a spec string,
+ *		parsing it only if it is not already in the cache
+ *
+ * @param[in,out]	cache	-	cache to look the spec up in
+ * @param[in]	str	-	spec string
+ * @param[in]	is_sel	-	str is a select spec rather than a place spec
+ *
+ * @return	void *
+ * @retval	shared selspec or place
+ * @retval	NULL	: invalid spec or error
+ *
+ * @par MT-safe: Yes
+ */
+static void *
+intern_spec(void **cache, char *str, int is_sel)
+{
+	spec_cache_entry *sce = NULL;
+	spec_cache_entry *old = NULL;
+	void *key = str;
+	void *spec;
+
+	if (str == NULL)
+		return NULL;
+
+	pthread_mutex_lock(&spec_cache_lock);
+	if (*cache != NULL &&
+		pbs_idx_find(*cache, &key, (void **) &sce, NULL) == PBS_IDX_RET_OK) {
+		sce->last_used = spec_cache_gen;
+		spec = is_sel ? (void *) share_selspec(sce->spec) : (void *) share_place(sce->spec);
+		pthread_mutex_unlock(&spec_cache_lock);
+		return spec;
+	}
+	pthread_mutex_unlock(&spec_cache_lock);
+
+	/* parse outside of the lock, other threads are querying jobs too */
+	spec = is_sel ? (void *) parse_selspec(str) : (void *) parse_placespec(str);
+	if (spec == NULL)
+		return NULL;
+
+	if ((sce = malloc(sizeof(spec_cache_entry))) == NULL) {
+		log_err(errno, __func__, MEM_ERR_MSG);
+		return spec;
+	}
+	if ((sce->str = string_dup(str)) == NULL) {
+		free(sce);
+		return spec;
+	}
+	sce->spec = spec;
+
+	pthread_mutex_lock(&spec_cache_lock);
+	if (*cache == NULL)
+		*cache = pbs_idx_create(0, 0);
+	key = str;
+	if (*cache != NULL &&
+		pbs_idx_find(*cache, &key, (void **) &old, NULL) == PBS_IDX_RET_OK) {
+		/* another thread parsed the same spec first, use theirs */
+		old->last_used = spec_cache_gen;
+		spec = is_sel ? (void *) share_selspec(old->spec) : (void *) share_place(old->spec);
+		pthread_mutex_unlock(&spec_cache_lock);
+		free_spec_cache_entry(sce, is_sel);
+		return spec;
+	}
+	if (*cache == NULL || pbs_idx_insert(*cache, sce->str, sce) != PBS_IDX_RET_OK) {
+		pthread_mutex_unlock(&spec_cache_lock);
+		/* hand our only reference to the caller */
+		free(sce->str);
+		free(sce);
+		return spec;
+	}
+	sce->last_used = spec_cache_gen;
+	/* the cache keeps the parse's reference, the caller gets another */
+	spec = is_sel ? (void *) share_selspec(sce->spec) : (void *) share_place(sce->spec);
+	pthread_mutex_unlock(&spec_cache_lock);
+
+	return spec;
+}
+
+/**
+ * @brief
+ *		intern_selspec - return the shared parsed form of a select spec
+ *
+ * @par	The returned selspec may be shared with other jobs and cycles.  It
+ *	must be treated as read-only and released with free_selspec().
+ *
+ * @param[in]	select_spec	-	the select spec to parse
+ *
+ * @return	selspec *
+ * @retval	NULL	: on error or invalid spec
+ *
+ * @par MT-safe: Yes
+ */
+selspec *
+intern_selspec(char *select_spec)
+{
+	return intern_spec(&selspec_cache, select_spec, 1);
+}
+
+/**
+ * @brief
+ *		intern_placespec - return the shared parsed form of a place spec
+ *
+ * @par	The returned place may be shared with other jobs and cycles.  It
+ *	must be treated as read-only and released with free_place().
+ *
+ * @param[in]	place_str	-	placespec as a string
+ *
+ * @return	place *
+ * @retval	NULL	: invalid placement spec
+ *
+ * @par MT-safe: Yes
+ */
+place *
+intern_placespec(char *place_str)
+{
+	return intern_spec(&place_cache, place_str, 0);
+}
+
+/**
+ * @brief	drop the entries of one spec cache not used in the last cycle
+ *		and not held by any job
+ *
+ * @param[in]	cache	-	cache to purge
+ * @param[in]	is_sel	-	cache holds selspecs rather than places
+ *
+ * @return	int
+ * @retval	number of entries left in the cache
+ */
+static int
+purge_one_spec_cache(void *cache, int is_sel)
+{
+	spec_cache_entry *sce = NULL;
+	spec_cache_entry **stale = NULL;
+	void *ctx = NULL;
+	int nstale = 0;
+	int size = 0;
+	int count = 0;
+	int i;
+
+	if (cache == NULL)
+		return 0;
+
+	/* collect the entries first, we can't delete while iterating */
+	while (pbs_idx_find(cache, NULL, (void **) &sce, &ctx) == PBS_IDX_RET_OK) {
+		int refs;
+
+		count++;
+		if (sce->last_used == spec_cache_gen)
+			continue;
+		/* still held by a job, e.g. one duplicated from the job cache */
+		if (is_sel)
+			refs = __atomic_load_n(&((selspec *) sce->spec)->refcount, __ATOMIC_ACQUIRE);
+		else
+			refs = __atomic_load_n(&((place *) sce->spec)->refcount, __ATOMIC_ACQUIRE);
+		if (refs > 1)
+			continue;
+		if (nstale == size) {
+			spec_cache_entry **tmp;
+
+			size = size == 0 ? INIT_ARR_SIZE : size * 2;
+			tmp = realloc(stale, size * sizeof(spec_cache_entry *));
+			if (tmp == NULL) {
+				log_err(errno, __func__, MEM_ERR_MSG);
+				break;
+			}
+			stale = tmp;
+		}
+		stale[nstale++] = sce;
+	}
+	pbs_idx_free_ctx(ctx);
+
+	for (i = 0; i < nstale; i++) {
+		pbs_idx_delete(cache, stale[i]->str);
+		free_spec_cache_entry(stale[i], is_sel);
+	}
+	free(stale);
+
+	return count - nstale;
+}
+
+/**
+ * @brief	remove specs from the spec cache which no job used this cycle
+ *		and start a new cache generation.  Called once all queues have
+ *		been queried.
+ *
+ * @return void
+ */
+void
+purge_spec_cache(void)
+{
+	int nsel;
+	int npl;
+
+	pthread_mutex_lock(&spec_cache_lock);
+	nsel = purge_one_spec_cache(selspec_cache, 1);
+	npl = purge_one_spec_cache(place_cache, 0);
+	spec_cache_gen++;
+	pthread_mutex_unlock(&spec_cache_lock);
+
+	log_eventf(PBSEVENT_DEBUG3, PBS_EVENTCLASS_SCHED, LOG_DEBUG, __func__,
+		"Spec cache holds %d select specs and %d place specs", nsel, npl);
+}
+
+/**
+ * @brief	free every entry in the spec cache
+ *
+ * @par	Jobs still holding a reference keep their spec until they are freed.
+ *
+ * @return void
+ */
+void
+flush_spec_cache(void)
+{
+	spec_cache_entry *sce = NULL;
+	void *ctx = NULL;
+
+	pthread_mutex_lock(&spec_cache_lock);
+	if (selspec_cache != NULL) {
+		while (pbs_idx_find(selspec_cache, NULL, (void **) &sce, &ctx) == PBS_IDX_RET_OK)
+			free_spec_cache_entry(sce, 1);
+		pbs_idx_free_ctx(ctx);
+		pbs_idx_destroy(selspec_cache);
+		selspec_cache = NULL;
+	}
+	ctx = NULL;
+	if (place_cache != NULL) {
+		while (pbs_idx_find(place_cache, NULL, (void **) &sce, &ctx) == PBS_IDX_RET_OK)
+			free_spec_cache_entry(sce, 0);
+		pbs_idx_free_ctx(ctx);
+		pbs_idx_destroy(place_cache);
+		place_cache = NULL;
+	}
+	pthread_mutex_unlock(&spec_cache_lock);
+}
+
 /**
  *	@brief compare two chunks for equality
  *	@param[in] c1 - first chunk
@@ -4621,7 +4752,8 @@ int compare_selspec(selspec *s1, selspec *s2) {
 	int i;
 	int ret = 1;
 
-	if(s1 == NULL && s2 == NULL)
+	/* also true for interned specs of the same string */
+	if (s1 == s2)
 		return 1;
 	else if(s1 == NULL || s2 == NULL)
 		return 0;
@@ -4819,7 +4951,7 @@ parse_execvnode(char *execvnode, server_info *sinfo, selspec *sel)
 	for (i = 0; i < num_chunk && !invalid && simplespec != NULL; i++) {
 		nspec_arr[i] = new_nspec();
 		if (nspec_arr[i] != NULL) {
-			ninfo = find_node_info(sinfo->nodes, node_name);
+			ninfo = find_node_info_idx(sinfo->nodes_idx, sinfo->nodes, node_name);
 			if (ninfo != NULL) {
 				nspec_arr[i]->ninfo = ninfo;
 				for (j = 0; j < num_el; j++) {
@@ -6152,41 +6284,6 @@ check_node_eligibility_chunk(th_data_nd_eligible *data)
 	data->err = misc_err;
 }
 
-/**
- * @brief	 Allocates th_data_nd_eligible for multi-threading of check_node_array_eligibility
- *
- * @param[in]	pl	-	the placement object
- * @param[in]	resresv	-	resresv to check to place on nodes
- * @param[in]	exclerr_buf	-	buffer for not exclusive error message
- * @param[in]	ninfo_arr	-	array to check
- * @param[in]	sidx	-	the start index in ninfo_arr for the thread
- * @param[in]	eidx	-	the end index in ninfo_arr for the thread
- *
- * @return th_data_nd_eligible *
- * @retval a newly allocated th_data_nd_eligible object
- * @retval NULL for malloc error
- */
-static inline th_data_nd_eligible *
-alloc_tdata_nd_eligible(place *pl, resource_resv *resresv, node_info **ninfo_arr,
-		int sidx, int eidx)
-{
-	th_data_nd_eligible *tdata = NULL;
-
-	tdata = malloc(sizeof(th_data_nd_eligible));
-	if (tdata == NULL)  {
-		log_err(errno, __func__, MEM_ERR_MSG);
-		return NULL;
-	}
-	tdata->err = NULL;
-	tdata->pl = pl;
-	tdata->resresv = resresv;
-	tdata->ninfo_arr = ninfo_arr;
-	tdata->sidx = sidx;
-	tdata->eidx = eidx;
-
-	return tdata;
-}
-
 /**
  * @brief
  * 		check nodes for eligibility and mark them ineligible if not
@@ -6206,12 +6303,9 @@ void
 check_node_array_eligibility(node_info **ninfo_arr, resource_resv *resresv, place *pl,
 		int num_nodes, schd_error *err)
 {
-	int i, j;
-	th_data_nd_eligible *tdata = NULL;
-	th_task_info *task = NULL;
-	int chunk_size;
-	int num_tasks;
-	int tid;
+	int i;
+	th_data_nd_eligible tdata;
+	th_task_info task;
 
 	if (ninfo_arr == NULL || resresv == NULL || pl == NULL || err == NULL)
 		return;
@@ -6219,56 +6313,30 @@ check_node_array_eligibility(node_info **ninfo_arr, resource_resv *resresv, plac
 	if (num_nodes == -1)
 		num_nodes = count_array(ninfo_arr);
 
-	tid = *((int *) pthread_getspecific(th_id_key));
-	if (tid != 0 || num_threads <= 1) {
-		/* don't use multi-threading if I am a worker thread or num_threads is 1 */
-		tdata = alloc_tdata_nd_eligible(pl, resresv, ninfo_arr, 0, num_nodes - 1);
-		if (tdata == NULL)
-			return;
-		check_node_eligibility_chunk(tdata);
-		copy_schd_error(err, tdata->err);
-		free_schd_error(tdata->err);
-		free(tdata);
-	} else {	 /* We are multithreading */
-		chunk_size = num_nodes / num_threads;
-		chunk_size = (chunk_size > MT_CHUNK_SIZE_MIN) ? chunk_size : MT_CHUNK_SIZE_MIN;
-		for (j = 0, num_tasks = 0; num_nodes > 0;
-				num_tasks++, j += chunk_size, num_nodes -= chunk_size) {
-			tdata = alloc_tdata_nd_eligible(pl, resresv, ninfo_arr, j, j + chunk_size - 1);
-			if (tdata == NULL)
-				break;
+	tdata.err = NULL;
+	tdata.pl = pl;
+	tdata.resresv = resresv;
+	tdata.ninfo_arr = ninfo_arr;
 
-			task = malloc(sizeof(th_task_info));
-			if (task == NULL) {
-				free(tdata);
-				log_err(errno, __func__, MEM_ERR_MSG);
-				break;
-			}
-			task->task_type = TS_IS_ND_ELIGIBLE;
-			task->thread_data = (void *) tdata;
+	task.task_type = TS_IS_ND_ELIGIBLE;
+	task.thread_data = (void *) &tdata;
+	task.num_items = num_nodes;
+	run_parallel_task(&task);
 
-			queue_work_for_threads(task);
-		}
+	if (task.results == NULL)
+		return;
 
-		/* Get results from worker threads */
-		for (i = 0; i < num_tasks;) {
-			pthread_mutex_lock(&result_lock);
-			while (ds_queue_is_empty(result_queue))
-				pthread_cond_wait(&result_cond, &result_lock);
-			while (!ds_queue_is_empty(result_queue)) {
-				task = (th_task_info *) ds_dequeue(result_queue);
-				tdata = (th_data_nd_eligible *) task->thread_data;
-				if (err->status_code == SCHD_UNKWN && tdata->err->status_code != SCHD_UNKWN)
-					copy_schd_error(err, tdata->err);
-
-				free_schd_error(tdata->err);
-				free(tdata);
-				free(task);
-				i++;
-			}
-			pthread_mutex_unlock(&result_lock);
-		}
+	/* Report the first error found, in node order */
+	for (i = 0; i < task.num_ranges; i++) {
+		schd_error *range_err = task.results[i];
+
+		if (range_err == NULL)
+			continue;
+		if (err->status_code == SCHD_UNKWN && range_err->status_code != SCHD_UNKWN)
+			copy_schd_error(err, range_err);
+		free_schd_error(range_err);
 	}
+	free(task.results);
 }
 
 /**
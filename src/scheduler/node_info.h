@@ -123,6 +123,16 @@ int is_node_timeshared(node_info *node, void *arg);
  */
 node_info *find_node_info(node_info **ninfo_arr, char *nodename);
 
+/*
+ *      create_node_name_idx - create an index of nodes by name
+ */
+void *create_node_name_idx(node_info **ninfo_arr);
+
+/*
+ *      find_node_info_idx - find a node by name using a name index
+ */
+node_info *find_node_info_idx(void *idx, node_info **ninfo_arr, char *nodename);
+
 /*
  *      dup_node_info - duplicate a node by creating a new one and coping all
  *                      the data into the new
@@ -331,6 +341,18 @@ selspec *parse_selspec(char *selspec);
 /* compare two selspecs to see if they are equal*/
 int compare_selspec(selspec *sel1, selspec *sel2);
 
+/* return the shared parsed form of a select spec from the spec cache */
+selspec *intern_selspec(char *select_spec);
+
+/* return the shared parsed form of a place spec from the spec cache */
+place *intern_placespec(char *place_str);
+
+/* drop specs no job used this cycle from the spec cache */
+void purge_spec_cache(void);
+
+/* free every entry in the spec cache */
+void flush_spec_cache(void);
+
 /*
  *	combine_nspec_array - find and combine any nspec's for the same node
  *				in an nspec array
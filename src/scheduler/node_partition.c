@@ -90,6 +90,7 @@
 #include "globals.h"
 #include "sort.h"
 #include "buckets.h"
+#include "cycle_profile.h"
 
 
 /**
@@ -258,6 +259,8 @@ dup_node_partition(node_partition *onp, server_info *nsinfo)
 	nnp->tot_nodes = onp->tot_nodes;
 	nnp->free_nodes = onp->free_nodes;
 	nnp->res = dup_resource_list(onp->res);
+	if (nnp->res != NULL)
+		index_resource_list(nnp->res);
 	nnp->ninfo_arr = copy_node_ptr_array(onp->ninfo_arr, nsinfo->nodes);
 
 	nnp->bkts = dup_node_bucket_array(onp->bkts, nsinfo);
@@ -594,7 +597,9 @@ create_node_partitions(status *policy, node_info **nodes, char **resnames, unsig
 		 * recalculating tot_nodes for each node partition.
 		 */
 		np_arr[np_i]->tot_nodes = count_array(np_arr[np_i]->ninfo_arr);
+		prof_phase_start(PROF_NODE_BUCKETS);
 		np_arr[np_i]->bkts = create_node_buckets(policy, np_arr[np_i]->ninfo_arr, queues, NO_PRINT_BUCKETS);
+		prof_phase_end(PROF_NODE_BUCKETS);
 		node_partition_update(policy, np_arr[np_i]);
 	}
 
@@ -738,19 +743,22 @@ node_partition_update(status *policy, node_partition *np)
 		} else
 			arl_flags |= ADD_AVAIL_ASSIGNED;
 
-		if (np->res == NULL)
+		if (np->res == NULL) {
 			np->res = dup_selective_resource_list(np->ninfo_arr[i]->res,
 				policy->resdef_to_check, arl_flags);
-		else if (!add_resource_list(policy, np->res, np->ninfo_arr[i]->res, arl_flags)) {
+		} else if (!add_resource_list(policy, np->res, np->ninfo_arr[i]->res, arl_flags)) {
 			rc = 0;
 			break;
 		}
 	}
 
+	/* index the list once it has every resource the nodes added to it */
+	if (np->res != NULL)
+		index_resource_list(np->res);
+
 	if (policy->node_sort[0].res_name != NULL && conf.node_sort_unused) {
 		/* Resort the nodes in the partition so that selection works correctly. */
-		qsort(np->ninfo_arr, np->tot_nodes, sizeof(node_info *),
-			multi_node_sort);
+		sort_nodes(np->ninfo_arr, np->tot_nodes);
 	}
 
 	return rc;
@@ -0,0 +1,253 @@
+/*
+ * Copyright (C) 1994-2020 Altair Engineering, Inc.
+ * For more information, contact Altair at www.altair.com.
+ *
+ * This file is part of both the OpenPBS software ("OpenPBS")
+ * and the PBS Professional ("PBS Pro") software.
+ *
+ * Open Source License Information:
+ *
+ * OpenPBS is free software. You can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * OpenPBS is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Affero General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Commercial License Information:
+ *
+ * PBS Pro is commercially licensed software that shares a common core with
+ * the OpenPBS software.  For a copy of the commercial license terms and
+ * conditions, go to: (http://www.pbspro.com/agreement.html) or contact the
+ * Altair Legal Department.
+ *
+ * Altair's dual-license business model allows companies, individuals, and
+ * organizations to create proprietary derivative works of OpenPBS and
+ * distribute them - whether embedded or bundled with other software -
+ * under a commercial license agreement.
+ *
+ * Use of Altair's trademarks, including but not limited to "PBS™",
+ * "OpenPBS®", "PBS Professional®", and "PBS Pro™" and Altair's logos is
+ * subject to Altair's trademark licensing policies.
+ */
+
+
+/**
+ * @file    obj_pool.c
+ *
+ * @brief
+ * 	Per-thread free lists for the small objects the scheduler creates
+ *	and destroys by the million every cycle.  A freed object is kept on
+ *	the freeing thread's list (up to OBJ_POOL_MAX_FREE of each type) and
+ *	handed back out zeroed by the next allocation of that type instead of
+ *	going back through malloc().
+ *
+ *	Objects are still individually malloc()ed, so it is always safe to
+ *	free() a pooled object or to obj_pool_free() an object which was not
+ *	allocated from the pool.
+ *
+ *	The free lists hang off a pthread key, which frees them when their
+ *	thread exits.
+ *
+ * Functions included are:
+ * 	obj_pool_alloc()
+ * 	obj_pool_free()
+ * 	obj_pool_log_stats()
+ */
+
+#include <pbs_config.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+
+#include "log.h"
+
+#include "data_types.h"
+#include "constant.h"
+#include "obj_pool.h"
+
+struct pool_obj {
+	struct pool_obj *next;
+};
+
+struct obj_pool_list {
+	struct pool_obj *head;	/* freed objects ready for reuse */
+	int count;		/* number of objects on head */
+};
+
+/* a thread's free lists */
+struct obj_pools {
+	struct obj_pool_list lists[OBJ_POOL_NUM];
+	long allocs;		/* objects handed out since the last obj_pool_log_stats() */
+	long reused;		/* how many of them came from the free lists */
+};
+
+static size_t obj_pool_sizes[OBJ_POOL_NUM] = {
+	sizeof(resource_req),
+	sizeof(schd_resource),
+	sizeof(nspec),
+	sizeof(te_list)
+};
+
+static pthread_key_t obj_pool_key;
+static pthread_once_t obj_pool_key_once = PTHREAD_ONCE_INIT;
+
+/**
+ * @brief	release a thread's free lists when the thread exits
+ *
+ * @param[in]	arg	-	the thread's struct obj_pools
+ *
+ * @return	void
+ */
+static void
+obj_pool_thread_exit(void *arg)
+{
+	struct obj_pools *pools = arg;
+	struct pool_obj *obj;
+	int i;
+
+	for (i = 0; i < OBJ_POOL_NUM; i++) {
+		while ((obj = pools->lists[i].head) != NULL) {
+			pools->lists[i].head = obj->next;
+			free(obj);
+		}
+	}
+	free(pools);
+}
+
+/**
+ * @brief	create the key holding each thread's free lists
+ */
+static void
+create_obj_pool_key(void)
+{
+	pthread_key_create(&obj_pool_key, obj_pool_thread_exit);
+}
+
+/**
+ * @brief	get the calling thread's free lists
+ *
+ * @param[in]	create	-	create them if the thread has none yet
+ *
+ * @return	struct obj_pools *
+ * @retval	the thread's free lists
+ * @retval	NULL	: the thread has none (or out of memory)
+ */
+static struct obj_pools *
+get_obj_pools(int create)
+{
+	struct obj_pools *pools;
+
+	pthread_once(&obj_pool_key_once, create_obj_pool_key);
+	pools = pthread_getspecific(obj_pool_key);
+	if (pools == NULL && create) {
+		if ((pools = calloc(1, sizeof(struct obj_pools))) == NULL) {
+			log_err(errno, __func__, MEM_ERR_MSG);
+			return NULL;
+		}
+		pthread_setspecific(obj_pool_key, pools);
+	}
+
+	return pools;
+}
+
+/**
+ * @brief	allocate a zeroed object of a pooled type
+ *
+ * @param[in]	type	-	the type of object
+ *
+ * @return	void *
+ * @retval	the object
+ * @retval	NULL	: out of memory
+ */
+void *
+obj_pool_alloc(enum obj_pool_type type)
+{
+	struct obj_pools *pools;
+	struct obj_pool_list *list;
+	struct pool_obj *obj;
+
+	if ((pools = get_obj_pools(1)) == NULL)
+		return calloc(1, obj_pool_sizes[type]);
+
+	pools->allocs++;
+	list = &pools->lists[type];
+	if (list->head == NULL)
+		return calloc(1, obj_pool_sizes[type]);
+
+	obj = list->head;
+	list->head = obj->next;
+	list->count--;
+	pools->reused++;
+	memset(obj, 0, obj_pool_sizes[type]);
+
+	return obj;
+}
+
+/**
+ * @brief	give an object of a pooled type back for reuse.  The object's
+ *		members must already have been freed.
+ *
+ * @param[in]	type	-	the type of object
+ * @param[in]	obj	-	the object
+ *
+ * @return	void
+ */
+void
+obj_pool_free(enum obj_pool_type type, void *obj)
+{
+	struct obj_pools *pools;
+	struct obj_pool_list *list;
+	struct pool_obj *pobj = obj;
+
+	if (obj == NULL)
+		return;
+
+	if ((pools = get_obj_pools(1)) == NULL) {
+		free(obj);
+		return;
+	}
+
+	list = &pools->lists[type];
+	if (list->count >= OBJ_POOL_MAX_FREE) {
+		free(obj);
+		return;
+	}
+
+	pobj->next = list->head;
+	list->head = pobj;
+	list->count++;
+}
+
+/**
+ * @brief	log how many objects the calling thread allocated since the
+ *		last call, and how many of them were reused from its free lists
+ *
+ * @return	void
+ */
+void
+obj_pool_log_stats(void)
+{
+	struct obj_pools *pools;
+	int pooled = 0;
+	int i;
+
+	if ((pools = get_obj_pools(0)) == NULL)
+		return;
+
+	for (i = 0; i < OBJ_POOL_NUM; i++)
+		pooled += pools->lists[i].count;
+
+	log_eventf(PBSEVENT_DEBUG2, PBS_EVENTCLASS_SCHED, LOG_DEBUG, __func__,
+		"Object pools: %ld allocated, %ld reused, %d free", pools->allocs, pools->reused, pooled);
+	pools->allocs = 0;
+	pools->reused = 0;
+}
@@ -37,25 +37,24 @@
  * subject to Altair's trademark licensing policies.
  */
 
-#ifndef SRC_SCHEDULER_QUEUE_H_
-#define SRC_SCHEDULER_QUEUE_H_
 
-#define QUEUE_DS_MIN_SIZE 512	/* Minimum size of the queue data structure */
+#ifndef SRC_SCHEDULER_OBJ_POOL_H_
+#define SRC_SCHEDULER_OBJ_POOL_H_
 
-typedef struct ds_queue ds_queue;
+/* maximum number of freed objects of each type a thread keeps for reuse */
+#define OBJ_POOL_MAX_FREE 16384
 
-struct ds_queue {
-	int min_size;
-	long front;
-	long rear;
-	long q_size;
-	void **content_arr;
+/* small objects which are created and destroyed many times a cycle */
+enum obj_pool_type {
+	OBJ_POOL_RESOURCE_REQ,
+	OBJ_POOL_SCHD_RESOURCE,
+	OBJ_POOL_NSPEC,
+	OBJ_POOL_TE_LIST,
+	OBJ_POOL_NUM
 };
 
-ds_queue *new_ds_queue(void);
-void free_ds_queue(ds_queue *queue);
-int ds_enqueue(ds_queue *queue, void *obj);
-void *ds_dequeue(ds_queue *queue);
-int ds_queue_is_empty(ds_queue *queue);
+void *obj_pool_alloc(enum obj_pool_type type);
+void obj_pool_free(enum obj_pool_type type, void *obj);
+void obj_pool_log_stats(void);
 
-#endif /* SRC_SCHEDULER_QUEUE_H_ */
+#endif /* SRC_SCHEDULER_OBJ_POOL_H_ */
@@ -728,6 +728,12 @@ parse_config(char *fname)
 				}
 				else if (!strcmp(config_name, PARSE_PREEMPT_ATTEMPTS))
 					conf.max_preempt_attempts = num;
+				else if (!strcmp(config_name, PARSE_RUNJOB_PIPELINE_DEPTH)) {
+					if (num < 0)
+						error = 1;
+					else
+						conf.runjob_pipeline_depth = num;
+				}
 				else if (!strcmp(config_name, PARSE_MAX_JOB_CHECK)) {
 					if (!strcmp(config_value, "ALL_JOBS"))
 						conf.max_jobs_to_check = SCHD_INFINITY;
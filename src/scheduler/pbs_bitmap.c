@@ -40,6 +40,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "pbs_bitmap.h"
 
@@ -217,7 +218,7 @@ pbs_bitmap_next_on_bit(pbs_bitmap *pbm, long start_bit)
 {
 	long long_ind;
 	long bit;
-	int i;
+	unsigned long word;
 
 	if (pbm == NULL)
 		return -1;
@@ -228,33 +229,19 @@ pbs_bitmap_next_on_bit(pbs_bitmap *pbm, long start_bit)
 	long_ind = start_bit / BYTES_TO_BITS(sizeof(unsigned long));
 	bit = start_bit % BYTES_TO_BITS(sizeof(unsigned long));
 
-	/* special case - look at first long that contains start_bit */
-	if (pbm->bits[long_ind] != 0) {
-		for (i = bit + 1; i < BYTES_TO_BITS(sizeof(unsigned long)); i++) {
-			if (pbm->bits[long_ind] & (1UL << i)) {
-				return (long_ind * BYTES_TO_BITS(sizeof(unsigned long)) + i);
-			}
-		}
-
-		/* didn't find an on bit after start_bit_index in the long that contained start_bit */
-		if (long_ind < pbm->num_longs) {
-			long_ind++;
-		}
-	}
-
-	for( ; long_ind < pbm->num_longs && pbm->bits[long_ind] == 0; long_ind++)
-		;
-
-	if (long_ind == pbm->num_longs)
-		return -1;
+	/* mask off start_bit and everything below it in the first long */
+	if (bit == BYTES_TO_BITS(sizeof(unsigned long)) - 1)
+		word = 0;
+	else
+		word = pbm->bits[long_ind] & (~0UL << (bit + 1));
 
-	for (i = 0 ; i < BYTES_TO_BITS(sizeof(unsigned long)) ; i++) {
-		if (pbm->bits[long_ind] & (1UL << i)) {
-			return (long_ind * BYTES_TO_BITS(sizeof(unsigned long)) + i);
-		}
+	while (word == 0) {
+		if (++long_ind >= pbm->num_longs)
+			return -1;
+		word = pbm->bits[long_ind];
 	}
 
-	return -1;
+	return (long_ind * BYTES_TO_BITS(sizeof(unsigned long)) + __builtin_ctzl(word));
 }
 
 /**
@@ -284,8 +271,6 @@ pbs_bitmap_first_on_bit(pbs_bitmap *bm)
 int
 pbs_bitmap_assign(pbs_bitmap *L, pbs_bitmap *R)
 {
-	int i;
-
 	if (L == NULL || R == NULL)
 		return 0;
 
@@ -299,11 +284,9 @@ pbs_bitmap_assign(pbs_bitmap *L, pbs_bitmap *R)
 		if(pbs_bitmap_alloc(L, BYTES_TO_BITS(R->num_longs * sizeof(unsigned long))) == NULL)
 			return 0;
 
-	for (i = 0; i < R->num_longs; i++)
-		L->bits[i] = R->bits[i];
+	memcpy(L->bits, R->bits, R->num_longs * sizeof(unsigned long));
 	if (R->num_longs < L->num_longs)
-		for(; i < L->num_longs; i++)
-			L->bits[i] = 0;
+		memset(L->bits + R->num_longs, 0, (L->num_longs - R->num_longs) * sizeof(unsigned long));
 
 	L->num_bits = R->num_bits;
 	return 1;
@@ -320,7 +303,7 @@ pbs_bitmap_assign(pbs_bitmap *L, pbs_bitmap *R)
 int
 pbs_bitmap_is_equal(pbs_bitmap *L, pbs_bitmap *R)
 {
-	int i;
+	long num_longs;
 
 	if(L == NULL || R == NULL)
 		return 0;
@@ -328,9 +311,150 @@ pbs_bitmap_is_equal(pbs_bitmap *L, pbs_bitmap *R)
 	if (L->num_bits != R->num_bits)
 		return 0;
 
-	for(i = 0; i < L->num_longs; i++)
-		if(L->bits[i] != R->bits[i])
+	/* Either bitmap may have more longs allocated than its num_bits needs.
+	 * Unused bits are always off, so only compare the longs in use.
+	 */
+	num_longs = (L->num_bits + BYTES_TO_BITS(sizeof(unsigned long)) - 1) / BYTES_TO_BITS(sizeof(unsigned long));
+	if (memcmp(L->bits, R->bits, num_longs * sizeof(unsigned long)) != 0)
+		return 0;
+
+	return 1;
+}
+
+/**
+ * @brief pbs_bitmap version of L |= R
+ * @param L - bitmap lvalue
+ * @param R - bitmap rvalue
+ * @return int
+ * @retval 1 success
+ * @retval 0 failure
+ */
+int
+pbs_bitmap_or(pbs_bitmap *L, pbs_bitmap *R)
+{
+	long i;
+
+	if (L == NULL || R == NULL)
+		return 0;
+
+	if (R->num_bits > L->num_bits)
+		if (pbs_bitmap_alloc(L, R->num_bits) == NULL)
 			return 0;
 
+	for (i = 0; i < R->num_longs && i < L->num_longs; i++)
+		L->bits[i] |= R->bits[i];
+
+	return 1;
+}
+
+/**
+ * @brief pbs_bitmap version of L &= R
+ * @param L - bitmap lvalue
+ * @param R - bitmap rvalue
+ * @return int
+ * @retval 1 success
+ * @retval 0 failure
+ */
+int
+pbs_bitmap_and(pbs_bitmap *L, pbs_bitmap *R)
+{
+	long i;
+
+	if (L == NULL || R == NULL)
+		return 0;
+
+	for (i = 0; i < R->num_longs && i < L->num_longs; i++)
+		L->bits[i] &= R->bits[i];
+	/* bits past the end of R are off */
+	for (; i < L->num_longs; i++)
+		L->bits[i] = 0;
+
 	return 1;
 }
+
+/**
+ * @brief pbs_bitmap version of L &= ~R
+ * @param L - bitmap lvalue
+ * @param R - bitmap rvalue
+ * @return int
+ * @retval 1 success
+ * @retval 0 failure
+ */
+int
+pbs_bitmap_andnot(pbs_bitmap *L, pbs_bitmap *R)
+{
+	long i;
+
+	if (L == NULL || R == NULL)
+		return 0;
+
+	for (i = 0; i < R->num_longs && i < L->num_longs; i++)
+		L->bits[i] &= ~R->bits[i];
+
+	return 1;
+}
+
+/**
+ * @brief count the number of on bits in a bitmap
+ * @param pbm - the bitmap
+ * @return long
+ * @retval number of on bits
+ */
+long
+pbs_bitmap_count(pbs_bitmap *pbm)
+{
+	long i;
+	long ct = 0;
+
+	if (pbm == NULL)
+		return 0;
+
+	for (i = 0; i < pbm->num_longs; i++)
+		ct += __builtin_popcountl(pbm->bits[i]);
+
+	return ct;
+}
+
+/**
+ * @brief set out to the first n on bits of a bitmap.  Whole longs are
+ *        taken at a time while more than a long's worth of bits are needed.
+ * @param pbm - the bitmap
+ * @param n - the number of on bits to take
+ * @param out - the bitmap to set.  Any previous bits are cleared.
+ * @return long
+ * @retval number of bits set in out (less than n if pbm has fewer on bits)
+ * @retval -1 on error
+ */
+long
+pbs_bitmap_first_n_on_bits(pbs_bitmap *pbm, long n, pbs_bitmap *out)
+{
+	long i;
+	long left = n;
+	unsigned long word;
+	int ct;
+
+	if (pbm == NULL || out == NULL)
+		return -1;
+
+	if (pbs_bitmap_alloc(out, pbm->num_bits) == NULL)
+		return -1;
+
+	memset(out->bits, 0, out->num_longs * sizeof(unsigned long));
+
+	for (i = 0; i < pbm->num_longs && left > 0; i++) {
+		word = pbm->bits[i];
+		ct = __builtin_popcountl(word);
+		if (ct <= left) {
+			out->bits[i] = word;
+			left -= ct;
+		} else {
+			/* take the lowest remaining bits one at a time */
+			for (; left > 0; left--) {
+				out->bits[i] |= word & -word;
+				word &= word - 1;
+			}
+		}
+	}
+
+	return n - left;
+}
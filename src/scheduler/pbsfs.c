@@ -224,7 +224,7 @@ main(int argc, char *argv[])
 		print_fairshare(conf.fairshare->root, -1);
 	}
 	else if (flags & FS_DECAY)
-		decay_fairshare_tree(conf.fairshare->root);
+		decay_fairshare_tree(conf.fairshare->root, 1);
 	else if (flags & (FS_GET | FS_SET | FS_COMP)) {
 		ginfo = find_group_info(argv[optind], conf.fairshare->root);
 
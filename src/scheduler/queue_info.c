@@ -659,8 +659,7 @@ update_queue_on_run(queue_info *qinfo, resource_resv *resresv, char *job_state)
 
 	if (cstat.node_sort[0].res_name != NULL &&
 		conf.node_sort_unused && qinfo->nodes != NULL)
-		qsort(qinfo->nodes, qinfo->num_nodes, sizeof(node_info *),
-			multi_node_sort);
+		sort_nodes(qinfo->nodes, qinfo->num_nodes);
 
 
 	if ((job_state != NULL) && (*job_state == 'S') && (resresv->job->resreq_rel != NULL))
@@ -91,8 +91,11 @@
 #include "pbs_internal.h"
 #include "limits_if.h"
 #include "sort.h"
+#include "job_info.h"
+#include "node_info.h"
 #include "parse.h"
 #include "limits_if.h"
+#include "formula.h"
 
 
 
@@ -220,6 +223,11 @@ query_resources(int pbs_sd)
 		free_resdef_array(defarr);
 		return NULL;
 	}
+
+	/* the position in allres is the resource's dense index */
+	for (i = 0; defarr[i] != NULL; i++)
+		defarr[i]->idx = i;
+
 	return defarr;
 }
 
@@ -326,6 +334,7 @@ new_resdef(void)
 	}
 
 	newdef->name = NULL;
+	newdef->idx = -1;
 	/* calloc will have zeroed flags and the type structure */
 
 	return newdef;
@@ -351,6 +360,7 @@ dup_resdef(resdef *olddef)
 
 	newdef->type = olddef->type;
 	newdef->flags = olddef->flags;
+	newdef->idx = olddef->idx;
 	newdef->name = string_dup(olddef->name);
 
 	if (newdef->name == NULL) {
@@ -734,6 +744,13 @@ update_resource_defs(int pbs_sd)
 	if (allres != NULL)
 		return 1;
 
+	/* jobs cached across cycles were parsed against the old definitions */
+	flush_job_cache();
+	/* as are the interned select and place specs */
+	flush_spec_cache();
+	/* compiled formulas refer to the old definitions */
+	flush_formula_cache();
+
 	allres = query_resources(pbs_sd);
 
 	if (allres != NULL) {
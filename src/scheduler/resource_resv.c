@@ -54,6 +54,10 @@
  * 	find_resource_resv()
  * 	find_resource_resv_by_indrank()
  * 	find_resource_resv_by_time()
+ * 	create_resresv_name_idx()
+ * 	add_resresv_to_name_idx()
+ * 	find_resource_resv_idx()
+ * 	find_resource_resv_by_time_idx()
  * 	find_resource_resv_func()
  * 	cmp_job_arrays()
  * 	is_resource_resv_valid()
@@ -78,6 +82,7 @@
  * 	new_place()
  * 	free_place()
  * 	dup_place()
+ * 	share_place()
  * 	new_chunk()
  * 	dup_chunk_array()
  * 	dup_chunk()
@@ -85,6 +90,7 @@
  * 	free_chunk()
  * 	new_selspec()
  * 	dup_selspec()
+ * 	share_selspec()
  * 	free_selspec()
  * 	compare_res_to_str()
  * 	compare_non_consumable()
@@ -102,6 +108,7 @@
 #include <log.h>
 #include <pthread.h>
 #include <libutil.h>
+#include <pbs_idx.h>
 #include "pbs_config.h"
 #include "data_types.h"
 #include "resource_resv.h"
@@ -119,6 +126,7 @@
 #include "range.h"
 #include "simulate.h"
 #include "multi_threading.h"
+#include "obj_pool.h"
 
 
 /**
@@ -224,35 +232,6 @@ free_resource_resv_array_chunk(th_data_free_resresv *data)
 	}
 }
 
-/**
- * @brief	Allocates th_data_free_resresv for multi-threading of free_resource_resv_array
- *
- * @param[in,out]	resresv_arr	-	the resresv array to free
- * @param[in]	sidx	-	start index for the resresv array for the thread
- * @param[in]	eidx	-	end index for the resresv array for the thread
- *
- * @return th_data_free_resresv *
- * @retval a newly allocated th_data_free_resresv object
- * @retval NULL for malloc error
- */
-static inline th_data_free_resresv *
-alloc_tdata_free_rr_arr(resource_resv **resresv_arr, int sidx, int eidx)
-{
-	th_data_free_resresv *tdata = NULL;
-
-	tdata = malloc(sizeof(th_data_free_resresv));
-	if (tdata == NULL) {
-		log_err(errno, __func__, MEM_ERR_MSG);
-		return NULL;
-	}
-
-	tdata->resresv_arr = resresv_arr;
-	tdata->sidx = sidx;
-	tdata->eidx = eidx;
-
-	return tdata;
-}
-
 /**
  * @brief
  *		free_resource_resv_array - free an array of resource resvs
@@ -265,62 +244,18 @@ alloc_tdata_free_rr_arr(resource_resv **resresv_arr, int sidx, int eidx)
 void
 free_resource_resv_array(resource_resv **resresv_arr)
 {
-	int i;
-	int chunk_size;
-	th_data_free_resresv *tdata = NULL;
-	th_task_info *task = NULL;
-	int num_tasks;
-	int num_jobs;
-	int tid;
+	th_data_free_resresv tdata;
+	th_task_info task;
 
 	if (resresv_arr == NULL)
 		return;
 
-	num_jobs = count_array(resresv_arr);
-
-	tid = *((int *) pthread_getspecific(th_id_key));
-	if (tid != 0 || num_threads <= 1) {
-		/* don't use multi-threading if I am a worker thread or num_threads is 1 */
-		tdata = alloc_tdata_free_rr_arr(resresv_arr, 0, num_jobs - 1);
-		if (tdata == NULL)
-			return;
-
-		free_resource_resv_array_chunk(tdata);
-		free(tdata);
-		free(resresv_arr);
-		return;
-	}
-
-	chunk_size = num_jobs / num_threads;
-	chunk_size = (chunk_size > MT_CHUNK_SIZE_MIN) ? chunk_size : MT_CHUNK_SIZE_MIN;
-	chunk_size = (chunk_size < MT_CHUNK_SIZE_MAX) ? chunk_size : MT_CHUNK_SIZE_MAX;
-	for (i = 0, num_tasks = 0; num_jobs > 0;
-			num_tasks++, i += chunk_size, num_jobs -= chunk_size) {
-		tdata = alloc_tdata_free_rr_arr(resresv_arr, i, i + chunk_size - 1);
-		if (tdata == NULL)
-			break;
+	tdata.resresv_arr = resresv_arr;
 
-		task = malloc(sizeof(th_task_info));
-		task->task_type = TS_FREE_RESRESV;
-		task->thread_data = (void *) tdata;
-
-		queue_work_for_threads(task);
-	}
-
-	/* Get results from worker threads */
-	for (i = 0; i < num_tasks;) {
-		pthread_mutex_lock(&result_lock);
-		while (ds_queue_is_empty(result_queue))
-			pthread_cond_wait(&result_cond, &result_lock);
-		while (!ds_queue_is_empty(result_queue)) {
-			task = (th_task_info *) ds_dequeue(result_queue);
-			tdata = task->thread_data;
-			free(tdata);
-			free(task);
-			i++;
-		}
-		pthread_mutex_unlock(&result_lock);
-	}
+	task.task_type = TS_FREE_RESRESV;
+	task.thread_data = (void *) &tdata;
+	task.num_items = count_array(resresv_arr);
+	run_parallel_task(&task);
 
 	free(resresv_arr);
 }
@@ -448,42 +383,6 @@ dup_resource_resv_array_chunk(th_data_dup_resresv *data)
 	free_schd_error(err);
 }
 
-/**
- * @brief	Allocates th_data_dup_resresv for multi-threading of dup_resource_resv_array
- *
- * @param[in]	oresresv_arr	-	the array to duplicate
- * @param[out]	nresresv_arr	-	the duplicated array
- * @param[in]	nsinfo	-	new server ptr for new resresv array
- * @param[in]	nqinfo	-	new queue ptr for new resresv array
- * @param[in]	sidx	-	start index for the resresv list for the thread
- * @param[in]	eidx	-	end index for the resresv list for the thread
- *
- * @return th_data_dup_resresv *
- * @retval a newly allocated th_data_dup_resresv object
- * @retval NULL for malloc error
- */
-static inline th_data_dup_resresv *
-alloc_tdata_dup_nodes(resource_resv **oresresv_arr, resource_resv **nresresv_arr, server_info *nsinfo,
-		queue_info *nqinfo, int sidx, int eidx)
-{
-	th_data_dup_resresv *tdata = NULL;
-
-	tdata = malloc(sizeof(th_data_dup_resresv));
-	if (tdata == NULL) {
-		log_err(errno, __func__, MEM_ERR_MSG);
-		return NULL;
-	}
-	tdata->oresresv_arr = oresresv_arr;
-	tdata->nresresv_arr = nresresv_arr;
-	tdata->nsinfo = nsinfo;
-	tdata->nqinfo = nqinfo;
-	tdata->sidx = sidx;
-	tdata->eidx = eidx;
-	tdata->error = 0;
-
-	return tdata;
-}
-
 /**
  * @brief
  *		dup_resource_resv_array - dup a array of pointers of resource resvs
@@ -501,77 +400,37 @@ dup_resource_resv_array(resource_resv **oresresv_arr,
 	server_info *nsinfo, queue_info *nqinfo)
 {
 	resource_resv **nresresv_arr;
-	int i, j;
-	int chunk_size;
-	th_data_dup_resresv *tdata = NULL;
-	th_task_info *task = NULL;
-	int num_tasks;
+	th_data_dup_resresv tdata;
+	th_task_info task;
 	int num_resresv;
-	int thread_job_ct_left;
-	int th_err = 0;
-	int tid;
 
 	if (oresresv_arr == NULL || nsinfo == NULL)
 		return NULL;
 
-	num_resresv = thread_job_ct_left = count_array(oresresv_arr);
+	num_resresv = count_array(oresresv_arr);
 
-	if ((nresresv_arr = malloc((num_resresv + 1) * sizeof(resource_resv *))) == NULL) {
+	/* calloc() so a partially duplicated array can be freed on error */
+	if ((nresresv_arr = calloc(num_resresv + 1, sizeof(resource_resv *))) == NULL) {
 		log_err(errno, __func__, MEM_ERR_MSG);
 		return NULL;
 	}
-	nresresv_arr[0] = NULL;
 
-	tid = *((int *) pthread_getspecific(th_id_key));
-	if (tid != 0 || num_threads <= 1) {
-		/* don't use multi-threading if I am a worker thread or num_threads is 1 */
-		tdata = alloc_tdata_dup_nodes(oresresv_arr, nresresv_arr, nsinfo, nqinfo, 0, num_resresv - 1);
-		if (tdata == NULL)
-			th_err = 1;
-		else {
-			dup_resource_resv_array_chunk(tdata);
-			th_err = tdata->error;
-			free(tdata);
-		}
-	} else { /* We are multithreading */
-		chunk_size = num_resresv / num_threads;
-		chunk_size = (chunk_size > MT_CHUNK_SIZE_MIN)? chunk_size: MT_CHUNK_SIZE_MIN;
-		chunk_size = (chunk_size < MT_CHUNK_SIZE_MAX)? chunk_size: MT_CHUNK_SIZE_MAX;
-		for (j = 0, num_tasks = 0; thread_job_ct_left > 0;
-				num_tasks++, j += chunk_size, thread_job_ct_left -= chunk_size) {
-			tdata = alloc_tdata_dup_nodes(oresresv_arr, nresresv_arr, nsinfo, nqinfo, j, j + chunk_size - 1);
-			if (tdata == NULL) {
-				th_err = 1;
-				break;
-			}
-			task = malloc(sizeof(th_task_info));
-			task->task_type = TS_DUP_RESRESV;
-			task->thread_data = (void *) tdata;
+	tdata.error = 0;
+	tdata.oresresv_arr = oresresv_arr;
+	tdata.nresresv_arr = nresresv_arr;
+	tdata.nsinfo = nsinfo;
+	tdata.nqinfo = nqinfo;
 
-			queue_work_for_threads(task);
+	task.task_type = TS_DUP_RESRESV;
+	task.thread_data = (void *) &tdata;
+	task.num_items = num_resresv;
+	if (!run_parallel_task(&task)) {
+		int i;
 
-		}
-
-		/* Get results from worker threads */
-		for (i = 0; i < num_tasks;) {
-			pthread_mutex_lock(&result_lock);
-			while (ds_queue_is_empty(result_queue))
-				pthread_cond_wait(&result_cond, &result_lock);
-			while (!ds_queue_is_empty(result_queue)) {
-				task = (th_task_info *) ds_dequeue(result_queue);
-				tdata = (th_data_dup_resresv *) task->thread_data;
-				if (tdata->error)
-					th_err = 1;
-				free(tdata);
-				free(task);
-				i++;
-			}
-			pthread_mutex_unlock(&result_lock);
-		}
-	}
-
-	if (th_err) {
-		free_resource_resv_array(nresresv_arr);
+		/* a failed range leaves holes, so don't stop at the first NULL */
+		for (i = 0; i < num_resresv; i++)
+			free_resource_resv(nresresv_arr[i]);
+		free(nresresv_arr);
 		return NULL;
 	}
 	nresresv_arr[num_resresv] = NULL;
@@ -621,8 +480,11 @@ dup_resource_resv(resource_resv *oresresv, server_info *nsinfo, queue_info *nqin
 	nresresv->project = string_dup(oresresv->project);
 
 	nresresv->nodepart_name = string_dup(oresresv->nodepart_name);
-	nresresv->select = dup_selspec(oresresv->select); /* must come before calls to dup_nspecs() below */
-	nresresv->execselect = dup_selspec(oresresv->execselect);
+	/* The select/place specs are never modified once a resresv is queried.
+	 * Share them with the original rather than deep copying every chunk.
+	 */
+	nresresv->select = share_selspec(oresresv->select); /* must come before calls to dup_nspecs() below */
+	nresresv->execselect = share_selspec(oresresv->execselect);
 
 	nresresv->is_invalid = oresresv->is_invalid;
 	nresresv->can_not_fit = oresresv->can_not_fit;
@@ -648,7 +510,7 @@ dup_resource_resv(resource_resv *oresresv, server_info *nsinfo, queue_info *nqin
 
 	nresresv->resreq = dup_resource_req_list(oresresv->resreq);
 
-	nresresv->place_spec = dup_place(oresresv->place_spec);
+	nresresv->place_spec = share_place(oresresv->place_spec);
 
 	nresresv->aoename = string_dup(oresresv->aoename);
 	nresresv->eoename = string_dup(oresresv->eoename);
@@ -794,6 +656,145 @@ find_resource_resv_by_time(resource_resv **resresv_arr, char *name, time_t start
 	return resresv_arr[i];
 }
 
+/**
+ * @brief
+ * 		create an index of resource_resvs by name.  If a name appears more
+ *		than once (e.g. occurrences of a standing reservation), the first
+ *		one in the array is indexed, matching find_resource_resv().
+ *
+ * @param[in]	resresv_arr	-	array of resource_resvs to index
+ *
+ * @return	void *
+ * @retval	the index
+ * @retval	NULL	: on error
+ *
+ */
+void *
+create_resresv_name_idx(resource_resv **resresv_arr)
+{
+	void *idx;
+	void *key;
+	void *data;
+	int i;
+
+	if ((idx = pbs_idx_create(0, 0)) == NULL) {
+		log_err(errno, __func__, MEM_ERR_MSG);
+		return NULL;
+	}
+
+	if (resresv_arr == NULL)
+		return idx;
+
+	for (i = 0; resresv_arr[i] != NULL; i++) {
+		key = resresv_arr[i]->name;
+		if (pbs_idx_find(idx, &key, &data, NULL) == PBS_IDX_RET_OK)
+			continue;
+		if (pbs_idx_insert(idx, resresv_arr[i]->name, resresv_arr[i]) != PBS_IDX_RET_OK) {
+			log_err(errno, __func__, "Failed to index resource_resv");
+			pbs_idx_destroy(idx);
+			return NULL;
+		}
+	}
+
+	return idx;
+}
+
+/**
+ * @brief
+ * 		add a resource_resv to a name index created by
+ *		create_resresv_name_idx().  If the index can't be updated, it is
+ *		destroyed so lookups fall back to scanning the array.
+ *
+ * @param[in,out]	idx	-	pointer to the index
+ * @param[in]	resresv	-	resource_resv to add
+ *
+ * @return	void
+ *
+ */
+void
+add_resresv_to_name_idx(void **idx, resource_resv *resresv)
+{
+	void *key;
+	void *data;
+
+	if (idx == NULL || *idx == NULL || resresv == NULL)
+		return;
+
+	key = resresv->name;
+	if (pbs_idx_find(*idx, &key, &data, NULL) == PBS_IDX_RET_OK)
+		return;
+
+	if (pbs_idx_insert(*idx, resresv->name, resresv) != PBS_IDX_RET_OK) {
+		pbs_idx_destroy(*idx);
+		*idx = NULL;
+	}
+}
+
+/**
+ * @brief
+ * 		find a resource_resv by name using a name index if we have one
+ *
+ * @param[in]	idx	-	index created by create_resresv_name_idx() (may be NULL)
+ * @param[in]	resresv_arr	-	array idx was created from
+ * @param[in]	name	-	name of resource_resv to find
+ *
+ * @return	resource_resv *
+ * @retval	resource_resv if found
+ * @retval	NULL	: if not found or on error
+ *
+ */
+resource_resv *
+find_resource_resv_idx(void *idx, resource_resv **resresv_arr, char *name)
+{
+	void *key = name;
+	void *data = NULL;
+
+	if (idx == NULL)
+		return find_resource_resv(resresv_arr, name);
+
+	if (name == NULL)
+		return NULL;
+
+	if (pbs_idx_find(idx, &key, &data, NULL) != PBS_IDX_RET_OK)
+		return NULL;
+
+	return (resource_resv *) data;
+}
+
+/**
+ * @brief
+ * 		find a resource_resv by name and start time using a name index if
+ *		we have one.  Only the first resource_resv of a name is indexed, so
+ *		later occurrences of a standing reservation are found by a scan.
+ *
+ * @param[in]	idx	-	index created by create_resresv_name_idx() (may be NULL)
+ * @param[in]	resresv_arr	-	array idx was created from
+ * @param[in]	name	-	name of resource_resv to find
+ * @param[in]	start_time	-	the start time of the resource_resv
+ *
+ * @return	resource_resv *
+ * @retval	resource_resv	: if found
+ * @retval	NULL	: if not found or on error
+ *
+ */
+resource_resv *
+find_resource_resv_by_time_idx(void *idx, resource_resv **resresv_arr, char *name, time_t start_time)
+{
+	resource_resv *resresv;
+
+	if (idx == NULL)
+		return find_resource_resv_by_time(resresv_arr, name, start_time);
+
+	resresv = find_resource_resv_idx(idx, resresv_arr, name);
+	if (resresv == NULL)
+		return NULL;
+
+	if (resresv->start == start_time)
+		return resresv;
+
+	return find_resource_resv_by_time(resresv_arr, name, start_time);
+}
+
 /**
  * @brief
  * 		find a resource resv by calling a caller provided comparison function
@@ -1138,12 +1139,12 @@ new_resource_req()
 {
 	resource_req *resreq;
 
-	if ((resreq = (resource_req *) calloc(1, sizeof(resource_req))) == NULL) {
+	if ((resreq = obj_pool_alloc(OBJ_POOL_RESOURCE_REQ)) == NULL) {
 		log_err(errno, __func__, MEM_ERR_MSG);
 		return NULL;
 	}
 
-	/* member type zero'd by calloc() */
+	/* member type zero'd by obj_pool_alloc() */
 
 	resreq->name = NULL;
 	resreq->res_str = NULL;
@@ -1509,7 +1510,7 @@ free_resource_req(resource_req *req)
 	if (req->res_str != NULL)
 		free(req->res_str);
 
-	free(req);
+	obj_pool_free(OBJ_POOL_RESOURCE_REQ, req);
 }
 
 /**
@@ -2070,6 +2071,7 @@ new_place()
 	pl->exclhost = 0;
 
 	pl->group = NULL;
+	pl->refcount = 1;
 
 	return pl;
 }
@@ -2089,6 +2091,9 @@ free_place(place *pl)
 	if (pl == NULL)
 		return;
 
+	if (__atomic_sub_fetch(&pl->refcount, 1, __ATOMIC_ACQ_REL) > 0)
+		return;
+
 	if (pl->group != NULL)
 		free(pl->group);
 
@@ -2130,6 +2135,30 @@ dup_place(place *pl)
 	return newpl;
 }
 
+/**
+ * @brief
+ *		share_place - take another reference on a place structure
+ *
+ * @par	Unlike dup_place(), the returned place is the same object.  It must
+ *	be treated as read-only and released with free_place().  Callers
+ *	who need to modify their copy must use dup_place() instead.
+ *
+ * @param[in]	pl	-	the place structure to share
+ *
+ * @return	pl
+ *
+ */
+place *
+share_place(place *pl)
+{
+	if (pl == NULL)
+		return NULL;
+
+	__atomic_add_fetch(&pl->refcount, 1, __ATOMIC_RELAXED);
+
+	return pl;
+}
+
 /**
  * @brief
  *		new_chunk - constructor for chunk
@@ -2315,6 +2344,7 @@ new_selspec()
 	spec->total_cpus = 0;
 	spec->defs = NULL;
 	spec->chunks = NULL;
+	spec->refcount = 1;
 
 	return spec;
 }
@@ -2354,9 +2384,34 @@ dup_selspec(selspec *oldspec)
 	return newspec;
 }
 
+/**
+ * @brief
+ *		share_selspec - take another reference on a selspec
+ *
+ * @par	Unlike dup_selspec(), the returned selspec is the same object.
+ *	It must be treated as read-only and released with free_selspec().
+ *	Callers who need to modify their copy (e.g., decrementing chunk
+ *	counts while placing) must use dup_selspec() instead.
+ *
+ * @param[in]	spec	-	selspec to share
+ *
+ * @return	spec
+ */
+selspec *
+share_selspec(selspec *spec)
+{
+	if (spec == NULL)
+		return NULL;
+
+	__atomic_add_fetch(&spec->refcount, 1, __ATOMIC_RELAXED);
+
+	return spec;
+}
+
 /**
  * @brief
  *		free_selspec - destructor for selspec
+ *		The spec is only freed once its last reference is released.
  *
  * @param[in,out]	spec	-	selspec to be freed.
  */
@@ -2366,6 +2421,9 @@ free_selspec(selspec *spec)
 	if (spec == NULL)
 		return;
 
+	if (__atomic_sub_fetch(&spec->refcount, 1, __ATOMIC_ACQ_REL) > 0)
+		return;
+
 	if (spec->defs != NULL)
 		free(spec->defs);
 
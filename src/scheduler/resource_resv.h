@@ -110,6 +110,26 @@ resource_resv *find_resource_resv_by_indrank(resource_resv **resresv_arr, int in
  */
 resource_resv *find_resource_resv_by_time(resource_resv **resresv_arr, char *name, time_t start_time);
 
+/*
+ * create an index of resource_resvs by name
+ */
+void *create_resresv_name_idx(resource_resv **resresv_arr);
+
+/*
+ * add a resource_resv to a name index
+ */
+void add_resresv_to_name_idx(void **idx, resource_resv *resresv);
+
+/*
+ * find_resource_resv_idx - find a resource_resv by name using a name index
+ */
+resource_resv *find_resource_resv_idx(void *idx, resource_resv **resresv_arr, char *name);
+
+/*
+ * find a resource_resv by name and start time using a name index
+ */
+resource_resv *find_resource_resv_by_time_idx(void *idx, resource_resv **resresv_arr, char *name, time_t start_time);
+
 /*
  *      find_resource_req - find a resource_req from a resource_req list
  */
@@ -278,6 +298,11 @@ void free_place(place *pl);
  */
 place *dup_place(place *pl);
 
+/*
+ *	share_place - take a read-only reference on a place structure
+ */
+place *share_place(place *pl);
+
 /*
  *	compare_res_to_str - compare a resource structure of type string to
  *			     a character array string
@@ -342,6 +367,11 @@ selspec *new_selspec();
  */
 selspec *dup_selspec(selspec *oldspec);
 
+/*
+ *	share_selspec - take a read-only reference on a selspec
+ */
+selspec *share_selspec(selspec *spec);
+
 /*
  *	free_selspec - destructor for selspec
  */
@@ -373,9 +373,8 @@ query_reservations(int pbs_sd, server_info *sinfo, struct batch_status *resvs)
 				free(jobs_in_reservations);
 
 				/* Sort the nodes to ensure correct job placement. */
-				qsort(resresv->resv->resv_nodes,
-					count_array(resresv->resv->resv_nodes),
-					sizeof(node_info *), multi_node_sort);
+				sort_nodes(resresv->resv->resv_nodes,
+					count_array(resresv->resv->resv_nodes));
 			}
 		}
 		/* The server's info only gives information about a single reservation
@@ -939,7 +938,7 @@ dup_resv_info(resv_info *rinfo, server_info *sinfo)
 	if (rinfo->partition != NULL)
 		nrinfo->partition = string_dup(rinfo->partition);
 	if (rinfo->select_orig != NULL)
-		nrinfo->select_orig = dup_selspec(rinfo->select_orig);
+		nrinfo->select_orig = share_selspec(rinfo->select_orig);
 
 	/* the queues may not be available right now.  If they aren't, we'll
 	 * catch this when we duplicate the queues
@@ -1119,7 +1118,7 @@ check_new_reservations(status *policy, int pbs_sd, resource_resv **resvs, server
 						 * the all_resresv list
 						 */
 						if (nresv->resv->resv_substate == RESV_DEGRADED || nresv->resv->resv_substate == RESV_IN_CONFLICT) {
-							nresv_copy = find_resource_resv_by_time(sinfo->all_resresv,
+							nresv_copy = find_resource_resv_by_time_idx(sinfo->all_resresv_idx, sinfo->all_resresv,
 								nresv_copy->name, nresv->resv->occr_start_arr[j]);
 							if (nresv_copy == NULL) {
 								log_event(PBSEVENT_RESV, PBS_EVENTCLASS_RESV,
@@ -1204,7 +1203,7 @@ check_new_reservations(status *policy, int pbs_sd, resource_resv **resvs, server
 				 */
 				if (nresv->resv->resv_substate == RESV_DEGRADED || nresv->resv->resv_substate == RESV_IN_CONFLICT) {
 					for (j = 0; j < nresv->resv->count; j++) {
-						nresv_copy = find_resource_resv_by_time(sinfo->all_resresv,
+						nresv_copy = find_resource_resv_by_time_idx(sinfo->all_resresv_idx, sinfo->all_resresv,
 							nresv->name, nresv->resv->occr_start_arr[j]);
 						if (nresv_copy == NULL) {
 							log_event(PBSEVENT_RESV, PBS_EVENTCLASS_RESV,
@@ -1419,7 +1418,7 @@ confirm_reservation(status *policy, int pbs_sd, resource_resv *unconf_resv, serv
 			 * is retrieved from the duplicated real server universe
 			 */
 			if (nresv->resv->resv_substate == RESV_DEGRADED || nresv->resv->resv_substate == RESV_IN_CONFLICT) {
-				nresv_copy = find_resource_resv_by_time(nsinfo->all_resresv,
+				nresv_copy = find_resource_resv_by_time_idx(nsinfo->all_resresv_idx, nsinfo->all_resresv,
 					nresv->name, next);
 				if (nresv_copy == NULL) {
 					log_event(PBSEVENT_RESV, PBS_EVENTCLASS_RESV, LOG_INFO, nresv->name,
@@ -1456,6 +1455,7 @@ confirm_reservation(status *policy, int pbs_sd, resource_resv *unconf_resv, serv
 					break;
 				}
 				nsinfo->all_resresv = tmp_resresv;
+				add_resresv_to_name_idx(&nsinfo->all_resresv_idx, nresv);
 				nsinfo->num_resvs++;
 			}
 			/* Concatenate the execvnode to a Token separator */
@@ -53,6 +53,8 @@
  * 	find_alloc_resource_by_str()
  * 	find_resource_by_str()
  * 	find_resource()
+ * 	index_resource_list()
+ * 	free_resource_lookup()
  * 	free_server_info()
  * 	free_resource_list()
  * 	free_resource()
@@ -121,6 +123,7 @@
 #include <sys/wait.h>
 
 #include "pbs_ifl.h"
+#include "pbs_idx.h"
 #include "pbs_error.h"
 #include "log.h"
 #include "tpp.h"
@@ -149,8 +152,10 @@
 #include "pbs_sched.h"
 #include "fifo.h"
 #include "buckets.h"
+#include "cycle_profile.h"
 #include "parse.h"
 #include "hook.h"
+#include "obj_pool.h"
 #ifdef NAS
 #include "site_code.h"
 #endif
@@ -228,6 +233,8 @@ query_server(status *pol, int pbs_sd)
 		free_server(sinfo);
 		return NULL;
 	}
+	if (sinfo->res != NULL)
+		index_resource_list(sinfo->res);
 
 	if (!dflt_sched && (sc_attrs.partition == NULL)) {
 		log_event(PBSEVENT_SCHED, PBS_EVENTCLASS_SERVER, LOG_ERR, __func__, "Scheduler does not contain a partition");
@@ -253,11 +260,11 @@ query_server(status *pol, int pbs_sd)
 		pbs_statfree(bs_resvs);
 		return NULL;
 	}
+	sinfo->nodes_idx = create_node_name_idx(sinfo->nodes);
 
 	/* sort the nodes before we filter them down to more useful lists */
 	if (policy->node_sort[0].res_name != NULL)
-		qsort(sinfo->nodes, sinfo->num_nodes, sizeof(node_info *),
-			multi_node_sort);
+		sort_nodes(sinfo->nodes, sinfo->num_nodes);
 
 	/* get the queues */
 	if ((sinfo->queues = query_queues(policy, pbs_sd, sinfo)) == NULL) {
@@ -268,6 +275,10 @@ query_server(status *pol, int pbs_sd)
 		return NULL;
 	}
 
+	/* all jobs have been queried, drop cached jobs the server no longer has */
+	purge_job_cache();
+	purge_spec_cache();
+
 	if (sinfo->has_nodes_assoc_queue)
 		sinfo->unassoc_nodes =
 			node_filter(sinfo->nodes, sinfo->num_nodes, is_unassoc_node, NULL, 0);
@@ -438,7 +449,9 @@ query_server(status *pol, int pbs_sd)
 	 */
 	create_placement_sets(policy, sinfo);
 
+	prof_phase_start(PROF_NODE_BUCKETS);
 	sinfo->buckets = create_node_buckets(policy, sinfo->nodes, sinfo->queues, UPDATE_BUCKET_IND);
+	prof_phase_end(PROF_NODE_BUCKETS);
 
 	if (sinfo->buckets != NULL) {
 		int ct;
@@ -941,18 +954,112 @@ schd_resource *
 find_resource(schd_resource *reslist, resdef *def)
 {
 	schd_resource *resp;
+	resource_lookup *ind;
 
 	if (reslist == NULL || def == NULL)
 		return NULL;
 
 	resp = reslist;
 
+	/* If the list has been indexed, the resources up to the indexed tail are
+	 * found in the table.  Resources are only ever appended to a list, so
+	 * anything added after indexing is found by walking past the tail.
+	 */
+	ind = reslist->res_ind;
+	if (ind != NULL) {
+		if (def->idx >= 0 && def->idx < ind->num_defs) {
+			resp = ind->res[def->idx];
+			if (resp != NULL && resp->def == def)
+				return resp;
+		}
+		resp = ind->tail->next;
+	}
+
 	while (resp != NULL && resp->def != def)
 		resp = resp->next;
 
 	return resp;
 }
 
+/**
+ * @brief
+ * 		build a dense lookup table on the head of a resource list so
+ *		find_resource() does not need to walk the list.  An existing
+ *		table is rebuilt only if resources were appended since it was built.
+ *
+ * @param[in,out]	reslist	-	resource list to index
+ *
+ * @return	int
+ * @retval	1	: success
+ * @retval	0	: failure - the list is left unindexed
+ *
+ * @par MT-Safe:	yes - as long as reslist is only used by one thread
+ */
+int
+index_resource_list(schd_resource *reslist)
+{
+	schd_resource *resp;
+	schd_resource *tail = NULL;
+	resource_lookup *ind;
+	int num_defs = 0;
+
+	if (reslist == NULL)
+		return 0;
+
+	if (reslist->res_ind != NULL && reslist->res_ind->tail->next == NULL)
+		return 1;
+
+	free_resource_lookup(reslist->res_ind);
+	reslist->res_ind = NULL;
+
+	for (resp = reslist; resp != NULL; resp = resp->next) {
+		if (resp->def != NULL && resp->def->idx >= num_defs)
+			num_defs = resp->def->idx + 1;
+		tail = resp;
+	}
+
+	if ((ind = malloc(sizeof(resource_lookup))) == NULL) {
+		log_err(errno, __func__, MEM_ERR_MSG);
+		return 0;
+	}
+	if ((ind->res = calloc(num_defs + 1, sizeof(schd_resource *))) == NULL) {
+		log_err(errno, __func__, MEM_ERR_MSG);
+		free(ind);
+		return 0;
+	}
+	ind->num_defs = num_defs;
+	ind->tail = tail;
+
+	/* like a list walk, the first resource with a definition wins */
+	for (resp = reslist; resp != NULL; resp = resp->next) {
+		if (resp->def != NULL && resp->def->idx >= 0 &&
+			ind->res[resp->def->idx] == NULL)
+			ind->res[resp->def->idx] = resp;
+	}
+
+	reslist->res_ind = ind;
+
+	return 1;
+}
+
+/**
+ * @brief
+ * 		free a resource list lookup table
+ *
+ * @param[in]	ind	-	table to free
+ *
+ * @return	void
+ */
+void
+free_resource_lookup(resource_lookup *ind)
+{
+	if (ind == NULL)
+		return;
+
+	free(ind->res);
+	free(ind);
+}
+
 /**
  * @brief
  * 		free_server_info - free the space used by a server_info
@@ -973,6 +1080,12 @@ free_server_info(server_info *sinfo)
 		free(sinfo->jobs);
 	if (sinfo->all_resresv != NULL)
 		free(sinfo->all_resresv);
+	if (sinfo->jobs_idx != NULL)
+		pbs_idx_destroy(sinfo->jobs_idx);
+	if (sinfo->all_resresv_idx != NULL)
+		pbs_idx_destroy(sinfo->all_resresv_idx);
+	if (sinfo->nodes_idx != NULL)
+		pbs_idx_destroy(sinfo->nodes_idx);
 	if (sinfo->running_jobs != NULL)
 		free(sinfo->running_jobs);
 	if (sinfo->exiting_jobs != NULL)
@@ -1091,7 +1204,9 @@ free_resource(schd_resource *resp)
 	if (resp->str_assigned != NULL)
 		free(resp->str_assigned);
 
-	free(resp);
+	free_resource_lookup(resp->res_ind);
+
+	obj_pool_free(OBJ_POOL_SCHD_RESOURCE, resp);
 }
 
 /**
@@ -1144,11 +1259,14 @@ new_server_info(int limallocflag)
 	sinfo->queues = NULL;
 	sinfo->queue_list = NULL;
 	sinfo->jobs = NULL;
+	sinfo->jobs_idx = NULL;
 	sinfo->all_resresv = NULL;
+	sinfo->all_resresv_idx = NULL;
 	sinfo->calendar = NULL;
 	sinfo->running_jobs = NULL;
 	sinfo->exiting_jobs = NULL;
 	sinfo->nodes = NULL;
+	sinfo->nodes_idx = NULL;
 	sinfo->unassoc_nodes = NULL;
 	sinfo->resvs = NULL;
 	sinfo->alljobcounts = NULL;
@@ -1206,12 +1324,12 @@ new_resource()
 {
 	schd_resource *resp;		/* the new resource */
 
-	if ((resp = calloc(1,  sizeof(schd_resource))) == NULL) {
+	if ((resp = obj_pool_alloc(OBJ_POOL_SCHD_RESOURCE)) == NULL) {
 		log_err(errno, __func__, MEM_ERR_MSG);
 		return NULL;
 	}
 
-	/* member type zero'd by calloc() */
+	/* member type zero'd by obj_pool_alloc() */
 
 	resp->name = NULL;
 	resp->next = NULL;
@@ -1221,6 +1339,7 @@ new_resource()
 	resp->indirect_res = NULL;
 	resp->str_avail = NULL;
 	resp->str_assigned = NULL;
+	resp->res_ind = NULL;
 	resp->assigned = RES_DEFAULT_ASSN;
 	resp->avail = RES_DEFAULT_AVAIL;
 
@@ -1651,16 +1770,13 @@ update_server_on_run(status *policy, server_info *sinfo,
 
 				resv_nodes = resresv->job->resv->resv->resv_nodes;
 				num_resv_nodes = count_array(resv_nodes);
-				qsort(resv_nodes, num_resv_nodes, sizeof(node_info *),
-					multi_node_sort);
+				sort_nodes(resv_nodes, num_resv_nodes);
 			} else {
-				qsort(sinfo->nodes, sinfo->num_nodes, sizeof(node_info *),
-					multi_node_sort);
+				sort_nodes(sinfo->nodes, sinfo->num_nodes);
 
 				if (sinfo->nodes != sinfo->unassoc_nodes) {
 					num_unassoc = count_array(sinfo->unassoc_nodes);
-					qsort(sinfo->unassoc_nodes, num_unassoc, sizeof(node_info *),
-						multi_node_sort);
+					sort_nodes(sinfo->unassoc_nodes, num_unassoc);
 				}
 			}
 		}
@@ -1880,6 +1996,10 @@ copy_server_arrays(server_info *nsinfo, server_info *osinfo)
 	nsinfo->jobs = job_arr;
 	nsinfo->all_resresv = all_arr;
 	nsinfo->num_resvs = osinfo->num_resvs;
+
+	nsinfo->jobs_idx = create_resresv_name_idx(job_arr);
+	nsinfo->all_resresv_idx = create_resresv_name_idx(all_arr);
+
 	return 1;
 }
 
@@ -1968,6 +2088,10 @@ create_server_arrays(server_info *sinfo)
 	sinfo->jobs = job_arr;
 	sinfo->all_resresv = all_arr;
 
+	/* if we fail to create an index, lookups fall back to array scans */
+	sinfo->jobs_idx = create_resresv_name_idx(job_arr);
+	sinfo->all_resresv_idx = create_resresv_name_idx(all_arr);
+
 	return 1;
 }
 
@@ -2190,6 +2314,8 @@ dup_server_info(server_info *osinfo)
 	nsinfo->server_time = osinfo->server_time;
 	nsinfo->flt_lic = osinfo->flt_lic;
 	nsinfo->res = dup_resource_list(osinfo->res);
+	if (nsinfo->res != NULL)
+		index_resource_list(nsinfo->res);
 	nsinfo->alljobcounts = dup_counts_list(osinfo->alljobcounts);
 	nsinfo->group_counts = dup_counts_list(osinfo->group_counts);
 	nsinfo->project_counts = dup_counts_list(osinfo->project_counts);
@@ -2207,6 +2333,7 @@ dup_server_info(server_info *osinfo)
 
 	/* dup the nodes, if there are any nodes */
 	nsinfo->nodes = dup_nodes(osinfo->nodes, nsinfo, NO_FLAGS);
+	nsinfo->nodes_idx = create_node_name_idx(nsinfo->nodes);
 
 	if (nsinfo->has_nodes_assoc_queue) {
 		nsinfo->unassoc_nodes =
@@ -2278,7 +2405,7 @@ dup_server_info(server_info *osinfo)
 	nsinfo->num_preempted = osinfo->num_preempted;
 
 	if (osinfo->qrun_job != NULL)
-		nsinfo->qrun_job = find_resource_resv(nsinfo->jobs,
+		nsinfo->qrun_job = find_resource_resv_idx(nsinfo->jobs_idx, nsinfo->jobs,
 			osinfo->qrun_job->name);
 
 	for (i = 0; i < NUM_PPRIO; i++)
@@ -2334,7 +2461,7 @@ dup_server_info(server_info *osinfo)
 		nsinfo->nodes[i]->np_arr =
 			copy_node_partition_ptr_array(osinfo->nodes[i]->np_arr, nsinfo->nodepart);
 		if (nsinfo->calendar != NULL)
-			nsinfo->nodes[i]->node_events = dup_te_lists(osinfo->nodes[i]->node_events, nsinfo->calendar->next_event);
+			nsinfo->nodes[i]->node_events = dup_te_lists(osinfo->nodes[i]->node_events, nsinfo);
 	}
 	nsinfo->buckets = dup_node_bucket_array(osinfo->buckets, nsinfo);
 	/* Now that all job information has been created, time to associate
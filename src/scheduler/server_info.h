@@ -88,6 +88,16 @@ schd_resource *find_resource_by_str(schd_resource *reslist, const char *name);
  */
 schd_resource *find_resource(schd_resource *reslist, resdef *def);
 
+/*
+ *	index_resource_list - build a resdef index lookup table on a resource list
+ */
+int index_resource_list(schd_resource *reslist);
+
+/*
+ *	free_resource_lookup - free a resource list lookup table
+ */
+void free_resource_lookup(resource_lookup *ind);
+
 /*
  *	free_server_info - free the space used by a server_info structure
  */
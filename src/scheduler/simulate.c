@@ -71,7 +71,9 @@
  * 	free_timed_event_list()
  * 	add_event()
  * 	add_timed_event()
+ * 	remove_timed_event()
  * 	delete_event()
+ * 	calendar_has_pending_event()
  * 	create_event()
  * 	determine_event_name()
  * 	dedtime_change()
@@ -109,6 +111,7 @@
 #include "globals.h"
 #include "check.h"
 #include "buckets.h"
+#include "obj_pool.h"
 #ifdef NAS /* localmod 030 */
 #include "site_code.h"
 #endif /* localmod 030 */
@@ -722,7 +725,7 @@ calc_run_time(char *name, server_info *sinfo, int flags)
 	event_time = sinfo->server_time;
 	calendar = sinfo->calendar;
 
-	resresv = find_resource_resv(sinfo->all_resresv, name);
+	resresv = find_resource_resv_idx(sinfo->all_resresv_idx, sinfo->all_resresv, name);
 
 	if (!is_resource_resv_valid(resresv, NULL))
 		return (time_t) -1;
@@ -834,7 +837,7 @@ create_event_list(server_info *sinfo)
 	if (elist == NULL)
 		return NULL;
 
-	elist->events = create_events(sinfo);
+	create_events(sinfo, elist);
 
 	elist->next_event = elist->events;
 	elist->first_run_event = find_timed_event(elist->events, 0, NULL, TIMED_RUN_EVENT, 0);
@@ -846,18 +849,20 @@ create_event_list(server_info *sinfo)
 
 /**
  * @brief
- *		create_events - creates an timed_event list from running jobs
+ *		create_events - fill a calendar with events from running jobs
  *			    and confirmed reservations
  *
  * @param[in] sinfo - server universe to act upon
+ * @param[in,out] calendar - empty calendar to add the events to
  *
- * @return	timed_event list
+ * @return	int
+ * @retval	1	: success
+ * @retval	0	: failure, calendar is left empty
  *
  */
-timed_event *
-create_events(server_info *sinfo)
+int
+create_events(server_info *sinfo, event_list *calendar)
 {
-	timed_event	*events = NULL;
 	timed_event	*te = NULL;
 	resource_resv	**all = NULL;
 	int		errflag = 0;
@@ -872,8 +877,10 @@ create_events(server_info *sinfo)
 	 */
 	all_resresv_len = count_array(sinfo->all_resresv);
 	all_resresv_copy = malloc((all_resresv_len + 1) * sizeof(resource_resv *));
-	if (all_resresv_copy == NULL)
+	if (all_resresv_copy == NULL) {
+		log_err(errno, __func__, MEM_ERR_MSG);
 		return 0;
+	}
 	for (i = 0; sinfo->all_resresv[i] != NULL; i++)
 		all_resresv_copy[i] = sinfo->all_resresv[i];
 	all_resresv_copy[i] = NULL;
@@ -888,11 +895,11 @@ create_events(server_info *sinfo)
 		 */
 		if (in_runnable_state(all[i])) {
 			te = create_event(TIMED_RUN_EVENT, all[i]->start, all[i], NULL, NULL);
-			if (te == NULL) {
+			if (te == NULL || !add_timed_event(calendar, te)) {
+				free_timed_event(te);
 				errflag++;
 				break;
 			}
-			events = add_timed_event(events, te);
 		}
 
 		if (sinfo->use_hard_duration)
@@ -900,11 +907,11 @@ create_events(server_info *sinfo)
 		else
 			end = all[i]->end;
 		te = create_event(TIMED_END_EVENT, end, all[i], NULL, NULL);
-		if (te == NULL) {
+		if (te == NULL || !add_timed_event(calendar, te)) {
+			free_timed_event(te);
 			errflag++;
 			break;
 		}
-		events = add_timed_event(events, te);
 	}
 
 	/* for nodes that are in state=sleep add a timed event */
@@ -913,23 +920,26 @@ create_events(server_info *sinfo)
 		if (node->is_sleeping) {
 			te = create_event(TIMED_NODE_UP_EVENT, sinfo->server_time + PROVISION_DURATION,
 					(event_ptr_t *) node, (event_func_t) node_up_event, NULL);
-			if (te == NULL) {
+			if (te == NULL || !add_timed_event(calendar, te)) {
+				free_timed_event(te);
 				errflag++;
 				break;
 			}
-			events = add_timed_event(events, te);
 		}
 	}
 
 	/* A malloc error was encountered, free all allocated memory and return */
 	if (errflag > 0) {
-		free_timed_event_list(events);
+		free_timed_event_list(calendar->events);
+		calendar->events = NULL;
+		memset(calendar->skip_head, 0, sizeof(calendar->skip_head));
+		calendar->skip_top = 1;
 		free(all_resresv_copy);
 		return 0;
 	}
 
 	free(all_resresv_copy);
-	return events;
+	return 1;
 }
 
 /**
@@ -954,6 +964,9 @@ new_event_list()
 	elist->next_event = NULL;
 	elist->first_run_event = NULL;
 	elist->current_time = NULL;
+	memset(elist->skip_head, 0, sizeof(elist->skip_head));
+	elist->skip_top = 1;
+	elist->skip_seed = 0x9e3779b9;
 
 	return elist;
 }
@@ -983,20 +996,17 @@ dup_event_list(event_list *oelist, server_info *nsinfo)
 
 	nelist->eol = oelist->eol;
 	nelist->current_time = &nsinfo->server_time;
+	nelist->skip_seed = oelist->skip_seed;
 
+	/* dup_timed_event_list() also maps next_event and first_run_event */
 	if (oelist->events != NULL) {
-		nelist->events = dup_timed_event_list(oelist->events, nsinfo);
-		if (nelist->events == NULL) {
+		if (dup_timed_event_list(oelist, nelist, nsinfo) == 0) {
 			free_event_list(nelist);
 			return NULL;
 		}
 	}
 
 	if (oelist->next_event != NULL) {
-		nelist->next_event = find_timed_event(nelist->events, 0,
-			oelist->next_event->name,
-			oelist->next_event->event_type,
-			oelist->next_event->event_time);
 		if (nelist->next_event == NULL) {
 			log_event(PBSEVENT_SCHED, PBS_EVENTCLASS_SCHED, LOG_WARNING,
 			oelist->next_event->name, "can't find next event in duplicated list");
@@ -1006,11 +1016,6 @@ dup_event_list(event_list *oelist, server_info *nsinfo)
 	}
 
 	if (oelist->first_run_event != NULL) {
-		nelist->first_run_event =
-		    find_timed_event(nelist->events, 0,
-				     oelist->first_run_event->name,
-				     TIMED_RUN_EVENT,
-				     oelist->first_run_event->event_time);
 		if (nelist->first_run_event == NULL) {
 			log_event(PBSEVENT_SCHED, PBS_EVENTCLASS_SCHED, LOG_WARNING, oelist->first_run_event->name,
 				"can't find first run event event in duplicated list");
@@ -1065,6 +1070,8 @@ new_timed_event()
 	te->event_func_arg = NULL;
 	te->next = NULL;
 	te->prev = NULL;
+	te->skip_lvl = 1;
+	te->skip_next = NULL;
 
 	return te;
 }
@@ -1110,7 +1117,7 @@ dup_timed_event(timed_event *ote, server_info *nsinfo)
 te_list *
 new_te_list() {
 	te_list *tel;
-	tel = malloc(sizeof(te_list));
+	tel = obj_pool_alloc(OBJ_POOL_TE_LIST);
 
 	if(tel == NULL) {
 		log_err(errno, __func__, MEM_ERR_MSG);
@@ -1134,29 +1141,42 @@ free_te_list(te_list *tel) {
 	if(tel == NULL)
 		return;
 	free_te_list(tel->next);
-	free(tel);
+	obj_pool_free(OBJ_POOL_TE_LIST, tel);
 }
 
 /*
  * @brief te_list copy constructor
  * @param[in] ote - te_list to copy
- * @param[in] new_timed_even_list - new timed events
+ * @param[in] nsinfo - new universe whose calendar holds the new timed events
  *
  * @return copied te_list
  */
 te_list *
-dup_te_list(te_list *ote, timed_event *new_timed_event_list)
+dup_te_list(te_list *ote, server_info *nsinfo)
 {
 	te_list *nte;
+	timed_event *oev;
+	resource_resv *nresresv;
 
-	if(ote == NULL || new_timed_event_list == NULL)
+	if(ote == NULL || nsinfo == NULL || nsinfo->calendar == NULL)
 		return NULL;
 
 	nte = new_te_list();
 	if(nte == NULL)
 		return NULL;
 
-	nte->event = find_timed_event(new_timed_event_list, 0, ote->event->name, ote->event->event_type, ote->event->event_time);
+	oev = ote->event;
+	/* run and end events hang off their resource_resv, so look them up there
+	 * rather than walking the calendar for them
+	 */
+	if (oev->event_type == TIMED_RUN_EVENT || oev->event_type == TIMED_END_EVENT) {
+		nresresv = (resource_resv *) find_event_ptr(oev, nsinfo);
+		if (nresresv != NULL)
+			nte->event = (oev->event_type == TIMED_RUN_EVENT) ?
+				nresresv->run_event : nresresv->end_event;
+	}
+	if (nte->event == NULL)
+		nte->event = find_timed_event(nsinfo->calendar->next_event, 0, oev->name, oev->event_type, oev->event_time);
 
 	return nte;
 }
@@ -1164,23 +1184,23 @@ dup_te_list(te_list *ote, timed_event *new_timed_event_list)
 /*
  * @brief copy constructor for a list of te_list structures
  * @param[in] ote - te_list to copy
- * @param[in] new_timed_even_list - new timed events
+ * @param[in] nsinfo - new universe whose calendar holds the new timed events
  *
  * @return copied te_list list
  */
 
 te_list *
-dup_te_lists(te_list *ote, timed_event *new_timed_event_list) {
+dup_te_lists(te_list *ote, server_info *nsinfo) {
 	te_list *nte;
 	te_list *end_te = NULL;
 	te_list *cur;
 	te_list *nte_head = NULL;
 
-	if (ote == NULL || new_timed_event_list == NULL)
+	if (ote == NULL || nsinfo == NULL || nsinfo->calendar == NULL)
 		return NULL;
 
 	for(cur = ote; cur != NULL; cur = cur->next) {
-		nte = dup_te_list(cur, new_timed_event_list);
+		nte = dup_te_list(cur, nsinfo);
 		if (nte == NULL) {
 			free_te_list(nte_head);
 			return NULL;
@@ -1292,8 +1312,8 @@ find_event_ptr(timed_event *ote, server_info *nsinfo)
 			oep = (resource_resv *) ote->event_ptr;
 			if (oep->is_resv)
 				event_ptr =
-					find_resource_resv_by_time(nsinfo->all_resresv,
-					oep->name, oep->start);
+					find_resource_resv_by_time_idx(nsinfo->all_resresv_idx,
+					nsinfo->all_resresv, oep->name, oep->start);
 			else
 				/* In case of jobs there can be only one occurance of job in
 				 * all_resresv list, so no need to search using start time of job
@@ -1314,7 +1334,7 @@ find_event_ptr(timed_event *ote, server_info *nsinfo)
 			break;
 		case TIMED_NODE_DOWN_EVENT:
 		case TIMED_NODE_UP_EVENT:
-			event_ptr = find_node_info(nsinfo->nodes,
+			event_ptr = find_node_info_idx(nsinfo->nodes_idx, nsinfo->nodes,
 				((node_info*)(ote->event_ptr))->name);
 			break;
 		default:
@@ -1327,38 +1347,103 @@ find_event_ptr(timed_event *ote, server_info *nsinfo)
 
 /**
  * @brief
- *		dup_timed_event_list() - timed_event copy constructor for a list
+ *		calendar_link - address of an event's forward link on a skip list level
+ *
+ * @param[in]	calendar - calendar the event is in
+ * @param[in]	te       - the event or NULL for the head of the calendar
+ * @param[in]	lvl      - skip list level (level 0 is the next list itself)
+ *
+ * @return	timed_event **
+ */
+static timed_event **
+calendar_link(event_list *calendar, timed_event *te, int lvl)
+{
+	if (lvl == 0)
+		return te == NULL ? &calendar->events : &te->next;
+
+	return te == NULL ? &calendar->skip_head[lvl] : &te->skip_next[lvl - 1];
+}
+
+/**
+ * @brief
+ *		set_event_level - put a timed event on the given number of skip list
+ *			      levels by allocating its forward links
+ *
+ * @param[in,out]	te  - the event
+ * @param[in]	lvl - number of levels (1 .. CALENDAR_SKIP_LEVELS)
+ *
+ * @return	int
+ * @retval	1	: success
+ * @retval	0	: malloc failure
+ */
+static int
+set_event_level(timed_event *te, int lvl)
+{
+	free(te->skip_next);
+	te->skip_next = NULL;
+	te->skip_lvl = 1;
+
+	if (lvl > 1) {
+		if ((te->skip_next = calloc(lvl - 1, sizeof(timed_event *))) == NULL) {
+			log_err(errno, __func__, MEM_ERR_MSG);
+			return 0;
+		}
+		te->skip_lvl = lvl;
+	}
+
+	return 1;
+}
+
+/**
+ * @brief
+ *		dup_timed_event_list() - copy the events of one calendar into another
  *
- * @param[in]	ote_list 	- list of timed_events to copy
+ * @par
+ *		The events are appended in order and keep the skip list level they had
+ *		in the old calendar, so the copy is a single linear pass with no
+ *		searching.  The new calendar's next_event and first_run_event are set
+ *		to the copies of the old calendar's ones along the way.
+ *
+ * @param[in]	oelist 	- calendar whose events to copy
+ * @param[in,out]	nelist	- empty calendar to copy the events into
  * @param[in]	nsinfo		- "new" universe where to find the event_ptr
  *
- * @return	timed_event *
- * @retval	NULL	: one of the input is null
+ * @return	int
+ * @retval	1	: success
+ * @retval	0	: failure
  */
-timed_event *
-dup_timed_event_list(timed_event *ote_list, server_info *nsinfo)
+int
+dup_timed_event_list(event_list *oelist, event_list *nelist, server_info *nsinfo)
 {
 	timed_event *ote;
-	timed_event *nte = NULL;
-	timed_event *nte_prev = NULL;
-	timed_event *nte_head = NULL;
+	timed_event *nte;
+	timed_event *tail[CALENDAR_SKIP_LEVELS] = {NULL};
+	int i;
 
-	if (ote_list == NULL || nsinfo == NULL)
-		return NULL;
+	if (oelist == NULL || nelist == NULL || nsinfo == NULL)
+		return 0;
 
-	for (ote = ote_list; ote != NULL; ote = ote->next) {
+	for (ote = oelist->events; ote != NULL; ote = ote->next) {
 		nte = dup_timed_event(ote, nsinfo);
+		if (nte == NULL || !set_event_level(nte, ote->skip_lvl)) {
+			free_timed_event(nte);
+			return 0;
+		}
 
-		if (nte_prev != NULL)
-			nte_prev->next = nte;
-		else
-			nte_head = nte;
-		nte->prev = nte_prev;
+		nte->prev = tail[0];
+		for (i = 0; i < nte->skip_lvl; i++) {
+			*calendar_link(nelist, tail[i], i) = nte;
+			tail[i] = nte;
+		}
 
-		nte_prev = nte;
+		if (ote == oelist->next_event)
+			nelist->next_event = nte;
+		if (ote == oelist->first_run_event)
+			nelist->first_run_event = nte;
 	}
+	nelist->skip_top = oelist->skip_top;
 
-	return nte_head;
+	return 1;
 }
 
 /**
@@ -1379,6 +1464,7 @@ free_timed_event(timed_event *te)
 			((resource_resv *)te->event_ptr)->end_event = NULL;
 	}
 
+	free(te->skip_next);
 	free(te);
 }
 
@@ -1431,7 +1517,8 @@ add_event(event_list *calendar, timed_event *te)
 	if (calendar->events == NULL)
 		events_is_null = 1;
 
-	calendar->events = add_timed_event(calendar->events, te);
+	if (!add_timed_event(calendar, te))
+		return 0;
 
 	/* empty event list - the new event is the only event */
 	if (events_is_null)
@@ -1444,9 +1531,12 @@ add_event(event_list *calendar, timed_event *te)
 			if (te->event_time < calendar->next_event->event_time)
 				calendar->next_event = te;
 			else if (te->event_time == calendar->next_event->event_time) {
-				calendar->next_event =
-					find_timed_event(calendar->events, 0, NULL,
-					TIMED_NOEVENT, te->event_time);
+				/* move back to the first event at this time */
+				timed_event *first = te;
+
+				while (first->prev != NULL && first->prev->event_time == te->event_time)
+					first = first->prev;
+				calendar->next_event = first;
 			}
 		}
 	}
@@ -1469,54 +1559,148 @@ add_event(event_list *calendar, timed_event *te)
 
 /**
  * @brief
- * 		add_timed_event - add an event to a sorted list of events
+ *		event_goes_before - does a new event sort before an event
+ *				    already in the calendar
+ *
+ * @note
+ *		if multiple events are at the same time, all end events come
+ *		first.  A new end event goes in front of every event at its time
+ *		and any other new event goes after them.
+ *
+ * @param[in]	te - new event
+ * @param[in]	e  - event in the calendar
+ *
+ * @return	int
+ * @retval	1	: te sorts before e
+ * @retval	0	: te sorts after e
+ */
+static int
+event_goes_before(timed_event *te, timed_event *e)
+{
+	if (e->event_time != te->event_time)
+		return e->event_time > te->event_time;
+
+	return te->event_type == TIMED_END_EVENT;
+}
+
+/**
+ * @brief
+ * 		add_timed_event - add an event to a calendar in sorted order
+ *
+ * @par
+ *		The calendar is a doubly linked list of events with a skip list
+ *		index over it, so the insert is O(log n) instead of a walk over
+ *		every event in front of it.  Each event is put on a random number
+ *		of skip list levels, each level holding roughly a quarter of the
+ *		events of the level below.
  *
  * @note
  *		ASSUMPTION: if multiple events are at the same time, all
  *		    end events will come first
  *
- * @param	events - event list to add event to
- * @param 	te     - timed_event to add to list
+ * @param[in,out]	calendar - calendar to add event to
+ * @param[in]	te       - timed_event to add to calendar
  *
- * @return	head of timed_event list
+ * @return	int
+ * @retval	1	: success
+ * @retval	0	: failure
  */
-timed_event *
-add_timed_event(timed_event *events, timed_event *te)
+int
+add_timed_event(event_list *calendar, timed_event *te)
 {
-	timed_event *eloop;
-	timed_event *eloop_prev = NULL;
+	timed_event *update[CALENDAR_SKIP_LEVELS];
+	timed_event *x = NULL;
+	timed_event *nx;
+	timed_event **link;
+	unsigned int r;
+	int lvl;
+	int i;
 
-	if (te == NULL)
-		return events;
+	if (calendar == NULL || te == NULL)
+		return 0;
 
-	if (events == NULL)
-		return te;
+	/* xorshift: two bits of randomness per level */
+	r = calendar->skip_seed;
+	r ^= r << 13;
+	r ^= r >> 17;
+	r ^= r << 5;
+	calendar->skip_seed = r;
+	for (lvl = 1; lvl < CALENDAR_SKIP_LEVELS && (r & 3) == 0; lvl++)
+		r >>= 2;
 
-	for (eloop = events; eloop != NULL; eloop = eloop->next) {
-		if (eloop->event_time > te->event_time)
-			break;
-		if (eloop->event_time == te->event_time &&
-			te->event_type == TIMED_END_EVENT) {
-			break;
-		}
+	if (!set_event_level(te, lvl))
+		return 0;
 
-		eloop_prev = eloop;
+	for (i = calendar->skip_top - 1; i >= 0; i--) {
+		while ((nx = *calendar_link(calendar, x, i)) != NULL && !event_goes_before(te, nx))
+			x = nx;
+		update[i] = x;
 	}
+	for (i = calendar->skip_top; i < lvl; i++)
+		update[i] = NULL;
+	if (lvl > calendar->skip_top)
+		calendar->skip_top = lvl;
+
+	for (i = 0; i < lvl; i++) {
+		link = calendar_link(calendar, update[i], i);
+		*calendar_link(calendar, te, i) = *link;
+		*link = te;
+	}
+
+	te->prev = update[0];
+	if (te->next != NULL)
+		te->next->prev = te;
+
+	return 1;
+}
+
+/**
+ * @brief
+ * 		remove_timed_event - unlink an event from a calendar without
+ *				     freeing it
+ *
+ * @param[in,out]	calendar - calendar to remove event from
+ * @param[in]	e        - event to remove
+ *
+ * @return	void
+ */
+void
+remove_timed_event(event_list *calendar, timed_event *e)
+{
+	timed_event *x = NULL;
+	timed_event *nx;
+	int i;
+
+	if (calendar == NULL || e == NULL)
+		return;
 
-	if (eloop_prev == NULL) {
-		te->next = events;
-		events->prev = te;
-		te->prev = NULL;
-		return te;
+	/* most events are only on level 0 and the prev link is all we need */
+	if (e->skip_lvl > 1) {
+		for (i = calendar->skip_top - 1; i >= 1; i--) {
+			/* stop in front of e's time on levels e is not on */
+			while ((nx = *calendar_link(calendar, x, i)) != NULL && nx != e &&
+				(nx->event_time < e->event_time ||
+				(i < e->skip_lvl && nx->event_time == e->event_time)))
+				x = nx;
+			if (nx == e)
+				*calendar_link(calendar, x, i) = e->skip_next[i - 1];
+		}
+		while (calendar->skip_top > 1 && calendar->skip_head[calendar->skip_top - 1] == NULL)
+			calendar->skip_top--;
 	}
 
-	te->next = eloop;
-	eloop_prev->next = te;
-	te->prev = eloop_prev;
-	if (eloop != NULL)
-		eloop->prev = te;
+	if (e->prev == NULL)
+		calendar->events = e->next;
+	else
+		e->prev->next = e->next;
+
+	if (e->next != NULL)
+		e->next->prev = e->prev;
 
-	return events;
+	e->next = NULL;
+	e->prev = NULL;
+	if (e->skip_next != NULL)
+		memset(e->skip_next, 0, (e->skip_lvl - 1) * sizeof(timed_event *));
 }
 
 /**
@@ -1542,20 +1726,51 @@ delete_event(server_info *sinfo, timed_event *e)
 	if (calendar->next_event == e)
 		calendar->next_event = e->next;
 
+	/* first_run_event is the first run event in calendar order */
 	if (calendar->first_run_event == e)
-		calendar->first_run_event = find_timed_event(calendar->events, 0, NULL, TIMED_RUN_EVENT, 0);
-
-	if (e->prev == NULL)
-		calendar->events = e->next;
-	else
-		e->prev->next = e->next;
+		calendar->first_run_event = find_timed_event(e->next, 0, NULL, TIMED_RUN_EVENT, 0);
 
-	if (e->next != NULL)
-		e->next->prev = e->prev;
+	remove_timed_event(calendar, e);
 
 	free_timed_event(e);
 }
 
+/**
+ * @brief
+ *		calendar_has_pending_event - is an event still ahead in the calendar
+ *
+ * @par
+ *		Used instead of a by-name search of the calendar: the run and end
+ *		events of a resource_resv are hung off it, so callers pass those in
+ *		and only the events at the same time as the current event are walked.
+ *
+ * @param[in]	calendar - the calendar
+ * @param[in]	te       - the event (may be NULL)
+ *
+ * @return	int
+ * @retval	1	: te is enabled and is at or after the calendar's next event
+ * @retval	0	: otherwise
+ */
+int
+calendar_has_pending_event(event_list *calendar, timed_event *te)
+{
+	timed_event *e;
+
+	if (calendar == NULL || te == NULL || te->disabled)
+		return 0;
+
+	e = calendar->next_event;
+	if (e == NULL || te->event_time < e->event_time)
+		return 0;
+	if (te->event_time > e->event_time)
+		return 1;
+
+	for (; e != NULL && e->event_time == te->event_time; e = e->next)
+		if (e == te)
+			return 1;
+
+	return 0;
+}
 
 /**
  * @brief
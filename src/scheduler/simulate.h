@@ -193,15 +193,15 @@ int exists_resv_event(event_list *calendar, time_t end);
 
 
 /*
- *      create_events - creates an timed_event list from running jobs
+ *      create_events - fill a calendar with events from running jobs
  *                          and confirmed reservations
  *
  *        \param sinfo - server universe to act upon
- *        \param flags -
+ *        \param calendar - empty calendar to add the events to
  *
- *        \return timed_event list
+ *        \return 1 success / 0 failure
  */
-timed_event *create_events(server_info *sinfo);
+int create_events(server_info *sinfo, event_list *calendar);
 
 /*
  * new_event_list() - event_list constructor
@@ -245,12 +245,15 @@ timed_event *new_timed_event();
 timed_event *dup_timed_event(timed_event *ote, server_info *nsinfo);
 
 /*
- *      dup_timed_event_list() - timed_event copy constructor for a list
+ *      dup_timed_event_list() - copy the events of one calendar into another
  *
- *        \param ote_list - list of timed_events to copy
+ *        \param oelist - calendar whose events to copy
+ *        \param nelist - empty calendar to copy the events into
  *        \param nsinfo - "new" universe where to find the event_ptr
+ *
+ *      \return 1 success / 0 failure
  */
-timed_event *dup_timed_event_list(timed_event *ote_list, server_info *nsinfo);
+int dup_timed_event_list(event_list *oelist, event_list *nelist, server_info *nsinfo);
 
 /*
  * free_timed_event - timed_event destructor
@@ -296,17 +299,22 @@ timed_event *find_event_by_name(timed_event *events, char *name);
 
 
 /*
- *      add_timed_event - add an event to a sorted list of events
+ *      add_timed_event - add an event to a calendar in sorted order
  *
  *      ASSUMPTION: if multiple events are at the same time, all
  *                  end events will come first
  *
- *        \param events - event list to add event to
- *        \param te     - timed_event to add to list
+ *        \param calendar - calendar to add event to
+ *        \param te       - timed_event to add to calendar
  *
- *      \return head of timed_event list
+ *      \return 1 success / 0 failure
+ */
+int add_timed_event(event_list *calendar, timed_event *te);
+
+/*
+ *	remove_timed_event - unlink an event from a calendar without freeing it
  */
-timed_event *add_timed_event(timed_event *events, timed_event *te);
+void remove_timed_event(event_list *calendar, timed_event *e);
 /*
  *
  *	add_event - add a timed_event to an event list
@@ -324,6 +332,12 @@ int add_event(event_list *calendar, timed_event *te);
  */
 void delete_event(server_info *sinfo, timed_event *e);
 
+/*
+ *	calendar_has_pending_event - is an event enabled and at or after
+ *				     the calendar's next event
+ */
+int calendar_has_pending_event(event_list *calendar, timed_event *te);
+
 /*
  *      create_event - create a timed_event with the passed in arguemtns
  *
@@ -449,8 +463,8 @@ generic_sim(event_list *calendar, unsigned int event_mask, time_t end, int defau
 
 te_list *new_te_list();
 
-te_list *dup_te_list(te_list *ote, timed_event *new_timed_event_list);
-te_list *dup_te_lists(te_list *ote, timed_event *new_timed_event_list);
+te_list *dup_te_list(te_list *ote, server_info *nsinfo);
+te_list *dup_te_lists(te_list *ote, server_info *nsinfo);
 
 void free_te_list(te_list *tel);
 
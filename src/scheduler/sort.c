@@ -71,6 +71,16 @@
  * 	cmp_job_preemption_time_asc()
  * 	cmp_starving_jobs()
  * 	sort_jobs()
+ * 	count_sort_keys()
+ * 	fill_node_sort_keys()
+ * 	fill_job_sort_keys()
+ * 	cmp_sort_keys()
+ * 	merge_two_runs()
+ * 	merge_sorted_runs()
+ * 	sort_keys_chunk()
+ * 	sort_on_keys()
+ * 	sort_nodes()
+ * 	sort_resresv_array()
  * 	swapfunc()
  * 	med3()
  * 	qsort()
@@ -96,11 +106,19 @@
 #include "server_info.h"
 #include "resource.h"
 #include "constant.h"
+#include "cycle_profile.h"
+#include "multi_threading.h"
 
 #ifdef NAS
 #include "site_code.h"
 #endif
 
+/* Keys of a job ahead of the job_sort_key keys: runnable, preempt priority,
+ * preempted, time preempted, starving, starving priority and sort formula.
+ * qrank and rank follow the job_sort_key keys.
+ */
+#define JOB_SORT_PRE_KEYS 7
+#define JOB_SORT_POST_KEYS 2
 
 
 /**
@@ -1259,6 +1277,8 @@ sort_jobs(status *policy, server_info *sinfo)
 	int index = 0;
 	int count = 0;
 
+	prof_phase_start(PROF_SORT_JOBS);
+
 	/** sort jobs in such a way that Higher Priority jobs come on top
 	 * followed by preempted jobs and then starving jobs and normal jobs
 	 */
@@ -1272,8 +1292,8 @@ sort_jobs(status *policy, server_info *sinfo)
 			 */
 			for (; i < sinfo->num_queues; i++) {
 				if (sinfo->queues[i]->sc.total > 0) {
-					qsort(sinfo->queues[i]->jobs, sinfo->queues[i]->sc.total,
-						sizeof(resource_resv*), cmp_sort);
+					sort_resresv_array(policy, sinfo->queues[i]->jobs,
+						sinfo->queues[i]->sc.total);
 				}
 			}
 			for (count = 0; count != sinfo->num_queues; count++) {
@@ -1286,14 +1306,14 @@ sort_jobs(status *policy, server_info *sinfo)
 		}
 		/** Sort on entire complex **/
 		else if (!policy->by_queue && !policy->round_robin) {
-			qsort(sinfo->jobs, count_array(sinfo->jobs), sizeof(resource_resv *), cmp_sort);
+			sort_resresv_array(policy, sinfo->jobs, count_array(sinfo->jobs));
 		}
 	}
 	else if (policy->by_queue) {
 		for (i = 0; i < sinfo->num_queues; i++) {
-			qsort(sinfo->queues[i]->jobs, count_array(sinfo->queues[i]->jobs), sizeof(resource_resv *), cmp_sort);
+			sort_resresv_array(policy, sinfo->queues[i]->jobs, count_array(sinfo->queues[i]->jobs));
 		}
-		qsort(sinfo->jobs, count_array(sinfo->jobs), sizeof(resource_resv*), cmp_sort);
+		sort_resresv_array(policy, sinfo->jobs, count_array(sinfo->jobs));
 	}
 	else if (policy->round_robin) {
 		if (sinfo -> queue_list != NULL) {
@@ -1304,13 +1324,393 @@ sort_jobs(status *policy, server_info *sinfo)
 				int queue_index_size = count_array(sinfo->queue_list[i]);
 				for (j = 0; j < queue_index_size; j++)
 				{
-				    qsort(sinfo->queue_list[i][j]->jobs, count_array(sinfo->queue_list[i][j]->jobs),
-					    sizeof(resource_resv *), cmp_sort);
+				    sort_resresv_array(policy, sinfo->queue_list[i][j]->jobs,
+					    count_array(sinfo->queue_list[i][j]->jobs));
 				}
 			}
 
 		}
 	}
 	else
-		qsort(sinfo->jobs, count_array(sinfo->jobs), sizeof(resource_resv*), cmp_sort);
+		sort_resresv_array(policy, sinfo->jobs, count_array(sinfo->jobs));
+
+	prof_phase_end(PROF_SORT_JOBS);
+}
+
+/**
+ * @brief
+ * 		count the keys of a sort_info array
+ *
+ * @param[in]	si	-	sort_info array terminated by a NULL res_name
+ *
+ * @return	int
+ * @retval	number of keys
+ */
+static int
+count_sort_keys(struct sort_info *si)
+{
+	int i;
+
+	if (si == NULL)
+		return 0;
+
+	for (i = 0; i <= MAX_SORTS && si[i].res_name != NULL; i++)
+		;
+
+	return i;
+}
+
+/**
+ * @brief
+ * 		compute the node_sort keys of a node.  Comparing the keys in
+ *		ascending order orders nodes like multi_node_sort()
+ *
+ * @param[in]	ninfo	-	the node
+ * @param[out]	keys	-	nkeys keys
+ * @param[in]	nkeys	-	number of node_sort keys
+ *
+ * @return void
+ */
+static void
+fill_node_sort_keys(node_info *ninfo, sch_resource_t *keys, int nkeys)
+{
+	int i;
+	sch_resource_t v;
+
+	for (i = 0; i < nkeys; i++) {
+		v = find_node_amount(ninfo, cstat.node_sort[i].res_name,
+			cstat.node_sort[i].def, cstat.node_sort[i].res_type);
+		keys[i] = cstat.node_sort[i].order == ASC ? v : -v;
+	}
+}
+
+/**
+ * @brief
+ * 		compute the sort keys of a job.  Comparing the keys in ascending
+ *		order (with the fairshare paths ahead of the job_sort_key keys)
+ *		gives the same order as cmp_sort()
+ *
+ * @param[in]	resresv	-	the job
+ * @param[out]	keys	-	JOB_SORT_PRE_KEYS + nsorts + JOB_SORT_POST_KEYS keys
+ * @param[in]	nsorts	-	number of job_sort_key keys
+ *
+ * @return void
+ */
+static void
+fill_job_sort_keys(resource_resv *resresv, sch_resource_t *keys, int nsorts)
+{
+	job_info *job = resresv->job;
+	int i;
+	sch_resource_t v;
+
+	memset(keys, 0, JOB_SORT_PRE_KEYS * sizeof(sch_resource_t));
+	keys[0] = in_runnable_state(resresv) ? 0 : 1;
+	if (job != NULL) {
+		keys[1] = -job->preempt;
+		keys[2] = job->time_preempted == UNSPECIFIED ? 1 : 0;
+		keys[3] = job->time_preempted;
+		keys[4] = 1;
+#ifndef NAS /* localmod 041 */
+		if (resresv->is_job && resresv->server->policy->help_starving_jobs &&
+			job->is_starving) {
+			keys[4] = 0;
+			keys[5] = -resresv->sch_priority;
+		}
+#endif /* localmod 041 */
+		keys[6] = -job->formula_value;
+	}
+
+	for (i = 0; i < nsorts; i++) {
+		v = find_resresv_amount(resresv, cstat.sort_by[i].res_name, cstat.sort_by[i].def);
+		keys[JOB_SORT_PRE_KEYS + i] = cstat.sort_by[i].order == ASC ? v : -v;
+	}
+	keys[JOB_SORT_PRE_KEYS + nsorts] = resresv->qrank;
+	keys[JOB_SORT_PRE_KEYS + nsorts + 1] = resresv->rank;
+}
+
+/**
+ * @brief
+ * 		compare two objects on their precomputed sort keys.  The
+ *		position before the sort breaks ties so the sort is stable.
+ *
+ * @param[in]	ski	-	sort keys
+ * @param[in]	i1	-	index of the first object
+ * @param[in]	i2	-	index of the second object
+ *
+ * @return	int
+ * @retval	-1, 0, 1 : standard qsort() cmp
+ */
+static int
+cmp_sort_keys(sort_keys_info *ski, int i1, int i2)
+{
+	const sch_resource_t *k1 = ski->keys + (size_t) i1 * ski->nkeys;
+	const sch_resource_t *k2 = ski->keys + (size_t) i2 * ski->nkeys;
+	int cmp;
+	int k;
+
+	for (k = 0; k < ski->nkeys; k++) {
+		if (k == ski->fs_key) {
+			cmp = cmp_fairshare(&ski->obj_arr[i1], &ski->obj_arr[i2]);
+			if (cmp != 0)
+				return cmp;
+		}
+		cmp = (k1[k] > k2[k]) - (k1[k] < k2[k]);
+		if (cmp != 0)
+			return cmp;
+	}
+
+	return (i1 > i2) - (i1 < i2);
+}
+
+/**
+ * @brief
+ * 		merge the sorted runs src[lo .. mid - 1] and src[mid .. hi - 1]
+ *		into dst[lo .. hi - 1]
+ *
+ * @param[in]	ski	-	sort keys
+ * @param[in]	src	-	object indices holding the runs
+ * @param[out]	dst	-	object indices to merge into
+ * @param[in]	lo	-	start of the first run
+ * @param[in]	mid	-	start of the second run
+ * @param[in]	hi	-	end of the second run
+ *
+ * @return void
+ */
+static void
+merge_two_runs(sort_keys_info *ski, int *src, int *dst, int lo, int mid, int hi)
+{
+	int i = lo;
+	int j = mid;
+	int k = lo;
+	int take_j;
+
+	/* runs are often already in order, e.g. sorted ranges of a list which was sorted last time */
+	if (mid == hi || cmp_sort_keys(ski, src[mid - 1], src[mid]) < 0) {
+		memcpy(dst + lo, src + lo, (hi - lo) * sizeof(int));
+		return;
+	}
+
+	while (i < mid && j < hi) {
+		take_j = cmp_sort_keys(ski, src[j], src[i]) < 0;
+		dst[k++] = take_j ? src[j] : src[i];
+		j += take_j;
+		i += !take_j;
+	}
+	while (i < mid)
+		dst[k++] = src[i++];
+	while (j < hi)
+		dst[k++] = src[j++];
+}
+
+/**
+ * @brief
+ * 		merge sorted runs pairwise until one run is left
+ *
+ * @param[in]	ski	-	sort keys
+ * @param[in,out]	order	-	object indices holding the runs, sorted on return
+ * @param[in]	tmp	-	merge buffer, as large as order
+ * @param[in,out]	runs	-	the starts of the runs, runs[0] is the start of the area
+ * @param[in]	nruns	-	number of runs
+ * @param[in]	end	-	end of the last run
+ *
+ * @return void
+ */
+static void
+merge_sorted_runs(sort_keys_info *ski, int *order, int *tmp, int *runs, int nruns, int end)
+{
+	int *src = order;
+	int *dst = tmp;
+	int *swap;
+	int start;
+	int mid;
+	int hi;
+	int i;
+	int n;
+
+	if (nruns <= 1)
+		return;
+
+	start = runs[0];
+	while (nruns > 1) {
+		for (i = 0, n = 0; i < nruns; i += 2, n++) {
+			mid = (i + 1 < nruns) ? runs[i + 1] : end;
+			hi = (i + 2 < nruns) ? runs[i + 2] : end;
+			merge_two_runs(ski, src, dst, runs[i], mid, hi);
+			runs[n] = runs[i];
+		}
+		nruns = n;
+		swap = src;
+		src = dst;
+		dst = swap;
+	}
+
+	if (src != order)
+		memcpy(order + start, src + start, (end - start) * sizeof(int));
+}
+
+/**
+ * @brief
+ * 		compute the sort keys of a range of objects and sort the range.
+ *		The range is split into the runs which are already in order and
+ *		the runs are merged, so a list which is mostly sorted (like the
+ *		nodes after a job ran on a few of them) costs little more than
+ *		computing its keys.
+ *
+ * @param[in,out]	data	-	the range to sort
+ *
+ * @return void
+ */
+void
+sort_keys_chunk(th_data_sort_keys *data)
+{
+	sort_keys_info *ski = data->ski;
+	int nruns = 0;
+	int i;
+
+	for (i = data->sidx; i <= data->eidx; i++) {
+		sch_resource_t *keys = ski->keys + (size_t) i * ski->nkeys;
+
+		if (ski->obj_type == SOBJ_NODE)
+			fill_node_sort_keys(ski->obj_arr[i], keys, ski->nkeys);
+		else
+			fill_job_sort_keys(ski->obj_arr[i], keys,
+				ski->nkeys - JOB_SORT_PRE_KEYS - JOB_SORT_POST_KEYS);
+	}
+
+	for (i = data->sidx; i <= data->eidx; i++) {
+		data->order[i] = i;
+		if (i == data->sidx || cmp_sort_keys(ski, i, i - 1) < 0)
+			data->runs[data->sidx + nruns++] = i;
+	}
+
+	merge_sorted_runs(ski, data->order, data->tmp, data->runs + data->sidx, nruns, data->eidx + 1);
+}
+
+/**
+ * @brief
+ * 		sort an array on precomputed keys.  The keys are computed and the
+ *		ranges sorted in parallel, then the sorted ranges are merged.
+ *
+ * @param[in,out]	ski	-	sort keys, obj_type, nkeys and fs_key are set by the caller
+ * @param[in,out]	arr	-	array to sort
+ * @param[in]	num	-	number of objects in arr
+ *
+ * @return	int
+ * @retval	1	: arr is sorted
+ * @retval	0	: malloc error, arr is untouched
+ */
+static int
+sort_on_keys(sort_keys_info *ski, void **arr, int num)
+{
+	th_data_sort_keys tdata;
+	th_task_info task;
+	int *order;
+	int *tmp;
+	int *runs;
+	int i;
+
+	ski->obj_arr = malloc(num * sizeof(void *));
+	ski->keys = malloc((size_t) num * ski->nkeys * sizeof(sch_resource_t));
+	order = malloc(num * sizeof(int));
+	tmp = malloc(num * sizeof(int));
+	runs = malloc(num * sizeof(int));
+	if (ski->obj_arr == NULL || ski->keys == NULL || order == NULL ||
+		tmp == NULL || runs == NULL) {
+		log_err(errno, __func__, MEM_ERR_MSG);
+		free(ski->obj_arr);
+		free(ski->keys);
+		free(order);
+		free(tmp);
+		free(runs);
+		return 0;
+	}
+	memcpy(ski->obj_arr, arr, num * sizeof(void *));
+
+	tdata.ski = ski;
+	tdata.order = order;
+	tdata.tmp = tmp;
+	tdata.runs = runs;
+
+	task.task_type = TS_SORT_KEYS;
+	task.thread_data = (void *) &tdata;
+	task.num_items = num;
+	run_parallel_task(&task);
+
+	for (i = 0; i < task.num_ranges; i++)
+		runs[i] = i * task.range_size;
+	merge_sorted_runs(ski, order, tmp, runs, task.num_ranges, num);
+
+	for (i = 0; i < num; i++)
+		arr[i] = ski->obj_arr[order[i]];
+
+	free(ski->obj_arr);
+	free(ski->keys);
+	free(order);
+	free(tmp);
+	free(runs);
+
+	return 1;
+}
+
+/**
+ * @brief
+ * 		sort nodes by node_sort_key, ordering them like multi_node_sort()
+ *		but computing each node's keys once instead of on every comparison.
+ *		Nodes which tie on every key keep their order from before the
+ *		sort.  qsort() leaves ties in no particular order, so tied nodes
+ *		may come out differently than with the qsort() fallback.
+ *
+ * @param[in,out]	nodes	-	nodes to sort
+ * @param[in]	num_nodes	-	number of nodes
+ *
+ * @return void
+ */
+void
+sort_nodes(node_info **nodes, int num_nodes)
+{
+	sort_keys_info ski;
+
+	if (nodes == NULL || num_nodes < 2)
+		return;
+
+	ski.obj_type = SOBJ_NODE;
+	ski.nkeys = count_sort_keys(cstat.node_sort);
+	ski.fs_key = -1;
+	if (ski.nkeys == 0)
+		return;
+
+	if (!sort_on_keys(&ski, (void **) nodes, num_nodes))
+		qsort(nodes, num_nodes, sizeof(node_info *), multi_node_sort);
+}
+
+/**
+ * @brief
+ * 		sort jobs into the order they are considered in.  The order is
+ *		the same as sorting with qsort() and cmp_sort(), but each job's
+ *		keys are computed once instead of on every comparison.
+ *
+ * @param[in]	policy	-	policy info
+ * @param[in,out]	resresv_arr	-	jobs to sort
+ * @param[in]	num_resresv	-	number of jobs
+ *
+ * @return void
+ */
+void
+sort_resresv_array(status *policy, resource_resv **resresv_arr, int num_resresv)
+{
+	sort_keys_info ski;
+
+	if (resresv_arr == NULL || num_resresv < 2)
+		return;
+
+	ski.obj_type = SOBJ_JOB;
+	ski.nkeys = JOB_SORT_PRE_KEYS + count_sort_keys(cstat.sort_by) + JOB_SORT_POST_KEYS;
+	ski.fs_key = -1;
+#ifndef NAS /* localmod 041 */
+	if (policy->fair_share)
+		ski.fs_key = JOB_SORT_PRE_KEYS;
+#endif /* localmod 041 */
+
+	if (!sort_on_keys(&ski, (void **) resresv_arr, num_resresv))
+		qsort(resresv_arr, num_resresv, sizeof(resource_resv *), cmp_sort);
 }
@@ -201,6 +201,15 @@ int cmp_resv_state(const void *r1, const void *r2);
  */
 void sort_jobs(status *policy, server_info *sinfo);
 
+/* compute the sort keys of a range of objects and sort the range on them */
+void sort_keys_chunk(th_data_sort_keys *data);
+
+/* sort nodes on the node_sort keys, same order as multi_node_sort() */
+void sort_nodes(node_info **nodes, int num_nodes);
+
+/* sort jobs on precomputed keys, same order as cmp_sort() */
+void sort_resresv_array(status *policy, resource_resv **resresv_arr, int num_resresv);
+
 #ifdef	__cplusplus
 }
 #endif
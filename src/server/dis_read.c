@@ -348,6 +348,7 @@ decode_DIS_replySvr_inner(int sock, struct batch_reply *reply)
 				CLEAR_LINK(pstsvr->brp_stlink);
 				pstsvr->brp_objname[0] = '\0';
 				CLEAR_HEAD(pstsvr->brp_attr);
+				pstsvr->brp_cache = NULL;
 
 				pstsvr->brp_objtype = disrui(sock, &rc);
 				if (rc == 0) {
@@ -647,6 +648,10 @@ dis_request_read(int sfds, struct batch_request *request)
 			decode_DIS_PreemptJobs(sfds, request);
 			break;
 
+		case PBS_BATCH_ModifyJobs_Async:
+			rc = decode_DIS_ModifyJobs(sfds, request);
+			break;
+
 #else	/* yes PBS_MOM */
 
 		case PBS_BATCH_CopyHookFile:
@@ -690,7 +695,7 @@ dis_request_read(int sfds, struct batch_request *request)
 				LOG_DEBUG, "?", log_buffer);
 			rc = PBSE_DISPROTO;
 		}
-	} else if (rc != PBSE_UNKREQ) {
+	} else if ((rc != PBSE_UNKREQ) && (rc != PBSE_PROTOCOL)) {
 		(void)sprintf(log_buffer,
 			"Req Body bad, dis error %d, type %d",
 			rc, request->rq_type);
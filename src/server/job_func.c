@@ -358,6 +358,7 @@ job_alloc(void)
 	pj->ji_pmt_preq = NULL;
 	CLEAR_HEAD(pj->ji_svrtask);
 	CLEAR_HEAD(pj->ji_rejectdest);
+	CLEAR_LINK(pj->ji_dbsave_link);
 	pj->ji_terminated = 0;
 	pj->ji_deletehistory = 0;
 	pj->ji_script = NULL;
@@ -500,6 +501,12 @@ job_free(job *pj)
 
 		free_job_work_tasks(pj);
 
+		/* release the job's encoded status */
+		free_job_stcache(pj);
+
+		/* drop a deferred db save, the job is gone */
+		delete_link(&pj->ji_dbsave_link);
+
 		/* free any bad destination structs */
 
 		bp = (badplace *)GET_NEXT(pj->ji_rejectdest);
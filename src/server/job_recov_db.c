@@ -60,6 +60,8 @@
 #include "queue.h"
 #include "log.h"
 #include "pbs_nodes.h"
+#include "credential.h"
+#include "batch_request.h"
 #include "svrfunc.h"
 #include <memory.h>
 #include "libutil.h"
@@ -77,6 +79,23 @@ void print_backtrace(char *);
 /* global data items */
 extern time_t time_now;
 
+/* jobs whose save is deferred to the end of the current save batch */
+static pbs_list_head deferred_job_saves = {&deferred_job_saves, &deferred_job_saves, NULL};
+static int job_save_batch_nest = 0;	/* nesting level of job_save_db_batch_begin */
+static int job_save_batch_requests = 0;	/* saves asked for in the current batch */
+
+/* counters for the job save batches, see update_job_save_ct() */
+static struct {
+	long	jsc_batches;	/* batches committed */
+	long	jsc_jobs;	/* jobs written by them */
+	long	jsc_requests;	/* saves deferred into them */
+	int	jsc_depth;	/* jobs queued in the last batch */
+	int	jsc_max_depth;	/* most jobs queued in a batch */
+	long	jsc_usec;	/* commit time of the last batch */
+	long	jsc_max_usec;	/* longest commit time */
+	long	jsc_total_usec;	/* total commit time */
+} job_save_ct;
+
 job *recov_job_cb(pbs_db_obj_info_t *dbobj, int *refreshed);
 resc_resv *recov_resv_cb(pbs_db_obj_info_t *dbobj, int *refreshed);
 
@@ -218,7 +237,7 @@ db_to_job(job *pjob,  pbs_db_job_info_t *dbjob)
 
 /**
  * @brief
- *		Save job to database
+ *		Write a job to the database
  *
  * @param[in]	pjob - The job to save
  *
@@ -228,8 +247,8 @@ db_to_job(job *pjob,  pbs_db_job_info_t *dbjob)
  * @retval	 1 - Jobid clash, retry with new jobid
  *
  */
-int
-job_save_db(job *pjob)
+static int
+job_write_db(job *pjob)
 {
 	pbs_db_job_info_t dbjob = {{0}};
 	pbs_db_obj_info_t obj;
@@ -277,6 +296,158 @@ done:
 	return (rc);
 }
 
+/**
+ * @brief
+ *		Save job to database.  Inside a save batch the save of a job
+ *		which is already in the database is deferred to the end of the
+ *		batch, so repeated saves of a job are written once.
+ *
+ * @param[in]	pjob - The job to save
+ *
+ * @return      Error code
+ * @retval	 0 - Success
+ * @retval	-1 - Failure
+ * @retval	 1 - Jobid clash, retry with new jobid
+ *
+ */
+int
+job_save_db(job *pjob)
+{
+	if (job_save_batch_nest > 0 && !pjob->newobj) {
+		job_save_batch_requests++;
+		if (pjob->ji_dbsave_link.ll_next == &pjob->ji_dbsave_link)
+			append_link(&deferred_job_saves, &pjob->ji_dbsave_link, pjob);
+		return 0;
+	}
+
+	return (job_write_db(pjob));
+}
+
+/**
+ * @brief
+ *		Start a batch of job saves.  Until the matching
+ *		job_save_db_batch_end(), saves of jobs already in the database
+ *		are deferred.  Batches nest.
+ *
+ * @return	void
+ */
+void
+job_save_db_batch_begin(void)
+{
+	if (job_save_batch_nest++ == 0)
+		job_save_batch_requests = 0;
+}
+
+/**
+ * @brief
+ *		End a batch of job saves.  The outermost end writes every
+ *		deferred job once, all in one transaction, so the batch costs
+ *		one commit instead of one per save.  A request which saved jobs
+ *		in a batch should be acknowledged after this returns.
+ *
+ * @return      Error code
+ * @retval	 0 - Success
+ * @retval	-1 - Failure
+ *
+ */
+int
+job_save_db_batch_end(void)
+{
+	job *pjob;
+	int njobs = 0;
+	int in_trx = 1;
+	int rc = 0;
+	long usec;
+	struct timespec start;
+	struct timespec end;
+
+	if (job_save_batch_nest == 0 || --job_save_batch_nest > 0)
+		return 0;
+
+	if (GET_NEXT(deferred_job_saves) != NULL) {
+		clock_gettime(CLOCK_MONOTONIC, &start);
+
+		/* without a transaction the jobs are still saved, just one commit each */
+		if (pbs_db_begin_trx(svr_db_conn) != 0) {
+			log_err(-1, __func__, "Failed to start a transaction for the job save batch");
+			in_trx = 0;
+		}
+
+		while ((pjob = (job *) GET_NEXT(deferred_job_saves)) != NULL) {
+			delete_link(&pjob->ji_dbsave_link);
+			if (job_write_db(pjob) != 0)
+				rc = -1;
+			njobs++;
+		}
+
+		if (in_trx && pbs_db_end_trx(svr_db_conn, rc == 0 ? PBS_DB_COMMIT : PBS_DB_ROLLBACK) != 0) {
+			log_err(-1, __func__, "Failed to commit the job save batch");
+			panic_stop_db();
+		}
+
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		usec = (end.tv_sec - start.tv_sec) * 1000000L + (end.tv_nsec - start.tv_nsec) / 1000;
+		job_save_ct.jsc_batches++;
+		job_save_ct.jsc_jobs += njobs;
+		job_save_ct.jsc_requests += job_save_batch_requests;
+		job_save_ct.jsc_depth = njobs;
+		if (njobs > job_save_ct.jsc_max_depth)
+			job_save_ct.jsc_max_depth = njobs;
+		job_save_ct.jsc_usec = usec;
+		if (usec > job_save_ct.jsc_max_usec)
+			job_save_ct.jsc_max_usec = usec;
+		job_save_ct.jsc_total_usec += usec;
+
+		log_eventf(PBSEVENT_DEBUG3, PBS_EVENTCLASS_SERVER, LOG_DEBUG, __func__,
+			"Saved %d jobs for %d save requests in %ld usec", njobs, job_save_batch_requests, usec);
+	}
+
+	/* the saves are committed, replies which waited on them can go */
+	flush_held_replies(-1);
+
+	return rc;
+}
+
+/**
+ * @brief
+ *		Are job saves waiting in the current save batch?  A reply to a
+ *		request which made them should not be sent before they are
+ *		committed.
+ *
+ * @return	int
+ * @retval	1 - saves are pending
+ * @retval	0 - no saves are pending
+ */
+int
+job_save_db_batch_pending(void)
+{
+	return ((job_save_batch_nest > 0) && (GET_NEXT(deferred_job_saves) != NULL));
+}
+
+/**
+ * @brief
+ *		update_job_save_ct - update the job save batch counters in the
+ *		'job_save_stats' server attribute.
+ *
+ * @param[out]	pattr	-	server attribute.
+ *
+ * @par MT-safe: No
+ */
+void
+update_job_save_ct(attribute *pattr)
+{
+	static char buf[256];
+
+	snprintf(buf, sizeof(buf),
+		"batches:%ld jobs:%ld save_requests:%ld queue_depth:%d max_queue_depth:%d "
+		"commit_usec:%ld max_commit_usec:%ld total_commit_usec:%ld",
+		job_save_ct.jsc_batches, job_save_ct.jsc_jobs, job_save_ct.jsc_requests,
+		job_save_ct.jsc_depth, job_save_ct.jsc_max_depth,
+		job_save_ct.jsc_usec, job_save_ct.jsc_max_usec, job_save_ct.jsc_total_usec);
+	pattr->at_val.at_str = buf;
+	pattr->at_flags |= ATR_SET_MOD_MCACHE;
+}
+
 /**
  * @brief
  *	Utility function called inside job_recov_db
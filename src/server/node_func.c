@@ -830,6 +830,9 @@ save_nodes_db(int changemodtime, void *p)
 		return (-1);
 	}
 
+	if (pbs_db_begin_trx(svr_db_conn) != 0)
+		goto db_err;
+
 	/* insert/update the mominfo_time to db */
 	mom_tm.mit_time = mominfo_time.mit_time;
 	mom_tm.mit_gen = mominfo_time.mit_gen;
@@ -849,6 +852,9 @@ save_nodes_db(int changemodtime, void *p)
 			goto db_err;
 	}
 
+	if (pbs_db_end_trx(svr_db_conn, PBS_DB_COMMIT) != 0)
+		goto db_err;
+
 	/*
 	 * Clear the ATR_VFLAG_MODIFY bit on each node attribute
 	 * and on the node_group_key resource, for those nodes
@@ -887,6 +893,7 @@ save_nodes_db(int changemodtime, void *p)
 	return (0);
 
 db_err:
+	pbs_db_end_trx(svr_db_conn, PBS_DB_ROLLBACK);
 	pbs_db_get_errmsg(PBS_DB_ERR, &conn_db_err);
 	log_errf(-1, __func__, "Unable to save node to the database %s", conn_db_err ? conn_db_err: "");
 	free(conn_db_err);
@@ -333,6 +333,9 @@ pbsd_init(int type)
 	void	*conn = (void *) svr_db_conn;
 	char *buf = NULL;
 	int buf_len = 0;
+	struct timespec recov_start;
+	struct timespec recov_end;
+	double recov_secs;
 
 #ifdef  RLIMIT_CORE
 	int      char_in_cname = 0;
@@ -744,7 +747,9 @@ pbsd_init(int type)
 	/* get jobs from DB */
 	obj.pbs_db_obj_type = PBS_DB_JOB;
 	obj.pbs_db_un.pbs_db_job = &dbjob;
+	clock_gettime(CLOCK_MONOTONIC, &recov_start);
 	rc = pbs_db_search(conn, &obj, NULL, (query_cb_t)&recov_job_cb);
+	clock_gettime(CLOCK_MONOTONIC, &recov_end);
 	if (rc == -1) {
 		pbs_db_get_errmsg(PBS_DB_ERR, &conn_db_err);
 		if (conn_db_err != NULL) {
@@ -759,6 +764,10 @@ pbsd_init(int type)
 	}
 
 	log_eventf(PBSEVENT_SYSTEM, PBS_EVENTCLASS_SERVER, LOG_NOTICE, msg_daemonname, msg_init_exptjobs, server.sv_qs.sv_numjobs);
+	recov_secs = (recov_end.tv_sec - recov_start.tv_sec) + (recov_end.tv_nsec - recov_start.tv_nsec) / 1e9;
+	log_eventf(PBSEVENT_SYSTEM, PBS_EVENTCLASS_SERVER, LOG_INFO, msg_daemonname,
+		"Recovered %d jobs in %.3f seconds (%.0f jobs/sec)", server.sv_qs.sv_numjobs,
+		recov_secs, recov_secs > 0 ? server.sv_qs.sv_numjobs / recov_secs : 0);
 
 	/* Now, cause any reservations marked RESV_FINISHED to be
 	 * removed and place "begin" and "end" tasks onto the
@@ -430,6 +430,8 @@ tpp_request(int fd)
 	if (server.sv_attr[(int) SVR_ATR_rpp_max_pkt_check].at_flags & ATR_VFLAG_SET)
 		rpp_max_pkt_check = server.sv_attr[(int) SVR_ATR_rpp_max_pkt_check].at_val.at_long;
 
+	/* the job saves of the messages read here (e.g. obits) are committed together */
+	job_save_db_batch_begin();
 	for (iloop = 0; iloop < rpp_max_pkt_check; iloop++) {
 		int	stream;
 
@@ -441,6 +443,7 @@ tpp_request(int fd)
 			break;
 		do_tpp(stream);
 	}
+	(void)job_save_db_batch_end();
 	return;
 }
 
@@ -1756,6 +1759,7 @@ get_port(char *arg, unsigned int *port, pbs_net_t *addr)
  *	   		find and process it.
  *		2. All items on the immediate list, then
  *		3. All items on the timed task list which have expired times
+ *		4. The next slice of any status request being served in slices
  *
  * @return	amount of time till next task
  */
@@ -1781,6 +1785,10 @@ next_task()
 
 	next_sync_mom_hookfiles();
 
+	/* large status requests served in slices, poll for requests between them */
+	if (resume_stat_requests())
+		tilwhen = 0;
+
 	return (tilwhen);
 }
 
@@ -68,6 +68,7 @@
  *	decode_DIS_PySpawn()
  *	free_br()
  *	freebr_manage()
+ *	freebr_modifyjobs()
  *	freebr_cpyfile()
  *	freebr_cpyfile_cred()
  *	parse_servername()
@@ -132,6 +133,9 @@ extern void   req_stat_hook(struct batch_request *);
 /* Private functions local to this file */
 
 static void freebr_manage(struct rq_manage *);
+#ifndef PBS_MOM
+static void freebr_modifyjobs(struct rq_modifyjobs *);
+#endif
 static void freebr_cpyfile(struct rq_cpyfile *);
 static void freebr_cpyfile_cred(struct rq_cpyfile_cred *);
 static void close_quejob(int sfds);
@@ -585,7 +589,14 @@ process_request(int sfds)
 	 * the request struture.
 	 */
 
+#ifndef PBS_MOM
+	/* commit the job saves the request makes together, before its reply goes */
+	job_save_db_batch_begin();
 	dispatch_request(sfds, request);
+	(void)job_save_db_batch_end();
+#else
+	dispatch_request(sfds, request);
+#endif
 	return;
 }
 
@@ -841,6 +852,10 @@ dispatch_request(int sfds, struct batch_request *request)
 			req_runjob(request);
 			break;
 
+		case PBS_BATCH_ModifyJobs_Async:
+			req_modifyjobs(request);
+			break;
+
 		case PBS_BATCH_DefSchReply:
 			req_defschedreply(request);
 			break;
@@ -1043,6 +1058,9 @@ close_client(int sfds)
 {
 	struct batch_request *preq;
 
+#ifndef PBS_MOM
+	drop_held_reply(sfds);	/* its job saves are not committed yet */
+#endif
 	close_conn(sfds);	/* close the connection */
 	preq = (struct batch_request *)GET_NEXT(svr_requests);
 	while (preq) {			/* list of outstanding requests */
@@ -1431,6 +1449,9 @@ free_br(struct batch_request *preq)
 		case PBS_BATCH_ReleaseJob:
 			freebr_manage(&preq->rq_ind.rq_release);
 			break;
+		case PBS_BATCH_ModifyJobs_Async:
+			freebr_modifyjobs(&preq->rq_ind.rq_modifyjobs);
+			break;
 		case PBS_BATCH_Rescq:
 		case PBS_BATCH_ReserveResc:
 		case PBS_BATCH_ReleaseResc:
@@ -1466,6 +1487,29 @@ freebr_manage(struct rq_manage *pmgr)
 {
 	free_attrlist(&pmgr->rq_attr);
 }
+#ifndef PBS_MOM
+/**
+ * @brief
+ * 		free the per job manage structures of a ModifyJobs request
+ *
+ * @param[in]	pmjs - request modifyjobs structure.
+ */
+static void
+freebr_modifyjobs(struct rq_modifyjobs *pmjs)
+{
+	int i;
+
+	if (pmjs->rq_jobs == NULL)
+		return;
+	for (i = 0; i < pmjs->rq_count; i++) {
+		freebr_manage(pmjs->rq_jobs[i]);
+		free(pmjs->rq_jobs[i]);
+	}
+	free(pmjs->rq_jobs);
+	pmjs->rq_jobs = NULL;
+	pmjs->rq_count = 0;
+}
+#endif /* PBS_MOM */
 /**
  * @brief
  * 		remove all the rqfpair and free their memory
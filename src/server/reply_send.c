@@ -51,6 +51,9 @@
  *	reply_jobid() - used by several requests where the job id must be sent
  *	reply_free()  - free the substructure that might hang from a reply
  *	set_err_msg() - set a message relating to the error "code"
+ *	hold_reply()	- hold a reply until the job save batch is committed
+ *	flush_held_replies()	- send the held replies
+ *	drop_held_reply()	- forget the held reply of a closing connection
  *	dis_reply_write()	- reply is sent to a remote client
  *	reply_badattr()	- Create a reject (error) reply for a request including the name of the bad attribute/resource.
  *
@@ -74,6 +77,7 @@
 #include "credential.h"
 #include "batch_request.h"
 #include "work_task.h"
+#include "job.h"
 #include "pbs_nodes.h"
 #include "svrfunc.h"
 #include "tpp.h"
@@ -89,6 +93,11 @@ extern char *msg_system;
 extern pbs_list_head task_list_event;
 extern pbs_list_head task_list_immed;
 char   *resc_in_err = NULL;
+
+/* connections whose reply waits for the job save batch to be committed */
+static int *held_reply_fds = NULL;
+static int held_reply_nfds = 0;
+static int held_reply_size = 0;
 #endif	/* PBS_MOM */
 
 #ifndef WIN32
@@ -182,6 +191,119 @@ reply_alarm(int sig)
 }
 #endif
 
+#ifndef PBS_MOM
+/**
+ * @brief
+ * 		hold_reply - note that the reply encoded for a connection is to be
+ *		flushed once the job saves it depends on are committed
+ *
+ * @param[in]	sfds - connection socket
+ *
+ * @return	int
+ * @retval	0	- held
+ * @retval	-1	- could not be held, flush it now
+ */
+static int
+hold_reply(int sfds)
+{
+	int i;
+	int *tmp;
+
+	for (i = 0; i < held_reply_nfds; i++)
+		if (held_reply_fds[i] == sfds)
+			return 0;
+	if (held_reply_nfds == held_reply_size) {
+		tmp = realloc(held_reply_fds, (held_reply_size + 16) * sizeof(int));
+		if (tmp == NULL)
+			return -1;
+		held_reply_fds = tmp;
+		held_reply_size += 16;
+	}
+	held_reply_fds[held_reply_nfds++] = sfds;
+	return 0;
+}
+
+/**
+ * @brief
+ * 		flush_held_replies - send the replies held by dis_reply_write()
+ *		while job saves were pending.  Called once the job save batch is
+ *		committed.
+ *
+ * @param[in]	sfds - connection socket, or -1 for all held replies
+ */
+void
+flush_held_replies(int sfds)
+{
+	int i;
+	int fd;
+	int rc;
+#ifndef WIN32
+	struct sigaction act, oact;
+	time_t  old_tcp_timeout = pbs_tcp_timeout;
+#endif
+
+	for (i = 0; i < held_reply_nfds; ) {
+		fd = held_reply_fds[i];
+		if ((sfds != -1) && (fd != sfds)) {
+			i++;
+			continue;
+		}
+		held_reply_fds[i] = held_reply_fds[--held_reply_nfds];
+
+		/* the connection went away while the reply was held */
+		if (get_conn(fd) == NULL)
+			continue;
+
+#ifndef WIN32
+		reply_timedout = 0;
+		sigemptyset(&act.sa_mask);
+		act.sa_flags = 0;
+		act.sa_handler = reply_alarm;
+		if (sigaction(SIGALRM, &act, &oact) == 0)
+			alarm(PBS_DIS_TCP_TIMEOUT_REPLY);
+		pbs_tcp_timeout = PBS_DIS_TCP_TIMEOUT_REPLY;
+#endif
+		pbs_tcp_errno = 0;
+		DIS_tcp_funcs();
+		rc = dis_flush(fd);
+#ifndef WIN32
+		reply_timedout = 0;
+		alarm(0);
+		(void)sigaction(SIGALRM, &oact, NULL);
+		pbs_tcp_timeout = old_tcp_timeout;
+#endif
+		if (rc) {
+			log_eventf(PBSEVENT_SYSTEM, PBS_EVENTCLASS_REQUEST, LOG_WARNING, __func__,
+				"DIS reply failure, %d, errno=%d", rc, pbs_tcp_errno);
+			close_client(fd);
+		}
+	}
+}
+
+/**
+ * @brief
+ * 		drop_held_reply - forget the reply held for a connection which is
+ *		being closed.  The reply must not be sent before the job saves it
+ *		depends on are committed, and the client is gone, so it is dropped
+ *		together with the rest of the connection's buffer.  This also keeps
+ *		a later flush from writing it to a new connection reusing the socket.
+ *
+ * @param[in]	sfds - connection socket
+ */
+void
+drop_held_reply(int sfds)
+{
+	int i;
+
+	for (i = 0; i < held_reply_nfds; i++) {
+		if (held_reply_fds[i] == sfds) {
+			held_reply_fds[i] = held_reply_fds[--held_reply_nfds];
+			return;
+		}
+	}
+}
+#endif	/* PBS_MOM */
+
 /**
  * @brief
  * 		reply is to be sent to a remote client
@@ -226,7 +348,14 @@ dis_reply_write(int sfds, struct batch_request *preq)
 	}
 
 	if (rc == 0) {
-		rc = dis_flush(sfds);
+#ifndef PBS_MOM
+		/* not acknowledged until the job saves it made are committed */
+		if ((preq->prot == PROT_TCP) && job_save_db_batch_pending() &&
+			(hold_reply(sfds) == 0))
+			rc = 0;
+		else
+#endif
+			rc = dis_flush(sfds);
 	}
 
 #ifndef WIN32
@@ -300,6 +429,7 @@ reply_send(struct batch_request *request)
 	int		    sfds = request->rq_conn;		/* socket */
 
 	if (request && (request->rq_type == PBS_BATCH_ModifyJob_Async ||
+			request->rq_type == PBS_BATCH_ModifyJobs_Async ||
 			request->rq_type == PBS_BATCH_AsyrunJob)) {
 		free_br(request);
 		return 0;
@@ -390,7 +520,8 @@ reply_ack(struct batch_request *preq)
 	if (preq == NULL)
 		return;
 
-	if (preq->rq_type == PBS_BATCH_ModifyJob_Async || preq->rq_type == PBS_BATCH_AsyrunJob) {
+	if (preq->rq_type == PBS_BATCH_ModifyJob_Async || preq->rq_type == PBS_BATCH_ModifyJobs_Async ||
+		preq->rq_type == PBS_BATCH_AsyrunJob) {
 		free_br(preq);
 		return;
 	}
@@ -444,6 +575,7 @@ reply_free(struct batch_reply *prep)
 		while (pstat) {
 			pstatx = (struct brp_status *)GET_NEXT(pstat->brp_stlink);
 			free_attrlist(&pstat->brp_attr);
+			free_brp_cache(pstat->brp_cache);
 			(void)free(pstat);
 			pstat = pstatx;
 		}
@@ -477,7 +609,8 @@ req_reject(int code, int aux, struct batch_request *preq)
 	if (preq == NULL)
 		return;
 
-	if (preq->rq_type == PBS_BATCH_ModifyJob_Async || preq->rq_type == PBS_BATCH_AsyrunJob) {
+	if (preq->rq_type == PBS_BATCH_ModifyJob_Async || preq->rq_type == PBS_BATCH_ModifyJobs_Async ||
+		preq->rq_type == PBS_BATCH_AsyrunJob) {
 		free_br(preq);
 		return;
 	}
@@ -534,7 +667,7 @@ reply_badattr(int code, int aux, svrattrl *pal,
 	if (preq == NULL)
 		return;
 
-	if (preq->rq_type == PBS_BATCH_ModifyJob_Async) {
+	if (preq->rq_type == PBS_BATCH_ModifyJob_Async || preq->rq_type == PBS_BATCH_ModifyJobs_Async) {
 		free_br(preq);
 		return;
 	}
@@ -592,7 +725,7 @@ reply_text(struct batch_request *preq, int code, char *text)
 	if (preq == NULL)
 		return 0;
 
-	if (preq->rq_type == PBS_BATCH_ModifyJob_Async) {
+	if (preq->rq_type == PBS_BATCH_ModifyJob_Async || preq->rq_type == PBS_BATCH_ModifyJobs_Async) {
 		free_br(preq);
 		return 0;
 	}
@@ -398,6 +398,136 @@ req_modifyjob(struct batch_request *preq)
 	reply_ack(preq);
 }
 
+/**
+ * @brief
+ * 		Remove from a ModifyJobs entry the attribute settings which would
+ *		not change the job.
+ *
+ * @par	Only plain string and long attributes without an action function are
+ *		considered, everything else is always passed on to req_modifyjob().
+ *
+ * @param[in]	pjob	-	job to compare against
+ * @param[in,out]	phead	-	head of the svrattrl list to prune
+ *
+ * @return	int
+ * @retval	number of attribute settings removed
+ */
+static int
+drop_unchanged_job_attrs(job *pjob, pbs_list_head *phead)
+{
+	svrattrl *plist;
+	svrattrl *pnext;
+	attribute *pattr;
+	int i;
+	int dropped = 0;
+
+	for (plist = (svrattrl *)GET_NEXT(*phead); plist != NULL; plist = pnext) {
+		int same = 0;
+
+		pnext = (svrattrl *)GET_NEXT(plist->al_link);
+		if (plist->al_resc != NULL || plist->al_op != SET || plist->al_value == NULL)
+			continue;
+		i = find_attr(job_attr_idx, job_attr_def, plist->al_name);
+		if (i < 0 || job_attr_def[i].at_action != NULL)
+			continue;
+		pattr = &pjob->ji_wattr[i];
+		if ((pattr->at_flags & ATR_VFLAG_SET) == 0)
+			continue;
+
+		switch (job_attr_def[i].at_type) {
+			case ATR_TYPE_STR:
+				same = (pattr->at_val.at_str != NULL &&
+					strcmp(pattr->at_val.at_str, plist->al_value) == 0);
+				break;
+			case ATR_TYPE_LONG: {
+				char *endp;
+				long val;
+
+				val = strtol(plist->al_value, &endp, 10);
+				same = (*plist->al_value != '\0' && *endp == '\0' &&
+					val == pattr->at_val.at_long);
+				break;
+			}
+			default:
+				break;
+		}
+		if (same) {
+			delete_link(&plist->al_link);
+			free_svrattrl(plist);
+			dropped++;
+		}
+	}
+	return dropped;
+}
+
+/**
+ * @brief
+ * 		Service the Modify Jobs Request.
+ *
+ * @par	The request carries a (job id, attribute list) pair for each of a
+ *		number of jobs, typically all the updates a scheduling cycle made.
+ *		Attribute settings which would not change the job are dropped, and
+ *		each remaining pair is handled as its own ModifyJob_Async request.
+ *		The job saves are done as one batch, so the request costs one
+ *		database commit.  No reply is sent.  Only manager or operator
+ *		(i.e. scheduler) connections may send it.
+ *
+ * @param[in]	preq	-	Modify Jobs Request
+ */
+void
+req_modifyjobs(struct batch_request *preq)
+{
+	struct rq_modifyjobs *pmjs = &preq->rq_ind.rq_modifyjobs;
+	struct batch_request *pchild;
+	job *pjob;
+	int i;
+	int applied = 0;
+	int dropped = 0;
+
+	/* only the scheduler, or a manager/operator, sends these */
+	if ((preq->rq_perm & (ATR_DFLAG_MGWR | ATR_DFLAG_OPWR)) == 0) {
+		req_reject(PBSE_PERM, 0, preq);
+		return;
+	}
+
+	job_save_db_batch_begin();
+	for (i = 0; i < pmjs->rq_count; i++) {
+		struct rq_manage *pmgr = pmjs->rq_jobs[i];
+
+		pjob = find_job(pmgr->rq_objname);
+		if (pjob != NULL)
+			dropped += drop_unchanged_job_attrs(pjob, &pmgr->rq_attr);
+		if (GET_NEXT(pmgr->rq_attr) == NULL)
+			continue;
+
+		pchild = alloc_br(PBS_BATCH_ModifyJob_Async);
+		if (pchild == NULL)
+			break;
+		pchild->rq_perm = preq->rq_perm;
+		pchild->rq_fromsvr = preq->rq_fromsvr;
+		pchild->rq_conn = preq->rq_conn;
+		pchild->rq_orgconn = preq->rq_orgconn;
+		pchild->rq_time = preq->rq_time;
+		strcpy(pchild->rq_user, preq->rq_user);
+		strcpy(pchild->rq_host, preq->rq_host);
+		pchild->rq_ind.rq_modify.rq_cmd = pmgr->rq_cmd;
+		pchild->rq_ind.rq_modify.rq_objtype = pmgr->rq_objtype;
+		strcpy(pchild->rq_ind.rq_modify.rq_objname, pmgr->rq_objname);
+		CLEAR_HEAD(pchild->rq_ind.rq_modify.rq_attr);
+		list_move(&pmgr->rq_attr, &pchild->rq_ind.rq_modify.rq_attr);
+
+		req_modifyjob(pchild);
+		applied++;
+	}
+	job_save_db_batch_end();
+
+	log_eventf(PBSEVENT_DEBUG3, PBS_EVENTCLASS_REQUEST, LOG_DEBUG, preq->rq_user,
+		"Modify jobs request: %d jobs, %d modified, %d unchanged values dropped",
+		pmjs->rq_count, applied, dropped);
+
+	reply_ack(preq);
+}
+
 /**
  * @brief
  * 		Returns the svrattrl entry matching attribute 'name', or NULL if not found.
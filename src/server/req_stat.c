@@ -60,6 +60,13 @@
  * 	status_resv()
  * 	status_resc()
  * 	req_stat_resc()
+ * 	reply_stat_node()
+ * 	new_stat_pending()
+ * 	defer_stat_jobs()
+ * 	defer_stat_nodes()
+ * 	stat_jobs_slice()
+ * 	stat_nodes_slice()
+ * 	resume_stat_requests()
  *
  */
 #include <pbs_config.h>   /* the master config generated by configure */
@@ -118,11 +125,40 @@ extern int svr_chk_histjob(job *);
 
 static int bad;
 
+/*
+ * A status of all jobs (or all jobs in a queue) or of all nodes which is
+ * larger than STAT_SLICE_SIZE objects is served a slice at a time from the
+ * main loop by resume_stat_requests(), each slice going out as a partial
+ * reply, so that a large qstat or pbsnodes does not hold up the requests
+ * arriving behind it.  The names of the objects are taken when the request
+ * arrives; each slice finds the objects again by name and skips any that
+ * have gone since.
+ */
+#define STAT_SLICE_SIZE MAX_JOBS_PER_REPLY
+
+struct stat_pending {
+	pbs_list_link sp_link;
+	struct batch_request *sp_preq;	      /* the status request */
+	int sp_objtype;			      /* MGR_OBJ_JOB or MGR_OBJ_NODE */
+	int sp_dohistjobs;		      /* include history jobs */
+	int sp_dosubjobs;		      /* expand Array jobs into subjobs */
+	char sp_queue[PBS_MAXQUEUENAME + 1]; /* only jobs still in this queue, "" for any */
+	char *sp_names;			      /* names of objects, each null terminated */
+	char *sp_next;			      /* next name to status */
+	int sp_left;			      /* names left to status */
+};
+
+static pbs_list_head stat_pending_list;
+static int stat_pending_init = 0;
+
 /* The following private support functions are included */
 
 static int status_que(pbs_queue *, struct batch_request *, pbs_list_head *);
 static int status_node(struct pbsnode *, struct batch_request *, pbs_list_head *);
 static int status_resv(resc_resv *, struct batch_request *, pbs_list_head *);
+static void reply_stat_node(struct batch_request *, int);
+static int defer_stat_jobs(struct batch_request *, pbs_queue *, int, int);
+static int defer_stat_nodes(struct batch_request *);
 
 /**
  * @brief
@@ -380,6 +416,9 @@ req_stat_job(struct batch_request *preq)
 		return;
 
 	} else {
+		if (defer_stat_jobs(preq, type == 2 ? pque : NULL, dohistjobs, dosubjobs))
+			return; /* served in slices by resume_stat_requests() */
+
 		pjob = (job *) GET_NEXT(type == 2 ? pque->qu_jobs : svr_alljobs);
 		while (pjob) {
 			rc = do_stat_of_a_job(preq, pjob, dohistjobs, dosubjobs);
@@ -517,6 +556,7 @@ status_que(pbs_queue *pque, struct batch_request *preq, pbs_list_head *pstathd)
 	strcpy(pstat->brp_objname, pque->qu_qs.qu_name);
 	CLEAR_LINK(pstat->brp_stlink);
 	CLEAR_HEAD(pstat->brp_attr);
+	pstat->brp_cache = NULL;
 	append_link(pstathd, &pstat->brp_stlink, pstat);
 	preq->rq_reply.brp_count++;
 
@@ -548,7 +588,6 @@ req_stat_node(struct batch_request *preq)
 {
 	char		    *name;
 	struct batch_reply  *preply;
-	svrattrl	    *pal;
 	struct pbsnode	    *pnode = NULL;
 	int		    rc   = 0;
 	int		    type = 0;
@@ -590,6 +629,9 @@ req_stat_node(struct batch_request *preq)
 
 	} else {			/* get status of all nodes */
 
+		if (defer_stat_nodes(preq))
+			return; /* served in slices by resume_stat_requests() */
+
 		for (i = 0; i < svr_totnodes; i++) {
 			pnode = pbsndlist[i];
 
@@ -600,6 +642,22 @@ req_stat_node(struct batch_request *preq)
 		}
 	}
 
+	reply_stat_node(preq, rc);
+}
+
+/**
+ * @brief
+ * 		reply_stat_node - send the final reply to a Status Node Request
+ *
+ * @param[in]	preq	-	ptr to the decoded request
+ * @param[in]	rc	-	error from building the status, 0 if none
+ */
+
+static void
+reply_stat_node(struct batch_request *preq, int rc)
+{
+	svrattrl	    *pal;
+
 	if (!rc) {
 		reply_send(preq);
 	} else {
@@ -671,6 +729,7 @@ status_node(struct pbsnode *pnode, struct batch_request *preq, pbs_list_head *ps
 	strcpy(pstat->brp_objname, pnode->nd_name);
 	CLEAR_LINK(pstat->brp_stlink);
 	CLEAR_HEAD(pstat->brp_attr);
+	pstat->brp_cache = NULL;
 
 	/*add this new brp_status structure to the list hanging off*/
 	/*the request's reply substructure                         */
@@ -754,6 +813,8 @@ req_stat_svr(struct batch_request *preq)
 	update_license_ct(&server.sv_attr[(int)SVR_ATR_license_count],
 		server.sv_license_ct_buf);
 
+	update_job_save_ct(&server.sv_attr[(int)SVR_ATR_job_save_stats]);
+
 	conn = get_conn(preq->rq_conn);
 	if (conn->cn_authen & PBS_NET_CONN_TO_SCHED) {
 		/* Request is from sched so update "has_runjob_hook" */
@@ -777,6 +838,7 @@ req_stat_svr(struct batch_request *preq)
 	strcpy(pstat->brp_objname, server_name);
 	pstat->brp_objtype = MGR_OBJ_SERVER;
 	CLEAR_HEAD(pstat->brp_attr);
+	pstat->brp_cache = NULL;
 	append_link(&preply->brp_un.brp_status, &pstat->brp_stlink, pstat);
 	preply->brp_count++;
 
@@ -821,6 +883,7 @@ status_sched(pbs_sched *psched, struct batch_request *preq, pbs_list_head *pstat
 
 	CLEAR_LINK(pstat->brp_stlink);
 	CLEAR_HEAD(pstat->brp_attr);
+	pstat->brp_cache = NULL;
 	append_link(pstathd, &pstat->brp_stlink, pstat);
 	preq->rq_reply.brp_count++;
 
@@ -1040,6 +1103,7 @@ status_resv(resc_resv *presv, struct batch_request *preq, pbs_list_head *pstathd
 	strcpy(pstat->brp_objname, presv->ri_qs.ri_resvID);
 	CLEAR_LINK(pstat->brp_stlink);
 	CLEAR_HEAD(pstat->brp_attr);
+	pstat->brp_cache = NULL;
 	append_link(pstathd, &pstat->brp_stlink, pstat);
 	preq->rq_reply.brp_count++;
 
@@ -1093,6 +1157,7 @@ status_resc(struct resource_def *prd, struct batch_request *preq, pbs_list_head
 	strcpy(pstat->brp_objname, prd->rs_name);
 	CLEAR_LINK(pstat->brp_stlink);
 	CLEAR_HEAD(pstat->brp_attr);
+	pstat->brp_cache = NULL;
 
 	/* add attributes to the status reply */
 	if (private) {
@@ -1214,3 +1279,279 @@ req_stat_resc(struct batch_request *preq)
 		reply_send(preq);
 	}
 }
+
+/**
+ * @brief
+ * 		new_stat_pending - set up a status request to be served in slices
+ *
+ * @param[in]	preq	-	ptr to the decoded request
+ * @param[in]	objtype	-	MGR_OBJ_JOB or MGR_OBJ_NODE
+ * @param[in]	count	-	number of object names to be added
+ * @param[in]	len	-	space needed by the names, with terminators
+ *
+ * @return	struct stat_pending *
+ * @retval	!NULL	: the pending status, its names still to be filled in
+ * @retval	NULL	: out of memory
+ */
+
+static struct stat_pending *
+new_stat_pending(struct batch_request *preq, int objtype, int count, size_t len)
+{
+	struct stat_pending *psp;
+
+	psp = (struct stat_pending *)calloc(1, sizeof(struct stat_pending));
+	if (psp == NULL)
+		return NULL;
+	psp->sp_names = malloc(len);
+	if (psp->sp_names == NULL) {
+		free(psp);
+		return NULL;
+	}
+	CLEAR_LINK(psp->sp_link);
+	psp->sp_preq = preq;
+	psp->sp_objtype = objtype;
+	psp->sp_next = psp->sp_names;
+	psp->sp_left = count;
+	return psp;
+}
+
+/**
+ * @brief
+ * 		defer_stat_jobs - arrange for a status of all jobs, or all jobs
+ *		in a queue, to be served in slices if it is large enough to hold
+ *		up other requests.
+ *
+ * @param[in]	preq	-	ptr to the decoded request, reply initialized
+ * @param[in]	pque	-	queue whose jobs are wanted, NULL for all jobs
+ * @param[in]	dohistjobs	-	include history jobs
+ * @param[in]	dosubjobs	-	expand Array jobs into subjobs
+ *
+ * @return	int
+ * @retval	1	: request will be served by resume_stat_requests()
+ * @retval	0	: caller should serve the request now
+ */
+
+static int
+defer_stat_jobs(struct batch_request *preq, pbs_queue *pque, int dohistjobs, int dosubjobs)
+{
+	struct stat_pending *psp;
+	job		    *pjob;
+	size_t		     len = 0;
+	int		     ct = 0;
+	char		    *p;
+
+	/* local requests are answered through a work task, not in parts */
+	if (preq->rq_conn < 0 || preq->rq_conn == PBS_LOCAL_CONNECTION)
+		return 0;
+
+	for (pjob = (job *)GET_NEXT(pque ? pque->qu_jobs : svr_alljobs); pjob;
+		pjob = (job *)GET_NEXT(pque ? pjob->ji_jobque : pjob->ji_alljobs)) {
+		if (!dohistjobs && (pjob->ji_qs.ji_state == JOB_STATE_FINISHED || pjob->ji_qs.ji_state == JOB_STATE_MOVED))
+			continue;
+		len += strlen(pjob->ji_qs.ji_jobid) + 1;
+		ct++;
+	}
+	if (ct <= STAT_SLICE_SIZE)
+		return 0;
+
+	if ((psp = new_stat_pending(preq, MGR_OBJ_JOB, ct, len)) == NULL)
+		return 0;
+	psp->sp_dohistjobs = dohistjobs;
+	psp->sp_dosubjobs = dosubjobs;
+	if (pque)
+		strcpy(psp->sp_queue, pque->qu_qs.qu_name);
+
+	p = psp->sp_names;
+	for (pjob = (job *)GET_NEXT(pque ? pque->qu_jobs : svr_alljobs); pjob;
+		pjob = (job *)GET_NEXT(pque ? pjob->ji_jobque : pjob->ji_alljobs)) {
+		if (!dohistjobs && (pjob->ji_qs.ji_state == JOB_STATE_FINISHED || pjob->ji_qs.ji_state == JOB_STATE_MOVED))
+			continue;
+		strcpy(p, pjob->ji_qs.ji_jobid);
+		p += strlen(p) + 1;
+	}
+
+	if (!stat_pending_init) {
+		CLEAR_HEAD(stat_pending_list);
+		stat_pending_init = 1;
+	}
+	append_link(&stat_pending_list, &psp->sp_link, psp);
+	return 1;
+}
+
+/**
+ * @brief
+ * 		defer_stat_nodes - arrange for a status of all nodes to be served
+ *		in slices if it is large enough to hold up other requests.
+ *
+ * @param[in]	preq	-	ptr to the decoded request, reply initialized
+ *
+ * @return	int
+ * @retval	1	: request will be served by resume_stat_requests()
+ * @retval	0	: caller should serve the request now
+ */
+
+static int
+defer_stat_nodes(struct batch_request *preq)
+{
+	struct stat_pending *psp;
+	size_t		     len = 0;
+	char		    *p;
+	int		     i;
+
+	if (preq->rq_conn < 0 || preq->rq_conn == PBS_LOCAL_CONNECTION)
+		return 0;
+	if (svr_totnodes <= STAT_SLICE_SIZE)
+		return 0;
+
+	for (i = 0; i < svr_totnodes; i++)
+		len += strlen(pbsndlist[i]->nd_name) + 1;
+	if ((psp = new_stat_pending(preq, MGR_OBJ_NODE, svr_totnodes, len)) == NULL)
+		return 0;
+
+	p = psp->sp_names;
+	for (i = 0; i < svr_totnodes; i++) {
+		strcpy(p, pbsndlist[i]->nd_name);
+		p += strlen(p) + 1;
+	}
+
+	if (!stat_pending_init) {
+		CLEAR_HEAD(stat_pending_list);
+		stat_pending_init = 1;
+	}
+	append_link(&stat_pending_list, &psp->sp_link, psp);
+	return 1;
+}
+
+/**
+ * @brief
+ * 		stat_jobs_slice - add the status of the next slice of jobs of a
+ *		pending job status to its reply.
+ *
+ * @param[in,out]	psp	-	the pending status
+ *
+ * @return	int
+ * @retval	PBSE_NONE	: no error
+ * @retval	!PBSE_NONE	: PBS error code to return to client
+ */
+
+static int
+stat_jobs_slice(struct stat_pending *psp)
+{
+	struct batch_request *preq = psp->sp_preq;
+	job		     *pjob;
+	char		     *name;
+	int		      rc;
+	int		      n;
+
+	for (n = 0; n < STAT_SLICE_SIZE && psp->sp_left > 0; n++) {
+		name = psp->sp_next;
+		psp->sp_next += strlen(name) + 1;
+		psp->sp_left--;
+
+		pjob = find_job(name);
+		if (pjob == NULL)
+			continue;
+		if (psp->sp_queue[0] != '\0' && strcmp(pjob->ji_qs.ji_queue, psp->sp_queue) != 0)
+			continue; /* moved out of the queue since */
+		rc = do_stat_of_a_job(preq, pjob, psp->sp_dohistjobs, psp->sp_dosubjobs);
+		if (rc != PBSE_NONE)
+			return rc;
+	}
+	return PBSE_NONE;
+}
+
+/**
+ * @brief
+ * 		stat_nodes_slice - add the status of the next slice of nodes of a
+ *		pending node status to its reply.
+ *
+ * @param[in,out]	psp	-	the pending status
+ *
+ * @return	int
+ * @retval	0	: success
+ * @retval	!0	: PBSE error code
+ */
+
+static int
+stat_nodes_slice(struct stat_pending *psp)
+{
+	struct batch_request *preq = psp->sp_preq;
+	struct pbsnode	     *pnode;
+	char		     *name;
+	int		      rc;
+	int		      n;
+
+	for (n = 0; n < STAT_SLICE_SIZE && psp->sp_left > 0; n++) {
+		name = psp->sp_next;
+		psp->sp_next += strlen(name) + 1;
+		psp->sp_left--;
+
+		pnode = find_nodebyname(name);
+		if (pnode == NULL)
+			continue;
+		rc = status_node(pnode, preq, &preq->rq_reply.brp_un.brp_status);
+		if (rc)
+			return rc;
+	}
+	return 0;
+}
+
+/**
+ * @brief
+ * 		resume_stat_requests - serve the next slice of each job or node
+ *		status request which is being served in slices, see
+ *		defer_stat_jobs() and defer_stat_nodes().  Called once per pass
+ *		of the main loop, between the passes other requests are read
+ *		and served.
+ *
+ * @return	int
+ * @retval	1	: some requests are not done yet, call again soon
+ * @retval	0	: no request is pending
+ */
+
+int
+resume_stat_requests(void)
+{
+	struct stat_pending  *psp;
+	struct stat_pending  *nxt;
+	struct batch_request *preq;
+	int		      rc;
+
+	if (!stat_pending_init)
+		return 0;
+
+	for (psp = (struct stat_pending *)GET_NEXT(stat_pending_list); psp; psp = nxt) {
+		nxt = (struct stat_pending *)GET_NEXT(psp->sp_link);
+		preq = psp->sp_preq;
+
+		if (preq->rq_conn >= 0) {
+			/* the privilege may have been changed by requests served since */
+			resc_access_perm = preq->rq_perm;
+			if (psp->sp_objtype == MGR_OBJ_JOB)
+				rc = stat_jobs_slice(psp);
+			else
+				rc = stat_nodes_slice(psp);
+
+			if (rc == PBSE_NONE && psp->sp_left > 0) {
+				if (preq->rq_reply.brp_count == 0 ||
+					(rc = reply_send_status_part(preq)) == PBSE_NONE)
+					continue;
+			}
+
+			if (psp->sp_objtype == MGR_OBJ_JOB) {
+				if (rc != PBSE_NONE)
+					req_reject(rc, bad, preq);
+				else
+					reply_send(preq);
+			} else
+				reply_stat_node(preq, rc);
+		} else
+			free_br(preq); /* client has gone away */
+
+		delete_link(&psp->sp_link);
+		free(psp->sp_names);
+		free(psp);
+	}
+
+	return (GET_NEXT(stat_pending_list) != NULL);
+}
@@ -48,12 +48,18 @@
  * Included funtions are:
  *	svrcached()
  *	status_attrib()
+ *	stcache_note_modified()
+ *	stcache_attrs()
+ *	stcache_attrs_match()
+ *	stcache_slot()
+ *	free_job_stcache()
  *	status_job()
  *	status_subjob()
  *
  */
 #include <sys/types.h>
 #include <stdlib.h>
+#include <string.h>
 #include "libpbs.h"
 #include <ctype.h>
 #include <time.h>
@@ -227,6 +233,147 @@ status_attrib(svrattrl *pal, void *pidx, attribute_def *padef, attribute *pattr,
 	return (0);
 }
 
+/**
+ * @brief
+ * 		stcache_note_modified - drop the cached svrattrl of each job attribute
+ *		modified since it was last encoded, as svrcached() would, and if
+ *		there were any bump the job's status version so that its encoded
+ *		status is no longer used.
+ *
+ * @param[in,out]	pjob	-	job to check
+ */
+static void
+stcache_note_modified(job *pjob)
+{
+	int i;
+	int modified = 0;
+
+	for (i = 0; i < (int)JOB_ATR_LAST; i++) {
+		if (pjob->ji_wattr[i].at_flags & ATR_VFLAG_MODCACHE) {
+			free_svrcache(&pjob->ji_wattr[i]);
+			pjob->ji_wattr[i].at_flags &= ~ATR_VFLAG_MODCACHE;
+			modified = 1;
+		}
+	}
+	if (modified)
+		pjob->ji_stversion++;
+}
+
+/**
+ * @brief
+ * 		stcache_attrs - make the key for a list of requested attributes,
+ *		each name followed by a comma
+ *
+ * @param[in]	pal	-	specific attributes to status
+ *
+ * @return	char *
+ * @retval	!NULL	: malloc-ed key
+ * @retval	NULL	: memory allocation error
+ */
+static char *
+stcache_attrs(svrattrl *pal)
+{
+	svrattrl *p;
+	size_t len = 1;
+	char *key;
+	char *pc;
+
+	for (p = pal; p; p = (svrattrl *)GET_NEXT(p->al_link))
+		len += strlen(p->al_name) + 1;
+	if ((key = malloc(len)) == NULL)
+		return NULL;
+	pc = key;
+	for (p = pal; p; p = (svrattrl *)GET_NEXT(p->al_link)) {
+		len = strlen(p->al_name);
+		memcpy(pc, p->al_name, len);
+		pc += len;
+		*pc++ = ',';
+	}
+	*pc = '\0';
+	return key;
+}
+
+/**
+ * @brief
+ * 		stcache_attrs_match - does a list of requested attributes match a
+ *		key made by stcache_attrs()
+ *
+ * @param[in]	key	-	key of a cached status
+ * @param[in]	pal	-	specific attributes to status
+ *
+ * @return	int
+ * @retval	1	: the same attributes, in the same order
+ * @retval	0	: otherwise
+ */
+static int
+stcache_attrs_match(char *key, svrattrl *pal)
+{
+	size_t len;
+
+	for (; pal; pal = (svrattrl *)GET_NEXT(pal->al_link)) {
+		len = strlen(pal->al_name);
+		if ((strncmp(key, pal->al_name, len) != 0) || (key[len] != ','))
+			return 0;
+		key += len + 1;
+	}
+	return (*key == '\0');
+}
+
+/**
+ * @brief
+ * 		stcache_slot - find the slot of a job's encoded status for a list
+ *		of requested attributes.  If no slot holds the list, an unused
+ *		list slot or else the one sent least recently is returned, to be
+ *		encoded over.
+ *
+ * @param[in]	pjob	-	job being statused
+ * @param[in]	pal	-	specific attributes to status, or NULL for all
+ *
+ * @return	struct job_stcache *
+ */
+static struct job_stcache *
+stcache_slot(job *pjob, svrattrl *pal)
+{
+	struct job_stcache *psc;
+	struct job_stcache *pfree = NULL;
+	struct job_stcache *pold = NULL;
+	int i;
+
+	if (pal == NULL)
+		return &pjob->ji_stcache[JOB_STCACHE_ALL];
+
+	for (i = JOB_STCACHE_LIST; i < JOB_STCACHE_SLOTS; i++) {
+		psc = &pjob->ji_stcache[i];
+		if (psc->jsc_attrs == NULL) {
+			if (pfree == NULL)
+				pfree = psc;
+		} else if (stcache_attrs_match(psc->jsc_attrs, pal))
+			return psc;
+		else if ((pold == NULL) || (psc->jsc_used < pold->jsc_used))
+			pold = psc;
+	}
+	return (pfree ? pfree : pold);
+}
+
+/**
+ * @brief
+ * 		free_job_stcache - release the encoded status kept for a job
+ *
+ * @param[in,out]	pjob	-	job being freed
+ */
+void
+free_job_stcache(job *pjob)
+{
+	int i;
+
+	for (i = 0; i < JOB_STCACHE_SLOTS; i++) {
+		free_brp_cache(pjob->ji_stcache[i].jsc_enc);
+		pjob->ji_stcache[i].jsc_enc = NULL;
+		free(pjob->ji_stcache[i].jsc_attrs);
+		pjob->ji_stcache[i].jsc_attrs = NULL;
+	}
+}
+
 /**
  * @brief
  * 		status_job - Build the status reply for a single job, regular or Array,
@@ -243,15 +390,29 @@ status_attrib(svrattrl *pal, void *pidx, attribute_def *padef, attribute *pattr,
  * @retval	PBSE_PERM	: client is not authorized to status the job
  * @retval	PBSE_SYSTEM	: memory allocation error
  * @retval	PBSE_NOATTR	: attribute error
+ *
+ * @par
+ *		For a remote client, the job as encoded for the reply is kept in
+ *		ji_stcache[] and sent as is to the next client with the same
+ *		privilege asking for the same attributes, until an attribute of
+ *		the job or show_hidden_attribs or eligible_time_enable changes.
+ *		There is a slot for all attributes and JOB_STCACHE_SLOTS - 1 for
+ *		attribute lists; with more lists in use than that, the one sent
+ *		least recently is dropped.  A job whose eligible_time is computed
+ *		on the fly is always encoded afresh.
  */
 
 int
 status_job(job *pjob, struct batch_request *preq, svrattrl *pal, pbs_list_head *pstathd, int *bad)
 {
 	struct brp_status *pstat;
+	struct job_stcache *psc = NULL;
 	long oldtime = 0;
 	int old_elig_flags = 0;
 	int old_atyp_flags = 0;
+	int perm;
+	long hidden;
+	long elig;
 
 	/* see if the client is authorized to status this job */
 
@@ -265,6 +426,57 @@ status_job(job *pjob, struct batch_request *preq, svrattrl *pal, pbs_list_head *
 		update_array_indices_remaining_attr(pjob);
 	}
 
+	stcache_note_modified(pjob);
+
+	perm = preq->rq_perm & (ATR_DFLAG_RDACC | ATR_DFLAG_SvWR);
+	hidden = server.sv_attr[(int)SVR_ATR_show_hidden_attribs].at_val.at_long;
+	/* decides whether eligible_time and accrue_type are shown */
+	elig = server.sv_attr[(int)SVR_ATR_EligibleTimeEnable].at_val.at_long;
+	if ((preq->rq_conn >= 0) && (preq->rq_conn != PBS_LOCAL_CONNECTION) &&
+		!((elig == TRUE) &&
+		(pjob->ji_wattr[JOB_ATR_accrue_type].at_val.at_long == JOB_ELIGIBLE))) {
+		psc = stcache_slot(pjob, pal);
+		if ((psc->jsc_enc != NULL) && (psc->jsc_enc->bc_len > 0) &&
+			(psc->jsc_version == pjob->ji_stversion) &&
+			(psc->jsc_perm == perm) && (psc->jsc_hidden == hidden) &&
+			(psc->jsc_elig == elig) &&
+			((pal == NULL) || stcache_attrs_match(psc->jsc_attrs, pal))) {
+			/* unchanged since last encoded, send that */
+			pstat = (struct brp_status *)malloc(sizeof(struct brp_status));
+			if (pstat == NULL)
+				return (PBSE_SYSTEM);
+			CLEAR_LINK(pstat->brp_stlink);
+			pstat->brp_objtype = MGR_OBJ_JOB;
+			(void)strcpy(pstat->brp_objname, pjob->ji_qs.ji_jobid);
+			CLEAR_HEAD(pstat->brp_attr);
+			pstat->brp_cache = psc->jsc_enc;
+			psc->jsc_enc->bc_refct++;
+			psc->jsc_used = time_now;
+			append_link(pstathd, &pstat->brp_stlink, pstat);
+			preq->rq_reply.brp_count++;
+			*bad = 0;
+			return (0);
+		}
+
+		/* start the slot over, the encoder fills it in when the reply goes out */
+		free_brp_cache(psc->jsc_enc);
+		free(psc->jsc_attrs);
+		psc->jsc_attrs = NULL;
+		psc->jsc_enc = (struct brp_cache *)calloc(1, sizeof(struct brp_cache));
+		if ((psc->jsc_enc == NULL) || ((pal != NULL) && ((psc->jsc_attrs = stcache_attrs(pal)) == NULL))) {
+			free(psc->jsc_enc);
+			psc->jsc_enc = NULL;
+			psc = NULL;
+		} else {
+			psc->jsc_enc->bc_refct = 1;
+			psc->jsc_version = pjob->ji_stversion;
+			psc->jsc_perm = perm;
+			psc->jsc_hidden = hidden;
+			psc->jsc_elig = elig;
+			psc->jsc_used = time_now;
+		}
+	}
+
 	/* calc eligible time on the fly and return, don't save. */
 	if (server.sv_attr[SVR_ATR_EligibleTimeEnable].at_val.at_long == TRUE) {
 		if (pjob->ji_wattr[JOB_ATR_accrue_type].at_val.at_long == JOB_ELIGIBLE) {
@@ -299,6 +511,7 @@ status_job(job *pjob, struct batch_request *preq, svrattrl *pal, pbs_list_head *
 	pstat->brp_objtype = MGR_OBJ_JOB;
 	(void)strcpy(pstat->brp_objname, pjob->ji_qs.ji_jobid);
 	CLEAR_HEAD(pstat->brp_attr);
+	pstat->brp_cache = NULL;
 	append_link(pstathd, &pstat->brp_stlink, pstat);
 	preq->rq_reply.brp_count++;
 
@@ -308,6 +521,11 @@ status_job(job *pjob, struct batch_request *preq, svrattrl *pal, pbs_list_head *
 	if (status_attrib(pal, job_attr_idx, job_attr_def, pjob->ji_wattr, JOB_ATR_LAST, preq->rq_perm, &pstat->brp_attr, bad))
 		return (PBSE_NOATTR);
 
+	if (psc != NULL) {
+		pstat->brp_cache = psc->jsc_enc;
+		psc->jsc_enc->bc_refct++;
+	}
+
 	/* reset eligible time, it was calctd on the fly, real calctn only when accrue_type changes */
 
 	if (server.sv_attr[(int)SVR_ATR_EligibleTimeEnable].at_val.at_long != 0) {
@@ -390,6 +608,7 @@ status_subjob(job *pjob, struct batch_request *preq, svrattrl *pal, int subj, pb
 	pstat->brp_objtype = MGR_OBJ_JOB;
 	(void)strcpy(pstat->brp_objname, mk_subjob_id(pjob, subj));
 	CLEAR_HEAD(pstat->brp_attr);
+	pstat->brp_cache = NULL;
 	append_link(pstathd, &pstat->brp_stlink, pstat);
 	preq->rq_reply.brp_count++;
 
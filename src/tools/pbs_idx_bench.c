@@ -0,0 +1,355 @@
+/*
+ * Copyright (C) 1994-2020 Altair Engineering, Inc.
+ * For more information, contact Altair at www.altair.com.
+ *
+ * This file is part of both the OpenPBS software ("OpenPBS")
+ * and the PBS Professional ("PBS Pro") software.
+ *
+ * Open Source License Information:
+ *
+ * OpenPBS is free software. You can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * OpenPBS is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Affero General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Commercial License Information:
+ *
+ * PBS Pro is commercially licensed software that shares a common core with
+ * the OpenPBS software.  For a copy of the commercial license terms and
+ * conditions, go to: (http://www.pbspro.com/agreement.html) or contact the
+ * Altair Legal Department.
+ *
+ * Altair's dual-license business model allows companies, individuals, and
+ * organizations to create proprietary derivative works of OpenPBS and
+ * distribute them - whether embedded or bundled with other software -
+ * under a commercial license agreement.
+ *
+ * Use of Altair's trademarks, including but not limited to "PBS™",
+ * "OpenPBS®", "PBS Professional®", and "PBS Pro™" and Altair's logos is
+ * subject to Altair's trademark licensing policies.
+ */
+
+/**
+ * @file    pbs_idx_bench.c
+ *
+ * @brief
+ * 		pbs_idx_bench.c - Compare the pbs_idx index with the AVL tree
+ *		it replaced, on job id like keys.
+ *		Not installed, build it with "make pbs_idx_bench".
+ *
+ * Functions included are:
+ * 	main()
+ * 	elapsed()
+ * 	avl_insert()
+ * 	avl_find()
+ * 	avl_iterate()
+ * 	avl_delete()
+ * 	idx_iterate()
+ * 	report()
+ */
+
+#include <pbs_config.h> /* the master config generated by configure */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "avltree.h"
+#include "pbs_idx.h"
+
+#define BENCH_DEF_KEYS 100000
+#define BENCH_KEYLEN   32
+
+/**
+ * @brief
+ * 		return the seconds passed since a given time
+ *
+ * @param[in]	start	-	start time
+ *
+ * @return	double
+ */
+static double
+elapsed(struct timespec *start)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+/**
+ * @brief
+ * 		insert a key in an AVL tree, the way pbs_idx_insert() used to
+ *
+ * @param[in]	tree	-	AVL tree
+ * @param[in]	key	-	key
+ * @param[in]	data	-	data of key
+ *
+ * @return	int
+ * @retval	0	: success
+ * @retval	1	: failure
+ */
+static int
+avl_insert(AVL_IX_DESC *tree, char *key, void *data)
+{
+	AVL_IX_REC *pkey;
+	int rc;
+
+	if ((pkey = avlkey_create(tree, key)) == NULL)
+		return 1;
+	pkey->recptr = data;
+	rc = avl_add_key(pkey, tree) != AVL_IX_OK;
+	free(pkey);
+	return rc;
+}
+
+/**
+ * @brief
+ * 		find a key in an AVL tree, the way pbs_idx_find() used to
+ *
+ * @param[in]	tree	-	AVL tree
+ * @param[in]	key	-	key
+ *
+ * @return	void *
+ * @retval	data of key, NULL if not found
+ */
+static void *
+avl_find(AVL_IX_DESC *tree, char *key)
+{
+	AVL_IX_REC *pkey;
+	void *data = NULL;
+
+	if ((pkey = avlkey_create(tree, key)) == NULL)
+		return NULL;
+	if (avl_find_key(pkey, tree) == AVL_IX_OK)
+		data = pkey->recptr;
+	free(pkey);
+	return data;
+}
+
+/**
+ * @brief
+ * 		walk an AVL tree in key order
+ *
+ * @param[in]	tree	-	AVL tree
+ *
+ * @return	int
+ * @retval	number of entries walked
+ */
+static int
+avl_iterate(AVL_IX_DESC *tree)
+{
+	AVL_IX_REC *pkey;
+	int n = 0;
+
+	if ((pkey = avlkey_create(tree, NULL)) == NULL)
+		return 0;
+	avl_first_key(tree);
+	while (avl_next_key(pkey, tree) == AVL_IX_OK)
+		n++;
+	free(pkey);
+	return n;
+}
+
+/**
+ * @brief
+ * 		delete a key from an AVL tree, the way pbs_idx_delete() used to
+ *
+ * @param[in]	tree	-	AVL tree
+ * @param[in]	key	-	key
+ *
+ * @return	void
+ */
+static void
+avl_delete(AVL_IX_DESC *tree, char *key)
+{
+	AVL_IX_REC *pkey;
+
+	if ((pkey = avlkey_create(tree, key)) == NULL)
+		return;
+	avl_delete_key(pkey, tree);
+	free(pkey);
+}
+
+/**
+ * @brief
+ * 		walk a pbs_idx index in key order
+ *
+ * @param[in]	idx	-	index
+ *
+ * @return	int
+ * @retval	number of entries walked
+ */
+static int
+idx_iterate(void *idx)
+{
+	void *ctx = NULL;
+	void *data;
+	int n = 0;
+
+	while (pbs_idx_find(idx, NULL, &data, &ctx) == PBS_IDX_RET_OK)
+		n++;
+	pbs_idx_free_ctx(ctx);
+	return n;
+}
+
+/**
+ * @brief
+ * 		print the rates of one operation for both indexes
+ *
+ * @param[in]	op	-	name of operation
+ * @param[in]	nops	-	operations done
+ * @param[in]	t_avl	-	seconds taken by the AVL tree
+ * @param[in]	t_idx	-	seconds taken by pbs_idx
+ *
+ * @return	void
+ */
+static void
+report(char *op, int nops, double t_avl, double t_idx)
+{
+	printf("%-10s %14.0f %14.0f %8.2fx\n", op,
+	       t_avl > 0 ? nops / t_avl : 0,
+	       t_idx > 0 ? nops / t_idx : 0,
+	       t_idx > 0 ? t_avl / t_idx : 0);
+}
+
+/**
+ * @brief
+ * 		main	-	The main function of pbs_idx_bench
+ *
+ * @param[in]	argc	-	argument count
+ * @param[in]	argv	-	argument variables.
+ *
+ * @return	int
+ * @retval	0	: success
+ * @retval	1	: failure
+ */
+int
+main(int argc, char *argv[])
+{
+	AVL_IX_DESC tree;
+	void *idx;
+	void *data;
+	void *pkey;
+	char *keys;
+	char miss[BENCH_KEYLEN];
+	struct timespec start;
+	double t_avl;
+	double t_idx;
+	int nkeys = BENCH_DEF_KEYS;
+	int err = 0;
+	int i;
+	int c;
+
+	while ((c = getopt(argc, argv, "n:")) != EOF) {
+		switch (c) {
+			case 'n':
+				nkeys = atoi(optarg);
+				break;
+			default:
+				err = 1;
+		}
+	}
+	if (err || nkeys <= 0) {
+		fprintf(stderr, "Usage: %s [-n number_of_keys]\n", argv[0]);
+		return 1;
+	}
+
+	if ((keys = malloc((size_t) nkeys * BENCH_KEYLEN)) == NULL) {
+		fprintf(stderr, "Out of memory\n");
+		return 1;
+	}
+	/* job ids, inserted in a scrambled order */
+	for (i = 0; i < nkeys; i++)
+		snprintf(keys + (size_t) i * BENCH_KEYLEN, BENCH_KEYLEN, "%d.pbsserver",
+			 (int) (((long long) i * 7919) % nkeys));
+
+	avl_create_index(&tree, 0, 0);
+	if ((idx = pbs_idx_create(0, 0)) == NULL) {
+		fprintf(stderr, "Out of memory\n");
+		return 1;
+	}
+
+	printf("%d keys\n%-10s %14s %14s %9s\n", nkeys, "op/sec", "avltree", "pbs_idx", "speedup");
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < nkeys; i++)
+		avl_insert(&tree, keys + (size_t) i * BENCH_KEYLEN, keys + (size_t) i * BENCH_KEYLEN);
+	t_avl = elapsed(&start);
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < nkeys; i++)
+		pbs_idx_insert(idx, keys + (size_t) i * BENCH_KEYLEN, keys + (size_t) i * BENCH_KEYLEN);
+	t_idx = elapsed(&start);
+	report("insert", nkeys, t_avl, t_idx);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < nkeys; i++) {
+		if (avl_find(&tree, keys + (size_t) i * BENCH_KEYLEN) == NULL)
+			err = 1;
+	}
+	t_avl = elapsed(&start);
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < nkeys; i++) {
+		pkey = keys + (size_t) i * BENCH_KEYLEN;
+		if (pbs_idx_find(idx, &pkey, &data, NULL) != PBS_IDX_RET_OK)
+			err = 1;
+	}
+	t_idx = elapsed(&start);
+	report("find", nkeys, t_avl, t_idx);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < nkeys; i++) {
+		snprintf(miss, sizeof(miss), "%d.pbsserver", nkeys + i);
+		if (avl_find(&tree, miss) != NULL)
+			err = 1;
+	}
+	t_avl = elapsed(&start);
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < nkeys; i++) {
+		snprintf(miss, sizeof(miss), "%d.pbsserver", nkeys + i);
+		pkey = miss;
+		if (pbs_idx_find(idx, &pkey, &data, NULL) == PBS_IDX_RET_OK)
+			err = 1;
+	}
+	t_idx = elapsed(&start);
+	report("miss", nkeys, t_avl, t_idx);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	if (avl_iterate(&tree) != nkeys)
+		err = 1;
+	t_avl = elapsed(&start);
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	if (idx_iterate(idx) != nkeys)
+		err = 1;
+	t_idx = elapsed(&start);
+	report("iterate", nkeys, t_avl, t_idx);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < nkeys; i++)
+		avl_delete(&tree, keys + (size_t) i * BENCH_KEYLEN);
+	t_avl = elapsed(&start);
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < nkeys; i++)
+		pbs_idx_delete(idx, keys + (size_t) i * BENCH_KEYLEN);
+	t_idx = elapsed(&start);
+	report("delete", nkeys, t_avl, t_idx);
+
+	avl_destroy_index(&tree);
+	pbs_idx_destroy(idx);
+	free(keys);
+
+	if (err) {
+		fprintf(stderr, "Index results differ from the keys inserted\n");
+		return 1;
+	}
+	return 0;
+}
@@ -95,6 +95,38 @@ class TestEquivClass(TestFunctional):
         self.scheduler.log_match("Number of job equivalence classes: 2",
                                  starttime=self.t)
 
+    @skipOnCpuSet
+    def test_class_membership(self):
+        """
+        Test that the scheduler logs how many jobs are in the
+        equivalence classes
+        """
+        self.server.manager(MGR_CMD_SET, SERVER,
+                            {'scheduling': 'False'})
+
+        # Eat up all the resources
+        a = {'Resource_List.select': '1:ncpus=8'}
+        J = Job(TEST_USER, attrs=a)
+        self.server.submit(J)
+
+        self.submit_jobs(3, a)
+
+        a = {'Resource_List.select': '1:ncpus=4'}
+        self.submit_jobs(3, a)
+
+        a = {'Resource_List.select': '1:ncpus=2'}
+        self.submit_jobs(1, a)
+
+        self.server.manager(MGR_CMD_SET, SERVER,
+                            {'scheduling': 'True'})
+
+        self.scheduler.log_match("Number of job equivalence classes: 3",
+                                 starttime=self.t)
+        self.scheduler.log_match("Job equivalence classes: 8 jobs, "
+                                 "largest class 4 jobs, "
+                                 "1 single job classes",
+                                 starttime=self.t)
+
     @skipOnCpuSet
     def test_select(self):
         """
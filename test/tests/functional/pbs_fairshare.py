@@ -38,6 +38,8 @@
 # subject to Altair's trademark licensing policies.
 
 
+import struct
+
 from tests.functional import *
 
 
@@ -414,3 +416,108 @@ class TestFairshare(TestFunctional):
         jorder = [j.split('.')[0] for j in jorder]
         msg = 'Jobs ran out of order'
         self.assertEqual(jorder, c.political_order, msg)
+
+    def usage_file_path(self):
+        """
+        Return the path of the scheduler's usage file
+        """
+        if 'sched_priv' in self.scheduler.attributes:
+            priv = self.scheduler.attributes['sched_priv']
+        else:
+            priv = os.path.join(self.server.pbs_conf['PBS_HOME'],
+                                'sched_priv')
+        return os.path.join(priv, 'usage')
+
+    def test_usage_file_checksum(self):
+        """
+        Test that the usage file is replaced atomically and that a usage
+        file which fails its checksum is not loaded
+        """
+        self.scheduler.add_to_resource_group(TEST_USER, 11, 'root', 10)
+        self.scheduler.set_sched_config({'fair_share': 'True'})
+        self.scheduler.set_fairshare_usage(TEST_USER, 100)
+
+        fs = self.scheduler.query_fairshare(name=str(TEST_USER))
+        self.assertEqual(fs.usage, 100)
+
+        usage_file = self.usage_file_path()
+        self.assertFalse(self.du.isfile(self.scheduler.hostname,
+                                        path=usage_file + '.new',
+                                        sudo=True))
+
+        # Grow the file by a byte so it no longer matches its header
+        cmd = ['truncate', '-s', '+1', usage_file]
+        ret = self.du.run_cmd(self.scheduler.hostname, cmd, sudo=True)
+        self.assertEqual(ret['rc'], 0)
+
+        fs = self.scheduler.query_fairshare(name=str(TEST_USER))
+        self.assertEqual(fs.usage, 1)
+
+    def test_usage_journal_damaged_record(self):
+        """
+        Test that a damaged record in the middle of the usage journal is
+        cut off on replay, so usage recovered before it and records
+        appended after it survive a scheduler restart
+        """
+        def checksum(buf):
+            # 32 bit FNV-1a, as computed by the scheduler
+            s = 2166136261
+            for b in bytearray(buf):
+                s = ((s ^ b) * 16777619) & 0xffffffff
+            return s
+
+        def record(usage, damaged=False):
+            grp = struct.pack('=50s6xd', str(TEST_USER).encode(), usage)
+            ck = checksum(grp)
+            if damaged:
+                ck ^= 1
+            return grp + struct.pack('=I4x', ck)
+
+        self.scheduler.add_to_resource_group(TEST_USER, 11, 'root', 10)
+        self.scheduler.set_sched_config({'fair_share': 'True'})
+        self.scheduler.set_fairshare_usage(TEST_USER, 100)
+        self.scheduler.stop()
+
+        usage_file = self.usage_file_path()
+        journal = usage_file + '.journal'
+
+        # the journal applies to the generation of the usage file, which
+        # follows the group_node_header and last_decay in its header
+        cmd = ['od', '-An', '-tu4', '-j', '32', '-N', '4', usage_file]
+        ret = self.du.run_cmd(self.scheduler.hostname, cmd, sudo=True)
+        self.assertEqual(ret['rc'], 0)
+        gen = int(ret['out'][0].strip())
+
+        head = struct.pack('=9s7xd', b'PBS_MAG!', 3) + struct.pack('=I', gen)
+        recs = [record(10), record(20, damaged=True), record(40)]
+
+        def write_journal(data):
+            fn = self.du.create_temp_file()
+            with open(fn, 'wb') as f:
+                f.write(data)
+            self.du.run_copy(self.scheduler.hostname, src=fn, dest=journal,
+                             sudo=True)
+            self.du.rm(path=fn)
+
+        def journal_size():
+            cmd = ['stat', '-c', '%s', journal]
+            ret = self.du.run_cmd(self.scheduler.hostname, cmd, sudo=True)
+            self.assertEqual(ret['rc'], 0)
+            return int(ret['out'][0].strip())
+
+        write_journal(head + b''.join(recs))
+
+        # usage is recovered up to the damaged record, where the journal
+        # is truncated
+        fs = self.scheduler.query_fairshare(name=str(TEST_USER))
+        self.assertEqual(fs.usage, 110)
+        self.assertEqual(journal_size(), len(head) + len(recs[0]))
+
+        # a record appended to the truncated journal is replayed
+        write_journal(head + recs[0] + record(5))
+        self.scheduler.start()
+        fs = self.scheduler.query_fairshare(name=str(TEST_USER))
+        self.assertEqual(fs.usage, 115)
+        self.scheduler.restart()
+        fs = self.scheduler.query_fairshare(name=str(TEST_USER))
+        self.assertEqual(fs.usage, 115)
@@ -0,0 +1,72 @@
+# coding: utf-8
+
+# Copyright (C) 1994-2020 Altair Engineering, Inc.
+# For more information, contact Altair at www.altair.com.
+#
+# This file is part of both the OpenPBS software ("OpenPBS")
+# and the PBS Professional ("PBS Pro") software.
+#
+# Open Source License Information:
+#
+# OpenPBS is free software. You can redistribute it and/or modify it under
+# the terms of the GNU Affero General Public License as published by the
+# Free Software Foundation, either version 3 of the License, or (at your
+# option) any later version.
+#
+# OpenPBS is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+# FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Affero General Public
+# License for more details.
+#
+# You should have received a copy of the GNU Affero General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+# Commercial License Information:
+#
+# PBS Pro is commercially licensed software that shares a common core with
+# the OpenPBS software.  For a copy of the commercial license terms and
+# conditions, go to: (http://www.pbspro.com/agreement.html) or contact the
+# Altair Legal Department.
+#
+# Altair's dual-license business model allows companies, individuals, and
+# organizations to create proprietary derivative works of OpenPBS and
+# distribute them - whether embedded or bundled with other software -
+# under a commercial license agreement.
+#
+# Use of Altair's trademarks, including but not limited to "PBS™",
+# "OpenPBS®", "PBS Professional®", and "PBS Pro™" and Altair's logos is
+# subject to Altair's trademark licensing policies.
+
+from tests.functional import *
+
+
+class TestJobSaveBatch(TestFunctional):
+    """
+    Tests for batching the job saves made while serving a request
+    """
+
+    def test_job_save_stats(self):
+        """
+        Test that job saves made by a request are committed as a batch
+        and counted in the server's job_save_stats attribute
+        """
+        def save_stats():
+            st = self.server.status(SERVER, ATTR_job_save_stats)
+            self.assertIn(ATTR_job_save_stats, st[0])
+            return dict((k, int(v)) for k, v in
+                        (f.split(':') for f in
+                         st[0][ATTR_job_save_stats].split()))
+
+        a = {"scheduling": "False"}
+        self.server.manager(MGR_CMD_SET, SCHED, a, id="default")
+        jid = self.server.submit(Job())
+        before = save_stats()
+
+        self.server.alterjob(jid, {ATTR_N: "renamed"})
+        self.server.expect(JOB, {ATTR_N: "renamed"}, id=jid)
+        after = save_stats()
+        self.assertGreater(after["batches"], before["batches"])
+        self.assertGreater(after["jobs"], before["jobs"])
+        self.assertGreaterEqual(after["max_queue_depth"], 1)
+        self.assertGreaterEqual(after["total_commit_usec"],
+                                before["total_commit_usec"])
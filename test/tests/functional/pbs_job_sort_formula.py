@@ -73,3 +73,51 @@ class TestJobSortFormula(TestFunctional):
             self.assertEqual(job.split('.')[0], c.political_order[i])
 
         self.server.expect(JOB, {'job_state=R': 2})
+
+    def test_job_sort_formula_operators(self):
+        """
+        Test that formulas evaluate with Python's operator semantics,
+        both for formulas the scheduler evaluates natively and for ones
+        which need the Python interpreter
+        """
+        self.server.manager(MGR_CMD_CREATE, RSC, {'type': 'float'}, id='foo')
+        self.server.manager(MGR_CMD_SET, SERVER, {'scheduling': 'False'})
+        j = Job(TEST_USER, attrs={'Resource_List.foo': 3})
+        jid = self.server.submit(j)
+
+        formulas = [('-foo**2 + 7 // 2 + -7 % 3', '-4'),
+                    ('(foo + 1) / 8', '0.5'),
+                    ('foo / 0', '0'),
+                    ('max(foo, 5)', '5')]
+        for formula, value in formulas:
+            a = {'job_sort_formula': formula}
+            self.server.manager(MGR_CMD_SET, SERVER, a, runas=ROOT_USER)
+            t = time.time()
+            self.scheduler.run_scheduling_cycle()
+            self.scheduler.log_match('%s;Formula Evaluation = %s' %
+                                     (jid, value), starttime=t)
+
+    def test_job_sort_formula_ties(self):
+        """
+        Test that jobs with the same formula value are ordered by
+        job_sort_key and then by submission order
+        """
+        a = {'resources_available.ncpus': 8}
+        self.server.manager(MGR_CMD_SET, NODE, a, self.mom.shortname)
+        self.server.manager(MGR_CMD_CREATE, RSC, {'type': 'float'}, id='foo')
+        self.scheduler.set_sched_config({'job_sort_key': '"ncpus HIGH"'})
+
+        a = {'job_sort_formula': 'foo', 'scheduling': 'False'}
+        self.server.manager(MGR_CMD_SET, SERVER, a, runas=ROOT_USER)
+
+        jids = []
+        for foo, ncpus in [(1, 1), (2, 1), (1, 2), (1, 1)]:
+            a = {'Resource_List.foo': foo, 'Resource_List.ncpus': ncpus}
+            jids.append(self.server.submit(Job(TEST_USER, attrs=a)))
+
+        self.scheduler.run_scheduling_cycle()
+
+        c = self.scheduler.cycles(lastN=1)[0]
+        job_order = [jids[1], jids[2], jids[0], jids[3]]
+        for i, job in enumerate(job_order):
+            self.assertEqual(job.split('.')[0], c.political_order[i])
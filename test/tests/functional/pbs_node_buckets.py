@@ -878,6 +878,53 @@ class TestNodeBuckets(TestFunctional):
         for node in n1:
             self.assertTrue(node not in n2, 'Jobs share nodes: ' + node)
 
+    @skipOnCpuSet
+    def test_bucket_multi_word_grab(self):
+        """
+        Test that chunks taking nodes across many bitmap words of a bucket
+        get distinct nodes of the right bucket, and that once the bucket is
+        used up no more nodes are handed out from it
+        """
+        self.server.manager(MGR_CMD_SET, SERVER, {'scheduling': 'False'})
+
+        # 130 nodes span three 64 bit words, 1300 the rest of the bucket
+        chunk1 = '130:ncpus=1:color=yellow'
+        chunk2 = '1300:ncpus=1:color=yellow'
+        a = {'Resource_List.select': chunk1,
+             'Resource_List.place': 'scatter:excl'}
+        j1 = Job(TEST_USER, attrs=a)
+        jid1 = self.server.submit(j1)
+        a['Resource_List.select'] = chunk2
+        j2 = Job(TEST_USER, attrs=a)
+        jid2 = self.server.submit(j2)
+        a['Resource_List.select'] = '1:ncpus=1:color=yellow'
+        j3 = Job(TEST_USER, attrs=a)
+        jid3 = self.server.submit(j3)
+
+        self.server.manager(MGR_CMD_SET, SERVER, {'scheduling': 'True'})
+
+        self.server.expect(JOB, {'job_state': 'R'}, id=jid1)
+        self.server.expect(JOB, {'job_state': 'R'}, id=jid2)
+        a = {'comment': (MATCH_RE, '^Not Running'), 'job_state': 'Q'}
+        self.server.expect(JOB, a, attrop=PTL_AND, id=jid3)
+        self.scheduler.log_match(jid1 + ';Chunk: ' + chunk1, n=10000)
+        self.scheduler.log_match(jid2 + ';Chunk: ' + chunk2, n=10000)
+
+        s1 = self.server.status(JOB, 'exec_vnode', id=jid1)
+        s2 = self.server.status(JOB, 'exec_vnode', id=jid2)
+        n1 = j1.get_vnodes(s1[0]['exec_vnode'])
+        n2 = j2.get_vnodes(s2[0]['exec_vnode'])
+
+        msg = 'job did not run on correct number of nodes'
+        self.assertEqual(len(set(n1)), 130, msg)
+        self.assertEqual(len(set(n2)), 1300, msg)
+
+        # yellow is the third color, vnode[2860] to vnode[4289]
+        yellow = set('vnode[%d]' % i for i in range(2860, 4290))
+        self.assertTrue(set(n1).isdisjoint(n2), 'Jobs share nodes')
+        self.assertEqual(set(n1) | set(n2), yellow,
+                         'Jobs did not get the yellow nodes')
+
     @skipOnCpuSet
     def test_queue_nodes(self):
         """
@@ -775,3 +775,31 @@ exit 3
         jid2 = self.server.submit(j2)
 
         self.server.expect(JOB, {'state': 'R'}, id=jid2)
+
+    @skipOnCpuSet
+    def test_preempt_index_candidates(self):
+        """
+        Test that running jobs which can never be preempted for a
+        high priority job are left out of the preemption candidates
+        """
+        a = {'resources_available.ncpus': 3}
+        self.server.manager(MGR_CMD_SET, NODE, a, id=self.mom.shortname)
+
+        j1 = Job(TEST_USER)
+        jid1 = self.server.submit(j1)
+        j2 = Job(TEST_USER, {ATTR_q: 'expressq'})
+        jid2 = self.server.submit(j2)
+        j3 = Job(TEST_USER)
+        jid3 = self.server.submit(j3)
+        for jid in [jid1, jid2, jid3]:
+            self.server.expect(JOB, {ATTR_state: 'R'}, id=jid)
+
+        # only the two normal jobs can be preempted for another express job
+        t = time.time()
+        j4 = Job(TEST_USER, {ATTR_q: 'expressq'})
+        jid4 = self.server.submit(j4)
+        self.server.expect(JOB, {ATTR_state: 'R'}, id=jid4)
+        self.server.expect(JOB, {ATTR_state: 'R'}, id=jid2)
+        self.scheduler.log_match(
+            jid4 + ";Preemption index: 2 of 3 running jobs are candidates",
+            starttime=t)
@@ -155,3 +155,106 @@ class TestQstat(TestFunctional):
                             % re.escape(self.mom.shortname),
                             qstat_out), None, "The exec host does not"
                             " contain the task slot number")
+
+    def test_qstat_after_qalter(self):
+        """
+        Test that repeated status of an unchanged job gives the same
+        output, and that a change to the job shows in the next status,
+        both for all attributes and for a specific list of attributes
+        """
+        self.server.manager(MGR_CMD_SET, SERVER, {'scheduling': 'False'})
+        j = Job(TEST_USER, {ATTR_N: 'before'})
+        jid = self.server.submit(j)
+        qstat_cmd = os.path.join(self.server.pbs_conf['PBS_EXEC'],
+                                 'bin', 'qstat')
+        qstat_f = [qstat_cmd, '-f', jid]
+        out = []
+        for _ in range(2):
+            ret = self.du.run_cmd(self.server.hostname, cmd=qstat_f)
+            self.assertEqual(ret['rc'], 0,
+                             'Qstat returned with non-zero exit status')
+            out.append('\n'.join(ret['out']))
+        self.assertEqual(out[0], out[1])
+        self.assertIn('Job_Name = before', out[1])
+        self.server.expect(JOB, {ATTR_N: 'before'}, id=jid)
+
+        self.server.alterjob(jid, {ATTR_N: 'after'})
+        ret = self.du.run_cmd(self.server.hostname, cmd=qstat_f)
+        self.assertEqual(ret['rc'], 0,
+                         'Qstat returned with non-zero exit status')
+        qstat_out = '\n'.join(ret['out'])
+        self.assertIn('Job_Name = after', qstat_out)
+        self.assertNotIn('Job_Name = before', qstat_out)
+        self.server.expect(JOB, {ATTR_N: 'after'}, id=jid)
+
+        self.server.manager(MGR_CMD_SET, SERVER, {'scheduling': 'True'})
+        self.server.expect(JOB, {'job_state': 'R'}, id=jid)
+        ret = self.du.run_cmd(self.server.hostname, cmd=qstat_f)
+        self.assertEqual(ret['rc'], 0,
+                         'Qstat returned with non-zero exit status')
+        self.assertIn('job_state = R', '\n'.join(ret['out']))
+
+    def test_qstat_after_qrls(self):
+        """
+        Test that an attribute which is cleared rather than set, here the
+        comment freed when the last hold is released, disappears from the
+        next qstat -f of the job
+        """
+        self.server.manager(MGR_CMD_SET, SERVER, {'scheduling': 'False'})
+        j = Job(TEST_USER, {ATTR_h: None})
+        jid = self.server.submit(j)
+        self.server.alterjob(jid, {ATTR_comment: 'held for test'},
+                             runas=ROOT_USER)
+        qstat_cmd = os.path.join(self.server.pbs_conf['PBS_EXEC'],
+                                 'bin', 'qstat')
+        qstat_f = [qstat_cmd, '-f', jid]
+        for _ in range(2):
+            ret = self.du.run_cmd(self.server.hostname, cmd=qstat_f)
+            self.assertEqual(ret['rc'], 0,
+                             'Qstat returned with non-zero exit status')
+            qstat_out = '\n'.join(ret['out'])
+            self.assertIn('comment = held for test', qstat_out)
+            self.assertIn('Hold_Types = u', qstat_out)
+
+        self.server.rlsjob(jid, USER_HOLD)
+        ret = self.du.run_cmd(self.server.hostname, cmd=qstat_f)
+        self.assertEqual(ret['rc'], 0,
+                         'Qstat returned with non-zero exit status')
+        qstat_out = '\n'.join(ret['out'])
+        self.assertNotIn('comment = held for test', qstat_out)
+        self.assertIn('Hold_Types = n', qstat_out)
+        self.server.expect(JOB, 'comment', op=UNSET, id=jid)
+
+    def test_qstat_after_eligible_time_toggle(self):
+        """
+        Test that eligible_time and accrue_type appear in and disappear
+        from qstat -f of a job as eligible_time_enable is turned on and off
+        """
+        self.server.manager(MGR_CMD_SET, SERVER,
+                            {'scheduling': 'False',
+                             'eligible_time_enable': 'False'})
+        j = Job(TEST_USER, {ATTR_h: None})
+        jid = self.server.submit(j)
+        qstat_cmd = os.path.join(self.server.pbs_conf['PBS_EXEC'],
+                                 'bin', 'qstat')
+        qstat_f = [qstat_cmd, '-f', jid]
+
+        def check_qstat(shown):
+            for _ in range(2):
+                ret = self.du.run_cmd(self.server.hostname, cmd=qstat_f)
+                self.assertEqual(ret['rc'], 0,
+                                 'Qstat returned with non-zero exit status')
+                qstat_out = '\n'.join(ret['out'])
+                for a in ['eligible_time = ', 'accrue_type = ']:
+                    if shown:
+                        self.assertIn(a, qstat_out)
+                    else:
+                        self.assertNotIn(a, qstat_out)
+
+        check_qstat(False)
+        self.server.manager(MGR_CMD_SET, SERVER,
+                            {'eligible_time_enable': 'True'})
+        check_qstat(True)
+        self.server.manager(MGR_CMD_SET, SERVER,
+                            {'eligible_time_enable': 'False'})
+        check_qstat(False)
@@ -82,6 +82,8 @@ class TestSchedAttrUpdates(TestFunctional):
         self.server.expect(JOB, "comment", op=UNSET, id=jid6)
         self.server.log_match("Type 96 request received", existence=False,
                               starttime=t, max_attempts=5)
+        self.server.log_match("Type 98 request received", existence=False,
+                              starttime=t, max_attempts=5)
 
         self.logger.info("Sleep for 45s for the attr_update_period to pass")
         time.sleep(45)
@@ -94,7 +96,7 @@ class TestSchedAttrUpdates(TestFunctional):
         # Verify that scheduler sent attr updates for all new jobs
         self.server.expect(JOB, "comment", op=SET, id=jid7)
         self.server.expect(JOB, "comment", op=SET, id=jid8)
-        self.server.log_match("Type 96 request received", starttime=t)
+        self.server.log_match("Type 98 request received", starttime=t)
 
     @skipOnCpuSet
     def test_accrue_type(self):
@@ -139,3 +141,35 @@ class TestSchedAttrUpdates(TestFunctional):
         self.server.expect(JOB, "comment", op=SET, id=jid3, max_attempts=1)
         self.server.expect(JOB, {"accrue_type": "1"}, id=jid3, max_attempts=1)
         self.server.expect(JOB, {"accrue_type": "1"}, id=jid2, max_attempts=1)
+
+    @skipOnCpuSet
+    def test_batched_updates(self):
+        """
+        Test that the attribute updates of a cycle are sent to the server
+        in a single request
+        """
+        self.server.manager(MGR_CMD_SET, NODE,
+                            {"resources_available.ncpus": 1},
+                            id=self.mom.shortname)
+        self.server.manager(MGR_CMD_SET, SERVER, {"log_events": 2047})
+
+        a = {"scheduling": "False"}
+        self.server.manager(MGR_CMD_SET, SCHED, a, id="default")
+
+        j = Job()
+        j.set_sleep_time(1000)
+        jid1 = self.server.submit(j)
+        jids = [self.server.submit(Job()) for _ in range(5)]
+
+        t = time.time()
+        self.scheduler.run_scheduling_cycle()
+        self.server.expect(JOB, {"job_state": "R"}, id=jid1)
+        for jid in jids:
+            self.server.expect(JOB, "comment", op=SET, id=jid)
+        self.server.log_match("Type 98 request received", starttime=t)
+        self.server.log_match("Type 96 request received", existence=False,
+                              starttime=t, max_attempts=5)
+        self.server.log_match(r"Modify jobs request: \d+ jobs",
+                              regexp=True, starttime=t)
+        self.server.log_match(r"Saved \d+ jobs for \d+ save requests",
+                              regexp=True, starttime=t)
@@ -0,0 +1,95 @@
+# coding: utf-8
+
+# Copyright (C) 1994-2020 Altair Engineering, Inc.
+# For more information, contact Altair at www.altair.com.
+#
+# This file is part of both the OpenPBS software ("OpenPBS")
+# and the PBS Professional ("PBS Pro") software.
+#
+# Open Source License Information:
+#
+# OpenPBS is free software. You can redistribute it and/or modify it under
+# the terms of the GNU Affero General Public License as published by the
+# Free Software Foundation, either version 3 of the License, or (at your
+# option) any later version.
+#
+# OpenPBS is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+# FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Affero General Public
+# License for more details.
+#
+# You should have received a copy of the GNU Affero General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+# Commercial License Information:
+#
+# PBS Pro is commercially licensed software that shares a common core with
+# the OpenPBS software.  For a copy of the commercial license terms and
+# conditions, go to: (http://www.pbspro.com/agreement.html) or contact the
+# Altair Legal Department.
+#
+# Altair's dual-license business model allows companies, individuals, and
+# organizations to create proprietary derivative works of OpenPBS and
+# distribute them - whether embedded or bundled with other software -
+# under a commercial license agreement.
+#
+
+
+from tests.functional import *
+
+
+class TestSchedCycleProfile(TestFunctional):
+    """
+    Test the scheduler's per-cycle phase profile summary
+    """
+
+    def setUp(self):
+        TestFunctional.setUp(self)
+        a = {'resources_available.ncpus': 1}
+        self.server.manager(MGR_CMD_SET, NODE, a, self.mom.shortname)
+        self.server.manager(MGR_CMD_SET, SERVER, {'scheduling': 'False'})
+
+    def read_profile(self):
+        """
+        Read the cycle_profile file from sched_priv and return the last
+        cycle's phases as a dictionary of phase name to attributes
+        """
+        if 'sched_priv' in self.scheduler.attributes:
+            priv = self.scheduler.attributes['sched_priv']
+        else:
+            priv = os.path.join(self.server.pbs_conf['PBS_HOME'],
+                                'sched_priv')
+        fname = os.path.join(priv, 'cycle_profile')
+        ret = self.du.cat(self.scheduler.hostname, fname, sudo=True)
+        self.assertEqual(ret['rc'], 0, 'cycle_profile was not written')
+        phases = {}
+        for line in ret['out']:
+            fields = dict(f.split('=', 1) for f in line.split())
+            if 'cycle' in fields:
+                phases[fields['phase']] = fields
+        return phases
+
+    def test_cycle_profile_written(self):
+        """
+        Run a cycle which runs one job and adds another to the calendar.
+        Make sure the profile has the cycle and counts the phases used.
+        """
+        self.server.manager(MGR_CMD_SET, SERVER, {'backfill_depth': 1})
+        j1 = Job(TEST_USER)
+        jid1 = self.server.submit(j1)
+        j2 = Job(TEST_USER)
+        jid2 = self.server.submit(j2)
+
+        self.scheduler.run_scheduling_cycle()
+        self.server.expect(JOB, {'job_state': 'R'}, id=jid1)
+        self.server.expect(JOB, {'job_state': 'Q'}, id=jid2)
+
+        phases = self.read_profile()
+        for p in ['cycle', 'query_server', 'sort_jobs', 'is_ok_to_run',
+                  'check_nodes', 'add_job_to_calendar', 'run_job']:
+            self.assertIn(p, phases)
+        self.assertEqual(int(phases['query_server']['calls']), 1)
+        self.assertEqual(int(phases['is_ok_to_run']['calls']), 2)
+        self.assertEqual(int(phases['run_job']['calls']), 1)
+        self.assertEqual(int(phases['add_job_to_calendar']['calls']), 1)
+        self.assertGreater(float(phases['cycle']['wall']), 0)
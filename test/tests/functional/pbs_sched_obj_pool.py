@@ -0,0 +1,84 @@
+# coding: utf-8
+
+# Copyright (C) 1994-2020 Altair Engineering, Inc.
+# For more information, contact Altair at www.altair.com.
+#
+# This file is part of both the OpenPBS software ("OpenPBS")
+# and the PBS Professional ("PBS Pro") software.
+#
+# Open Source License Information:
+#
+# OpenPBS is free software. You can redistribute it and/or modify it under
+# the terms of the GNU Affero General Public License as published by the
+# Free Software Foundation, either version 3 of the License, or (at your
+# option) any later version.
+#
+# OpenPBS is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+# FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Affero General Public
+# License for more details.
+#
+# You should have received a copy of the GNU Affero General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+# Commercial License Information:
+#
+# PBS Pro is commercially licensed software that shares a common core with
+# the OpenPBS software.  For a copy of the commercial license terms and
+# conditions, go to: (http://www.pbspro.com/agreement.html) or contact the
+# Altair Legal Department.
+#
+# Altair's dual-license business model allows companies, individuals, and
+# organizations to create proprietary derivative works of OpenPBS and
+# distribute them - whether embedded or bundled with other software -
+# under a commercial license agreement.
+#
+
+
+from tests.functional import *
+
+
+class TestSchedObjPool(TestFunctional):
+    """
+    Test the scheduler's per-thread object pools
+    """
+
+    def setUp(self):
+        TestFunctional.setUp(self)
+        self.server.manager(MGR_CMD_SET, SERVER, {'scheduling': 'False'})
+
+    def test_object_pool_reuse_and_teardown(self):
+        """
+        Test that objects freed in one cycle are reused by the next one,
+        and that the scheduler's worker threads release their object
+        pools and exit cleanly when the scheduler stops
+        """
+        self.du.set_pbs_config(self.scheduler.hostname,
+                               confs={'PBS_SCHED_THREADS': 4})
+        self.scheduler.restart()
+        self.server.manager(MGR_CMD_SET, SCHED, {'log_events': 2047},
+                            id='default')
+        a = {'resources_available.ncpus': 2}
+        self.server.create_vnodes('vn', a, 16, self.mom)
+        for _ in range(20):
+            self.server.submit(Job(TEST_USER))
+
+        regex = r'Object pools: (\d+) allocated, (\d+) reused, (\d+) free'
+        self.scheduler.run_scheduling_cycle()
+        t = time.time()
+        self.scheduler.run_scheduling_cycle()
+        _, line = self.scheduler.log_match(regex, regexp=True, starttime=t)
+        m = re.search(regex, line)
+        self.assertGreater(int(m.group(1)), 0)
+        self.assertGreater(int(m.group(2)), 0)
+
+        # stopping the scheduler joins the worker threads, which frees
+        # their pools
+        t = time.time()
+        self.scheduler.stop()
+        self.scheduler.log_match('Killing worker threads', starttime=t)
+        self.assertFalse(self.scheduler.isUp())
+
+        self.du.unset_pbs_config(self.scheduler.hostname,
+                                 confs=['PBS_SCHED_THREADS'])
+        self.scheduler.start()
@@ -365,7 +365,7 @@ e.accept()"""
         self.server.expect(JOB, {"job_state": "Q"}, id=jid4)
         a = {"comment": (MATCH_RE, "no walltime specified")}
         self.server.expect(JOB, a, id=jid4)
-        self.server.log_match("Type 96 request", starttime=t1, max_attempts=5)
+        self.server.log_match("Type 98 request", starttime=t1, max_attempts=5)
 
     def test_runhook_reject_comment_server(self):
         """
@@ -393,3 +393,82 @@ e.accept()"""
         self.server.expect(JOB, a, id=jid)
         self.server.log_match("Type 96 request", starttime=t1, max_attempts=5,
                               existence=False)
+        self.server.log_match("Type 98 request", starttime=t1, max_attempts=5,
+                              existence=False)
+
+    def test_runjob_pipeline(self):
+        """
+        Test that with runjob_pipeline_depth set, the scheduler keeps
+        sending run requests without waiting for each runjob hook ack,
+        and reconciles jobs whose run requests were rejected
+        """
+        self.server.manager(MGR_CMD_SET, NODE,
+                            {"resources_available.ncpus": 4},
+                            id=self.mom.shortname)
+        a = {"scheduling": "False", "job_run_wait": "runjob_hook",
+             "log_events": 2047}
+        self.server.manager(MGR_CMD_SET, SCHED, a, id="default")
+        self.scheduler.set_sched_config({'runjob_pipeline_depth': '2'})
+
+        jids = []
+        for _ in range(4):
+            jids.append(self.server.submit(Job()))
+
+        hook_txt = """
+import pbs
+
+if pbs.event().job.id == '%s':
+    pbs.event().reject("rejecting second job")
+pbs.event().accept()
+"""
+        hk_attrs = {'event': 'runjob', 'enabled': 'True'}
+        self.server.create_import_hook('rj', hk_attrs, hook_txt % jids[1])
+
+        t = time.time()
+        self.scheduler.run_scheduling_cycle()
+        for jid in [jids[0], jids[2], jids[3]]:
+            self.server.expect(JOB, {'job_state': 'R'}, id=jid)
+        self.server.expect(JOB, {'job_state': 'Q'}, id=jids[1])
+        a = {"comment": (MATCH_RE, "rejecting second job")}
+        self.server.expect(JOB, a, id=jids[1])
+        self.scheduler.log_match("Pipelined 4 run requests, 1 failed",
+                                 starttime=t)
+
+    def test_runjob_pipeline_reject_frees_resources(self):
+        """
+        Test that when a pipelined run request is rejected, the resources
+        the scheduler gave the job are returned in the same cycle
+        """
+        self.server.manager(MGR_CMD_SET, NODE,
+                            {"resources_available.ncpus": 2},
+                            id=self.mom.shortname)
+        a = {"scheduling": "False", "job_run_wait": "runjob_hook",
+             "log_events": 2047}
+        self.server.manager(MGR_CMD_SET, SCHED, a, id="default")
+        self.scheduler.set_sched_config({'runjob_pipeline_depth': '1'})
+
+        jids = []
+        for _ in range(3):
+            jids.append(self.server.submit(Job()))
+
+        hook_txt = """
+import pbs
+
+if pbs.event().job.id == '%s':
+    pbs.event().reject("rejecting first job")
+pbs.event().accept()
+"""
+        hk_attrs = {'event': 'runjob', 'enabled': 'True'}
+        self.server.create_import_hook('rj', hk_attrs, hook_txt % jids[0])
+
+        # The reply rejecting the first job is read when the second job's
+        # request is sent, so its ncpus are free again for the third job
+        t = time.time()
+        self.scheduler.run_scheduling_cycle()
+        for jid in jids[1:]:
+            self.server.expect(JOB, {'job_state': 'R'}, id=jid)
+        self.server.expect(JOB, {'job_state': 'Q'}, id=jids[0])
+        a = {"comment": (MATCH_RE, "rejecting first job")}
+        self.server.expect(JOB, a, id=jids[0])
+        self.scheduler.log_match("Pipelined 3 run requests, 1 failed",
+                                 starttime=t)
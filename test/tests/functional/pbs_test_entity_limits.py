@@ -1098,3 +1098,36 @@ class TestEntityLimits(TestFunctional):
         self.server.expect(JOB, {'job_state': 'R'}, id=jid2)
         self.server.expect(JOB, {'job_state': 'S'}, id=jid1)
         self.server.expect(JOB, {'job_state': 'Q'}, id=jid4)
+
+    def test_server_res_and_queue_run_limits(self):
+        """
+        Test that with a server resource limit and a queue run limit set,
+        the scheduler enforces both of them and nothing else
+        """
+        a = {'resources_available.ncpus': 8}
+        self.server.manager(MGR_CMD_SET, NODE, a, self.mom.shortname)
+        self.server.manager(MGR_CMD_SET, SERVER,
+                            {'max_run_res.ncpus': '[u:PBS_GENERIC=3]'})
+        qname = self.server.default_queue
+        self.server.manager(MGR_CMD_SET, QUEUE,
+                            {'max_run': '[o:PBS_ALL=2]'}, id=qname)
+        self.server.manager(MGR_CMD_SET, SERVER, {'scheduling': 'False'})
+
+        attr = {'Resource_List.select': '1:ncpus=1'}
+        jids = []
+        for _ in range(4):
+            j = Job(TEST_USER, attrs=attr)
+            jids.append(self.server.submit(j))
+        self.server.manager(MGR_CMD_SET, SERVER, {'scheduling': 'True'})
+        self.server.expect(JOB, {'job_state': 'R'}, id=jids[0])
+        self.server.expect(JOB, {'job_state': 'R'}, id=jids[1])
+        msg = 'Not Running: Queue %s job limit has been reached.' % qname
+        self.server.expect(JOB, {'job_state': 'Q', 'comment': msg},
+                           id=jids[2])
+
+        # Without the queue limit, the server resource limit applies
+        self.server.manager(MGR_CMD_UNSET, QUEUE, 'max_run', id=qname)
+        self.server.expect(JOB, {'job_state': 'R'}, id=jids[2])
+        msg = 'Not Running: Server per-user limit reached on resource ncpus'
+        self.server.expect(JOB, {'job_state': 'Q', 'comment': msg},
+                           id=jids[3])
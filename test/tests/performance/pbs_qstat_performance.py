@@ -152,3 +152,60 @@ class TestQstatPerformance(TestPerformance):
         Submit 1000 job and compute performace of qstat
         """
         self.submit_and_stat_jobs(1000)
+
+    @timeout(1800)
+    def test_qsub_during_large_qstat(self):
+        """
+        Submit a job while full qstats of many jobs are being served and
+        check the submission is not held up until a qstat is done, and
+        that qstat still reports every job
+        """
+        num_jobs = 10000
+        self.server.manager(MGR_CMD_SET, SERVER, {'scheduling': 'False'})
+        self.submit_jobs(TEST_USER1, num_jobs)
+
+        bindir = os.path.join(self.server.client_conf['PBS_EXEC'], 'bin')
+        qstat = os.path.join(bindir, 'qstat')
+        qsub = os.path.join(bindir, 'qsub')
+
+        # time one qstat -f on its own to compare the qsub latency with
+        ret = self.du.run_cmd(self.server.hostname,
+                              cmd=self.time_command + ' -f "qstat %e" ' +
+                              qstat + ' -f > /dev/null',
+                              as_script=True, runas=TEST_USER1,
+                              logerr=False)
+        self.assertEqual(ret['rc'], 0)
+        single = None
+        for line in ret['err']:
+            fields = line.split()
+            if len(fields) == 2 and fields[0] == 'qstat':
+                single = float(fields[1])
+        self.assertIsNotNone(single)
+        self.perf_test_result(single, "elapse_time single qstat -f", "sec")
+
+        script = (self.time_command + ' -f "qstat %e" sh -c \'for i in 1 2 3'
+                  ' 4 5; do ' + qstat + ' -f > /dev/null; done\' &\n'
+                  'sleep 1\n' +
+                  self.time_command + ' -f "qsub %e" ' + qsub +
+                  ' -- /bin/true > /dev/null\n'
+                  'wait\n')
+        ret = self.du.run_cmd(self.server.hostname, cmd=script,
+                              as_script=True, runas=TEST_USER1,
+                              logerr=False)
+        self.assertEqual(ret['rc'], 0)
+        times = {}
+        for line in ret['err']:
+            fields = line.split()
+            if len(fields) == 2 and fields[0] in ('qstat', 'qsub'):
+                times[fields[0]] = float(fields[1])
+        self.assertIn('qstat', times)
+        self.assertIn('qsub', times)
+        self.perf_test_result(times['qstat'], "elapse_time 5 qstat -f", "sec")
+        self.perf_test_result(times['qsub'], "qsub_latency_during_qstat",
+                              "sec")
+        # a qsub which waited for a whole qstat -f to be served would take
+        # at least as long as one qstat -f run on its own
+        self.assertLess(times['qsub'], single / 2)
+
+        jobs = self.server.status(JOB)
+        self.assertEqual(len(jobs), num_jobs + 1)
@@ -359,3 +359,118 @@ class TestSchedPerf(TestPerformance):
         self.logger.info("##################################################")
         m = "sched cycle time"
         self.perf_test_result([cycle1_time, cycle2_time], m, "sec")
+
+    @timeout(3600)
+    def test_queued_job_cache_perf(self):
+        """
+        Time cycles over a large number of unchanging queued jobs.
+        The first cycle parses every job; later cycles reuse the jobs
+        cached by the scheduler and should be faster.
+        """
+        self.common_setup1()
+        num_jobs = 20000
+        num_cycles = 4
+        a = {'Resource_List.select': '1:ncpus=1:color=red',
+             'Resource_List.place': 'excl'}
+        # Fill up the red nodes so the rest of the jobs stay queued
+        self.submit_jobs(a, 1430, wt_start=3600)
+        self.run_cycle()
+        self.server.expect(JOB, {'job_state=R': 1430},
+                           trigger_sched_cycle=False, interval=5,
+                           max_attempts=240)
+        self.submit_jobs(a, num_jobs, wt_start=3600)
+
+        times = []
+        for _ in range(num_cycles):
+            times.append(self.run_cycle())
+
+        m = 'Time taken to consider %d queued jobs' % num_jobs
+        self.logger.info('#' * 80)
+        for i in range(num_cycles):
+            self.logger.info('[%d] %s: %.2f' % (i, m, times[i]))
+        self.logger.info('#' * 80)
+        self.perf_test_result(times, m, "sec")
+        self.assertLess(min(times[1:]), times[0])
+
+    @timeout(7200)
+    def test_running_job_lookup_scaling(self):
+        """
+        Measure how the cycle time grows with the number of running jobs.
+        Every running job is looked up by name when the scheduler collects
+        the jobs on each node and parses each exec_vnode.  With name indexes
+        the cycle time should grow roughly linearly with the job count.
+        """
+        self.common_setup1()
+        a = {'Resource_List.select': '1:ncpus=1'}
+        sizes = [2000, 8000]
+        times = []
+        total = 0
+        for num_jobs in sizes:
+            self.submit_jobs(a, num_jobs - total, wt_start=3600)
+            total = num_jobs
+            self.run_cycle()
+            self.server.expect(JOB, {'job_state=R': total},
+                               trigger_sched_cycle=False, interval=5,
+                               max_attempts=240)
+            # Time a cycle which only has to query the running jobs
+            times.append(self.run_cycle())
+
+        self.logger.info('#' * 80)
+        for n, t in zip(sizes, times):
+            self.logger.info('Cycle time with %d running jobs: %.2f' % (n, t))
+        self.logger.info('#' * 80)
+        m = 'Cycle time with running jobs'
+        self.perf_test_result(times, m, "sec")
+
+    @timeout(14400)
+    def test_sched_thread_scaling(self):
+        """
+        Benchmark each of the scheduler's multi-threaded task types
+        (querying/duplicating/freeing nodes and jobs, and node eligibility)
+        with 1 to 64 scheduler threads.  The per task timings are taken
+        from the scheduler's DEBUG3 log messages.
+        """
+        self.common_setup1()
+        self.server.manager(MGR_CMD_SET, SCHED, {'log_events': 2047})
+        self.server.manager(MGR_CMD_SET, SERVER, {'backfill_depth': 5})
+        self.scheduler.set_sched_config({'strict_ordering': 'True ALL'})
+        a = {'Resource_List.select': '1:ncpus=1'}
+        self.submit_jobs(a, 10010, wt_start=3600)
+        self.run_cycle()
+        self.server.expect(JOB, {'job_state=R': 10010},
+                           trigger_sched_cycle=False, interval=5,
+                           max_attempts=240)
+        # These jobs can't run and will be added to the calendar,
+        # which duplicates the server's nodes and jobs
+        a = {'Resource_List.select': '2:ncpus=1'}
+        self.submit_jobs(a, 5000, wt_start=3600)
+
+        regex = r'run_parallel_task;(\w+)\(\): (\d+) items in ' \
+            r'(\d+) ranges took ([\d.]+) seconds'
+        results = {}
+        for nthreads in [1, 2, 4, 8, 16, 32, 64]:
+            self.du.set_pbs_config(confs={'PBS_SCHED_THREADS': nthreads})
+            self.scheduler.restart()
+            st = time.time()
+            cycle_time = self.run_cycle()
+            lines = self.scheduler.log_match(regex, regexp=True,
+                                             allmatch=True, starttime=st,
+                                             n='ALL')
+            totals = {'cycle': cycle_time}
+            for _, line in lines:
+                m = re.search(regex, line)
+                if m is None:
+                    continue
+                func = m.group(1)
+                totals[func] = totals.get(func, 0) + float(m.group(4))
+            results[nthreads] = totals
+
+        self.logger.info('#' * 80)
+        for nthreads in sorted(results):
+            for func in sorted(results[nthreads]):
+                self.logger.info('[%d threads] %s: %.3f' %
+                                 (nthreads, func, results[nthreads][func]))
+        self.logger.info('#' * 80)
+        m = 'Cycle time with 1 to 64 scheduler threads'
+        self.perf_test_result([results[n]['cycle'] for n in sorted(results)],
+                              m, "sec")